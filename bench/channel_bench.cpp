@@ -0,0 +1,65 @@
+// bench/channel_bench.cpp
+// 通道在竞争下的开销：互斥锁版 Channel 与无锁环形队列版 BoundedChannel / SpscChannel
+#include "threadpool/channel.hpp"
+#include <benchmark/benchmark.h>
+#include <memory>
+
+using namespace threadpool;
+
+namespace {
+
+constexpr size_t kCapacity = 1024;
+
+// 每个基准一份共享通道：线程 0 在循环前创建、循环后销毁，
+// 循环的开始和结束处所有线程各同步一次
+template <typename C> std::unique_ptr<C> &shared_channel() {
+  static std::unique_ptr<C> channel;
+  return channel;
+}
+
+// 每个线程先发送再接收：所有线程同时争用两端
+template <typename C> void BM_SendRecv(benchmark::State &state) {
+  auto &channel = shared_channel<C>();
+  if (state.thread_index() == 0) {
+    channel = std::make_unique<C>(kCapacity);
+  }
+  for (auto _ : state) {
+    channel->send(1);
+    benchmark::DoNotOptimize(channel->recv());
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    channel.reset();
+  }
+}
+BENCHMARK_TEMPLATE(BM_SendRecv, Channel<int>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SendRecv, BoundedChannel<int>)->ThreadRange(1, 8)->UseRealTime();
+
+// 偶数线程只发送、奇数线程只接收；各线程迭代次数相同，收发总数相等
+template <typename C> void BM_ProducerConsumer(benchmark::State &state) {
+  auto &channel = shared_channel<C>();
+  if (state.thread_index() == 0) {
+    channel = std::make_unique<C>(kCapacity);
+  }
+  const bool producer = state.thread_index() % 2 == 0;
+  for (auto _ : state) {
+    if (producer) {
+      channel->send(1);
+    } else {
+      benchmark::DoNotOptimize(channel->recv());
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    channel.reset();
+  }
+}
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, Channel<int>)->Threads(2)->Threads(4)->Threads(8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, BoundedChannel<int>)
+    ->Threads(2)
+    ->Threads(4)
+    ->Threads(8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, SpscChannel<int>)->Threads(2)->UseRealTime();
+
+} // namespace
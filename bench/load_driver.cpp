@@ -0,0 +1,428 @@
+// bench/load_driver.cpp
+// 端到端负载驱动：若干线程各自用 epoll 驱动一组 keep-alive 连接，每个连接收到完整响应后
+// 立刻发送下一个请求（闭环），统计 RPS 与延迟分位，结果以 JSON 输出便于长期跟踪。
+// 不给 --port 时在进程内启动一个 Server 作为被测对象。
+//
+//   load_driver [--host 127.0.0.1] [--port N] [--path /] [--connections 64] [--threads 4]
+//               [--duration 10] [--warmup 1] [--reactors 2] [--json out.json]
+//
+// 只支持 IPv4 地址与带 Content-Length 的响应
+#include "http/server.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+  std::string host = "127.0.0.1";
+  std::optional<uint16_t> port; // 为空时启动进程内服务器
+  std::string path = "/";
+  size_t connections = 64;
+  size_t threads = 4;
+  double duration = 10;
+  double warmup = 1;
+  size_t reactors = 2;
+  std::string json; // 为空时写到标准输出
+};
+
+// 参数错误时返回 nullopt
+std::optional<Options> parse_options(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view flag = argv[i];
+    if (i + 1 >= argc) {
+      return std::nullopt;
+    }
+    const std::string value = argv[++i];
+    try {
+      if (flag == "--host") {
+        options.host = value;
+      } else if (flag == "--port") {
+        options.port = static_cast<uint16_t>(std::stoul(value));
+      } else if (flag == "--path") {
+        options.path = value;
+      } else if (flag == "--connections") {
+        options.connections = std::max<size_t>(1, std::stoul(value));
+      } else if (flag == "--threads") {
+        options.threads = std::max<size_t>(1, std::stoul(value));
+      } else if (flag == "--duration") {
+        options.duration = std::stod(value);
+      } else if (flag == "--warmup") {
+        options.warmup = std::stod(value);
+      } else if (flag == "--reactors") {
+        options.reactors = std::max<size_t>(1, std::stoul(value));
+      } else if (flag == "--json") {
+        options.json = value;
+      } else {
+        return std::nullopt;
+      }
+    } catch (const std::exception &) {
+      return std::nullopt;
+    }
+  }
+  options.threads = std::min(options.threads, options.connections);
+  return options;
+}
+
+struct Stats {
+  std::vector<int64_t> latencies_ns; // 只含测量窗口内完成的请求
+  uint64_t non_2xx = 0;
+  uint64_t errors = 0; // 连接失败、对端提前关闭或无法解析的响应
+};
+
+class Client {
+  struct Connection {
+    int fd = -1;
+    std::string in;
+    size_t sent = 0;
+    Clock::time_point started;
+  };
+
+  const Options &options_;
+  sockaddr_in addr_{};
+  std::string request_;
+  int epoll_fd_;
+  std::vector<Connection> connections_;
+  Stats stats_;
+
+public:
+  Client(const Options &options, uint16_t port, size_t connections)
+      : options_(options), epoll_fd_(::epoll_create1(EPOLL_CLOEXEC)), connections_(connections) {
+    addr_.sin_family = AF_INET;
+    addr_.sin_port = htons(port);
+    ::inet_pton(AF_INET, options.host.c_str(), &addr_.sin_addr);
+    request_ = "GET " + options.path + " HTTP/1.1\r\nHost: " + options.host +
+               "\r\nUser-Agent: load_driver\r\n\r\n";
+  }
+
+  Client(const Client &) = delete;
+  Client &operator=(const Client &) = delete;
+
+  ~Client() {
+    for (auto &conn : connections_) {
+      close(conn);
+    }
+    ::close(epoll_fd_);
+  }
+
+  // 运行到 end；measure_from 之前完成的请求不计入延迟
+  Stats run(Clock::time_point measure_from, Clock::time_point end) {
+    for (size_t i = 0; i < connections_.size(); ++i) {
+      open(i);
+    }
+    std::vector<epoll_event> events(connections_.size());
+    while (Clock::now() < end) {
+      const int n = ::epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), 10);
+      for (int e = 0; e < n; ++e) {
+        const auto index = static_cast<size_t>(events[e].data.u64);
+        if (events[e].events & EPOLLOUT) {
+          send_pending(index);
+        }
+        if (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+          receive(index, measure_from);
+        }
+      }
+    }
+    return std::move(stats_);
+  }
+
+private:
+  void open(size_t index) {
+    auto &conn = connections_[index];
+    close(conn);
+    conn.fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (conn.fd < 0 ||
+        ::connect(conn.fd, reinterpret_cast<const sockaddr *>(&addr_), sizeof(addr_)) != 0) {
+      ++stats_.errors;
+      close(conn);
+      return;
+    }
+    const int one = 1;
+    ::setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    http::server::set_nonblocking(conn.fd);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = index;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, conn.fd, &event);
+    start_request(index);
+  }
+
+  static void close(Connection &conn) {
+    if (conn.fd >= 0) {
+      ::close(conn.fd);
+    }
+    conn.fd = -1;
+    conn.in.clear();
+    conn.sent = 0;
+  }
+
+  void start_request(size_t index) {
+    auto &conn = connections_[index];
+    conn.sent = 0;
+    conn.started = Clock::now();
+    send_pending(index);
+  }
+
+  // 请求通常一次写完；写不完时等 EPOLLOUT
+  void send_pending(size_t index) {
+    auto &conn = connections_[index];
+    while (conn.fd >= 0 && conn.sent < request_.size()) {
+      const auto n = ::send(conn.fd, request_.data() + conn.sent, request_.size() - conn.sent,
+                            MSG_NOSIGNAL);
+      if (n > 0) {
+        conn.sent += static_cast<size_t>(n);
+        continue;
+      }
+      if (n < 0 && errno == EAGAIN) {
+        watch(conn, index, EPOLLIN | EPOLLOUT);
+        return;
+      }
+      fail(index);
+      return;
+    }
+    watch(conn, index, EPOLLIN);
+  }
+
+  void watch(const Connection &conn, size_t index, uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = index;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &event);
+  }
+
+  void receive(size_t index, Clock::time_point measure_from) {
+    auto &conn = connections_[index];
+    char buf[16 * 1024];
+    while (conn.fd >= 0) {
+      const auto n = ::recv(conn.fd, buf, sizeof(buf), 0);
+      if (n > 0) {
+        conn.in.append(buf, static_cast<size_t>(n));
+        continue;
+      }
+      if (n < 0 && errno == EAGAIN) {
+        break;
+      }
+      fail(index); // 对端关闭或出错：请求还没有完整的响应
+      return;
+    }
+    while (conn.fd >= 0) {
+      const auto response = parse_response(conn.in);
+      if (!response) {
+        return; // 还不完整
+      }
+      if (response->length == 0) {
+        fail(index);
+        return;
+      }
+      const auto now = Clock::now();
+      if (conn.started >= measure_from) {
+        stats_.latencies_ns.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - conn.started).count());
+        if (response->status < 200 || response->status >= 300) {
+          ++stats_.non_2xx;
+        }
+      }
+      conn.in.erase(0, response->length);
+      if (response->close) {
+        open(index);
+      } else {
+        start_request(index);
+      }
+    }
+  }
+
+  void fail(size_t index) {
+    ++stats_.errors;
+    open(index);
+  }
+
+  struct Response {
+    int status = 0;
+    size_t length = 0; // 整个响应的字节数；0 表示无法解析
+    bool close = false;
+  };
+
+  // 响应尚不完整时返回 nullopt
+  static std::optional<Response> parse_response(std::string_view in) {
+    const auto head_end = in.find("\r\n\r\n");
+    if (head_end == std::string_view::npos) {
+      return std::nullopt;
+    }
+    Response response;
+    const auto head = in.substr(0, head_end + 2);
+    if (head.size() < 12 || !head.starts_with("HTTP/1.")) {
+      return response;
+    }
+    response.status = std::atoi(std::string(head.substr(9, 3)).c_str());
+    std::optional<size_t> content_length;
+    for (size_t line = head.find("\r\n") + 2; line < head.size();) {
+      const auto end = head.find("\r\n", line);
+      const auto field = head.substr(line, end - line);
+      const auto colon = field.find(':');
+      if (colon != std::string_view::npos) {
+        const auto name = field.substr(0, colon);
+        auto value = field.substr(colon + 1);
+        value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+        if (http::parser::iequals(name, "Content-Length")) {
+          content_length = std::strtoull(std::string(value).c_str(), nullptr, 10);
+        } else if (http::parser::iequals(name, "Connection") &&
+                   http::parser::iequals(value, "close")) {
+          response.close = true;
+        }
+      }
+      line = end + 2;
+    }
+    if (!content_length) {
+      return response; // chunked 或读到关闭为止的响应不支持
+    }
+    const size_t total = head_end + 4 + *content_length;
+    if (in.size() < total) {
+      return std::nullopt;
+    }
+    response.length = total;
+    return response;
+  }
+};
+
+double percentile(const std::vector<int64_t> &sorted, double q) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  const auto rank = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+  return static_cast<double>(sorted[rank]) / 1000.0;
+}
+
+std::string to_json(const Options &options, uint16_t port, bool in_process, const Stats &stats,
+                    double seconds) {
+  const auto &lat = stats.latencies_ns;
+  double mean = 0;
+  for (const auto ns : lat) {
+    mean += static_cast<double>(ns);
+  }
+  mean = lat.empty() ? 0 : mean / static_cast<double>(lat.size()) / 1000.0;
+
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1);
+  out << "{\n"
+      << "  \"target\": \"" << options.host << ':' << port << options.path << "\",\n"
+      << "  \"in_process\": " << (in_process ? "true" : "false") << ",\n"
+      << "  \"connections\": " << options.connections << ",\n"
+      << "  \"threads\": " << options.threads << ",\n"
+      << "  \"duration_s\": " << seconds << ",\n"
+      << "  \"requests\": " << lat.size() << ",\n"
+      << "  \"non_2xx\": " << stats.non_2xx << ",\n"
+      << "  \"errors\": " << stats.errors << ",\n"
+      << "  \"rps\": " << static_cast<double>(lat.size()) / seconds << ",\n"
+      << "  \"latency_us\": {\"mean\": " << mean << ", \"p50\": " << percentile(lat, 0.50)
+      << ", \"p90\": " << percentile(lat, 0.90) << ", \"p99\": " << percentile(lat, 0.99)
+      << ", \"p999\": " << percentile(lat, 0.999)
+      << ", \"max\": " << (lat.empty() ? 0.0 : static_cast<double>(lat.back()) / 1000.0)
+      << "}\n"
+      << "}\n";
+  return out.str();
+}
+
+http::router::Router bench_router() {
+  using namespace http::router;
+  return RouterBuilder()
+      .get("/", [](const http::parser::HttpRequestView &) {
+        return HttpResponse::ok().with_text("hello");
+      })
+      .get("/json", [](const http::parser::HttpRequestView &) {
+        return HttpResponse::ok().with_json(R"({"id":42,"name":"load","tags":["a","b"]})");
+      })
+      .get("/users/:id", [](const http::parser::HttpRequest &req) {
+        return HttpResponse::ok().with_text(req.request_line.uri);
+      })
+      .build();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const auto options = parse_options(argc, argv);
+  if (!options) {
+    std::cerr << "usage: " << argv[0]
+              << " [--host ADDR] [--port N] [--path /] [--connections N] [--threads N]"
+                 " [--duration S] [--warmup S] [--reactors N] [--json FILE]\n";
+    return 2;
+  }
+
+  std::optional<http::server::Server> server;
+  uint16_t port = options->port.value_or(0);
+  if (!options->port) {
+    http::server::ServerConfig config;
+    config.host = options->host;
+    config.port = 0;
+    config.num_reactors = options->reactors;
+    server.emplace(config, bench_router());
+    if (auto started = server->start(); !started) {
+      std::cerr << "Failed to start server: " << static_cast<int>(started.error()) << "\n";
+      return 1;
+    }
+    port = server->port();
+  }
+
+  const auto start = Clock::now();
+  const auto measure_from =
+      start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options->warmup));
+  const auto end = measure_from + std::chrono::duration_cast<Clock::duration>(
+                                      std::chrono::duration<double>(options->duration));
+
+  std::vector<Stats> results(options->threads);
+  {
+    std::vector<std::jthread> threads;
+    for (size_t t = 0; t < options->threads; ++t) {
+      const size_t share = options->connections / options->threads +
+                           (t < options->connections % options->threads ? 1 : 0);
+      threads.emplace_back([&, t, share] {
+        Client client(*options, port, share);
+        results[t] = client.run(measure_from, end);
+      });
+    }
+  }
+  if (server) {
+    server->stop();
+  }
+
+  Stats total;
+  for (auto &stats : results) {
+    total.latencies_ns.insert(total.latencies_ns.end(), stats.latencies_ns.begin(),
+                              stats.latencies_ns.end());
+    total.non_2xx += stats.non_2xx;
+    total.errors += stats.errors;
+  }
+  std::sort(total.latencies_ns.begin(), total.latencies_ns.end());
+
+  const auto json =
+      to_json(*options, port, server.has_value(), total, std::max(options->duration, 1e-9));
+  if (options->json.empty()) {
+    std::cout << json;
+  } else {
+    std::ofstream(options->json) << json;
+  }
+  std::cerr << total.latencies_ns.size() << " requests, "
+            << static_cast<double>(total.latencies_ns.size()) / options->duration << " req/s, p99 "
+            << percentile(total.latencies_ns, 0.99) << " us, " << total.errors << " errors\n";
+  return total.errors > 0 && total.latencies_ns.empty() ? 1 : 0;
+}
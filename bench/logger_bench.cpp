@@ -0,0 +1,106 @@
+// bench/logger_bench.cpp
+// Logger → AsyncSink 的吞吐：写日志线程上的开销，以及后台线程格式化写出的持续速率
+#include "logger/logger.hpp"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+
+namespace {
+
+// 丢弃一切的 sink，只留下 AsyncSink 本身的开销
+class NullSink : public logger::Sink {
+public:
+  void write(const logger::LogEntry &) override {}
+  void write_record(const logger::LogRecord &) override {}
+  void write_batch(std::span<const logger::RecordView>) override {}
+  void flush() override {}
+};
+
+std::shared_ptr<logger::AsyncSink> make_async(std::unique_ptr<logger::Sink> inner,
+                                              logger::Overflow overflow) {
+  logger::AsyncSinkOptions options;
+  options.overflow = overflow;
+  return std::make_shared<logger::AsyncSink>(std::move(inner), options);
+}
+
+// 多个线程共用一个 logger；线程 0 在循环前创建，循环后 flush 并销毁
+struct Shared {
+  std::shared_ptr<logger::AsyncSink> sink;
+  logger::Logger log;
+};
+
+Shared &shared() {
+  static Shared instance;
+  return instance;
+}
+
+void setup(benchmark::State &state, std::unique_ptr<logger::Sink> inner,
+           logger::Overflow overflow) {
+  if (state.thread_index() == 0) {
+    shared().sink = make_async(std::move(inner), overflow);
+    shared().log = logger::Logger(logger::Level::Info).with_sink(shared().sink);
+  }
+}
+
+void teardown(benchmark::State &state) {
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    shared().sink->flush();
+    state.counters["dropped"] = static_cast<double>(shared().sink->dropped());
+    shared().log = logger::Logger();
+    shared().sink.reset();
+  }
+}
+
+// 延迟格式化：写日志线程只复制参数，丢弃模式下从不等待
+void BM_LogfToNullSink(benchmark::State &state) {
+  setup(state, std::make_unique<NullSink>(), logger::Overflow::Drop);
+  const std::string path = "/api/v1/orders";
+  int64_t i = 0;
+  for (auto _ : state) {
+    LOGF_INFO(shared().log, "request {} {} took {}us", path, i, 42);
+    ++i;
+  }
+  teardown(state);
+}
+BENCHMARK(BM_LogfToNullSink)->ThreadRange(1, 8)->UseRealTime();
+
+// 阻塞模式写到 /dev/null 的文本文件：吞吐受后台线程格式化与写出的速度限制
+void BM_LogfToFileBlocking(benchmark::State &state) {
+  setup(state, std::make_unique<logger::FileSink>("/dev/null"), logger::Overflow::Block);
+  const std::string path = "/api/v1/orders";
+  int64_t i = 0;
+  for (auto _ : state) {
+    LOGF_INFO(shared().log, "request {} {} took {}us", path, i, 42);
+    ++i;
+  }
+  teardown(state);
+}
+BENCHMARK(BM_LogfToFileBlocking)->ThreadRange(1, 4)->UseRealTime();
+
+// 在调用线程上拼好消息的 LogEntry 路径，作为对照
+void BM_LogEntryToNullSink(benchmark::State &state) {
+  setup(state, std::make_unique<NullSink>(), logger::Overflow::Drop);
+  int64_t i = 0;
+  for (auto _ : state) {
+    LOG_INFO(shared().log, "request /api/v1/orders " + std::to_string(i) + " took 42us");
+    ++i;
+  }
+  teardown(state);
+}
+BENCHMARK(BM_LogEntryToNullSink)->ThreadRange(1, 8)->UseRealTime();
+
+// 级别未开启的语句：只有一次比较
+void BM_DisabledLevel(benchmark::State &state) {
+  setup(state, std::make_unique<NullSink>(), logger::Overflow::Drop);
+  int64_t i = 0;
+  for (auto _ : state) {
+    LOGF_DEBUG(shared().log, "debug {}", i);
+    ++i;
+  }
+  benchmark::DoNotOptimize(i);
+  teardown(state);
+}
+BENCHMARK(BM_DisabledLevel);
+
+} // namespace
@@ -0,0 +1,123 @@
+// bench/router_bench.cpp
+// 路由查找与分发：10 / 100 / 1000 条路由，静态路径、参数路径和通配符各占一部分
+#include "router/middleware.hpp"
+#include "router/router.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+using namespace http::router;
+using namespace http::parser;
+
+namespace {
+
+HttpResponse no_content(const HttpRequest &) { return HttpResponse{204, "No Content", {}, {}}; }
+
+// 每组三条路由：/api/v1/r<i>、/api/v1/r<i>/:id/items/:item、/assets/r<i>/*path
+Router make_router(size_t routes) {
+  RouterBuilder builder;
+  for (size_t i = 0; builder.size() < routes; ++i) {
+    const auto name = "/r" + std::to_string(i);
+    builder.get("/api/v1" + name, no_content);
+    if (builder.size() < routes) {
+      builder.get("/api/v1" + name + "/:id/items/:item", no_content);
+    }
+    if (builder.size() < routes) {
+      builder.get("/assets" + name + "/*path", no_content);
+    }
+  }
+  return std::move(builder).build();
+}
+
+// 均匀覆盖全部路由，另有一成请求找不到路由
+std::vector<std::string> make_uris(size_t routes) {
+  std::vector<std::string> uris;
+  for (size_t i = 0; uris.size() < 1024; ++i) {
+    const size_t group = (i * 7919) % ((routes + 2) / 3);
+    const auto name = "/r" + std::to_string(group);
+    switch (i % 10) {
+    case 0:
+      uris.push_back("/missing" + name);
+      break;
+    case 1:
+    case 2:
+    case 3:
+      uris.push_back("/api/v1" + name + "?page=2");
+      break;
+    case 4:
+    case 5:
+    case 6:
+      uris.push_back("/api/v1" + name + "/12345/items/678");
+      break;
+    default:
+      uris.push_back("/assets" + name + "/css/site.min.css");
+      break;
+    }
+  }
+  return uris;
+}
+
+void BM_RouterFind(benchmark::State &state) {
+  const auto routes = static_cast<size_t>(state.range(0));
+  const auto router = make_router(routes);
+  const auto uris = make_uris(routes);
+  size_t i = 0;
+  for (auto _ : state) {
+    auto match = router.find(Method::Get, uris[i++ & (uris.size() - 1)]);
+    benchmark::DoNotOptimize(match);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RouterFind)->Arg(10)->Arg(100)->Arg(1000);
+
+// find 加上调用 handler 与异常保护，即服务器每个请求的路由开销
+void BM_RouterHandle(benchmark::State &state) {
+  const auto routes = static_cast<size_t>(state.range(0));
+  const auto router = make_router(routes);
+  std::vector<HttpRequest> requests;
+  for (auto &uri : make_uris(routes)) {
+    requests.push_back(HttpRequest{RequestLine{Method::Get, std::move(uri), Version::Http11}, {}, {}});
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    auto response = router.handle(requests[i++ & (requests.size() - 1)]);
+    benchmark::DoNotOptimize(response);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RouterHandle)->Arg(10)->Arg(100)->Arg(1000);
+
+// 同一组中间件：compose 的 std::function 链与 pipeline 的静态链
+HttpRequest cors_request() {
+  return HttpRequest{RequestLine{Method::Get, "/api/v1/r0", Version::Http11}, {}, {}};
+}
+
+void BM_MiddlewareCompose(benchmark::State &state) {
+  auto handler = middleware::compose(
+      {middleware::cors(), middleware::layer(middleware::AuthLayer{[](const HttpRequest &) {
+         return true;
+       }}),
+       middleware::compress()},
+      no_content);
+  const auto req = cors_request();
+  for (auto _ : state) {
+    auto response = handler(req);
+    benchmark::DoNotOptimize(response);
+  }
+}
+BENCHMARK(BM_MiddlewareCompose);
+
+void BM_MiddlewarePipeline(benchmark::State &state) {
+  auto handler =
+      middleware::pipeline(middleware::CorsLayer{},
+                           middleware::AuthLayer{[](const HttpRequest &) { return true; }},
+                           middleware::CompressLayer{})(no_content);
+  const auto req = cors_request();
+  for (auto _ : state) {
+    auto response = handler(req);
+    benchmark::DoNotOptimize(response);
+  }
+}
+BENCHMARK(BM_MiddlewarePipeline);
+
+} // namespace
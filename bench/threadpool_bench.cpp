@@ -0,0 +1,115 @@
+// bench/threadpool_bench.cpp
+// ThreadPool::submit 的往返延迟与吞吐：参数为 worker 数
+#include "threadpool/pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace threadpool;
+
+namespace {
+
+constexpr size_t kBatch = 1000;
+
+// 百分位写进计数器，和 benchmark 自己的均值一起输出
+void report_percentiles(benchmark::State &state, std::vector<int64_t> &samples) {
+  if (samples.empty()) {
+    return;
+  }
+  std::sort(samples.begin(), samples.end());
+  const auto at = [&](double q) {
+    return static_cast<double>(samples[static_cast<size_t>(q * static_cast<double>(samples.size() - 1))]);
+  };
+  state.counters["p50_ns"] = at(0.50);
+  state.counters["p99_ns"] = at(0.99);
+  state.counters["p999_ns"] = at(0.999);
+}
+
+// 提交一个空任务并等待结果：唤醒 worker 加上 future 往返的延迟
+void BM_SubmitLatency(benchmark::State &state) {
+  ThreadPool pool(static_cast<size_t>(state.range(0)));
+  std::vector<int64_t> samples;
+  samples.reserve(1 << 20);
+  for (auto _ : state) {
+    const auto start = std::chrono::steady_clock::now();
+    auto result = pool.submit([] { return 1; }).get();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    benchmark::DoNotOptimize(result);
+    if (samples.size() < samples.capacity()) {
+      samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+  }
+  report_percentiles(state, samples);
+}
+BENCHMARK(BM_SubmitLatency)->Arg(1)->Arg(4)->UseRealTime();
+
+// 连续提交一批再统一等待：入队、窃取与 future 的摊销开销
+void BM_SubmitThroughput(benchmark::State &state) {
+  ThreadPool pool(static_cast<size_t>(state.range(0)));
+  std::vector<std::future<TaskResult<int>>> futures;
+  futures.reserve(kBatch);
+  for (auto _ : state) {
+    for (size_t i = 0; i < kBatch; ++i) {
+      futures.push_back(pool.submit([i] { return static_cast<int>(i); }));
+    }
+    for (auto &future : futures) {
+      benchmark::DoNotOptimize(future.get());
+    }
+    futures.clear();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kBatch));
+}
+BENCHMARK(BM_SubmitThroughput)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// 同一批任务用 submit_batch 一次入队，只唤醒一次
+void BM_SubmitBatch(benchmark::State &state) {
+  ThreadPool pool(static_cast<size_t>(state.range(0)));
+  std::vector<std::function<int()>> tasks(kBatch, [] { return 1; });
+  for (auto _ : state) {
+    auto futures = pool.submit_batch(tasks);
+    for (auto &future : futures) {
+      benchmark::DoNotOptimize(future.get());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kBatch));
+}
+BENCHMARK(BM_SubmitBatch)->Arg(1)->Arg(4)->Arg(8)->UseRealTime();
+
+// 不需要结果的任务，没有 future
+void BM_PostThroughput(benchmark::State &state) {
+  ThreadPool pool(static_cast<size_t>(state.range(0)));
+  std::atomic<size_t> done{0};
+  size_t expected = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i < kBatch; ++i) {
+      (void)pool.post([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    expected += kBatch;
+    while (done.load(std::memory_order_acquire) < expected) {
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kBatch));
+}
+BENCHMARK(BM_PostThroughput)->Arg(1)->Arg(4)->Arg(8)->UseRealTime();
+
+// 多个外部线程同时向注入队列提交
+void BM_ContendedSubmit(benchmark::State &state) {
+  static std::unique_ptr<ThreadPool> pool;
+  if (state.thread_index() == 0) {
+    pool = std::make_unique<ThreadPool>(4);
+  }
+  // 循环开始处所有线程同步一次，线程 0 创建的线程池此时已经可见
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pool->submit([] { return 1; }).get());
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    pool.reset();
+  }
+}
+BENCHMARK(BM_ContendedSubmit)->Threads(1)->Threads(4)->Threads(8)->UseRealTime();
+
+} // namespace
@@ -67,5 +67,10 @@ int main() {
     auto response = with_middleware(test_req);
     std::cout << "Status: " << response.status_code << std::endl;
 
+    // 同样的两层在编译期组合，请求路径上没有 std::function 和分配
+    auto pipelined = middleware::pipeline(middleware::LoggingLayer{}, middleware::CorsLayer{})(
+        [&router](const HttpRequest& req) { return router.handle(req); });
+    std::cout << "Status: " << pipelined(test_req).status_code << std::endl;
+
     return 0;
 }
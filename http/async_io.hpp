@@ -0,0 +1,122 @@
+#pragma once
+#include "../threadpool/coro.hpp"
+#include "event_loop.hpp"
+#include <chrono>
+#include <coroutine>
+#include <span>
+#include <sys/epoll.h>
+
+namespace http::server {
+
+template <typename T = void> using Task = threadpool::coro::Task<T>;
+
+// 等待 fd 可读/可写。注册通过 post 交给 loop 线程完成，因此可以在任何线程上 co_await；
+// 协程总是在 loop 线程上恢复，之后需要计算时用 co_await pool.schedule() 切回线程池。
+// fd 不能同时被其他 watch 占用（例如服务端自己的连接套接字）
+class ReadinessAwaiter {
+  EventLoop &loop_;
+  int fd_;
+  uint32_t events_;
+  ServerResult<uint32_t> result_ = 0;
+
+public:
+  ReadinessAwaiter(EventLoop &loop, int fd, uint32_t events)
+      : loop_(loop), fd_(fd), events_(events) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> h) {
+    loop_.post([this, h] {
+      const bool ok = loop_.watch(fd_, events_ | EPOLLONESHOT, [this, h](uint32_t revents) {
+        loop_.unwatch(fd_);
+        result_ = revents;
+        h.resume();
+      });
+      if (!ok) {
+        result_ = std::unexpected(ServerError::EpollFailed);
+        h.resume();
+      }
+    });
+  }
+
+  ServerResult<uint32_t> await_resume() const { return result_; }
+};
+
+inline ReadinessAwaiter readable(EventLoop &loop, int fd) {
+  return {loop, fd, EPOLLIN | EPOLLRDHUP};
+}
+
+inline ReadinessAwaiter writable(EventLoop &loop, int fd) { return {loop, fd, EPOLLOUT}; }
+
+// 在 loop 线程上等待 delay 后恢复。定时器嵌在 awaiter 里（挂起期间位于协程帧中），
+// 由 loop 的时间轮驱动，不额外分配
+class SleepAwaiter {
+  EventLoop &loop_;
+  std::chrono::milliseconds delay_;
+  std::coroutine_handle<> handle_;
+  TimerWheel::Timer timer_{[](void *self) { static_cast<SleepAwaiter *>(self)->handle_.resume(); },
+                           this};
+
+public:
+  SleepAwaiter(EventLoop &loop, std::chrono::milliseconds delay) : loop_(loop), delay_(delay) {}
+
+  SleepAwaiter(const SleepAwaiter &) = delete;
+  SleepAwaiter &operator=(const SleepAwaiter &) = delete;
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> h) {
+    handle_ = h;
+    loop_.post([this] { loop_.timers().schedule(timer_, delay_); });
+  }
+
+  void await_resume() const noexcept {}
+};
+
+inline SleepAwaiter sleep_for(EventLoop &loop, std::chrono::milliseconds delay) {
+  return {loop, delay};
+}
+
+// 从非阻塞 fd 读取至多 buf.size() 字节；返回 0 表示对端关闭
+inline Task<ServerResult<size_t>> async_read(EventLoop &loop, int fd, std::span<char> buf) {
+  while (true) {
+    const ssize_t n = ::read(fd, buf.data(), buf.size());
+    if (n >= 0) {
+      co_return static_cast<size_t>(n);
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      co_return std::unexpected(ServerError::IoFailed);
+    }
+    if (auto ready = co_await readable(loop, fd); !ready) {
+      co_return std::unexpected(ready.error());
+    }
+  }
+}
+
+// 把 data 全部写入非阻塞套接字
+inline Task<ServerResult<size_t>> async_write(EventLoop &loop, int fd,
+                                              std::span<const char> data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t n = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+    if (n >= 0) {
+      written += static_cast<size_t>(n);
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      co_return std::unexpected(ServerError::IoFailed);
+    }
+    if (auto ready = co_await writable(loop, fd); !ready) {
+      co_return std::unexpected(ready.error());
+    }
+  }
+  co_return written;
+}
+
+} // namespace http::server
@@ -0,0 +1,498 @@
+#pragma once
+#include "../parser/arena.hpp"
+#include "../parser/request_parser.hpp"
+#include "../router/router.hpp"
+#include "event_loop.hpp"
+#include "response.hpp"
+#include "socket.hpp"
+#include "write_queue.hpp"
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/epoll.h>
+
+namespace http::server {
+
+// 超时为 0 表示不限制。请求头和 body 的期限从进入该阶段时开始计算，数据陆续到达不会延长，
+// 因此每隔几秒发一个字节的慢速客户端（slowloris）同样会被关闭。响应期限则在每次写出进展时
+// 重新计时，只关闭 handler 迟迟不完成或不再读取响应的连接
+struct ConnectionLimits {
+  size_t max_header_size = 64 * 1024;
+  size_t max_body_size = 8 * 1024 * 1024;
+  std::chrono::milliseconds idle_timeout{60'000};   // 两个请求之间没有任何读写事件的时长
+  std::chrono::milliseconds header_timeout{10'000}; // 新连接或请求的第一个字节到请求头完整
+  std::chrono::milliseconds body_timeout{60'000};   // 请求头完整到 body 收完
+  // 协程 handler 未完成或流式响应未发完时，两次写出进展之间的最长间隔
+  std::chrono::milliseconds response_timeout{60'000};
+  // 写队列中待发送的内存数据超过它时，暂停解析后续请求和读取套接字，排空后继续
+  size_t max_queued_output = 1024 * 1024;
+};
+
+// 连接层的指标：每个请求累计的解析耗时（跨多次 feed），以及按 ParseError 分类的解析错误。
+// 同一个 registry 上多次 create() 得到的是同一组指标
+struct ConnectionMetrics {
+  static constexpr size_t kParseErrorCount = static_cast<size_t>(parser::ParseError::BodyTooLarge) + 1;
+
+  metrics::Histogram *parse_time = nullptr;
+  std::array<metrics::Counter *, kParseErrorCount> parse_errors{};
+
+  static ConnectionMetrics create(metrics::Registry &registry) {
+    ConnectionMetrics out;
+    out.parse_time = &registry.histogram("http_parse_duration_seconds",
+                                         "Time spent parsing each request");
+    for (size_t i = 0; i < kParseErrorCount; ++i) {
+      const auto kind = parser::parse_error_name(static_cast<parser::ParseError>(i));
+      out.parse_errors[i] = &registry.counter("http_parse_errors_total",
+                                              "Requests rejected by the parser", {{"kind", kind}});
+    }
+    return out;
+  }
+};
+
+class Connection {
+  UniqueFd fd_;
+  router::RouterSnapshot &router_; // 属于所在 reactor，只在 loop 线程上使用
+  std::shared_ptr<EventLoop> loop_;
+  EventCallback on_ready_; // 协程响应就绪后由 loop 线程调用，驱动写出与关闭
+  std::function<void()> submit_; // 非空时写出交给完成式 I/O（io_uring），见 use_completion_io()
+  ConnectionLimits limits_;
+  const ConnectionMetrics *metrics_; // 为空时不计时
+  int64_t parse_ns_ = 0;             // 当前请求到目前为止的解析耗时
+
+  parser::RequestParser parser_;
+  // 同步 handler 的 HttpRequest 和排队响应的 header 从这里分配，写缓冲排空时一次性重置
+  parser::RequestArena arena_;
+  WriteQueue out_{arena_.resource()};
+  bool close_after_write_ = false; // Connection: close 或解析出错，不再处理后续请求
+  bool peer_closed_ = false;
+  bool closed_ = false;
+  bool awaiting_ = false; // 协程 handler 尚未完成
+  bool read_paused_ = false; // 因 input_backlogged() 停止过读取，见 on_event()
+  // 正在发送的流式响应；发送完之前后续请求只缓冲
+  router::BodySource stream_;
+  bool stream_chunked_ = false;
+  std::string piece_; // 流式响应当前一段数据的暂存
+  // 当前请求的流式 body 接收端与其中的第一个错误；出错后 body 仍然读完以保持请求边界
+  std::optional<router::BodyReader> reader_;
+  std::optional<std::string> reader_error_;
+  // 只用于让投递回来的协程结果判断连接是否已销毁，第一次使用协程 handler 时才创建
+  std::shared_ptr<std::monostate> lifetime_;
+
+  // 决定当前适用哪个超时；Busy 时（协程 handler 未完成、流式响应未发完）适用 response_timeout
+  enum class Phase { Idle, Headers, Body, Busy };
+  Phase phase_ = Phase::Headers;
+  uint64_t written_mark_ = 0; // 上次设置期限时 out_ 累计写出的字节，用于判断写出进展
+  TimerWheel::Timer deadline_{[](void *self) { static_cast<Connection *>(self)->on_deadline(); },
+                              this};
+
+public:
+  static constexpr uint32_t kEvents = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+
+  Connection(UniqueFd fd, router::RouterSnapshot &router, std::shared_ptr<EventLoop> loop,
+             EventCallback on_ready, ConnectionLimits limits = {},
+             const ConnectionMetrics *metrics = nullptr)
+      : fd_(std::move(fd)), router_(router), loop_(std::move(loop)),
+        on_ready_(std::move(on_ready)), limits_(limits), metrics_(metrics),
+        parser_(parser::ParserLimits{limits.max_header_size, limits.max_body_size}) {
+    parser_.set_body_sink_factory(
+        [this](const parser::HttpRequestView &request) { return open_body_stream(request); });
+    arm_deadline(limits_.header_timeout);
+  }
+
+  Connection(const Connection &) = delete;
+  Connection &operator=(const Connection &) = delete;
+
+  [[nodiscard]] int fd() const { return fd_.get(); }
+  [[nodiscard]] bool closed() const { return closed_; }
+
+  // 输入积压，此时不应再读取套接字：写队列超过 max_queued_output，或者请求处理中
+  // （协程 handler 未完成、流式响应未发完）缓冲的后续字节已经超过一个最大请求
+  [[nodiscard]] bool input_backlogged() const {
+    if (close_after_write_) {
+      return false; // 之后到达的字节都被丢弃，不会积压
+    }
+    if (out_.queued_bytes() >= limits_.max_queued_output) {
+      return true;
+    }
+    return (awaiting_ || stream_) &&
+           parser_.buffered() >= limits_.max_header_size + limits_.max_body_size;
+  }
+
+  // 边缘触发：每次事件都要把套接字读/写到 EAGAIN
+  void on_event(uint32_t events) {
+    if (events & (EPOLLERR | EPOLLHUP)) {
+      closed_ = true;
+      return;
+    }
+    if (events & EPOLLIN) {
+      on_readable();
+    }
+    if (!closed_ && (events & EPOLLOUT)) {
+      flush();
+    }
+    // 边缘触发下暂停期间到达的数据不会再有通知，积压解除后主动读一次
+    if (!closed_ && read_paused_ && !input_backlogged()) {
+      on_readable();
+    }
+    if (!closed_) {
+      update_deadline(events != 0);
+    }
+  }
+
+  // 完成式 I/O（io_uring 后端）：收发由驱动方提交，连接只消费收到的字节、维护写队列。
+  // 写队列有数据时调用 submit；它可能在上一次写出完成前被再次调用，驱动方应忽略。
+  // 驱动方从 output() 取得要写的数据，完成后调用 on_sent()；之后仍用 on_event(EPOLLOUT) 驱动写出
+  void use_completion_io(std::function<void()> submit) { submit_ = std::move(submit); }
+  [[nodiscard]] WriteQueue &output() { return out_; }
+
+  void on_received(std::string_view bytes) {
+    if (!close_after_write_) {
+      on_bytes(bytes);
+    }
+    after_io();
+  }
+
+  void on_sent(size_t n) {
+    out_.consume(n);
+    after_io();
+  }
+
+  // 对端关闭写端：已收到的请求照常应答，写完后关闭
+  void on_eof() {
+    peer_closed_ = true;
+    after_io();
+  }
+
+  void on_io_error() { closed_ = true; }
+
+private:
+  void after_io() {
+    if (!closed_) {
+      flush();
+    }
+    if (!closed_) {
+      update_deadline(true);
+    }
+  }
+
+  [[nodiscard]] Phase current_phase() const {
+    if (awaiting_ || stream_) {
+      return Phase::Busy;
+    }
+    switch (parser_.state()) {
+    case parser::ParseState::RequestLine:
+      return parser_.buffered() > 0 ? Phase::Headers : Phase::Idle;
+    case parser::ParseState::Headers:
+      return Phase::Headers;
+    case parser::ParseState::Body:
+      return Phase::Body;
+    case parser::ParseState::Complete:
+      break;
+    }
+    return Phase::Busy;
+  }
+
+  // 进入新阶段时按该阶段的超时重新设置；空闲阶段每次有读写事件、Busy 阶段每次写出进展都重新计时
+  void update_deadline(bool activity) {
+    const Phase phase = current_phase();
+    const bool progressed = out_.written_bytes() != written_mark_;
+    written_mark_ = out_.written_bytes();
+    if (phase == phase_ && !(phase == Phase::Idle && activity) &&
+        !(phase == Phase::Busy && progressed)) {
+      return;
+    }
+    phase_ = phase;
+    switch (phase) {
+    case Phase::Idle:
+      arm_deadline(limits_.idle_timeout);
+      break;
+    case Phase::Headers:
+      arm_deadline(limits_.header_timeout);
+      break;
+    case Phase::Body:
+      arm_deadline(limits_.body_timeout);
+      break;
+    case Phase::Busy:
+      arm_deadline(limits_.response_timeout);
+      break;
+    }
+  }
+
+  void arm_deadline(std::chrono::milliseconds timeout) {
+    if (timeout.count() > 0) {
+      loop_->timers().schedule(deadline_, timeout);
+    } else {
+      deadline_.cancel();
+    }
+  }
+
+  // 读请求期间超时回 408；空闲连接与响应停滞的连接直接关闭，后者已经发出的部分响应无法再改。
+  // on_ready_ 让 reactor 移除并销毁本连接
+  void on_deadline() {
+    if (phase_ == Phase::Headers || phase_ == Phase::Body) {
+      reply_error(router::HttpResponse{408, "Request Timeout", {}, {}});
+      flush();
+    }
+    closed_ = true;
+    on_ready_(0);
+  }
+
+  void on_readable() {
+    char buf[16 * 1024];
+    read_paused_ = false;
+    while (true) {
+      if (input_backlogged()) {
+        flush(); // 写出一部分后积压可能解除；仍然积压时写阻塞或请求未完成，之后一定还有事件
+        if (closed_) {
+          return;
+        }
+        if (input_backlogged()) {
+          read_paused_ = true; // 数据留在内核缓冲区里，由 TCP 流量控制让对端减速
+          return;
+        }
+      }
+      const ssize_t n = ::read(fd_.get(), buf, sizeof(buf));
+      if (n > 0) {
+        if (!close_after_write_) {
+          on_bytes(std::string_view(buf, static_cast<size_t>(n)));
+        }
+        continue;
+      }
+      if (n == 0) {
+        // 对端关闭写端：已收到的请求照常应答，写完后关闭
+        peer_closed_ = true;
+        break;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        closed_ = true;
+        return;
+      }
+      break;
+    }
+
+    flush();
+  }
+
+  void on_bytes(std::string_view bytes) { process(feed(bytes)); }
+
+  parser::ParseResult<parser::ParseState> feed(std::string_view bytes) {
+    if (metrics_ == nullptr) {
+      return parser_.feed(bytes);
+    }
+    const int64_t start = metrics::now_ns();
+    auto state = parser_.feed(bytes);
+    parse_ns_ += metrics::now_ns() - start;
+    return state;
+  }
+
+  // 依次处理缓冲区里已完整到达的请求（管线化），响应按请求顺序追加。
+  // 协程 handler 未完成、流式响应未发完或写队列超过 max_queued_output 时暂停，
+  // 之后到达的字节只缓冲，完成或排空后从这里继续
+  void process(parser::ParseResult<parser::ParseState> state) {
+    while (!awaiting_ && !stream_ && !close_after_write_ &&
+           out_.queued_bytes() < limits_.max_queued_output) {
+      if (!state) {
+        if (metrics_ != nullptr) {
+          metrics_->parse_errors[static_cast<size_t>(state.error())]->add();
+        }
+        reply_error(error_response(state.error()));
+        return;
+      }
+      if (*state != parser::ParseState::Complete) {
+        return;
+      }
+      if (metrics_ != nullptr) {
+        metrics_->parse_time->observe(static_cast<uint64_t>(std::exchange(parse_ns_, 0)));
+      }
+
+      auto request = parser_.view();
+      request.arena = arena_.resource();
+      const bool keep_alive = request.keep_alive();
+      const bool http11 = request.request_line.version == parser::Version::Http11;
+      const bool head = request.request_line.method == parser::Method::Head;
+      std::variant<router::HttpResponse, router::PendingResponse> reply =
+          reader_ ? finish_body_stream() : router_.get().respond(request);
+      parser_.consume();
+      close_after_write_ = !keep_alive;
+      if (auto *pending = std::get_if<router::PendingResponse>(&reply)) {
+        await_response(std::move(*pending), keep_alive, http11, head);
+        return;
+      }
+      queue_response(std::get<router::HttpResponse>(std::move(reply)), keep_alive, http11, head);
+      state = feed({});
+    }
+  }
+
+  // HEAD 的响应保留 header 和 Content-Length，但不能带 body，否则下一个响应会错位
+  void queue_response(router::HttpResponse response, bool keep_alive, bool http11, bool head) {
+    const auto framing = framing_of(response, http11);
+    if (framing == BodyFraming::UntilClose) {
+      close_after_write_ = true;
+    }
+    out_.push_response(std::move(response), keep_alive, framing, !head);
+    if (head) {
+      return;
+    }
+    // 带 Content-Length 的流式响应也由 pull_stream() 拉取，只是不做 chunked 编码
+    stream_ = std::move(response.stream);
+    stream_chunked_ = framing == BodyFraming::Chunked;
+  }
+
+  // 请求头完整时由解析器调用：流式 handler 的 body 直接交给它的 BodyReader
+  parser::BodySink open_body_stream(const parser::HttpRequestView &request) {
+    try {
+      reader_ = router_.get().body_reader(request);
+    } catch (const std::exception &e) {
+      reader_.emplace();
+      reader_error_ = e.what();
+    }
+    if (!reader_) {
+      return nullptr;
+    }
+    return [this](std::string_view data) -> parser::ParseResult<void> {
+      if (!reader_error_) {
+        try {
+          reader_->on_data(data);
+        } catch (const std::exception &e) {
+          reader_error_ = e.what();
+        }
+      }
+      return {};
+    };
+  }
+
+  router::HttpResponse finish_body_stream() {
+    auto reader = std::move(*reader_);
+    reader_.reset();
+    if (auto error = std::exchange(reader_error_, std::nullopt)) {
+      return router::Router::handler_error(*error);
+    }
+    try {
+      return reader.finish();
+    } catch (const std::exception &e) {
+      return router::Router::handler_error(e.what());
+    }
+  }
+
+  // 协程在 loop 线程上启动，可以在任意线程上完成；结果投递回 loop 线程，
+  // 连接在此之前已关闭时丢弃。持有 loop 的引用计数，服务器停止后投递也是安全的
+  void await_response(router::PendingResponse pending, bool keep_alive, bool http11, bool head) {
+    if (!lifetime_) {
+      lifetime_ = std::make_shared<std::monostate>();
+    }
+    awaiting_ = true;
+    threadpool::coro::start(
+        std::move(pending),
+        [this, keep_alive, http11, head, loop = loop_, on_ready = on_ready_,
+         alive = std::weak_ptr(lifetime_)](
+            threadpool::TaskResult<router::HttpResponse> result) mutable {
+          loop->post([this, keep_alive, http11, head, on_ready = std::move(on_ready),
+                      alive = std::move(alive), result = std::move(result)]() mutable {
+            if (alive.expired()) {
+              return;
+            }
+            awaiting_ = false;
+            queue_response(result ? std::move(*result)
+                                  : router::Router::handler_error(result.error()),
+                           keep_alive, http11, head);
+            process(feed({}));
+            on_ready(EPOLLOUT); // 可能销毁本连接，之后不能再访问成员
+          });
+        });
+  }
+
+  static router::HttpResponse error_response(parser::ParseError error) {
+    switch (error) {
+    case parser::ParseError::HeadersTooLarge:
+      return router::HttpResponse{431, "Request Header Fields Too Large", {}, {}};
+    case parser::ParseError::BodyTooLarge:
+      return router::HttpResponse{413, "Payload Too Large", {}, {}};
+    default:
+      return router::HttpResponse::bad_request().with_text("Malformed request");
+    }
+  }
+
+  void reply_error(router::HttpResponse response) {
+    parser_.reset();
+    reader_.reset();
+    reader_error_.reset();
+    out_.push_response(std::move(response), false, BodyFraming::Length);
+    close_after_write_ = true;
+  }
+
+  // 写到 EAGAIN 为止；写缓冲排空后才拉取流式响应的下一段，或继续处理因写队列过长
+  // 暂停的请求。完成式 I/O 下只通知驱动方提交写操作，排空后的处理在 on_sent() 里回到这里继续
+  void flush() {
+    while (true) {
+      if (submit_ && !out_.empty()) {
+        submit_();
+        return;
+      }
+      switch (submit_ ? WriteQueue::Status::Drained : out_.flush(fd_.get())) {
+      case WriteQueue::Status::WouldBlock:
+        return;
+      case WriteQueue::Status::Failed:
+        closed_ = true;
+        return;
+      case WriteQueue::Status::Drained:
+        arena_.reset(); // 已排队的响应都已写出，没有对象再引用池里的内存
+        break;
+      }
+      if (stream_) {
+        if (!pull_stream()) {
+          break;
+        }
+        continue;
+      }
+      if (awaiting_ || close_after_write_ || parser_.buffered() == 0) {
+        break;
+      }
+      process(feed({}));
+      if (out_.empty()) {
+        break;
+      }
+    }
+
+    if ((close_after_write_ || peer_closed_) && !awaiting_ && !stream_) {
+      closed_ = true;
+    }
+  }
+
+  // 返回 false 表示没有可写的数据了
+  bool pull_stream() {
+    bool more = false;
+    piece_.clear();
+    try {
+      more = stream_(piece_);
+    } catch (const std::exception &) {
+      // 响应头已经发出，无法再改成错误响应，只能断开
+      stream_ = nullptr;
+      closed_ = true;
+      return false;
+    }
+    if (stream_chunked_) {
+      std::string chunk;
+      append_chunk(chunk, piece_);
+      if (!more) {
+        append_last_chunk(chunk);
+      }
+      out_.push(std::move(chunk));
+    } else {
+      out_.push(std::move(piece_));
+    }
+    if (!more) {
+      stream_ = nullptr;
+      process(feed({}));
+    }
+    return true;
+  }
+};
+
+} // namespace http::server
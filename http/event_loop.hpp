@@ -0,0 +1,199 @@
+#pragma once
+#include "socket.hpp"
+#include "timer_wheel.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace http::server {
+
+using EventCallback = std::function<void(uint32_t events)>;
+
+class EventLoop {
+  struct Watch {
+    int fd;
+    EventCallback callback;
+    bool active = true;
+  };
+
+  UniqueFd epoll_fd_;
+  UniqueFd wakeup_fd_;
+  std::unordered_map<int, std::unique_ptr<Watch>> watches_;
+  // 在一轮 epoll_wait 的回调中调用 unwatch 时，Watch 延迟到本轮结束后再释放
+  std::vector<std::unique_ptr<Watch>> retired_;
+
+  std::mutex pending_mutex_;
+  std::vector<std::function<void()>> pending_;
+
+  // run_after() 的一次性定时器，由时间轮独占：触发后或时间轮析构时释放
+  struct OneShot {
+    TimerWheel::Timer timer;
+    std::function<void()> callback;
+
+    explicit OneShot(std::function<void()> fn)
+        : timer(&OneShot::fire, this, &OneShot::drop), callback(std::move(fn)) {}
+
+    static void fire(void *self) {
+      auto callback = std::move(static_cast<OneShot *>(self)->callback);
+      delete static_cast<OneShot *>(self);
+      callback();
+    }
+
+    static void drop(void *self) { delete static_cast<OneShot *>(self); }
+  };
+  TimerWheel timers_;
+
+  explicit EventLoop(UniqueFd epoll_fd, UniqueFd wakeup_fd)
+      : epoll_fd_(std::move(epoll_fd)), wakeup_fd_(std::move(wakeup_fd)) {}
+
+public:
+  static ServerResult<std::unique_ptr<EventLoop>> create() {
+    UniqueFd epoll_fd(::epoll_create1(EPOLL_CLOEXEC));
+    if (!epoll_fd) {
+      return std::unexpected(ServerError::EpollFailed);
+    }
+    UniqueFd wakeup_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    if (!wakeup_fd) {
+      return std::unexpected(ServerError::EventFdFailed);
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = nullptr;
+    if (::epoll_ctl(epoll_fd.get(), EPOLL_CTL_ADD, wakeup_fd.get(), &ev) != 0) {
+      return std::unexpected(ServerError::EpollFailed);
+    }
+    return std::unique_ptr<EventLoop>(
+        new EventLoop(std::move(epoll_fd), std::move(wakeup_fd)));
+  }
+
+  EventLoop(const EventLoop &) = delete;
+  EventLoop &operator=(const EventLoop &) = delete;
+
+  bool watch(int fd, uint32_t events, EventCallback callback) {
+    auto w = std::make_unique<Watch>(Watch{fd, std::move(callback)});
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.ptr = w.get();
+    if (::epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, fd, &ev) != 0) {
+      return false;
+    }
+    watches_[fd] = std::move(w);
+    return true;
+  }
+
+  bool modify(int fd, uint32_t events) {
+    auto it = watches_.find(fd);
+    if (it == watches_.end()) {
+      return false;
+    }
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.ptr = it->second.get();
+    return ::epoll_ctl(epoll_fd_.get(), EPOLL_CTL_MOD, fd, &ev) == 0;
+  }
+
+  void unwatch(int fd) {
+    auto it = watches_.find(fd);
+    if (it == watches_.end()) {
+      return;
+    }
+    ::epoll_ctl(epoll_fd_.get(), EPOLL_CTL_DEL, fd, nullptr);
+    it->second->active = false;
+    retired_.push_back(std::move(it->second));
+    watches_.erase(it);
+  }
+
+  // 线程安全：把任务投递到 loop 线程执行
+  void post(std::function<void()> fn) {
+    {
+      std::lock_guard lock(pending_mutex_);
+      pending_.push_back(std::move(fn));
+    }
+    wakeup();
+  }
+
+  // 只能在 loop 线程上调用（包括回调和 post 的任务中）；精度为毫秒
+  void run_after(std::chrono::milliseconds delay, std::function<void()> fn) {
+    timers_.schedule((new OneShot(std::move(fn)))->timer, delay);
+  }
+
+  // 本 loop 的时间轮，用于嵌在连接等对象里、需要反复设置和取消的定时器。只能在 loop 线程上使用
+  [[nodiscard]] TimerWheel &timers() { return timers_; }
+
+  void wakeup() {
+    const uint64_t one = 1;
+    [[maybe_unused]] auto n = ::write(wakeup_fd_.get(), &one, sizeof(one));
+  }
+
+  void run(std::stop_token stoken) {
+    std::stop_callback on_stop(stoken, [this] { wakeup(); });
+    while (!stoken.stop_requested()) {
+      if (!run_once(next_timeout())) {
+        break;
+      }
+    }
+  }
+
+  // 一轮：等待至多 timeout_ms 毫秒的就绪事件并分发，然后执行投递的任务和到期的定时器。
+  // 由别的事件源驱动本 loop 时（io_uring 后端），在 epoll_fd() 可读后以 0 超时调用。
+  // epoll_wait 出错时返回 false
+  bool run_once(int timeout_ms) {
+    std::array<epoll_event, 256> events; // NOLINT: 由 epoll_wait 填写
+    const int n = ::epoll_wait(epoll_fd_.get(), events.data(), static_cast<int>(events.size()),
+                               timeout_ms);
+    if (n < 0 && errno != EINTR) {
+      return false;
+    }
+    for (int i = 0; i < n; ++i) {
+      auto *w = static_cast<Watch *>(events[i].data.ptr);
+      if (w == nullptr) {
+        drain_wakeup();
+        continue;
+      }
+      if (w->active) {
+        w->callback(events[i].events);
+      }
+    }
+
+    run_pending();
+    run_timers();
+    retired_.clear();
+    return true;
+  }
+
+  // 有就绪事件或被 wakeup() 唤醒时可读
+  [[nodiscard]] int epoll_fd() const { return epoll_fd_.get(); }
+
+private:
+  void drain_wakeup() {
+    uint64_t value = 0;
+    while (::read(wakeup_fd_.get(), &value, sizeof(value)) > 0) {
+    }
+  }
+
+  [[nodiscard]] int next_timeout() const { return timers_.next_timeout(); }
+
+  void run_timers() { timers_.advance(); }
+
+  void run_pending() {
+    std::vector<std::function<void()>> tasks;
+    {
+      std::lock_guard lock(pending_mutex_);
+      tasks.swap(pending_);
+    }
+    for (auto &task : tasks) {
+      task();
+    }
+  }
+};
+
+} // namespace http::server
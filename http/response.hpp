@@ -0,0 +1,123 @@
+#pragma once
+#include "../router/types.hpp"
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace http::server {
+
+// 响应体的定界方式。普通响应按 Content-Length；流式响应未给出 Content-Length 时，
+// HTTP/1.1 使用 chunked 编码，HTTP/1.0 不支持 chunked，只能写到连接关闭为止
+enum class BodyFraming { Length, Chunked, UntilClose };
+
+inline BodyFraming framing_of(const router::HttpResponse &response, bool http11 = true) {
+  if (!response.stream || router::has_header(response.headers, "Content-Length")) {
+    return BodyFraming::Length;
+  }
+  return http11 ? BodyFraming::Chunked : BodyFraming::UntilClose;
+}
+
+// 状态行与 header，out 可以是 std::string 或 std::pmr::string。
+// UntilClose 时调用方必须在写完 body 后关闭连接
+template <typename String>
+void append_head(String &out, const router::HttpResponse &response, bool keep_alive,
+                 BodyFraming framing) {
+  out += "HTTP/1.1 ";
+  out += std::to_string(response.status_code);
+  out += ' ';
+  out += response.status_text;
+  out += "\r\n";
+
+  for (const auto &[key, value] : response.headers) {
+    out += key;
+    out += ": ";
+    out += value;
+    out += "\r\n";
+  }
+  for (const auto *block : response.static_headers) {
+    if (block == nullptr) {
+      break;
+    }
+    out += block->text();
+  }
+
+  if (framing == BodyFraming::Chunked) {
+    out += "Transfer-Encoding: chunked\r\n";
+  } else if (framing == BodyFraming::Length &&
+             !router::has_header(response.headers, "Content-Length")) {
+    out += "Content-Length: ";
+    out += std::to_string(response.body_size());
+    out += "\r\n";
+  }
+  if (!router::has_header(response.headers, "Connection")) {
+    out += keep_alive && framing != BodyFraming::UntilClose ? "Connection: keep-alive\r\n"
+                                                            : "Connection: close\r\n";
+  }
+  out += "\r\n";
+}
+
+// chunked 编码的一个数据块；空数据不输出，否则会被当成结束块
+inline void append_chunk(std::string &out, std::string_view data) {
+  if (data.empty()) {
+    return;
+  }
+  char size[20];
+  const int n = std::snprintf(size, sizeof(size), "%zx\r\n", data.size());
+  out.append(size, static_cast<size_t>(n));
+  out += data;
+  out += "\r\n";
+}
+
+inline void append_last_chunk(std::string &out) { out += "0\r\n\r\n"; }
+
+// 整个响应复制进一个字符串：流式响应被一次拉取完毕，文件 body 被读入内存，
+// 只适合测试和小响应。服务器通过 WriteQueue 发送，不做这些复制
+inline void append_response(std::string &out, const router::HttpResponse &response,
+                            bool keep_alive) {
+  const auto framing = framing_of(response);
+  append_head(out, response, keep_alive, framing);
+
+  if (response.file) {
+    const auto start = out.size();
+    out.resize(start + response.file->size());
+    size_t done = 0;
+    while (done < response.file->size()) {
+      const auto n = ::pread(response.file->fd(), out.data() + start + done,
+                             response.file->size() - done, static_cast<off_t>(done));
+      if (n <= 0) {
+        break;
+      }
+      done += static_cast<size_t>(n);
+    }
+    out.resize(start + done);
+    return;
+  }
+  if (!response.stream) {
+    const auto body = response.body_bytes();
+    out.append(reinterpret_cast<const char *>(body.data()), body.size());
+    return;
+  }
+  std::string piece;
+  for (bool more = true; more;) {
+    piece.clear();
+    more = response.stream(piece);
+    if (framing == BodyFraming::Chunked) {
+      append_chunk(out, piece);
+    } else {
+      out += piece;
+    }
+  }
+  if (framing == BodyFraming::Chunked) {
+    append_last_chunk(out);
+  }
+}
+
+inline std::string serialize(const router::HttpResponse &response,
+                             bool keep_alive = false) {
+  std::string out;
+  out.reserve(128 + response.body_size());
+  append_response(out, response, keep_alive);
+  return out;
+}
+
+} // namespace http::server
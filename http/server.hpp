@@ -0,0 +1,255 @@
+#pragma once
+#include "../threadpool/pool.hpp"
+#include "../threadpool/topology.hpp"
+#include "connection.hpp"
+#include "event_loop.hpp"
+#include "uring_driver.hpp"
+#include <algorithm>
+#include <csignal>
+#include <memory>
+#include <optional>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace http::server {
+
+// 连接 I/O 的驱动方式。IoUring 在内核不支持（或被 seccomp 禁用）时由各 reactor 自动退回 Epoll
+enum class IoBackend { Epoll, IoUring };
+
+struct ServerConfig {
+  std::string host = "0.0.0.0";
+  uint16_t port = 9006;
+  size_t num_reactors = std::max(1u, std::thread::hardware_concurrency());
+  ConnectionLimits limits = {};
+  // 每核一个 reactor 的无共享模式：reactor i 绑定到第 i 个可用 CPU（轮转），
+  // 连接等运行期内存优先取自该 CPU 所在的 NUMA 节点
+  bool pin_reactors = false;
+  // 大于 0 时每个 reactor 拥有自己的 ThreadPool，worker 与 reactor 绑定在同一 CPU 上，
+  // handler 通过 this_core().pool 使用
+  size_t workers_per_reactor = 0;
+  // 非空时记录每个请求的解析耗时、按类型的解析错误，以及各 reactor 线程池的排队情况
+  // （pool="reactor<i>"）。路由耗时由 Router::instrument() 单独开启；registry 必须比服务器活得长
+  metrics::Registry *metrics = nullptr;
+  IoBackend io_backend = IoBackend::Epoll;
+  UringOptions uring = {}; // 只对 IoUring 生效
+};
+
+// reactor 线程的本地资源。handler（以及协程 handler 的同步部分）在 reactor 线程上运行，
+// 可以用它取得本核的 event loop 和线程池，不与其他核共享任何状态
+struct CoreContext {
+  EventLoop *loop = nullptr;
+  threadpool::ThreadPool *pool = nullptr;
+  std::optional<threadpool::CpuTopology::Cpu> cpu;
+  IoBackend backend = IoBackend::Epoll; // 本 reactor 实际使用的后端
+};
+
+namespace detail {
+inline CoreContext &core_context() {
+  thread_local CoreContext context;
+  return context;
+}
+} // namespace detail
+
+// 不在 reactor 线程上调用时所有字段为空
+inline const CoreContext &this_core() { return detail::core_context(); }
+
+// 单个 reactor：独占一个监听套接字、一个 event loop 以及其上的全部连接。
+// io_uring 后端由 UringDriver 驱动连接，event loop 只负责定时器、post() 与其他 fd 的监视
+class Reactor {
+  std::shared_ptr<EventLoop> loop_;
+  UniqueFd listen_fd_;
+  router::RouterSnapshot router_;
+  ConnectionLimits limits_;
+  std::optional<threadpool::CpuTopology::Cpu> cpu_;
+  size_t workers_;
+  std::unique_ptr<threadpool::ThreadPool> pool_;
+  metrics::Registry *registry_;
+  std::string name_;
+  ConnectionMetrics metrics_;
+  IoBackend backend_;
+  UringOptions uring_;
+  std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+
+public:
+  Reactor(std::shared_ptr<EventLoop> loop, UniqueFd listen_fd,
+          const router::RouterHandle &router, ConnectionLimits limits,
+          std::optional<threadpool::CpuTopology::Cpu> cpu = std::nullopt, size_t workers = 0,
+          metrics::Registry *registry = nullptr, std::string name = "reactor",
+          IoBackend backend = IoBackend::Epoll, UringOptions uring = {})
+      : loop_(std::move(loop)), listen_fd_(std::move(listen_fd)), router_(router),
+        limits_(limits), cpu_(cpu), workers_(workers), registry_(registry),
+        name_(std::move(name)),
+        metrics_(registry ? ConnectionMetrics::create(*registry) : ConnectionMetrics{}),
+        backend_(backend), uring_(uring) {}
+
+  // 线程池在绑定 CPU 之后才创建，它的内存与 worker 都留在本地节点上；
+  // io_uring 也在本线程上创建（只允许创建它的线程提交）
+  void run(std::stop_token stoken) {
+    block_sigpipe();
+    if (cpu_) {
+      threadpool::bind_current_thread(*cpu_);
+    }
+    if (workers_ > 0) {
+      if (cpu_) {
+        std::vector<threadpool::CpuTopology::Cpu> cpus(workers_, *cpu_);
+        pool_ = std::make_unique<threadpool::ThreadPool>(std::span(cpus));
+      } else {
+        pool_ = std::make_unique<threadpool::ThreadPool>(workers_);
+      }
+      if (registry_ != nullptr) {
+        pool_->instrument(*registry_, name_);
+      }
+    }
+    std::unique_ptr<UringDriver> driver;
+    if (backend_ == IoBackend::IoUring) {
+      if (auto created = UringDriver::create(loop_, listen_fd_.get(), router_, limits_,
+                                             registry_ ? &metrics_ : nullptr, uring_)) {
+        driver = std::move(*created);
+      }
+    }
+    detail::core_context() = CoreContext{loop_.get(), pool_.get(), cpu_,
+                                         driver ? IoBackend::IoUring : IoBackend::Epoll};
+
+    if (driver) {
+      driver->run(stoken);
+      driver.reset();
+    } else {
+      loop_->watch(listen_fd_.get(), EPOLLIN | EPOLLET, [this](uint32_t) { on_accept(); });
+      loop_->run(stoken);
+      connections_.clear();
+    }
+
+    detail::core_context() = CoreContext{};
+    pool_.reset();
+  }
+
+  [[nodiscard]] EventLoop &loop() { return *loop_; }
+
+private:
+  // sendfile 没有 MSG_NOSIGNAL：对端关闭后写入产生的 SIGPIPE 在本线程上屏蔽，
+  // 只留下 EPIPE 错误，不改变进程级的信号处理
+  static void block_sigpipe() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    ::pthread_sigmask(SIG_BLOCK, &set, nullptr);
+  }
+
+  void on_accept() {
+    while (true) {
+      const int fd = ::accept4(listen_fd_.get(), nullptr, nullptr,
+                               SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) {
+          continue;
+        }
+        return; // EAGAIN，或 EMFILE 等资源耗尽：等下一次事件
+      }
+
+      const int one = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+      // 协程响应的完成回调：连接仍存活时 fd 一定还对应同一个 Connection
+      auto on_ready = [this, fd](uint32_t events) {
+        if (auto it = connections_.find(fd); it != connections_.end()) {
+          on_connection_event(it->second.get(), events);
+        }
+      };
+      auto conn = std::make_unique<Connection>(UniqueFd(fd), router_, loop_, std::move(on_ready),
+                                               limits_, registry_ ? &metrics_ : nullptr);
+      auto *raw = conn.get();
+      if (!loop_->watch(fd, Connection::kEvents,
+                        [this, raw](uint32_t events) { on_connection_event(raw, events); })) {
+        continue;
+      }
+      connections_[fd] = std::move(conn);
+    }
+  }
+
+  void on_connection_event(Connection *conn, uint32_t events) {
+    conn->on_event(events);
+    if (conn->closed()) {
+      const int fd = conn->fd();
+      loop_->unwatch(fd);
+      connections_.erase(fd);
+    }
+  }
+};
+
+class Server {
+  ServerConfig config_;
+  router::RouterHandle router_;
+  std::vector<std::unique_ptr<Reactor>> reactors_;
+  std::vector<std::jthread> threads_;
+  uint16_t bound_port_ = 0;
+
+public:
+  Server(ServerConfig config, router::Router router)
+      : config_(std::move(config)), router_(std::move(router)) {}
+
+  ~Server() { stop(); }
+
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+
+  // 在调用线程上完成全部监听套接字的创建，出错时不会启动任何线程
+  ServerResult<void> start() {
+    uint16_t port = config_.port;
+    std::vector<std::unique_ptr<Reactor>> reactors;
+
+    std::vector<threadpool::CpuTopology::Cpu> cpus;
+    if (config_.pin_reactors) {
+      cpus = threadpool::CpuTopology::detect().cpus();
+    }
+
+    for (size_t i = 0; i < config_.num_reactors; ++i) {
+      auto listen_fd = make_listen_socket(config_.host, port);
+      if (!listen_fd) {
+        return std::unexpected(listen_fd.error());
+      }
+      if (port == 0) {
+        port = local_port(listen_fd->get());
+      }
+
+      auto loop = EventLoop::create();
+      if (!loop) {
+        return std::unexpected(loop.error());
+      }
+      std::optional<threadpool::CpuTopology::Cpu> cpu;
+      if (!cpus.empty()) {
+        cpu = cpus[i % cpus.size()];
+      }
+      reactors.push_back(std::make_unique<Reactor>(std::move(*loop), std::move(*listen_fd), router_,
+                                                   config_.limits, cpu,
+                                                   config_.workers_per_reactor, config_.metrics,
+                                                   "reactor" + std::to_string(i),
+                                                   config_.io_backend, config_.uring));
+    }
+
+    bound_port_ = port;
+    reactors_ = std::move(reactors);
+    for (auto &reactor : reactors_) {
+      threads_.emplace_back(
+          [r = reactor.get()](std::stop_token stoken) { r->run(stoken); });
+    }
+    return {};
+  }
+
+  void stop() {
+    for (auto &t : threads_) {
+      t.request_stop();
+    }
+    threads_.clear();
+    reactors_.clear();
+  }
+
+  [[nodiscard]] uint16_t port() const { return bound_port_; }
+
+  // 热更新路由：之后到达的请求使用新路由表，正在处理的请求不受影响
+  void reload(router::Router router) { router_.store(std::move(router)); }
+};
+
+} // namespace http::server
@@ -0,0 +1,106 @@
+#pragma once
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdint>
+#include <expected>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+namespace http::server {
+
+enum class ServerError {
+  SocketFailed,
+  BindFailed,
+  ListenFailed,
+  EpollFailed,
+  EventFdFailed,
+  InvalidAddress,
+  IoFailed,
+  UringFailed
+};
+
+template <typename T> using ServerResult = std::expected<T, ServerError>;
+
+class UniqueFd {
+  int fd_ = -1;
+
+public:
+  UniqueFd() = default;
+  explicit UniqueFd(int fd) : fd_(fd) {}
+
+  UniqueFd(const UniqueFd &) = delete;
+  UniqueFd &operator=(const UniqueFd &) = delete;
+
+  UniqueFd(UniqueFd &&other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+  UniqueFd &operator=(UniqueFd &&other) noexcept {
+    if (this != &other) {
+      reset(std::exchange(other.fd_, -1));
+    }
+    return *this;
+  }
+
+  ~UniqueFd() { reset(); }
+
+  void reset(int fd = -1) {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+    fd_ = fd;
+  }
+
+  [[nodiscard]] int get() const { return fd_; }
+  [[nodiscard]] int release() { return std::exchange(fd_, -1); }
+  explicit operator bool() const { return fd_ >= 0; }
+};
+
+inline bool set_nonblocking(int fd) {
+  const int flags = ::fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// 每个 reactor 各自持有一个 SO_REUSEPORT 监听套接字，由内核在它们之间分发连接
+inline ServerResult<UniqueFd> make_listen_socket(const std::string &host,
+                                                 uint16_t port,
+                                                 int backlog = SOMAXCONN) {
+  UniqueFd fd(::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+  if (!fd) {
+    return std::unexpected(ServerError::SocketFailed);
+  }
+
+  const int one = 1;
+  ::setsockopt(fd.get(), SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (::setsockopt(fd.get(), SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+    return std::unexpected(ServerError::SocketFailed);
+  }
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+    return std::unexpected(ServerError::InvalidAddress);
+  }
+
+  if (::bind(fd.get(), reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+    return std::unexpected(ServerError::BindFailed);
+  }
+  if (::listen(fd.get(), backlog) != 0) {
+    return std::unexpected(ServerError::ListenFailed);
+  }
+  return fd;
+}
+
+inline uint16_t local_port(int fd) {
+  sockaddr_in addr{};
+  socklen_t len = sizeof(addr);
+  if (::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0) {
+    return 0;
+  }
+  return ntohs(addr.sin_port);
+}
+
+} // namespace http::server
@@ -0,0 +1,274 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace http::server {
+
+// 分层时间轮：4 层，每层 256 个槽位，第 0 层一格一个 tick（默认 1 ms），共可表示 2^32 个 tick
+// （约 49 天，更远的到期时间按上限处理）。第 L 层的一个槽位覆盖 256^L 个 tick，推进到它的起点时
+// 才把其中的定时器重新分配到下层（cascade），所以每个定时器最多被移动 3 次。
+// 定时器是侵入式的双向链表节点，嵌在拥有者里：设置、重新设置、取消都是 O(1) 且不分配内存。
+// 不是线程安全的，只在所属 event loop 的线程上使用
+class TimerWheel {
+  struct Link {
+    Link *prev = this;
+    Link *next = this;
+
+    Link() = default;
+    Link(const Link &) = delete;
+    Link &operator=(const Link &) = delete;
+
+    [[nodiscard]] bool empty() const { return next == this; }
+
+    void push_back(Link &node) {
+      node.prev = prev;
+      node.next = this;
+      prev->next = &node;
+      prev = &node;
+    }
+
+    void unlink() {
+      prev->next = next;
+      next->prev = prev;
+      prev = next = this;
+    }
+
+    // 把 from 的全部节点移到空链表 this 上
+    void take(Link &from) {
+      if (from.empty()) {
+        return;
+      }
+      next = from.next;
+      prev = from.prev;
+      next->prev = this;
+      prev->next = this;
+      from.prev = from.next = &from;
+    }
+  };
+
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr int kLevels = 4;
+  static constexpr int kSlotBits = 8;
+  static constexpr size_t kSlots = size_t{1} << kSlotBits;
+  static constexpr uint64_t kMaxTicks = (uint64_t{1} << (kLevels * kSlotBits)) - 1;
+
+  // 回调是函数指针加上下文指针：触发时时间轮已经不再引用这个定时器，
+  // 回调里可以销毁定时器本身，例如关闭并释放拥有它的连接
+  class Timer : Link {
+    friend class TimerWheel;
+
+  public:
+    using Callback = void (*)(void *context);
+
+    // on_drop 在时间轮析构时对仍未触发的定时器调用，用于释放时间轮独占的定时器
+    Timer(Callback callback, void *context, Callback on_drop = nullptr)
+        : callback_(callback), on_drop_(on_drop), context_(context) {}
+
+    ~Timer() { cancel(); }
+
+    [[nodiscard]] bool armed() const { return wheel_ != nullptr; }
+
+    void cancel() {
+      if (wheel_ != nullptr) {
+        wheel_->remove(*this);
+      }
+    }
+
+  private:
+    static constexpr uint16_t kDetached = 0xFFFF;
+
+    Callback callback_;
+    Callback on_drop_;
+    void *context_;
+    TimerWheel *wheel_ = nullptr;
+    uint64_t expiry_ = 0;       // 到期的 tick
+    uint16_t slot_ = kDetached; // level * kSlots + index；正在触发或重新分配时为 kDetached
+  };
+
+  explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds(1),
+                      Clock::time_point origin = Clock::now())
+      : origin_(origin), tick_(tick) {}
+
+  TimerWheel(const TimerWheel &) = delete;
+  TimerWheel &operator=(const TimerWheel &) = delete;
+
+  ~TimerWheel() {
+    for (auto &level : slots_) {
+      for (auto &head : level) {
+        while (!head.empty()) {
+          auto &timer = static_cast<Timer &>(*head.next);
+          timer.unlink();
+          timer.wheel_ = nullptr;
+          if (timer.on_drop_ != nullptr) {
+            timer.on_drop_(timer.context_);
+          }
+        }
+      }
+    }
+  }
+
+  // 在 now + delay 之后触发；已设置的定时器改为新的到期时间。
+  // 到期时间向上取整到 tick，所以不会提前触发，最多晚一个 tick 加上 event loop 的延迟
+  void schedule(Timer &timer, Clock::duration delay, Clock::time_point now = Clock::now()) {
+    if (timer.armed()) {
+      remove(timer);
+    }
+    const auto target = now + delay - origin_;
+    uint64_t expiry = 0;
+    if (target > Clock::duration::zero()) {
+      expiry = static_cast<uint64_t>((target + tick_ - Clock::duration(1)) / tick_);
+    }
+    expiry = std::max(expiry, current_ + 1);
+    expiry = std::min(expiry, current_ + kMaxTicks);
+
+    timer.expiry_ = expiry;
+    timer.wheel_ = this;
+    ++size_;
+    link(timer);
+  }
+
+  // 触发所有到期时间不晚于 now 的定时器，按到期的 tick 顺序
+  void advance(Clock::time_point now = Clock::now()) {
+    const uint64_t target = tick_of(now);
+    while (current_ < target) {
+      if (size_ == 0) {
+        current_ = target;
+        return;
+      }
+      // 跳过中间没有任何槽位需要处理的 tick
+      current_ = std::max(current_, std::min(target, next_event()) - 1);
+      ++current_;
+      for (int level = kLevels - 1; level >= 1; --level) {
+        const int shift = level * kSlotBits;
+        if ((current_ & ((uint64_t{1} << shift) - 1)) == 0) {
+          cascade(level, static_cast<size_t>((current_ >> shift) & (kSlots - 1)));
+        }
+      }
+      fire(static_cast<size_t>(current_ & (kSlots - 1)));
+    }
+  }
+
+  // 距下一次需要 advance() 的毫秒数（向上取整），没有定时器时为 -1，可直接作为 epoll_wait 的超时。
+  // 只有远期定时器时返回的是下一次 cascade 的时刻，到时重新计算
+  [[nodiscard]] int next_timeout(Clock::time_point now = Clock::now()) const {
+    if (size_ == 0) {
+      return -1;
+    }
+    const auto deadline = origin_ + tick_ * static_cast<Clock::rep>(next_event());
+    if (deadline <= now) {
+      return 0;
+    }
+    const auto ms = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+    return static_cast<int>(std::min<int64_t>(ms, std::numeric_limits<int>::max()));
+  }
+
+  // 已设置、尚未触发的定时器数
+  [[nodiscard]] size_t size() const { return size_; }
+
+private:
+  std::array<std::array<Link, kSlots>, kLevels> slots_;
+  std::array<std::array<uint64_t, kSlots / 64>, kLevels> occupied_{};
+  Clock::time_point origin_;
+  Clock::duration tick_;
+  uint64_t current_ = 0; // 已处理到的 tick
+  size_t size_ = 0;
+
+  [[nodiscard]] uint64_t tick_of(Clock::time_point now) const {
+    const auto elapsed = now - origin_;
+    return elapsed > Clock::duration::zero() ? static_cast<uint64_t>(elapsed / tick_) : 0;
+  }
+
+  // 按剩余 tick 数选层：剩余不足 256^(L+1) 的放在第 L 层，槽位取到期 tick 的第 L 组 8 位
+  void link(Timer &timer) {
+    const uint64_t delta = timer.expiry_ - current_;
+    int level = 0;
+    while (level < kLevels - 1 && delta >> ((level + 1) * kSlotBits) != 0) {
+      ++level;
+    }
+    const auto index = static_cast<size_t>((timer.expiry_ >> (level * kSlotBits)) & (kSlots - 1));
+    slots_[level][index].push_back(timer);
+    occupied_[level][index / 64] |= uint64_t{1} << (index % 64);
+    timer.slot_ = static_cast<uint16_t>(level * kSlots + index);
+  }
+
+  void remove(Timer &timer) {
+    timer.unlink();
+    if (timer.slot_ != Timer::kDetached) {
+      const size_t level = timer.slot_ / kSlots;
+      const size_t index = timer.slot_ % kSlots;
+      if (slots_[level][index].empty()) {
+        occupied_[level][index / 64] &= ~(uint64_t{1} << (index % 64));
+      }
+      timer.slot_ = Timer::kDetached;
+    }
+    timer.wheel_ = nullptr;
+    --size_;
+  }
+
+  // 把一个槽位原样摘到 out 上，槽位清空
+  void detach(int level, size_t index, Link &out) {
+    out.take(slots_[level][index]);
+    occupied_[level][index / 64] &= ~(uint64_t{1} << (index % 64));
+    for (Link *node = out.next; node != &out; node = node->next) {
+      static_cast<Timer *>(node)->slot_ = Timer::kDetached;
+    }
+  }
+
+  void cascade(int level, size_t index) {
+    Link pending;
+    detach(level, index, pending);
+    while (!pending.empty()) {
+      auto &timer = static_cast<Timer &>(*pending.next);
+      timer.unlink();
+      link(timer);
+    }
+  }
+
+  // 回调可能取消或重新设置任何定时器，包括同一槽位里尚未触发的那些
+  void fire(size_t index) {
+    Link due;
+    detach(0, index, due);
+    while (!due.empty()) {
+      auto &timer = static_cast<Timer &>(*due.next);
+      timer.unlink();
+      timer.wheel_ = nullptr;
+      --size_;
+      timer.callback_(timer.context_);
+    }
+  }
+
+  // 从 from 开始（含）循环查找第一个有定时器的槽位，返回距离；全空时返回 kSlots
+  [[nodiscard]] size_t next_occupied(int level, size_t from) const {
+    for (size_t n = 0; n < kSlots;) {
+      const size_t i = (from + n) & (kSlots - 1);
+      if (const uint64_t word = occupied_[level][i / 64] >> (i % 64); word != 0) {
+        return n + static_cast<size_t>(std::countr_zero(word));
+      }
+      n += 64 - i % 64;
+    }
+    return kSlots;
+  }
+
+  // 下一个需要处理的 tick：第 0 层是最早的到期时间，更高层是最早一个非空槽位的 cascade 时刻
+  [[nodiscard]] uint64_t next_event() const {
+    uint64_t best = std::numeric_limits<uint64_t>::max();
+    for (int level = 0; level < kLevels; ++level) {
+      const int shift = level * kSlotBits;
+      const uint64_t block = current_ >> shift;
+      const size_t distance = next_occupied(level, static_cast<size_t>((block + 1) & (kSlots - 1)));
+      if (distance < kSlots) {
+        best = std::min(best, (block + 1 + distance) << shift);
+      }
+    }
+    return best;
+  }
+};
+
+} // namespace http::server
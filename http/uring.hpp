@@ -0,0 +1,264 @@
+#pragma once
+#include "socket.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <linux/io_uring.h>
+#include <memory>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace http::server {
+
+// io_uring 的最小封装：直接用系统调用建立并映射提交/完成队列，不依赖 liburing。
+// 以 SINGLE_ISSUER | DEFER_TASKRUN 创建（内核不支持时退回默认参数），完成事件只在
+// submit_and_wait() 里处理，所以只能在创建它的线程上使用
+class Uring {
+  UniqueFd fd_;
+  void *rings_ = MAP_FAILED;
+  size_t rings_size_ = 0;
+  io_uring_sqe *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned *sq_head_ = nullptr;
+  unsigned *sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned sq_entries_ = 0;
+  unsigned sq_local_tail_ = 0; // 已填写、尚未发布给内核的 SQE 到这里为止
+
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+
+  Uring() = default;
+
+  static unsigned load_acquire(const unsigned *p) {
+    return std::atomic_ref(*const_cast<unsigned *>(p)).load(std::memory_order_acquire);
+  }
+  static void store_release(unsigned *p, unsigned value) {
+    std::atomic_ref(*p).store(value, std::memory_order_release);
+  }
+
+public:
+  static constexpr uint32_t kRequiredFeatures =
+      IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+
+  // entries 为提交队列长度，完成队列是它的 4 倍（多发的 accept/recv 一次提交产生多个完成）
+  static ServerResult<std::unique_ptr<Uring>> create(unsigned entries) {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    params.cq_entries = entries * 4;
+    int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0 && errno == EINVAL) {
+      params = io_uring_params{};
+      params.flags = IORING_SETUP_CQSIZE;
+      params.cq_entries = entries * 4;
+      fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    }
+    if (fd < 0) {
+      return std::unexpected(ServerError::UringFailed);
+    }
+
+    std::unique_ptr<Uring> ring(new Uring());
+    ring->fd_.reset(fd);
+    if ((params.features & kRequiredFeatures) != kRequiredFeatures) {
+      return std::unexpected(ServerError::UringFailed);
+    }
+
+    // SINGLE_MMAP：提交队列和完成队列的环共用一次映射
+    ring->rings_size_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                 params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    ring->rings_ = ::mmap(nullptr, ring->rings_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->rings_ == MAP_FAILED) {
+      return std::unexpected(ServerError::UringFailed);
+    }
+    ring->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = ::mmap(nullptr, ring->sqes_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+      return std::unexpected(ServerError::UringFailed);
+    }
+    ring->sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    auto *base = static_cast<char *>(ring->rings_);
+    ring->sq_head_ = reinterpret_cast<unsigned *>(base + params.sq_off.head);
+    ring->sq_tail_ = reinterpret_cast<unsigned *>(base + params.sq_off.tail);
+    ring->sq_mask_ = *reinterpret_cast<unsigned *>(base + params.sq_off.ring_mask);
+    ring->sq_entries_ = params.sq_entries;
+    ring->sq_local_tail_ = *ring->sq_tail_;
+    // 提交队列的间接数组固定为恒等映射：第 i 个位置就是第 i 个 SQE
+    auto *array = reinterpret_cast<unsigned *>(base + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; ++i) {
+      array[i] = i;
+    }
+    ring->cq_head_ = reinterpret_cast<unsigned *>(base + params.cq_off.head);
+    ring->cq_tail_ = reinterpret_cast<unsigned *>(base + params.cq_off.tail);
+    ring->cq_mask_ = *reinterpret_cast<unsigned *>(base + params.cq_off.ring_mask);
+    ring->cqes_ = reinterpret_cast<io_uring_cqe *>(base + params.cq_off.cqes);
+    return ring;
+  }
+
+  // 当前内核能否建立满足要求的 io_uring（容器或 seccomp 可能禁用它）
+  [[nodiscard]] static bool supported() { return create(8).has_value(); }
+
+  Uring(const Uring &) = delete;
+  Uring &operator=(const Uring &) = delete;
+
+  // 先关闭 fd 再解除映射：关闭时内核取消仍在进行的请求
+  ~Uring() {
+    fd_.reset();
+    if (sqes_ != nullptr) {
+      ::munmap(sqes_, sqes_size_);
+    }
+    if (rings_ != MAP_FAILED) {
+      ::munmap(rings_, rings_size_);
+    }
+  }
+
+  [[nodiscard]] int fd() const { return fd_.get(); }
+
+  // 保证接下来的 n 次 get_sqe() 不会中途提交，用于必须在同一批提交里的链接请求
+  bool reserve(unsigned n) {
+    if (sq_entries_ - (sq_local_tail_ - load_acquire(sq_head_)) < n) {
+      submit_and_wait(0, 0);
+    }
+    return sq_entries_ - (sq_local_tail_ - load_acquire(sq_head_)) >= n;
+  }
+
+  // 取一个清零的 SQE；队列满时先提交已填写的部分，仍然没有空位时返回 nullptr
+  io_uring_sqe *get_sqe() {
+    if (!reserve(1)) {
+      return nullptr;
+    }
+    auto *sqe = &sqes_[sq_local_tail_ & sq_mask_];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++sq_local_tail_;
+    return sqe;
+  }
+
+  // 一次系统调用：提交全部已填写的 SQE，并在 wait > 0 时等待至少 wait 个完成或 timeout_ms
+  // 毫秒（-1 为不限）。超时与被信号打断不算错误；返回 false 表示 ring 已不可用
+  bool submit_and_wait(unsigned wait, int timeout_ms) {
+    store_release(sq_tail_, sq_local_tail_);
+    const unsigned to_submit = sq_local_tail_ - load_acquire(sq_head_);
+    if (to_submit == 0 && wait == 0) {
+      return true;
+    }
+
+    unsigned flags = 0;
+    __kernel_timespec ts{};
+    io_uring_getevents_arg arg{};
+    arg.sigmask_sz = _NSIG / 8;
+    if (wait > 0) {
+      flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+      if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1'000'000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+      }
+    }
+    const long ret = ::syscall(__NR_io_uring_enter, fd_.get(), to_submit, wait, flags,
+                               wait > 0 ? &arg : nullptr, wait > 0 ? sizeof(arg) : 0);
+    if (ret < 0) {
+      return errno == ETIME || errno == EINTR || errno == EAGAIN || errno == EBUSY;
+    }
+    return true;
+  }
+
+  // 依次处理已到达的完成事件；回调里可以继续 get_sqe()，新的 SQE 在下一次 submit_and_wait() 提交
+  template <typename F> unsigned for_each_completion(F &&on_completion) {
+    unsigned head = *cq_head_;
+    const unsigned tail = load_acquire(cq_tail_);
+    unsigned count = 0;
+    for (; head != tail; ++count) {
+      const io_uring_cqe cqe = cqes_[head & cq_mask_];
+      store_release(cq_head_, ++head); // 先归还槽位，回调里产生的完成不会溢出
+      on_completion(cqe);
+    }
+    return count;
+  }
+};
+
+// 提供给内核的接收缓冲区环（IORING_REGISTER_PBUF_RING）：多发的 recv 到达时由内核挑一个
+// 空闲缓冲区写入，完成事件带回它的编号；处理完数据后 recycle() 放回环里。
+// entries 必须是 2 的幂；析构前所有引用这个缓冲区组的请求都必须已经结束
+class BufferRing {
+  // 按 io_uring_buf 数组访问：C++ 里 io_uring_buf_ring 的柔性数组成员不在偏移 0 处。
+  // 环的 tail 与 bufs[0].resv 重叠
+  io_uring_buf *ring_ = nullptr;
+  size_t ring_size_ = 0;
+  std::unique_ptr<char[]> storage_;
+  unsigned entries_ = 0;
+  size_t buffer_size_ = 0;
+  uint16_t group_ = 0;
+  uint16_t tail_ = 0;
+
+  BufferRing() = default;
+
+public:
+  static ServerResult<std::unique_ptr<BufferRing>> create(Uring &ring, uint16_t group,
+                                                          unsigned entries, size_t buffer_size) {
+    if (entries == 0 || (entries & (entries - 1)) != 0 || entries > 32768) {
+      return std::unexpected(ServerError::UringFailed);
+    }
+    std::unique_ptr<BufferRing> buffers(new BufferRing());
+    buffers->ring_size_ = entries * sizeof(io_uring_buf);
+    void *mem = ::mmap(nullptr, buffers->ring_size_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      return std::unexpected(ServerError::UringFailed);
+    }
+    buffers->ring_ = static_cast<io_uring_buf *>(mem);
+    buffers->storage_ = std::make_unique_for_overwrite<char[]>(entries * buffer_size);
+    buffers->entries_ = entries;
+    buffers->buffer_size_ = buffer_size;
+    buffers->group_ = group;
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(mem);
+    reg.ring_entries = entries;
+    reg.bgid = group;
+    if (::syscall(__NR_io_uring_register, ring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+      return std::unexpected(ServerError::UringFailed);
+    }
+    for (unsigned i = 0; i < entries; ++i) {
+      buffers->recycle(static_cast<uint16_t>(i));
+    }
+    return buffers;
+  }
+
+  BufferRing(const BufferRing &) = delete;
+  BufferRing &operator=(const BufferRing &) = delete;
+
+  // 不注销：关闭 ring 的 fd 时内核一并释放。所以要在 ring 之后销毁
+  ~BufferRing() {
+    if (ring_ != nullptr) {
+      ::munmap(ring_, ring_size_);
+    }
+  }
+
+  [[nodiscard]] uint16_t group() const { return group_; }
+
+  [[nodiscard]] std::string_view view(uint16_t id, size_t size) const {
+    return {storage_.get() + static_cast<size_t>(id) * buffer_size_, size};
+  }
+
+  void recycle(uint16_t id) {
+    auto &buf = ring_[tail_ & (entries_ - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(storage_.get() + static_cast<size_t>(id) * buffer_size_);
+    buf.len = static_cast<uint32_t>(buffer_size_);
+    buf.bid = id;
+    ++tail_;
+    std::atomic_ref(ring_[0].resv).store(tail_, std::memory_order_release);
+  }
+};
+
+} // namespace http::server
@@ -0,0 +1,489 @@
+#pragma once
+#include "connection.hpp"
+#include "event_loop.hpp"
+#include "uring.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fcntl.h>
+#include <memory>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace http::server {
+
+struct UringOptions {
+  unsigned entries = 1024;        // 提交队列长度
+  unsigned buffers = 512;         // 接收缓冲区个数（2 的幂），同一 reactor 的连接共用
+  size_t buffer_size = 16 * 1024; // 每个接收缓冲区的字节数
+};
+
+// io_uring 后端：一个 reactor 线程上的一个 ring 驱动监听套接字和其上的全部连接。
+// 连接本身（解析、路由、写队列、超时）与 epoll 后端是同一个 Connection，handler 不感知差别。
+// - 多发 accept：一个 SQE 持续产生新连接
+// - 每个连接一个多发 recv，从共享的提供缓冲区环取缓冲区，数据直接交给解析器后立即归还；
+//   连接输入积压（Connection::input_backlogged()）时取消它，积压解除后重新提交
+// - 排队的内存片段（含管线化的多个响应）一次 SENDMSG 写出；文件 body 用链接的两个 SPLICE
+//   （文件 → 管道 → 套接字）从页缓存发出
+// - reactor 的 EventLoop 仍负责定时器、post() 和 async_io 的 fd 监视：ring 上挂一个对它的
+//   epoll fd 的 POLL_ADD，可读时以 0 超时跑一轮；等待完成事件的超时取自它的时间轮
+// 连接的套接字保持阻塞模式：recv/sendmsg 由 io_uring 自己做非阻塞尝试加 poll，而 SPLICE
+// 在内核工作线程里执行，遇到非阻塞套接字写满只会返回 EAGAIN
+class UringDriver {
+  enum class Op : uint8_t { Nop, Accept, LoopPoll, Recv, Send, SpliceIn, SpliceOut, Cancel };
+
+  // 关闭连接时给正在进行的写操作（例如超时发出的 408）留出的时间
+  static constexpr std::chrono::milliseconds kLinger{1000};
+  static constexpr size_t kPipeSize = 256 * 1024;
+
+  struct Slot {
+    uint64_t id;
+    std::unique_ptr<Connection> conn;
+    std::array<iovec, WriteQueue::kMaxIov> iov{};
+    msghdr msg{};
+    UniqueFd pipe_read;  // 第一次发送文件时创建
+    UniqueFd pipe_write;
+    size_t pipe_capacity = 0;
+    size_t piped = 0;      // 已进入管道、尚未写到套接字的文件字节
+    unsigned inflight = 0; // 尚未收到最终完成事件的请求数，归零前不能销毁
+    unsigned writes = 0;   // 本轮写操作中尚未完成的个数
+    size_t written = 0;    // 本轮已写到套接字的字节
+    bool write_failed = false;
+    bool receiving = false;
+    bool recv_paused = false; // 因输入积压取消了 recv 或没有重新提交
+    bool closing = false;
+    TimerWheel::Timer linger{
+        [](void *self) { ::shutdown(static_cast<Slot *>(self)->conn->fd(), SHUT_RDWR); }, this};
+
+    explicit Slot(uint64_t slot_id) : id(slot_id) {}
+  };
+
+  std::shared_ptr<EventLoop> loop_;
+  int listen_fd_;
+  router::RouterSnapshot &router_;
+  ConnectionLimits limits_;
+  const ConnectionMetrics *metrics_;
+  // ring 必须先于缓冲区环销毁：关闭它时内核结束仍在引用缓冲区的请求
+  std::unique_ptr<BufferRing> buffers_;
+  std::unique_ptr<Uring> ring_;
+  std::unordered_map<uint64_t, std::unique_ptr<Slot>> slots_;
+  uint64_t next_id_ = 1; // 0 留给不属于连接的请求
+  bool stopping_ = false;
+  // accept 因资源耗尽（EMFILE 等）结束时，稍后再重新提交
+  TimerWheel::Timer accept_retry_{
+      [](void *self) { static_cast<UringDriver *>(self)->arm_accept(); }, this};
+
+  UringDriver(std::shared_ptr<EventLoop> loop, int listen_fd, router::RouterSnapshot &router,
+              ConnectionLimits limits, const ConnectionMetrics *metrics)
+      : loop_(std::move(loop)), listen_fd_(listen_fd), router_(router), limits_(limits),
+        metrics_(metrics) {}
+
+  static uint64_t tag(uint64_t id, Op op) { return id << 8 | static_cast<uint64_t>(op); }
+
+public:
+  // 必须在运行它的线程上创建；内核不支持所需特性时失败，调用方退回 epoll
+  static ServerResult<std::unique_ptr<UringDriver>>
+  create(std::shared_ptr<EventLoop> loop, int listen_fd, router::RouterSnapshot &router,
+         ConnectionLimits limits, const ConnectionMetrics *metrics, UringOptions options = {}) {
+    std::unique_ptr<UringDriver> driver(
+        new UringDriver(std::move(loop), listen_fd, router, limits, metrics));
+    auto ring = Uring::create(options.entries);
+    if (!ring) {
+      return std::unexpected(ring.error());
+    }
+    auto buffers = BufferRing::create(**ring, 0, options.buffers, options.buffer_size);
+    if (!buffers) {
+      return std::unexpected(buffers.error());
+    }
+    driver->ring_ = std::move(*ring);
+    driver->buffers_ = std::move(*buffers);
+    return driver;
+  }
+
+  UringDriver(const UringDriver &) = delete;
+  UringDriver &operator=(const UringDriver &) = delete;
+
+  void run(std::stop_token stoken) {
+    {
+      std::stop_callback on_stop(stoken, [this] { loop_->wakeup(); });
+      arm_accept();
+      arm_loop_poll();
+      while (!stoken.stop_requested()) {
+        if (!ring_->submit_and_wait(1, loop_->timers().next_timeout())) {
+          break;
+        }
+        ring_->for_each_completion([this](const io_uring_cqe &cqe) { on_completion(cqe); });
+        loop_->timers().advance();
+      }
+    }
+    drain();
+  }
+
+private:
+  void on_completion(const io_uring_cqe &cqe) {
+    const auto op = static_cast<Op>(cqe.user_data & 0xFF);
+    switch (op) {
+    case Op::Nop:
+    case Op::Cancel:
+      return;
+    case Op::Accept:
+      on_accept(cqe);
+      return;
+    case Op::LoopPoll:
+      if (!stopping_) {
+        loop_->run_once(0);
+        arm_loop_poll();
+      }
+      return;
+    default:
+      break;
+    }
+
+    auto it = slots_.find(cqe.user_data >> 8);
+    if (it == slots_.end()) {
+      return;
+    }
+    Slot &slot = *it->second;
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+      --slot.inflight;
+    }
+    if (op == Op::Recv) {
+      on_recv(slot, cqe);
+    } else {
+      on_write(slot, op, cqe.res);
+    }
+    settle(slot);
+  }
+
+  void arm_accept() {
+    auto *sqe = ring_->get_sqe();
+    if (sqe == nullptr) {
+      loop_->timers().schedule(accept_retry_, std::chrono::milliseconds(10));
+      return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd_;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = tag(0, Op::Accept);
+  }
+
+  void arm_loop_poll() {
+    auto *sqe = ring_->get_sqe();
+    if (sqe == nullptr) {
+      return;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = loop_->epoll_fd();
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = tag(0, Op::LoopPoll);
+  }
+
+  void cancel(uint64_t user_data) {
+    if (auto *sqe = ring_->get_sqe()) {
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd = -1;
+      sqe->addr = user_data;
+      sqe->user_data = tag(0, Op::Cancel);
+    }
+  }
+
+  void on_accept(const io_uring_cqe &cqe) {
+    if (cqe.res >= 0) {
+      add_connection(cqe.res);
+    }
+    if (!(cqe.flags & IORING_CQE_F_MORE) && !stopping_) {
+      if (cqe.res < 0 && cqe.res != -ECANCELED) {
+        loop_->timers().schedule(accept_retry_, std::chrono::milliseconds(10));
+      } else {
+        arm_accept();
+      }
+    }
+  }
+
+  void add_connection(int fd) {
+    if (stopping_) {
+      ::close(fd);
+      return;
+    }
+    const int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    const uint64_t id = next_id_++;
+    auto owned = std::make_unique<Slot>(id);
+    Slot &slot = *owned;
+    // 协程响应的完成回调与超时：连接仍存活时 id 一定还对应同一个 Slot
+    slot.conn = std::make_unique<Connection>(
+        UniqueFd(fd), router_, loop_, [this, id](uint32_t events) { on_ready(id, events); },
+        limits_, metrics_);
+    slot.conn->use_completion_io([this, &slot] { submit_write(slot); });
+    slots_.emplace(id, std::move(owned));
+    arm_recv(slot);
+    settle(slot);
+  }
+
+  void on_ready(uint64_t id, uint32_t events) {
+    auto it = slots_.find(id);
+    if (it == slots_.end()) {
+      return;
+    }
+    Slot &slot = *it->second;
+    if (!slot.closing) {
+      slot.conn->on_event(events);
+    }
+    settle(slot);
+  }
+
+  void arm_recv(Slot &slot) {
+    auto *sqe = ring_->get_sqe();
+    if (sqe == nullptr) {
+      slot.conn->on_io_error();
+      return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = slot.conn->fd();
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffers_->group();
+    sqe->user_data = tag(slot.id, Op::Recv);
+    slot.receiving = true;
+    ++slot.inflight;
+  }
+
+  // 每个完成事件带一个缓冲区：解析器复制走需要保留的部分，处理完马上归还
+  void on_recv(Slot &slot, const io_uring_cqe &cqe) {
+    const bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+    if (!more) {
+      slot.receiving = false;
+    }
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+      const auto id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+      if (cqe.res > 0 && !slot.closing) {
+        slot.conn->on_received(buffers_->view(id, static_cast<size_t>(cqe.res)));
+      }
+      buffers_->recycle(id);
+    }
+    if (slot.closing || slot.conn->closed()) {
+      return;
+    }
+    if (cqe.res == 0) {
+      slot.conn->on_eof();
+      return;
+    }
+    if (cqe.res == -ECANCELED && slot.recv_paused) {
+      return; // 下面因积压发出的取消
+    }
+    // ENOBUFS：缓冲区暂时用完，本批完成事件处理完、缓冲区归还后重新提交即可
+    if (cqe.res < 0 && cqe.res != -ENOBUFS) {
+      slot.conn->on_io_error();
+      return;
+    }
+    // 输入积压：停止接收，数据留在内核缓冲区里由 TCP 流量控制让对端减速。
+    // 取消生效前已经到达的完成事件照常交给连接，积压解除后由 settle() 重新提交
+    if (slot.conn->input_backlogged()) {
+      if (more && !slot.recv_paused) {
+        cancel(tag(slot.id, Op::Recv));
+        ring_->submit_and_wait(0, 0); // 立即提交，少收一些取消生效前的数据
+      }
+      slot.recv_paused = true;
+      return;
+    }
+    if (!more) {
+      arm_recv(slot);
+    }
+  }
+
+  // Connection::flush() 在写队列非空时调用。每个连接同一时刻只有一轮写操作：
+  // 管道里有残留先写完它，队首是文件时提交 文件→管道、管道→套接字 两个链接的 SPLICE，
+  // 否则一次 SENDMSG 写出排队的内存片段
+  void submit_write(Slot &slot) {
+    if (slot.writes > 0 || slot.closing) {
+      return;
+    }
+    if (slot.piped > 0) {
+      if (!splice_out(slot, slot.piped)) {
+        slot.conn->on_io_error();
+      }
+      return;
+    }
+    auto &out = slot.conn->output();
+    if (const auto file = out.file_chunk()) {
+      if (!open_pipe(slot) || !splice_file(slot, *file)) {
+        slot.conn->on_io_error();
+      }
+      return;
+    }
+    const size_t count = out.gather(slot.iov);
+    if (count == 0) {
+      return;
+    }
+    auto *sqe = ring_->get_sqe();
+    if (sqe == nullptr) {
+      slot.conn->on_io_error();
+      return;
+    }
+    slot.msg = msghdr{};
+    slot.msg.msg_iov = slot.iov.data();
+    slot.msg.msg_iovlen = count;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = slot.conn->fd();
+    sqe->addr = reinterpret_cast<uint64_t>(&slot.msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = tag(slot.id, Op::Send);
+    begin_write(slot, 1);
+  }
+
+  bool open_pipe(Slot &slot) {
+    if (slot.pipe_read) {
+      return true;
+    }
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) != 0) {
+      return false;
+    }
+    slot.pipe_read.reset(fds[0]);
+    slot.pipe_write.reset(fds[1]);
+    ::fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(kPipeSize));
+    const int capacity = ::fcntl(fds[1], F_GETPIPE_SZ);
+    slot.pipe_capacity = capacity > 0 ? static_cast<size_t>(capacity) : 64 * 1024;
+    return true;
+  }
+
+  // 链接：文件→管道 读到的字节不足时后一个 SPLICE 以 ECANCELED 结束，管道里的残留下一轮再写
+  bool splice_file(Slot &slot, const WriteQueue::FileChunk &file) {
+    if (!ring_->reserve(2)) {
+      return false;
+    }
+    auto *in = ring_->get_sqe();
+    const size_t size = std::min(file.size, slot.pipe_capacity);
+    in->opcode = IORING_OP_SPLICE;
+    in->fd = slot.pipe_write.get();
+    in->off = static_cast<uint64_t>(-1);
+    in->splice_fd_in = file.fd;
+    in->splice_off_in = static_cast<uint64_t>(file.offset);
+    in->len = static_cast<uint32_t>(size);
+    in->splice_flags = SPLICE_F_MOVE;
+    in->flags = IOSQE_IO_LINK;
+    in->user_data = tag(slot.id, Op::SpliceIn);
+    begin_write(slot, 1);
+    return splice_out(slot, size);
+  }
+
+  bool splice_out(Slot &slot, size_t size) {
+    auto *sqe = ring_->get_sqe();
+    if (sqe == nullptr) {
+      return false;
+    }
+    sqe->opcode = IORING_OP_SPLICE;
+    sqe->fd = slot.conn->fd();
+    sqe->off = static_cast<uint64_t>(-1);
+    sqe->splice_fd_in = slot.pipe_read.get();
+    sqe->splice_off_in = static_cast<uint64_t>(-1);
+    sqe->len = static_cast<uint32_t>(size);
+    sqe->splice_flags = SPLICE_F_MOVE;
+    sqe->user_data = tag(slot.id, Op::SpliceOut);
+    begin_write(slot, 1);
+    return true;
+  }
+
+  static void begin_write(Slot &slot, unsigned count) {
+    slot.writes += count;
+    slot.inflight += count;
+  }
+
+  // 一轮写操作全部完成后才把写到套接字的字节交给写队列记账，文件字节以写出管道为准
+  void on_write(Slot &slot, Op op, int res) {
+    --slot.writes;
+    if (res > 0) {
+      const auto n = static_cast<size_t>(res);
+      if (op == Op::SpliceIn) {
+        slot.piped += n;
+      } else {
+        if (op == Op::SpliceOut) {
+          slot.piped -= n;
+        }
+        slot.written += n;
+      }
+    } else if (res != -ECANCELED && res != -EINTR && res != -EAGAIN) {
+      slot.write_failed = true; // 包括写出 0 字节，避免反复提交
+    }
+    if (slot.writes > 0 || slot.closing) {
+      return;
+    }
+    if (std::exchange(slot.write_failed, false)) {
+      slot.conn->on_io_error();
+      return;
+    }
+    slot.conn->on_sent(std::exchange(slot.written, 0));
+  }
+
+  // 每个完成事件与协程结果之后调用：关闭已结束的连接，或恢复因积压暂停的接收
+  void settle(Slot &slot) {
+    if (slot.closing || slot.conn->closed()) {
+      close(slot);
+      return;
+    }
+    if (slot.recv_paused && !slot.receiving && !slot.conn->input_backlogged()) {
+      slot.recv_paused = false;
+      arm_recv(slot);
+      if (slot.conn->closed()) {
+        close(slot); // 提交队列已满，arm_recv() 把连接标记为出错
+      }
+    }
+  }
+
+  // 先只关闭读方向让多发 recv 结束，正在进行的写操作做完（最多 kLinger）后才完全关闭；
+  // 所有请求结束后销毁 Connection，之后不能再访问 slot
+  void close(Slot &slot) {
+    if (!slot.closing) {
+      slot.closing = true;
+      const int fd = slot.conn->fd();
+      if (slot.writes > 0) {
+        ::shutdown(fd, SHUT_RD);
+        loop_->timers().schedule(slot.linger, kLinger);
+      } else {
+        ::shutdown(fd, SHUT_RDWR);
+      }
+      if (slot.receiving) {
+        cancel(tag(slot.id, Op::Recv));
+      }
+    }
+    if (slot.inflight == 0) {
+      slots_.erase(slot.id);
+    }
+  }
+
+  // 停止时关闭全部连接，等它们的请求都结束（有上限）再释放。这期间仍会到达的新连接直接关闭
+  // 超时后仍有请求未结束时，先关闭 ring 让内核取消它们，再释放它们引用的连接与缓冲区
+  void drain() {
+    stopping_ = true;
+    cancel(tag(0, Op::Accept));
+    std::vector<uint64_t> ids;
+    ids.reserve(slots_.size());
+    for (const auto &entry : slots_) {
+      ids.push_back(entry.first);
+    }
+    for (const uint64_t id : ids) {
+      if (auto it = slots_.find(id); it != slots_.end()) {
+        ::shutdown(it->second->conn->fd(), SHUT_RDWR);
+        close(*it->second);
+      }
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + kLinger;
+    while (!slots_.empty() && std::chrono::steady_clock::now() < deadline) {
+      if (!ring_->submit_and_wait(1, 10)) {
+        break;
+      }
+      ring_->for_each_completion([this](const io_uring_cqe &cqe) { on_completion(cqe); });
+    }
+    ring_.reset();
+    slots_.clear();
+  }
+};
+
+} // namespace http::server
@@ -0,0 +1,188 @@
+#pragma once
+#include "response.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+namespace http::server {
+
+// 连接的待发送数据。每个响应只把状态行和 header 渲染进一个小字符串，body 从 HttpResponse
+// 移入、不复制；一次 sendmsg 用 iovec 把排队的多个片段（包括管线化的多个响应）一起写出。
+// 文件 body 用 sendfile 从页缓存直接写入套接字。
+// 状态行与 header 从构造时给出的内存资源分配（连接的 RequestArena），队列排空后才能重置它
+class WriteQueue {
+  struct Segment {
+    std::pmr::string head; // 状态行与 header
+    std::string data;      // 流式响应的一段（已含 chunked 分块头）
+    std::vector<uint8_t> body;
+    std::shared_ptr<const std::vector<uint8_t>> shared; // 与其他响应共享的 body
+    std::shared_ptr<const router::FileBody> file;
+    size_t sent = 0;      // head + data + body 已写出的字节
+    size_t file_sent = 0; // file 已写出的字节
+
+    [[nodiscard]] size_t memory_size() const {
+      return head.size() + data.size() + body.size() + (shared ? shared->size() : 0);
+    }
+    [[nodiscard]] bool done() const {
+      return sent == memory_size() && (!file || file_sent == file->size());
+    }
+  };
+
+  std::pmr::memory_resource *resource_;
+  std::deque<Segment> segments_;
+  size_t queued_ = 0; // 内存片段中尚未写出的字节，不含文件部分
+  uint64_t written_ = 0; // 累计写出的字节，含文件部分
+
+public:
+  enum class Status { Drained, WouldBlock, Failed };
+
+  static constexpr size_t kMaxIov = 64;
+
+  explicit WriteQueue(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+      : resource_(resource) {}
+
+  [[nodiscard]] bool empty() const { return segments_.empty(); }
+  [[nodiscard]] size_t queued_bytes() const { return queued_; }
+  [[nodiscard]] uint64_t written_bytes() const { return written_; }
+
+  // 流式响应只排入状态行与 header，数据由 push() 逐段追加；with_body 为 false 时
+  // （HEAD 请求）也只排入 header，Content-Length 仍按 body 计算
+  void push_response(router::HttpResponse &&response, bool keep_alive, BodyFraming framing,
+                     bool with_body = true) {
+    Segment segment{std::pmr::string(resource_), {}, {}, nullptr, nullptr};
+    append_head(segment.head, response, keep_alive, framing);
+    if (with_body && !response.stream) {
+      segment.body = std::move(response.body);
+      segment.shared = std::move(response.shared_body);
+      segment.file = std::move(response.file);
+    }
+    queued_ += segment.memory_size();
+    segments_.push_back(std::move(segment));
+  }
+
+  void push(std::string data) {
+    if (!data.empty()) {
+      queued_ += data.size();
+      segments_.push_back(
+          Segment{std::pmr::string(resource_), std::move(data), {}, nullptr, nullptr});
+    }
+  }
+
+  // 写到队列为空或套接字写满为止
+  Status flush(int fd) {
+    while (!segments_.empty()) {
+      ssize_t n = 0;
+      if (const auto file = file_chunk()) {
+        auto offset = file->offset;
+        n = ::sendfile(fd, file->fd, &offset, file->size);
+      } else {
+        iovec iov[kMaxIov];
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = gather(iov);
+        n = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+      }
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK ? Status::WouldBlock : Status::Failed;
+      }
+      if (n == 0) {
+        return Status::Failed;
+      }
+      consume(static_cast<size_t>(n));
+    }
+    return Status::Drained;
+  }
+
+  // 以下三个是 flush() 的分步形式，供自行提交写操作的完成式 I/O（io_uring）使用：
+  // 队首只剩文件部分时 file_chunk() 给出它的剩余范围，否则 gather() 收集下一次 sendmsg 的 iovec；
+  // 写出 n 字节后调用 consume(n)。两次 consume() 之间队列里已有的数据不会移动
+  struct FileChunk {
+    int fd;
+    off_t offset;
+    size_t size;
+  };
+
+  [[nodiscard]] std::optional<FileChunk> file_chunk() const {
+    if (segments_.empty()) {
+      return std::nullopt;
+    }
+    const auto &front = segments_.front();
+    if (front.sent != front.memory_size() || !front.file) {
+      return std::nullopt;
+    }
+    return FileChunk{front.file->fd(), static_cast<off_t>(front.file_sent),
+                     front.file->size() - front.file_sent};
+  }
+
+  // 从队首开始收集内存片段，直到遇到还有文件要发的片段（文件必须按顺序在它之后发送）
+  size_t gather(std::span<iovec, kMaxIov> iov) const {
+    size_t count = 0;
+    for (const auto &segment : segments_) {
+      size_t skip = segment.sent;
+      const auto add = [&](const void *data, size_t size) {
+        if (skip >= size) {
+          skip -= size;
+          return;
+        }
+        if (count < kMaxIov) {
+          iov[count++] = {const_cast<char *>(static_cast<const char *>(data)) + skip, size - skip};
+        }
+        skip = 0;
+      };
+      add(segment.head.data(), segment.head.size());
+      add(segment.data.data(), segment.data.size());
+      add(segment.body.data(), segment.body.size());
+      if (segment.shared) {
+        add(segment.shared->data(), segment.shared->size());
+      }
+      if (segment.file || count == kMaxIov) {
+        break;
+      }
+    }
+    return count;
+  }
+
+  void consume(size_t n) {
+    if (segments_.empty() || n == 0) {
+      return;
+    }
+    written_ += n;
+    if (file_chunk()) {
+      segments_.front().file_sent += n;
+    } else {
+      advance(n);
+    }
+    while (!segments_.empty() && segments_.front().done()) {
+      segments_.pop_front();
+    }
+  }
+
+private:
+  // 把写出的字节数摊到队首的各个内存片段上
+  void advance(size_t n) {
+    for (auto &segment : segments_) {
+      const auto take = std::min(n, segment.memory_size() - segment.sent);
+      segment.sent += take;
+      queued_ -= take;
+      n -= take;
+      if (n == 0) {
+        break;
+      }
+    }
+  }
+};
+
+} // namespace http::server
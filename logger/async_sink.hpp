@@ -0,0 +1,227 @@
+#pragma once
+#include "../metrics/metrics.hpp"
+#include "record_ring.hpp"
+#include "sink.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace logger {
+
+enum class Overflow {
+  Drop,  // 缓冲满时丢弃并计数，写日志的线程从不阻塞
+  Block, // 等后台线程腾出空间
+};
+
+struct AsyncSinkOptions {
+  size_t ring_bytes = 1024 * 1024; // 每个写日志线程的缓冲大小
+  Overflow overflow = Overflow::Drop;
+  // 后台线程空闲时的轮询间隔；缓冲过半或 flush() 时会被提前唤醒
+  std::chrono::milliseconds poll_interval{5};
+};
+
+// 每个写日志的线程第一次写入时分配自己的 RecordRing，写入只是一次 memcpy 和一次 release store。
+// 唯一的后台线程轮流排空各个环，每段连续的帧作为一批交给 inner 的 write_batch()，
+// 文件类 sink 因此一批只调用一次 write。flush() 是屏障：返回时，
+// 在它之前（happens-before）写入的日志都已交给 inner 并 flush
+class AsyncSink : public Sink {
+  // 线程退出时把自己的环标记为 abandoned，后台线程排空后回收
+  struct LocalRings {
+    std::vector<std::pair<uint64_t, std::shared_ptr<RecordRing>>> rings; // sink id → 环
+
+    ~LocalRings() {
+      for (auto &[id, ring] : rings) {
+        ring->abandon();
+      }
+    }
+  };
+
+  static inline std::atomic<uint64_t> next_id_{1};
+
+  const uint64_t id_ = next_id_.fetch_add(1, std::memory_order_relaxed);
+  std::unique_ptr<Sink> inner_sink_;
+  AsyncSinkOptions options_;
+
+  std::mutex rings_mutex_;
+  std::vector<std::shared_ptr<RecordRing>> rings_;
+  uint64_t retired_drops_ = 0; // 已回收的环的丢弃数
+  std::atomic<uint64_t> rings_version_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable flushed_;
+  uint64_t flush_requested_ = 0;
+  uint64_t flush_done_ = 0;
+  bool stopping_ = false;
+
+  std::thread writer_;
+  metrics::Registration dropped_metric_;
+
+public:
+  explicit AsyncSink(std::unique_ptr<Sink> sink, AsyncSinkOptions options = {})
+      : inner_sink_(std::move(sink)), options_(options), writer_([this] { run(); }) {}
+
+  AsyncSink(const AsyncSink &) = delete;
+  AsyncSink &operator=(const AsyncSink &) = delete;
+
+  // 排空所有缓冲并 flush inner 后才返回
+  ~AsyncSink() override {
+    dropped_metric_.reset();
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_one();
+    writer_.join();
+    std::lock_guard lock(rings_mutex_);
+    for (const auto &ring : rings_) {
+      ring->close();
+    }
+  }
+
+  void write(const LogEntry &entry) override {
+    thread_local std::string frame;
+    frame.clear();
+    append_entry_frame(frame, entry);
+    push(std::as_bytes(std::span(frame)));
+  }
+
+  void write_record(const LogRecord &record) override { push(record.bytes()); }
+
+  void flush() override {
+    std::unique_lock lock(mutex_);
+    const uint64_t ticket = ++flush_requested_;
+    wake_.notify_one();
+    flushed_.wait(lock, [&] { return flush_done_ >= ticket; });
+  }
+
+  // 缓冲满（Drop 模式）或单帧超过缓冲一半而丢弃的条数
+  [[nodiscard]] uint64_t dropped() {
+    std::lock_guard lock(rings_mutex_);
+    uint64_t total = retired_drops_;
+    for (const auto &ring : rings_) {
+      total += ring->dropped();
+    }
+    return total;
+  }
+
+  // 在 registry 中登记 dropped()，名为 log_dropped_total{sink="name"}；registry 必须比 sink 活得长
+  void instrument(metrics::Registry &registry, std::string_view name = "default") {
+    dropped_metric_ = registry.callback(
+        "log_dropped_total", "Log records dropped by AsyncSink", metrics::Registry::Type::Counter,
+        [this] { return static_cast<double>(dropped()); }, {{"sink", name}});
+  }
+
+private:
+  void push(std::span<const std::byte> frame) {
+    auto &ring = local_ring();
+    if (frame.size() > ring.max_frame()) {
+      ring.count_drop();
+      return;
+    }
+    while (!ring.try_push(frame)) {
+      if (options_.overflow == Overflow::Drop) {
+        ring.count_drop();
+        return;
+      }
+      wake_.notify_one();
+      ring.wait_for_space();
+    }
+    // 过半时提前唤醒后台线程，而不是每条都通知
+    if (ring.used_estimate() >= ring.capacity() / 2 && ring.used() >= ring.capacity() / 2) {
+      wake_.notify_one();
+    }
+  }
+
+  RecordRing &local_ring() {
+    thread_local LocalRings local;
+    auto &rings = local.rings;
+    for (auto it = rings.begin(); it != rings.end();) {
+      if (it->first == id_) {
+        return *it->second;
+      }
+      // 顺便丢掉已销毁的 sink 留下的环
+      it = it->second->closed() ? rings.erase(it) : it + 1;
+    }
+    auto ring = std::make_shared<RecordRing>(options_.ring_bytes);
+    {
+      std::lock_guard lock(rings_mutex_);
+      rings_.push_back(ring);
+    }
+    rings_version_.fetch_add(1, std::memory_order_release);
+    rings.emplace_back(id_, ring);
+    return *ring;
+  }
+
+  void run() {
+    std::vector<std::shared_ptr<RecordRing>> rings;
+    std::vector<RecordView> views;
+    uint64_t version = 0;
+    while (true) {
+      uint64_t requested;
+      bool stopping;
+      {
+        std::lock_guard lock(mutex_);
+        requested = flush_requested_;
+        stopping = stopping_;
+      }
+      // 读到请求号之后才排空：请求之前写入的帧都已发布
+      if (const auto current = rings_version_.load(std::memory_order_acquire);
+          current != version) {
+        version = current;
+        std::lock_guard lock(rings_mutex_);
+        rings = rings_;
+      }
+      size_t frames = 0;
+      for (const auto &ring : rings) {
+        frames += ring->drain(views, [&](std::span<const RecordView> batch) {
+          inner_sink_->write_batch(batch);
+        });
+      }
+      reclaim(rings, version);
+
+      if (stopping || requested != flush_done_) {
+        inner_sink_->flush();
+        std::lock_guard lock(mutex_);
+        flush_done_ = requested;
+        flushed_.notify_all();
+      }
+      if (stopping) {
+        return;
+      }
+      if (frames == 0) {
+        std::unique_lock lock(mutex_);
+        wake_.wait_for(lock, options_.poll_interval,
+                       [&] { return stopping_ || flush_requested_ != flush_done_; });
+      }
+    }
+  }
+
+  // 回收线程已退出且已排空的环
+  void reclaim(std::vector<std::shared_ptr<RecordRing>> &rings, uint64_t &version) {
+    const auto finished = [](const auto &ring) { return ring->abandoned() && ring->empty(); };
+    if (std::none_of(rings.begin(), rings.end(), finished)) {
+      return;
+    }
+    std::lock_guard lock(rings_mutex_);
+    std::erase_if(rings_, [&](const auto &ring) {
+      if (finished(ring)) {
+        retired_drops_ += ring->dropped();
+        return true;
+      }
+      return false;
+    });
+    rings = rings_;
+    version = rings_version_.load(std::memory_order_acquire);
+  }
+};
+
+} // namespace logger
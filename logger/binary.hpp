@@ -0,0 +1,190 @@
+#pragma once
+#include "record.hpp"
+#include "sink.hpp"
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace logger {
+
+// 二进制日志文件：每次打开先写 8 字节魔数，之后是一串帧。记录帧就是 LogRecord 的字节；
+// 每个调用点在文件里第一次出现前先写一个定义帧（flags 含 kSiteDefinition），载荷为
+// [int32 行号][format][file][function]，字符串带 2 字节长度，离线解码因此不需要原进程。
+// LogEntry 写成 kEntry 帧（append_entry_frame）
+inline constexpr std::string_view kBinaryLogMagic{"FPLOG01\n", 8};
+
+inline void append_site_definition(std::string &out, uint32_t id, const LogSite &site) {
+  const auto start = out.size();
+  out.resize(start + sizeof(RecordHeader));
+  const int32_t line = site.line;
+  out.append(reinterpret_cast<const char *>(&line), sizeof(line));
+  detail::put_string(out, site.format, detail::kMaxFrameString);
+  detail::put_string(out, site.file, detail::kMaxFrameString);
+  detail::put_string(out, site.function, detail::kMaxFrameString);
+  detail::put_frame(out, start, site.level, LogRecord::kSiteDefinition, id, 0);
+}
+
+// 把记录原样追加到文件，不做任何格式化；用 BinaryLogDecoder 或 log_decode 工具转成文本
+class BinaryFileSink : public Sink {
+  std::ofstream file_;
+  mutable std::mutex mutex_;
+  std::vector<bool> defined_; // 本文件里已经写过定义帧的调用点
+  std::string frame_;
+
+public:
+  explicit BinaryFileSink(const std::string &filepath)
+      : file_(filepath, std::ios::app | std::ios::binary) {
+    file_.write(kBinaryLogMagic.data(), kBinaryLogMagic.size());
+  }
+
+  void write(const LogEntry &entry) override {
+    std::lock_guard lock(mutex_);
+    frame_.clear();
+    append_entry_frame(frame_, entry);
+    file_.write(frame_.data(), static_cast<std::streamsize>(frame_.size()));
+  }
+
+  void write_record(const LogRecord &record) override {
+    std::lock_guard lock(mutex_);
+    frame_.clear();
+    define_site(record.header().site);
+    const auto bytes = record.bytes();
+    frame_.append(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+    file_.write(frame_.data(), static_cast<std::streamsize>(frame_.size()));
+  }
+
+  void write_batch(std::span<const RecordView> records) override {
+    std::lock_guard lock(mutex_);
+    frame_.clear();
+    for (const auto &record : records) {
+      if (!(record.header.flags & LogRecord::kEntry)) {
+        define_site(record.header.site);
+      }
+      frame_.append(reinterpret_cast<const char *>(record.frame.data()), record.frame.size());
+    }
+    file_.write(frame_.data(), static_cast<std::streamsize>(frame_.size()));
+  }
+
+  void flush() override {
+    std::lock_guard lock(mutex_);
+    file_.flush();
+  }
+
+private:
+  // 调用点第一次出现时把定义帧追加到 frame_
+  void define_site(uint32_t id) {
+    if (id < defined_.size() && defined_[id]) {
+      return;
+    }
+    if (const auto *site = SiteRegistry::instance().find(id)) {
+      append_site_definition(frame_, id, *site);
+      defined_.resize(std::max<size_t>(defined_.size(), id + 1));
+      defined_[id] = true;
+    }
+  }
+};
+
+// 离线解码 BinaryFileSink 的输出。文件可能由多次运行追加而成，每个魔数开始一段新的调用点表
+class BinaryLogDecoder {
+  struct Site {
+    Level level;
+    int32_t line;
+    std::string format;
+    std::string file;
+    std::string function;
+  };
+  std::unordered_map<uint32_t, Site> sites_;
+
+public:
+  // 返回 false 表示文件不以魔数开头、帧格式错误或在帧中间截断；之前的内容已经写出
+  bool decode(std::istream &in, std::ostream &out) {
+    std::string text;
+    std::vector<std::byte> frame;
+    bool ok = true;
+    bool started = false;
+    while (true) {
+      // 先读魔数长度的前缀：魔数的第 3 字节不是合法的级别，不会与帧头混淆
+      char head[sizeof(RecordHeader)];
+      if (!in.read(head, kBinaryLogMagic.size())) {
+        ok = in.gcount() == 0;
+        break;
+      }
+      if (std::string_view(head, kBinaryLogMagic.size()) == kBinaryLogMagic) {
+        sites_.clear();
+        started = true;
+        continue;
+      }
+      if (!started ||
+          !in.read(head + kBinaryLogMagic.size(), sizeof(head) - kBinaryLogMagic.size())) {
+        ok = false;
+        break;
+      }
+      RecordHeader header;
+      std::memcpy(&header, head, sizeof(header));
+      if (header.size < sizeof(header)) {
+        ok = false;
+        break;
+      }
+      frame.resize(header.size);
+      std::memcpy(frame.data(), &header, sizeof(header));
+      if (!in.read(reinterpret_cast<char *>(frame.data()) + sizeof(header),
+                   header.size - sizeof(header))) {
+        ok = false;
+        break;
+      }
+      if (!decode_frame(frame, text)) {
+        ok = false;
+        break;
+      }
+      if (text.size() >= 64 * 1024) {
+        out << text;
+        text.clear();
+      }
+    }
+    out << text;
+    return ok;
+  }
+
+private:
+  bool decode_frame(std::span<const std::byte> bytes, std::string &text) {
+    const auto view = RecordView::parse(bytes);
+    if (!view) {
+      return false;
+    }
+    auto payload = view->payload;
+    if (view->header.flags & LogRecord::kSiteDefinition) {
+      Site site{static_cast<Level>(view->header.level), 0, {}, {}, {}};
+      if (!detail::take_int(payload, site.line) || !detail::take_string(payload, site.format) ||
+          !detail::take_string(payload, site.file) ||
+          !detail::take_string(payload, site.function)) {
+        return false;
+      }
+      sites_[view->header.site] = std::move(site);
+      return true;
+    }
+    if (view->header.flags & LogRecord::kEntry) {
+      if (!entry_of(*view)) {
+        return false;
+      }
+      append_record(text, *view, nullptr);
+      return true;
+    }
+    auto it = sites_.find(view->header.site);
+    if (it == sites_.end()) {
+      append_record(text, *view, nullptr);
+      return true;
+    }
+    const auto &site = it->second;
+    const LogSite log_site{site.level, site.format, site.file, site.line, site.function};
+    append_record(text, *view, &log_site);
+    return true;
+  }
+};
+
+} // namespace logger
@@ -1,4 +1,7 @@
 #pragma once
+#include "async_sink.hpp"
+#include "binary.hpp"
+#include "mmap_sink.hpp"
 #include "sink.hpp"
 #include "writer.hpp"
 #include <vector>
@@ -9,6 +12,13 @@ namespace logger {
 
 using Filter = std::function<bool(const LogEntry&)>;
 
+// 编译期最低级别，-DFP_LOG_MIN_LEVEL=<0..5>（0 为 Trace）。低于它的 LOG_* / LOGF_*
+// 语句整条被编译掉，参数不求值，也不登记调用点
+#ifndef FP_LOG_MIN_LEVEL
+#define FP_LOG_MIN_LEVEL 0
+#endif
+inline constexpr Level kMinLevel = static_cast<Level>(FP_LOG_MIN_LEVEL);
+
 inline Filter level_filter(Level min_level) {
   return [min_level](const LogEntry& entry) {
     return entry.level >= min_level;
@@ -18,10 +28,10 @@ inline Filter level_filter(Level min_level) {
 class Logger {
   std::vector<std::shared_ptr<Sink>> sinks_;
   Level min_level_;
-  Filter filter_;
+  Filter filter_; // 为空表示只按级别过滤
 
 public:
-  explicit Logger(Level min_level = Level::Info) : min_level_(min_level), filter_(level_filter(min_level)) {}
+  explicit Logger(Level min_level = Level::Info) : min_level_(min_level) {}
 
   Logger with_sink(std::shared_ptr<Sink> sink) const {
     Logger new_logger = *this;
@@ -29,14 +39,33 @@ public:
     return new_logger;
   }
 
+  // 在级别检查之后对完整的 LogEntry 再做一次过滤
   Logger with_filter(Filter filter) const {
     Logger new_logger = *this;
     new_logger.filter_ = std::move(filter);
     return new_logger;
   }
 
-  void log(LogEntry entry) const {
-    if (!filter_(entry)) {
+  // 快速路径：一次比较。宏在求值参数之前调用它
+  [[nodiscard]] bool enabled(Level level) const {
+    return level >= kMinLevel && level >= min_level_;
+  }
+
+  // 二进制记录：只复制调用点 id、时间戳和参数，格式化留给 sink。
+  // 记录只按级别过滤，自定义 Filter 作用于完整的 LogEntry，不适用于记录
+  template <typename... Args>
+  void log_record(uint32_t site, Level level, const Args &...args) const {
+    if (!enabled(level)) {
+      return;
+    }
+    const LogRecord record(site, level, coarse_now(), args...);
+    for (const auto& sink : sinks_) {
+      sink->write_record(record);
+    }
+  }
+
+  void log(const LogEntry &entry) const {
+    if (!enabled(entry.level) || (filter_ && !filter_(entry))) {
       return;
     }
 
@@ -45,28 +74,20 @@ public:
     }
   }
 
+  void debug(std::string message, std::string file = "", int line = 0) const {
+    log_at(Level::Debug, std::move(message), std::move(file), line);
+  }
+
   void info(std::string message, std::string file = "", int line = 0) const {
-    log(LogEntry{
-      .level = Level::Info,
-      .message = std::move(message),
-      .timestamp = std::chrono::system_clock::now(),
-      .file = std::move(file),
-      .line = line,
-      .function = {},
-      .fields = {}
-    });
+    log_at(Level::Info, std::move(message), std::move(file), line);
+  }
+
+  void warn(std::string message, std::string file = "", int line = 0) const {
+    log_at(Level::Warn, std::move(message), std::move(file), line);
   }
 
   void error(std::string message, std::string file = "", int line = 0) const {
-    log(LogEntry{
-      .level = Level::Error,
-      .message = std::move(message),
-      .timestamp = std::chrono::system_clock::now(),
-      .file = std::move(file),
-      .line = line,
-      .function = {},
-      .fields = {}
-    });
+    log_at(Level::Error, std::move(message), std::move(file), line);
   }
 
   template<typename T>
@@ -81,11 +102,56 @@ public:
       sink->flush();
     }
   }
+
+private:
+  // 级别未开启时不取时间、不构造 LogEntry
+  void log_at(Level level, std::string message, std::string file, int line) const {
+    if (!enabled(level)) {
+      return;
+    }
+    log(LogEntry{
+      .level = level,
+      .message = std::move(message),
+      .timestamp = coarse_now(),
+      .file = std::move(file),
+      .line = line,
+      .function = {},
+      .fields = {}
+    });
+  }
 };
 
 }
 
-#define LOG_INFO(logger, msg) \
-(logger).info(msg, __FILE__, __LINE__);
-#define LOG_ERROR(logger, msg) \
-(logger).error(msg, __FILE__, __LINE__);
+// lvl 必须是常量表达式：低于 kMinLevel 时整条语句被丢弃；否则先检查运行时级别，
+// 通过后才对 msg 求值
+#define LOG_AT(log, lvl, method, msg)                                                       \
+  do {                                                                                      \
+    if constexpr ((lvl) >= ::logger::kMinLevel) {                                           \
+      if ((log).enabled(lvl)) {                                                             \
+        (log).method((msg), __FILE__, __LINE__);                                            \
+      }                                                                                     \
+    }                                                                                       \
+  } while (0)
+#define LOG_DEBUG(log, msg) LOG_AT(log, ::logger::Level::Debug, debug, msg)
+#define LOG_INFO(log, msg) LOG_AT(log, ::logger::Level::Info, info, msg)
+#define LOG_WARN(log, msg) LOG_AT(log, ::logger::Level::Warn, warn, msg)
+#define LOG_ERROR(log, msg) LOG_AT(log, ::logger::Level::Error, error, msg)
+
+// 延迟格式化的日志：LOGF_INFO(log, "user {} from {}", id, ip)。格式串必须是字面量，
+// 调用点在第一次执行时登记；之后每次调用只把参数按二进制复制进一条 LogRecord。
+// lvl 与 LOG_AT 一样必须是常量表达式
+#define LOGF(log, lvl, fmt, ...)                                                            \
+  do {                                                                                      \
+    if constexpr ((lvl) >= ::logger::kMinLevel) {                                           \
+      if ((log).enabled(lvl)) {                                                             \
+        static const uint32_t fp_log_site_ = ::logger::SiteRegistry::instance().add(        \
+            ::logger::LogSite{lvl, "" fmt, __FILE__, __LINE__, __func__});                  \
+        (log).log_record(fp_log_site_, lvl __VA_OPT__(, ) __VA_ARGS__);                     \
+      }                                                                                     \
+    }                                                                                       \
+  } while (0)
+#define LOGF_DEBUG(log, fmt, ...) LOGF(log, ::logger::Level::Debug, fmt __VA_OPT__(, ) __VA_ARGS__)
+#define LOGF_INFO(log, fmt, ...) LOGF(log, ::logger::Level::Info, fmt __VA_OPT__(, ) __VA_ARGS__)
+#define LOGF_WARN(log, fmt, ...) LOGF(log, ::logger::Level::Warn, fmt __VA_OPT__(, ) __VA_ARGS__)
+#define LOGF_ERROR(log, fmt, ...) LOGF(log, ::logger::Level::Error, fmt __VA_OPT__(, ) __VA_ARGS__)
@@ -0,0 +1,228 @@
+#pragma once
+#include "record.hpp"
+#include "sink.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace logger {
+
+struct MmapSinkOptions {
+  size_t segment_bytes = 64 * 1024 * 1024; // 每个段文件预分配的大小，至少一页
+  // 段里第一行之后经过这么久就换段；0 表示只按大小轮转
+  std::chrono::seconds max_age{0};
+};
+
+// 按段写入的文本日志：每个段是 fallocate 出固定大小并 mmap 的文件，写一行只是一次 memcpy。
+// 后台线程提前打开好下一个段，并负责把写满的段截断到实际长度、解除映射、关闭，
+// 所以轮转时写日志的线程只交换一下指针。
+// 段文件名为 <dir>/<name>_<sink 创建时间>_<序号>.log；进程崩溃时当前段尾部会留下 0 字节
+class MmapFileSink : public Sink {
+  struct Segment {
+    int fd = -1;
+    char *base = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+    std::string path;
+
+    [[nodiscard]] bool valid() const { return base != nullptr; }
+
+    // 截断到已写入的长度后关闭；空段直接删除
+    void close() {
+      if (base != nullptr) {
+        ::munmap(base, capacity);
+      }
+      if (fd >= 0) {
+        if (used == 0) {
+          ::unlink(path.c_str());
+        } else if (::ftruncate(fd, static_cast<off_t>(used)) != 0) {
+          std::cerr << "Failed to truncate log segment: " << path << std::endl;
+        }
+        ::close(fd);
+      }
+      fd = -1;
+      base = nullptr;
+    }
+  };
+
+  std::string base_dir_;
+  std::string base_name_;
+  std::string started_; // sink 创建时间，段文件名前缀
+  MmapSinkOptions options_;
+
+  // 写入状态，受 mutex_ 保护
+  std::mutex mutex_;
+  Segment current_;
+  std::time_t deadline_ = 0; // 当前段按时间轮转的时刻，段为空时为 0
+  std::string line_;
+
+  // 与后台线程交换的段，受 prepare_mutex_ 保护
+  std::mutex prepare_mutex_;
+  std::condition_variable prepare_cv_;
+  std::optional<Segment> spare_;
+  std::vector<Segment> retired_;
+  size_t next_sequence_ = 0;
+  bool stopping_ = false;
+
+  std::thread preparer_;
+
+public:
+  MmapFileSink(std::string base_dir, std::string base_name, MmapSinkOptions options = {})
+      : base_dir_(std::move(base_dir)), base_name_(std::move(base_name)), options_(options) {
+    const auto page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    options_.segment_bytes = std::max(options_.segment_bytes + page - 1, page) / page * page;
+    char started[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(started, sizeof(started), "%Y%m%d_%H%M%S", &local_time(now).tm);
+    started_ = started;
+    current_ = open_segment(next_sequence_++);
+    preparer_ = std::thread([this] { run(); });
+  }
+
+  MmapFileSink(const MmapFileSink &) = delete;
+  MmapFileSink &operator=(const MmapFileSink &) = delete;
+
+  ~MmapFileSink() override {
+    {
+      std::lock_guard lock(prepare_mutex_);
+      stopping_ = true;
+    }
+    prepare_cv_.notify_one();
+    preparer_.join();
+    current_.close();
+    if (spare_) {
+      spare_->close();
+    }
+  }
+
+  void write(const LogEntry &entry) override {
+    std::lock_guard lock(mutex_);
+    line_.clear();
+    entry.append_to(line_);
+    append(line_, std::chrono::system_clock::to_time_t(entry.timestamp));
+  }
+
+  void write_record(const LogRecord &record) override {
+    std::lock_guard lock(mutex_);
+    line_.clear();
+    append_record(line_, record);
+    append(line_, std::chrono::system_clock::to_time_t(record.time()));
+  }
+
+  // 逐行复制进映射区，行不会跨段；整批只加一次锁
+  void write_batch(std::span<const RecordView> records) override {
+    std::lock_guard lock(mutex_);
+    for (const auto &record : records) {
+      line_.clear();
+      append_record(line_, record);
+      append(line_, std::chrono::system_clock::to_time_t(record.time()));
+    }
+  }
+
+  // 数据在 memcpy 时已经进入页缓存，由内核回写，这里没有需要推送的用户态缓冲
+  void flush() override {}
+
+private:
+  // 放不下或到时间时先换段；超过整段的行被截断。当前段打开失败时每次都尝试换段
+  void append(std::string_view line, std::time_t t) {
+    if (!current_.valid() ||
+        (current_.used > 0 && (line.size() > current_.capacity - current_.used ||
+                               (deadline_ != 0 && t >= deadline_)))) {
+      rotate();
+    }
+    if (!current_.valid()) {
+      return;
+    }
+    if (current_.used == 0 && options_.max_age.count() > 0) {
+      deadline_ = t + static_cast<std::time_t>(options_.max_age.count());
+    }
+    const size_t length = std::min(line.size(), current_.capacity - current_.used);
+    std::memcpy(current_.base + current_.used, line.data(), length);
+    current_.used += length;
+  }
+
+  // 换上后台线程准备好的段；只有在它还没准备好时才等待
+  void rotate() {
+    std::unique_lock lock(prepare_mutex_);
+    prepare_cv_.wait(lock, [this] { return spare_.has_value(); });
+    retired_.push_back(std::exchange(current_, std::move(*spare_)));
+    spare_.reset();
+    deadline_ = 0;
+    lock.unlock();
+    prepare_cv_.notify_one();
+  }
+
+  void run() {
+    std::unique_lock lock(prepare_mutex_);
+    while (true) {
+      prepare_cv_.wait(lock, [this] { return stopping_ || !spare_ || !retired_.empty(); });
+      auto retired = std::move(retired_);
+      retired_.clear();
+      const bool need_spare = !stopping_ && !spare_;
+      const size_t sequence = need_spare ? next_sequence_++ : 0;
+      lock.unlock();
+
+      for (auto &segment : retired) {
+        segment.close();
+      }
+      std::optional<Segment> spare;
+      if (need_spare) {
+        spare = open_segment(sequence);
+      }
+
+      lock.lock();
+      if (spare) {
+        spare_ = std::move(spare);
+        prepare_cv_.notify_all();
+      }
+      if (stopping_ && retired_.empty()) {
+        return;
+      }
+    }
+  }
+
+  Segment open_segment(size_t sequence) const {
+    Segment segment;
+    segment.path = base_dir_ + "/" + base_name_ + "_" + started_ + "_" +
+                   std::to_string(sequence) + ".log";
+    segment.capacity = options_.segment_bytes;
+    segment.fd = ::open(segment.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (segment.fd < 0) {
+      std::cerr << "Failed to open log segment: " << segment.path << ": " << std::strerror(errno)
+                << std::endl;
+      return segment;
+    }
+    // 预分配磁盘块，写入时不再触发块分配；不支持 fallocate 的文件系统退回稀疏文件
+    const auto size = static_cast<off_t>(segment.capacity);
+    if (::fallocate(segment.fd, 0, 0, size) != 0 && ::ftruncate(segment.fd, size) != 0) {
+      std::cerr << "Failed to allocate log segment: " << segment.path << std::endl;
+      segment.close();
+      return segment;
+    }
+    // MAP_POPULATE 在后台线程里预先建立页表，写日志时不再缺页
+    void *base = ::mmap(nullptr, segment.capacity, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, segment.fd, 0);
+    if (base == MAP_FAILED) {
+      std::cerr << "Failed to map log segment: " << segment.path << std::endl;
+      segment.close();
+      return segment;
+    }
+    segment.base = static_cast<char *>(base);
+    return segment;
+  }
+};
+
+} // namespace logger
@@ -0,0 +1,440 @@
+#pragma once
+#include "types.hpp"
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace logger {
+
+// 日志调用点的静态部分：格式串、位置与级别。格式串只支持 {} 占位符（{{ 与 }} 转义），
+// 参数按出现顺序替换。所有字符串都是字面量，与进程同寿命
+struct LogSite {
+  Level level;
+  std::string_view format;
+  std::string_view file;
+  int line;
+  std::string_view function;
+};
+
+// 进程内的调用点表。每个调用点第一次执行时登记一次，记录里只保存 id。
+// 登记加锁；查找是两次原子读取，sink 线程解码时不加锁
+class SiteRegistry {
+  static constexpr uint32_t kChunkSize = 256;
+  static constexpr uint32_t kMaxChunks = 256;
+  using Chunk = std::array<LogSite, kChunkSize>;
+
+  std::mutex mutex_;
+  std::array<std::atomic<Chunk *>, kMaxChunks> chunks_{};
+  std::atomic<uint32_t> size_{0};
+
+  SiteRegistry() = default;
+
+public:
+  static constexpr uint32_t kMaxSites = kChunkSize * kMaxChunks;
+
+  // 调用点可能在静态析构期间仍被使用，表本身不释放
+  static SiteRegistry &instance() {
+    static auto *registry = new SiteRegistry;
+    return *registry;
+  }
+
+  // 表满时返回 kMaxSites，这样的记录解码为未知调用点
+  uint32_t add(const LogSite &site) {
+    std::lock_guard lock(mutex_);
+    const uint32_t id = size_.load(std::memory_order_relaxed);
+    if (id >= kMaxSites) {
+      return kMaxSites;
+    }
+    auto &slot = chunks_[id / kChunkSize];
+    auto *chunk = slot.load(std::memory_order_relaxed);
+    if (chunk == nullptr) {
+      chunk = new Chunk{};
+      slot.store(chunk, std::memory_order_release);
+    }
+    (*chunk)[id % kChunkSize] = site;
+    size_.store(id + 1, std::memory_order_release);
+    return id;
+  }
+
+  [[nodiscard]] const LogSite *find(uint32_t id) const {
+    if (id >= size_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &(*chunks_[id / kChunkSize].load(std::memory_order_acquire))[id % kChunkSize];
+  }
+
+  [[nodiscard]] uint32_t size() const { return size_.load(std::memory_order_acquire); }
+};
+
+enum class ArgType : uint8_t { Int, Uint, Double, Bool, Char, String, Pointer };
+
+// 记录与调用点定义共用的帧头，按本机字节序存放
+struct RecordHeader {
+  uint16_t size; // 含帧头
+  uint8_t level;
+  uint8_t flags;
+  uint32_t site;
+  int64_t timestamp_ns; // system_clock 纪元以来的纳秒
+
+  [[nodiscard]] std::chrono::system_clock::time_point time() const {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(timestamp_ns)));
+  }
+};
+static_assert(sizeof(RecordHeader) == 16);
+
+// 一帧的只读视图，引用帧所在的缓冲区；帧不完整或长度不符时 parse 返回 nullopt
+struct RecordView {
+  RecordHeader header;
+  std::span<const std::byte> payload;
+  std::span<const std::byte> frame; // 含帧头的整个帧
+
+  static std::optional<RecordView> parse(std::span<const std::byte> bytes) {
+    RecordHeader header;
+    if (bytes.size() < sizeof(header)) {
+      return std::nullopt;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.size < sizeof(header) || header.size > bytes.size()) {
+      return std::nullopt;
+    }
+    return RecordView{header, bytes.subspan(sizeof(header), header.size - sizeof(header)),
+                      bytes.first(header.size)};
+  }
+
+  [[nodiscard]] std::chrono::system_clock::time_point time() const { return header.time(); }
+};
+
+// 一条二进制日志：调用点 id、时间戳和原始参数，不做任何格式化。
+// 数字按 8 字节原样复制，字符串带 2 字节长度；超出容量的部分被截断并在帧头标记
+class LogRecord {
+public:
+  static constexpr size_t kCapacity = 256;
+  static constexpr uint8_t kTruncated = 1;
+  static constexpr uint8_t kSiteDefinition = 2; // 只出现在二进制日志文件里，见 binary.hpp
+  static constexpr uint8_t kEntry = 4;          // 序列化的 LogEntry，见 append_entry_frame
+
+private:
+  alignas(8) std::array<std::byte, kCapacity> bytes_;
+  size_t size_ = sizeof(RecordHeader);
+  uint8_t flags_ = 0;
+
+public:
+  template <typename... Args>
+  LogRecord(uint32_t site, Level level, std::chrono::system_clock::time_point time,
+            const Args &...args) {
+    (append(args), ...);
+    const RecordHeader header{
+        static_cast<uint16_t>(size_), static_cast<uint8_t>(level), flags_, site,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count()};
+    std::memcpy(bytes_.data(), &header, sizeof(header));
+  }
+
+  // 复制一个记录帧，例如从 AsyncSink 的环形缓冲里取出的帧
+  explicit LogRecord(const RecordView &view)
+      : size_(std::min(view.frame.size(), kCapacity)), flags_(view.header.flags) {
+    std::memcpy(bytes_.data(), view.frame.data(), size_);
+  }
+
+  LogRecord(const LogRecord &other) : size_(other.size_), flags_(other.flags_) {
+    std::memcpy(bytes_.data(), other.bytes_.data(), size_);
+  }
+
+  LogRecord &operator=(const LogRecord &other) {
+    size_ = other.size_;
+    flags_ = other.flags_;
+    std::memcpy(bytes_.data(), other.bytes_.data(), size_);
+    return *this;
+  }
+
+  [[nodiscard]] std::span<const std::byte> bytes() const { return {bytes_.data(), size_}; }
+
+  [[nodiscard]] RecordHeader header() const {
+    RecordHeader header;
+    std::memcpy(&header, bytes_.data(), sizeof(header));
+    return header;
+  }
+
+  [[nodiscard]] std::chrono::system_clock::time_point time() const { return header().time(); }
+
+  [[nodiscard]] LogEntry to_entry() const;
+
+private:
+  template <typename T> void append(const T &value) {
+    using U = std::remove_cvref_t<T>;
+    if constexpr (std::is_same_v<U, bool>) {
+      append_scalar(ArgType::Bool, static_cast<uint64_t>(value));
+    } else if constexpr (std::is_same_v<U, char>) {
+      append_scalar(ArgType::Char, static_cast<uint64_t>(static_cast<unsigned char>(value)));
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+      append_scalar(ArgType::Int, static_cast<int64_t>(value));
+    } else if constexpr (std::is_integral_v<U> || std::is_enum_v<U>) {
+      append_scalar(ArgType::Uint, static_cast<uint64_t>(value));
+    } else if constexpr (std::is_floating_point_v<U>) {
+      append_scalar(ArgType::Double, static_cast<double>(value));
+    } else if constexpr (std::is_convertible_v<const U &, std::string_view>) {
+      append_string(std::string_view(value));
+    } else if constexpr (std::is_null_pointer_v<U>) {
+      append_scalar(ArgType::Pointer, uint64_t{0});
+    } else if constexpr (std::is_pointer_v<U>) {
+      append_scalar(ArgType::Pointer, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+    } else {
+      static_assert(sizeof(U) == 0, "unsupported log argument type");
+    }
+  }
+
+  template <typename T> void append_scalar(ArgType type, T value) {
+    static_assert(sizeof(T) == 8);
+    if (size_ + 1 + sizeof(T) > kCapacity) {
+      flags_ |= kTruncated;
+      return;
+    }
+    bytes_[size_] = static_cast<std::byte>(type);
+    std::memcpy(bytes_.data() + size_ + 1, &value, sizeof(T));
+    size_ += 1 + sizeof(T);
+  }
+
+  void append_string(std::string_view value) {
+    if (size_ + 3 > kCapacity) {
+      flags_ |= kTruncated;
+      return;
+    }
+    const auto length = static_cast<uint16_t>(std::min(value.size(), kCapacity - size_ - 3));
+    if (length < value.size()) {
+      flags_ |= kTruncated;
+    }
+    bytes_[size_] = static_cast<std::byte>(ArgType::String);
+    std::memcpy(bytes_.data() + size_ + 1, &length, sizeof(length));
+    std::memcpy(bytes_.data() + size_ + 3, value.data(), length);
+    size_ += 3 + length;
+  }
+};
+
+namespace detail {
+
+// 从参数区取出下一个参数并以文本追加到 out；参数区用完或格式错误时返回 false
+inline bool append_next_arg(std::string &out, std::span<const std::byte> &args) {
+  if (args.empty()) {
+    return false;
+  }
+  const auto type = static_cast<ArgType>(args[0]);
+  args = args.subspan(1);
+  if (type == ArgType::String) {
+    uint16_t length;
+    if (args.size() < sizeof(length)) {
+      return false;
+    }
+    std::memcpy(&length, args.data(), sizeof(length));
+    if (args.size() < sizeof(length) + length) {
+      return false;
+    }
+    out.append(reinterpret_cast<const char *>(args.data()) + sizeof(length), length);
+    args = args.subspan(sizeof(length) + length);
+    return true;
+  }
+
+  uint64_t raw;
+  if (args.size() < sizeof(raw)) {
+    return false;
+  }
+  std::memcpy(&raw, args.data(), sizeof(raw));
+  args = args.subspan(sizeof(raw));
+  char buf[32];
+  char *end = buf;
+  switch (type) {
+  case ArgType::Int:
+    end = std::to_chars(buf, buf + sizeof(buf), static_cast<int64_t>(raw)).ptr;
+    break;
+  case ArgType::Uint:
+    end = std::to_chars(buf, buf + sizeof(buf), raw).ptr;
+    break;
+  case ArgType::Double: {
+    double value;
+    std::memcpy(&value, &raw, sizeof(value));
+    end = std::to_chars(buf, buf + sizeof(buf), value).ptr;
+    break;
+  }
+  case ArgType::Bool:
+    out += raw != 0 ? "true" : "false";
+    return true;
+  case ArgType::Char:
+    out += static_cast<char>(raw);
+    return true;
+  case ArgType::Pointer:
+    out += "0x";
+    end = std::to_chars(buf, buf + sizeof(buf), raw, 16).ptr;
+    break;
+  default:
+    return false;
+  }
+  out.append(buf, static_cast<size_t>(end - buf));
+  return true;
+}
+
+// 帧长度是 uint16，一帧里最多三个字符串平分剩余空间
+inline constexpr size_t kMaxFrameString = (UINT16_MAX - sizeof(RecordHeader) - 16) / 3;
+
+inline void put_string(std::string &out, std::string_view value, size_t limit) {
+  const auto length = static_cast<uint16_t>(std::min(value.size(), limit));
+  out.append(reinterpret_cast<const char *>(&length), sizeof(length));
+  out.append(value.data(), length);
+}
+
+inline void put_frame(std::string &out, size_t start, Level level, uint8_t flags, uint32_t site,
+                      int64_t timestamp_ns) {
+  const RecordHeader header{static_cast<uint16_t>(out.size() - start),
+                            static_cast<uint8_t>(level), flags, site, timestamp_ns};
+  std::memcpy(out.data() + start, &header, sizeof(header));
+}
+
+inline bool take_string(std::span<const std::byte> &in, std::string &out) {
+  uint16_t length;
+  if (in.size() < sizeof(length)) {
+    return false;
+  }
+  std::memcpy(&length, in.data(), sizeof(length));
+  if (in.size() < sizeof(length) + length) {
+    return false;
+  }
+  out.assign(reinterpret_cast<const char *>(in.data()) + sizeof(length), length);
+  in = in.subspan(sizeof(length) + length);
+  return true;
+}
+
+inline bool take_int(std::span<const std::byte> &in, int32_t &out) {
+  if (in.size() < sizeof(out)) {
+    return false;
+  }
+  std::memcpy(&out, in.data(), sizeof(out));
+  in = in.subspan(sizeof(out));
+  return true;
+}
+
+} // namespace detail
+
+// 把 LogEntry 序列化成一个 kEntry 帧，载荷为 [file][int32 行号][消息与附加字段]，
+// 字符串带 2 字节长度。帧长度上限 64 KiB，更长的消息被截断
+inline void append_entry_frame(std::string &out, const LogEntry &entry) {
+  const auto start = out.size();
+  out.resize(start + sizeof(RecordHeader));
+  detail::put_string(out, entry.file, detail::kMaxFrameString);
+  const int32_t line = entry.line;
+  out.append(reinterpret_cast<const char *>(&line), sizeof(line));
+  std::string body;
+  entry.append_body(body);
+  detail::put_string(out, body, 2 * detail::kMaxFrameString);
+  detail::put_frame(
+      out, start, entry.level, LogRecord::kEntry, 0,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(entry.timestamp.time_since_epoch())
+          .count());
+}
+
+// 还原 kEntry 帧；附加字段已经并入消息
+inline std::optional<LogEntry> entry_of(const RecordView &record) {
+  LogEntry entry{.level = static_cast<Level>(record.header.level),
+                 .message = {},
+                 .timestamp = record.time(),
+                 .file = {},
+                 .line = 0,
+                 .function = {},
+                 .fields = {}};
+  auto payload = record.payload;
+  int32_t line = 0;
+  if (!detail::take_string(payload, entry.file) || !detail::take_int(payload, line) ||
+      !detail::take_string(payload, entry.message)) {
+    return std::nullopt;
+  }
+  entry.line = line;
+  return entry;
+}
+
+// 把格式串里的 {} 依次替换为参数。参数不足时保留 {}，被截断的记录末尾加 "..."
+inline void append_message(std::string &out, std::string_view format,
+                           std::span<const std::byte> args, bool truncated = false) {
+  for (size_t i = 0; i < format.size(); ++i) {
+    const char c = format[i];
+    if ((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c) {
+      out += c;
+      ++i;
+    } else if (c == '{' && i + 1 < format.size() && format[i + 1] == '}') {
+      if (!detail::append_next_arg(out, args)) {
+        out += "{}";
+      }
+      ++i;
+    } else {
+      out += c;
+    }
+  }
+  if (truncated) {
+    out += "...";
+  }
+}
+
+// 与 LogEntry::append_to 相同的文本行。site 为空（调用点未知）时只输出 id；
+// kEntry 帧不需要调用点
+inline void append_record(std::string &out, const RecordView &record, const LogSite *site) {
+  if (record.header.flags & LogRecord::kEntry) {
+    if (auto entry = entry_of(record)) {
+      entry->append_to(out);
+    }
+    return;
+  }
+  out += format_local_time(std::chrono::system_clock::to_time_t(record.time()));
+  out += " [";
+  out += level_to_string(static_cast<Level>(record.header.level));
+  out += "] ";
+  if (site == nullptr) {
+    out += "<unknown log site ";
+    out += std::to_string(record.header.site);
+    out += ">\n";
+    return;
+  }
+  out += site->file;
+  out += ':';
+  out += std::to_string(site->line);
+  out += ' ';
+  append_message(out, site->format, record.payload,
+                 (record.header.flags & LogRecord::kTruncated) != 0);
+  out += '\n';
+}
+
+// 用进程内的调用点表解码
+inline void append_record(std::string &out, const RecordView &record) {
+  append_record(out, record, SiteRegistry::instance().find(record.header.site));
+}
+
+inline void append_record(std::string &out, const LogRecord &record) {
+  append_record(out, *RecordView::parse(record.bytes()));
+}
+
+inline LogEntry LogRecord::to_entry() const {
+  const auto view = *RecordView::parse(bytes());
+  const auto *site = SiteRegistry::instance().find(view.header.site);
+  LogEntry entry{.level = static_cast<Level>(view.header.level),
+                 .message = {},
+                 .timestamp = view.time(),
+                 .file = site ? std::string(site->file) : std::string(),
+                 .line = site ? site->line : 0,
+                 .function = site ? std::string(site->function) : std::string(),
+                 .fields = {}};
+  if (site) {
+    append_message(entry.message, site->format, view.payload,
+                   (view.header.flags & kTruncated) != 0);
+  } else {
+    entry.message = "<unknown log site " + std::to_string(view.header.site) + ">";
+  }
+  return entry;
+}
+
+} // namespace logger
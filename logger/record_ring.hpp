@@ -0,0 +1,147 @@
+#pragma once
+#include "record.hpp"
+#include "threadpool/cacheline.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace logger {
+
+// 单生产者单消费者的字节环，存放变长的日志帧（LogRecord 或 kEntry 帧）。
+// 帧按 8 字节对齐存放；尾部放不下时写一个长度为 0 的跳过标记，从缓冲区开头继续。
+// head/tail 是单调递增的字节偏移，各占一条缓存行；生产者缓存 head，只在看起来满时才重新读取
+class RecordRing {
+  static constexpr size_t kAlign = 8;
+
+  size_t capacity_;
+  std::unique_ptr<std::byte[]> data_;
+
+  alignas(threadpool::kCacheLineSize) std::atomic<size_t> head_{0}; // 消费者推进
+  std::atomic<bool> producer_waiting_{false};
+
+  alignas(threadpool::kCacheLineSize) std::atomic<size_t> tail_{0}; // 生产者推进
+  size_t cached_head_ = 0;                                          // 仅生产者访问
+
+  alignas(threadpool::kCacheLineSize) std::atomic<uint64_t> dropped_{0};
+  std::atomic<bool> abandoned_{false}; // 生产者线程已退出
+  std::atomic<bool> closed_{false};    // 消费者已停止
+
+public:
+  // 容量向上取整为 2 的幂，至少 4 KB
+  explicit RecordRing(size_t capacity)
+      : capacity_(std::bit_ceil(std::max<size_t>(capacity, 4096))),
+        data_(std::make_unique<std::byte[]>(capacity_)) {}
+
+  RecordRing(const RecordRing &) = delete;
+  RecordRing &operator=(const RecordRing &) = delete;
+
+  [[nodiscard]] size_t capacity() const { return capacity_; }
+
+  // 放得下的最大帧：留出一个跳过标记也不会超过容量
+  [[nodiscard]] size_t max_frame() const { return capacity_ / 2; }
+
+  // 仅生产者调用；空间不足时返回 false，不修改环
+  bool try_push(std::span<const std::byte> frame) {
+    const size_t length = align(frame.size());
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t offset = tail & (capacity_ - 1);
+    const size_t skip = capacity_ - offset < length ? capacity_ - offset : 0;
+    const size_t next = tail + skip + length;
+    if (next - cached_head_ > capacity_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (next - cached_head_ > capacity_) {
+        return false;
+      }
+    }
+    if (skip > 0) {
+      std::memset(data_.get() + offset, 0, sizeof(uint16_t));
+    }
+    std::memcpy(data_.get() + ((tail + skip) & (capacity_ - 1)), frame.data(), frame.size());
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // 仅生产者调用：按缓存的 head 估计已用字节数，可能偏大
+  [[nodiscard]] size_t used_estimate() const {
+    return tail_.load(std::memory_order_relaxed) - cached_head_;
+  }
+
+  // 仅生产者调用：刷新缓存的 head 后返回已用字节数
+  size_t used() {
+    cached_head_ = head_.load(std::memory_order_acquire);
+    return tail_.load(std::memory_order_relaxed) - cached_head_;
+  }
+
+  // 仅生产者调用：try_push 失败后等待消费者推进 head。
+  // waiting 标志与 head 的读写都是 seq_cst，消费者释放空间时不会错过唤醒
+  void wait_for_space() {
+    const size_t head = cached_head_;
+    producer_waiting_.store(true, std::memory_order_seq_cst);
+    if (head_.load(std::memory_order_seq_cst) == head) {
+      head_.wait(head, std::memory_order_seq_cst);
+    }
+    producer_waiting_.store(false, std::memory_order_relaxed);
+  }
+
+  // 仅消费者调用：取出调用时已写入的全部帧。每段连续区域解析成视图放进 views，
+  // 交给 batch(std::span<const RecordView>) 后再释放这段空间。返回帧数
+  template <typename F> size_t drain(std::vector<RecordView> &views, F &&batch) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    size_t frames = 0;
+    while (head != tail) {
+      const size_t offset = head & (capacity_ - 1);
+      const size_t length = std::min(tail - head, capacity_ - offset);
+      const std::span<const std::byte> region(data_.get() + offset, length);
+      views.clear();
+      for (size_t used = 0; used < length;) {
+        uint16_t size;
+        std::memcpy(&size, region.data() + used, sizeof(size));
+        if (size == 0) {
+          break; // 跳过标记：这段剩余部分为空
+        }
+        if (auto view = RecordView::parse(region.subspan(used))) {
+          views.push_back(*view);
+        }
+        used += align(size);
+      }
+      if (!views.empty()) {
+        batch(std::span<const RecordView>(views));
+        frames += views.size();
+      }
+      head += length;
+      release(head);
+    }
+    return frames;
+  }
+
+  [[nodiscard]] bool empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+  void count_drop() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+  [[nodiscard]] uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  void abandon() { abandoned_.store(true, std::memory_order_release); }
+  [[nodiscard]] bool abandoned() const { return abandoned_.load(std::memory_order_acquire); }
+
+  // 消费者已销毁；生产者线程据此丢掉自己持有的引用
+  void close() { closed_.store(true, std::memory_order_release); }
+  [[nodiscard]] bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+private:
+  static constexpr size_t align(size_t size) { return (size + kAlign - 1) & ~(kAlign - 1); }
+
+  void release(size_t head) {
+    head_.store(head, std::memory_order_seq_cst);
+    if (producer_waiting_.load(std::memory_order_seq_cst)) {
+      head_.notify_all();
+    }
+  }
+};
+
+} // namespace logger
@@ -1,12 +1,13 @@
 #pragma once
+#include "record.hpp"
 #include "types.hpp"
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <iomanip>
-#include <thread>
-#include "threadpool/channel.hpp"
+#include <span>
+#include <sstream>
 
 namespace logger{
 
@@ -14,11 +15,28 @@ class Sink {
 public:
 virtual ~Sink() = default;
 virtual void write(const logger::LogEntry &entry) = 0;
+// 二进制记录。默认在调用线程上还原成 LogEntry 交给 write()；文本 sink 直接格式化到
+// 复用的缓冲区，AsyncSink 原样排队，格式化留给后台线程
+virtual void write_record(const logger::LogRecord &record) { write(record.to_entry()); }
+// AsyncSink 的后台线程一次交来一批帧（记录或 kEntry 帧），视图只在调用期间有效。
+// 默认逐条转交；文本 sink 把整批格式化进一个缓冲区，只加一次锁、写一次
+virtual void write_batch(std::span<const logger::RecordView> records) {
+  for (const auto &record : records) {
+    if (record.header.flags & logger::LogRecord::kEntry) {
+      if (auto entry = logger::entry_of(record)) {
+        write(*entry);
+      }
+    } else {
+      write_record(logger::LogRecord(record));
+    }
+  }
+}
 virtual void flush() = 0;
 }; // namespace Sink
 
 class ConsoleSink : public Sink {
   mutable std::mutex mutex_;
+  std::string line_;
 
 public:
   void write(const logger::LogEntry &entry) override {
@@ -26,6 +44,24 @@ public:
     std::cout << entry.format() << std::flush;
   }
 
+  void write_record(const logger::LogRecord &record) override {
+    std::lock_guard lock(mutex_);
+    line_.clear();
+    append_record(line_, record);
+    std::cout.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+    std::cout.flush();
+  }
+
+  void write_batch(std::span<const logger::RecordView> records) override {
+    std::lock_guard lock(mutex_);
+    line_.clear();
+    for (const auto &record : records) {
+      append_record(line_, record);
+    }
+    std::cout.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+    std::cout.flush();
+  }
+
   void flush() override { std::cout << std::flush; }
 };
 
@@ -33,6 +69,7 @@ class FileSink : public Sink {
   std::ofstream file_;
   mutable std::mutex mutex_;
   std::string filepath_;
+  std::string line_;
 
 public:
   explicit FileSink(std::string filepath) : filepath_(std::move(filepath)) {
@@ -44,6 +81,25 @@ public:
       file_ << entry.format();
     }
   }
+  void write_record(const logger::LogRecord &record) override {
+    std::lock_guard lock(mutex_);
+    if (file_.is_open()) {
+      line_.clear();
+      append_record(line_, record);
+      file_.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+    }
+  }
+  // 大块写入时 filebuf 把缓冲区和数据用一次 writev 直接写出
+  void write_batch(std::span<const logger::RecordView> records) override {
+    std::lock_guard lock(mutex_);
+    if (file_.is_open()) {
+      line_.clear();
+      for (const auto &record : records) {
+        append_record(line_, record);
+      }
+      file_.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+    }
+  }
   void flush() override {
     std::lock_guard lock(mutex_);
     if (file_.is_open()) {
@@ -64,25 +120,30 @@ class RotatingFileSink : public Sink {
   size_t total_count_ = 0;
   std::ofstream file_;
   mutable std::mutex mutex_;
+  std::string line_;
+
+  // 下一个本地零点。换日判断只比较记录自己的时间戳，不再每行调用 time() + localtime()；
+  // 批量交来的记录时间可能略有乱序，早于零点的记录不会触发第二次轮转
+  std::time_t next_day_ = 0;
 
-  int current_day_ = 0;
-  static int get_today() {
-    time_t t = time(nullptr);
-    struct tm *sys_tm = localtime(&t);
-    return sys_tm->tm_mday;
+  static std::time_t next_midnight(std::time_t t) {
+    std::tm tm = local_time(t).tm;
+    tm.tm_mday += 1;
+    tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
   }
 
-  std::string generate_filepath(bool is_line_rotation) const {
-    time_t t = time(nullptr);
-    struct tm *sys_tm = localtime(&t);
+  std::string generate_filepath(bool is_line_rotation, std::time_t t) const {
+    const std::tm &sys_tm = local_time(t).tm;
 
     std::ostringstream oss;
-    oss << base_dir_ << "/" << (sys_tm->tm_year + 1900) << "_"
-        << std::setfill('0') << std::setw(2) << (sys_tm->tm_mon + 1) << "_"
-        << std::setfill('0') << std::setw(2) << sys_tm->tm_mday << "_"
-        << std::setfill('0') << std::setw(2) << sys_tm->tm_hour << "_"
-        << std::setfill('0') << std::setw(2) << sys_tm->tm_min << "_"
-        << std::setfill('0') << std::setw(2) << sys_tm->tm_sec << "_"
+    oss << base_dir_ << "/" << (sys_tm.tm_year + 1900) << "_"
+        << std::setfill('0') << std::setw(2) << (sys_tm.tm_mon + 1) << "_"
+        << std::setfill('0') << std::setw(2) << sys_tm.tm_mday << "_"
+        << std::setfill('0') << std::setw(2) << sys_tm.tm_hour << "_"
+        << std::setfill('0') << std::setw(2) << sys_tm.tm_min << "_"
+        << std::setfill('0') << std::setw(2) << sys_tm.tm_sec << "_"
         << base_name_ << ".log";
 
     if (is_line_rotation) {
@@ -91,23 +152,23 @@ class RotatingFileSink : public Sink {
 
     return oss.str();
   }
-  bool should_rotate(int today) const {
-    return (current_day_ != today) || (total_count_ % max_lines_ == 0);
+  bool should_rotate(std::time_t t) const {
+    return t >= next_day_ || (total_count_ % max_lines_ == 0);
   }
-  void rotate(int today) {
+  void rotate(std::time_t t) {
     if (file_.is_open()) {
       file_.flush();
       file_.close();
     }
 
-    bool is_line_rotation = (current_day_ == today);
+    bool is_line_rotation = t < next_day_;
 
-    if (current_day_ != today) {
-      current_day_ = today;
+    if (!is_line_rotation) {
+      next_day_ = next_midnight(t);
       total_count_ = 0;
     }
 
-    std::string new_path = generate_filepath(is_line_rotation);
+    std::string new_path = generate_filepath(is_line_rotation, t);
     file_.open(new_path, std::ios::app);
 
     if (!file_.is_open()) {
@@ -119,20 +180,33 @@ public:
   explicit RotatingFileSink(std::string base_dir, std::string base_name,
                             size_t max_lines = 5000000)
       : base_dir_(std::move(base_dir)), base_name_(std::move(base_name)),
-        max_lines_(max_lines), current_day_(get_today()) {
-    rotate(current_day_);
+        max_lines_(max_lines) {
+    const std::time_t now = std::time(nullptr);
+    next_day_ = next_midnight(now);
+    rotate(now);
   }
 
   void write(const LogEntry &entry) override {
     std::lock_guard lock(mutex_);
-    total_count_++;
-    int today = get_today();
-    if (should_rotate(today)) {
-      rotate(today);
-    }
+    line_.clear();
+    entry.append_to(line_);
+    write_line(std::chrono::system_clock::to_time_t(entry.timestamp));
+  }
 
-    if (file_.is_open()) {
-      file_ << entry.format();
+  void write_record(const LogRecord &record) override {
+    std::lock_guard lock(mutex_);
+    line_.clear();
+    append_record(line_, record);
+    write_line(std::chrono::system_clock::to_time_t(record.time()));
+  }
+
+  // 按行计数轮转，所以逐条写入，但整批只加一次锁
+  void write_batch(std::span<const RecordView> records) override {
+    std::lock_guard lock(mutex_);
+    for (const auto &record : records) {
+      line_.clear();
+      append_record(line_, record);
+      write_line(std::chrono::system_clock::to_time_t(record.time()));
     }
   }
 
@@ -148,39 +222,17 @@ public:
       file_.close();
     }
   }
-};
-
-class AsyncSink : public Sink {
-  std::unique_ptr<Sink> inner_sink_;
-  std::shared_ptr<threadpool::Channel<LogEntry>> channel_;
-  std::jthread worker_;
-
-public:
-  explicit AsyncSink(std::unique_ptr<Sink> sink, size_t buffer_size = 1000)
-      : inner_sink_(std::move(sink)),
-        channel_(std::make_shared<threadpool::Channel<LogEntry>>(buffer_size)),
-        worker_([this](std::stop_token stoken) { worker_loop(stoken); }) {}
 
-  void write(const LogEntry& entry) override {
-    channel_->try_send(entry);
-  }
-  void flush() override {
-    while (channel_->size() > 0) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+private:
+  // t 是这一行日志的时间
+  void write_line(std::time_t t) {
+    total_count_++;
+    if (should_rotate(t)) {
+      rotate(t);
     }
-    inner_sink_ -> flush();
-  }
-
-  ~AsyncSink() override {
-    channel_->close();
-  }
 
-private:
-  void worker_loop(std::stop_token stoken) {
-    while (!stoken.stop_requested()) {
-      auto entry = channel_->recv();
-      if (!entry) break;
-      inner_sink_->write(*entry);
+    if (file_.is_open()) {
+      file_.write(line_.data(), static_cast<std::streamsize>(line_.size()));
     }
   }
 };
@@ -1,10 +1,9 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <chrono>
+#include <ctime>
 #include <unordered_map>
-#include <sstream>
-#include <format>
-#include <iomanip>
 
 namespace logger {
 
@@ -35,6 +34,45 @@ inline std::string_view level_to_string(Level level) {
   return "UNKNOWN";
 }
 
+// 粗粒度的墙上时钟：CLOCK_REALTIME_COARSE 直接读取内核上一次 tick 的时间（精度为毫秒级），
+// 比 system_clock::now() 便宜。日志时间只渲染到秒，Logger 和 Logged 都用它打时间戳
+inline std::chrono::system_clock::time_point coarse_now() {
+#ifdef CLOCK_REALTIME_COARSE
+  timespec ts{};
+  ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+  return std::chrono::system_clock::time_point(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+#else
+  return std::chrono::system_clock::now();
+#endif
+}
+
+// 某一秒的本地时间及其 "%Y-%m-%d %H:%M:%S" 文本
+struct LocalTime {
+  std::time_t second = -1;
+  std::tm tm{};
+  char text[32] = {};
+  size_t length = 0;
+};
+
+// 每个线程缓存上一次的秒数，同一秒内只做一次 localtime_r + strftime。
+// 格式化与 RotatingFileSink 的换日判断共用这份缓存
+inline const LocalTime &local_time(std::time_t t) {
+  thread_local LocalTime cached;
+  if (t != cached.second) {
+    ::localtime_r(&t, &cached.tm);
+    cached.length = std::strftime(cached.text, sizeof(cached.text), "%Y-%m-%d %H:%M:%S", &cached.tm);
+    cached.second = t;
+  }
+  return cached;
+}
+
+inline std::string_view format_local_time(std::time_t t) {
+  const auto &local = local_time(t);
+  return {local.text, local.length};
+}
+
 struct LogEntry {
   Level level;
 std::string message;
@@ -44,30 +82,42 @@ std::chrono::system_clock::time_point timestamp;
   std::string function;
   std::unordered_map<std::string, std::string> fields;
 
-  std::string format() const {
-    std::ostringstream oss;
-
-    auto time_t = std::chrono::system_clock::to_time_t(timestamp);
-    oss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-
-    oss << " [" << level_to_string(level) << "]";
-
-    oss << " " << file << ":" <<line;
+  // "2024-01-02 03:04:05 [INFO] file:line message {k=v}\n"
+  void append_to(std::string &out) const {
+    out += format_local_time(std::chrono::system_clock::to_time_t(timestamp));
+    out += " [";
+    out += level_to_string(level);
+    out += "] ";
+    out += file;
+    out += ':';
+    out += std::to_string(line);
+    out += ' ';
+    append_body(out);
+    out += '\n';
+  }
 
-    oss << " " << message;
+  // 消息与附加字段
+  void append_body(std::string &out) const {
+    out += message;
 
     if (!fields.empty()) {
-      oss << " {";
+      out += " {";
       bool first = true;
       for (const auto& [k, v] : fields) {
-        if (!first) oss << ", ";
-        oss << k << "=" << v;
+        if (!first) out += ", ";
+        out += k;
+        out += '=';
+        out += v;
         first = false;
       }
-      oss << "}";
+      out += '}';
     }
-    oss << "\n";
-    return oss.str();
+  }
+
+  std::string format() const {
+    std::string out;
+    append_to(out);
+    return out;
   }
 };
 
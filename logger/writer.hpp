@@ -39,7 +39,7 @@ public:
   Logged<T> log_info(std::string message) const {
     return with_log(LogEntry{.level = Level::Info,
                              .message = std::move(message),
-                             .timestamp = std::chrono::system_clock::now(),
+                             .timestamp = coarse_now(),
                              .file = {},
                              .line = 0,
                              .function = {},
@@ -49,7 +49,7 @@ public:
   Logged<T> log_error(std::string message) const {
     return with_log(LogEntry{.level = Level::Error,
                              .message = std::move(message),
-                             .timestamp = std::chrono::system_clock::now(),
+                             .timestamp = coarse_now(),
                              .file = {},
                              .line = 0,
                              .function = {},
@@ -1,36 +1,60 @@
-#include "parser/http_parser.hpp"
+#include "http/server.hpp"
+#include <csignal>
 #include <iostream>
+#include <string>
 
-int main() {
-    std::string_view raw_request =
-        "GET /index.html HTTP/1.1\r\n"
-        "Host: localhost:9006\r\n"
-        "User-Agent: Mozilla/5.0\r\n"
-        "Accept: text/html\r\n"
-        "\r\n";
-
-    auto result = http::parser::parse_http_request(raw_request);
-
-    if (result) {
-        const auto& req = *result;
-
-        std::cout << "Method: "
-                  << (req.request_line.method == http::parser::Method::Get
-                      ? "GET" : "OTHER")
-                  << "\n";
-        std::cout << "URI: " << req.request_line.uri << "\n";
-        std::cout << "Version: "
-                  << (req.request_line.version == http::parser::Version::Http11
-                      ? "HTTP/1.1" : "HTTP/1.0")
-                  << "\n";
-
-        std::cout << "Headers:\n";
-        for (const auto& [key, value] : req.headers) {
-            std::cout << "  " << key << ": " << value << "\n";
-        }
-    } else {
-        std::cerr << "Parse error!\n";
+using namespace http::router;
+using namespace http::parser;
+
+int main(int argc, char *argv[]) {
+    http::server::ServerConfig config;
+    if (argc > 1) {
+        config.port = static_cast<uint16_t>(std::stoi(argv[1]));
+    }
+    if (argc > 2) {
+        config.num_reactors = std::max(1, std::stoi(argv[2]));
+    }
+    if (argc > 3 && std::string(argv[3]) == "uring") {
+        config.io_backend = http::server::IoBackend::IoUring;
+    }
+
+    auto &registry = metrics::Registry::global();
+    config.metrics = &registry;
+
+    auto router = RouterBuilder()
+        .instrument(registry)
+        .get("/", [](const HttpRequest&) {
+            return HttpResponse::ok().with_html("<h1>Welcome</h1>");
+        })
+        .get("/health", [](const HttpRequest&) {
+            return HttpResponse::ok().with_text("OK");
+        })
+        .get("/metrics", metrics_handler(registry))
+        .build();
+
+    // 在启动 reactor 线程前屏蔽信号，由主线程统一 sigwait
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    http::server::Server server(config, std::move(router));
+    if (auto started = server.start(); !started) {
+        std::cerr << "Failed to start server: "
+                  << static_cast<int>(started.error()) << "\n";
+        return 1;
     }
 
+    std::cout << "Listening on " << config.host << ":" << server.port()
+              << " with " << config.num_reactors << " reactor(s)"
+              << (config.io_backend == http::server::IoBackend::IoUring ? " on io_uring" : "")
+              << "\n";
+
+    int sig = 0;
+    sigwait(&signals, &sig);
+
+    std::cout << "Shutting down\n";
+    server.stop();
     return 0;
 }
@@ -0,0 +1,455 @@
+#pragma once
+#include "../threadpool/cacheline.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace metrics {
+
+// 单调时钟的纳秒数，用于计时；vDSO 调用，不进入内核
+inline int64_t now_ns() {
+  timespec ts{};
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+namespace detail {
+
+// 分片数：不超过 16 的 2 的幂，按 CPU 数选择，进程内固定
+inline size_t shard_count() {
+  static const size_t count =
+      std::bit_ceil(std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 16));
+  return count;
+}
+
+// 每个线程第一次写指标时领取一个分片号，轮流分配
+inline size_t shard_index() {
+  static std::atomic<size_t> next{0};
+  thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed);
+  return index & (shard_count() - 1);
+}
+
+struct alignas(threadpool::kCacheLineSize) Cell {
+  std::atomic<uint64_t> value{0};
+};
+
+} // namespace detail
+
+// 单调递增的计数器。每个线程写自己的分片（各占一条缓存行），读取时求和
+class Counter {
+  std::unique_ptr<detail::Cell[]> cells_;
+
+public:
+  Counter() : cells_(std::make_unique<detail::Cell[]>(detail::shard_count())) {}
+
+  void add(uint64_t n = 1) {
+    cells_[detail::shard_index()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] uint64_t value() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < detail::shard_count(); ++i) {
+      total += cells_[i].value.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+};
+
+// 可增可减、可直接设置的瞬时值。写入远少于计数器，不分片
+class Gauge {
+  std::atomic<int64_t> value_{0};
+
+public:
+  void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+  [[nodiscard]] int64_t value() const { return value_.load(std::memory_order_relaxed); }
+};
+
+// HDR 风格的对数-线性直方图，记录纳秒。每个 2 的幂区间再等分为 8 个桶，相对误差不超过 12.5%，
+// 覆盖 0 到 2^36 ns（约 68 秒），更大的值计入最后一个桶。每个分片是一组独立的桶，
+// 在对应线程第一次 observe 时才分配，之后 observe 只做两次 relaxed fetch_add；快照把各分片相加
+class Histogram {
+public:
+  static constexpr int kSubBits = 3;
+  static constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBits;
+  static constexpr int kMaxExponent = 36;
+  static constexpr size_t kBuckets = (kMaxExponent - kSubBits + 1) * kSubBuckets;
+
+  static constexpr size_t bucket_of(uint64_t value) {
+    if (value < kSubBuckets) {
+      return static_cast<size_t>(value);
+    }
+    const int exponent = std::bit_width(value) - 1;
+    if (exponent >= kMaxExponent) {
+      return kBuckets - 1;
+    }
+    const auto sub = (value >> (exponent - kSubBits)) & (kSubBuckets - 1);
+    return static_cast<size_t>((exponent - kSubBits + 1) * kSubBuckets + sub);
+  }
+
+  // 桶的下界（含）；bucket == kBuckets 时为可表示范围的上界
+  static constexpr uint64_t lower_bound(size_t bucket) {
+    if (bucket < kSubBuckets) {
+      return bucket;
+    }
+    const auto exponent = bucket / kSubBuckets + kSubBits - 1;
+    const auto sub = bucket % kSubBuckets;
+    return (kSubBuckets + sub) << (exponent - kSubBits);
+  }
+
+  struct Snapshot {
+    std::array<uint64_t, kBuckets> buckets{};
+    uint64_t count = 0;
+    uint64_t sum = 0; // 纳秒
+
+    // 第 q 分位所在桶的中点，q ∈ [0, 1]；没有样本时为 0
+    [[nodiscard]] uint64_t quantile(double q) const {
+      if (count == 0) {
+        return 0;
+      }
+      const auto rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+      uint64_t seen = 0;
+      for (size_t i = 0; i < kBuckets; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+          return (lower_bound(i) + lower_bound(i + 1) - 1) / 2;
+        }
+      }
+      return lower_bound(kBuckets);
+    }
+
+    // 小于 limit 的样本数；limit 必须是桶边界，例如 2 的幂
+    [[nodiscard]] uint64_t count_below(uint64_t limit) const {
+      uint64_t total = 0;
+      for (size_t i = 0; i < kBuckets && lower_bound(i + 1) <= limit; ++i) {
+        total += buckets[i];
+      }
+      return total;
+    }
+  };
+
+private:
+  struct alignas(threadpool::kCacheLineSize) Shard {
+    std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+    std::atomic<uint64_t> sum{0};
+  };
+
+  std::unique_ptr<std::atomic<Shard *>[]> shards_;
+
+public:
+  Histogram() : shards_(std::make_unique<std::atomic<Shard *>[]>(detail::shard_count())) {}
+
+  Histogram(const Histogram &) = delete;
+  Histogram &operator=(const Histogram &) = delete;
+
+  ~Histogram() {
+    for (size_t s = 0; s < detail::shard_count(); ++s) {
+      delete shards_[s].load(std::memory_order_relaxed);
+    }
+  }
+
+  void observe(uint64_t ns) {
+    auto &shard = local_shard();
+    shard.buckets[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(ns, std::memory_order_relaxed);
+  }
+
+  // 记录从 start_ns（now_ns() 的返回值）到现在的耗时
+  void observe_since(int64_t start_ns) {
+    observe(static_cast<uint64_t>(std::max<int64_t>(now_ns() - start_ns, 0)));
+  }
+
+  // 各分片分别读取，并发写入时结果不是同一时刻的精确值，但每个桶都单调不减
+  [[nodiscard]] Snapshot snapshot() const {
+    Snapshot out;
+    for (size_t s = 0; s < detail::shard_count(); ++s) {
+      const auto *shard = shards_[s].load(std::memory_order_acquire);
+      if (shard == nullptr) {
+        continue;
+      }
+      for (size_t i = 0; i < kBuckets; ++i) {
+        const auto n = shard->buckets[i].load(std::memory_order_relaxed);
+        out.buckets[i] += n;
+        out.count += n;
+      }
+      out.sum += shard->sum.load(std::memory_order_relaxed);
+    }
+    return out;
+  }
+
+private:
+  Shard &local_shard() {
+    auto &slot = shards_[detail::shard_index()];
+    auto *shard = slot.load(std::memory_order_acquire);
+    if (shard == nullptr) {
+      auto fresh = std::make_unique<Shard>();
+      // 同一分片的两个线程同时分配时，输的一方用赢家的
+      if (slot.compare_exchange_strong(shard, fresh.get(), std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+        shard = fresh.release();
+      }
+    }
+    return *shard;
+  }
+};
+
+using Label = std::pair<std::string_view, std::string_view>;
+
+class Registry;
+
+// 回调型指标的登记，析构时注销。回调引用的对象必须比它活得长
+class Registration {
+  friend class Registry;
+  Registry *registry_ = nullptr;
+  uint64_t id_ = 0;
+
+  Registration(Registry *registry, uint64_t id) : registry_(registry), id_(id) {}
+
+public:
+  Registration() = default;
+  Registration(Registration &&other) noexcept
+      : registry_(std::exchange(other.registry_, nullptr)), id_(other.id_) {}
+  Registration &operator=(Registration &&other) noexcept {
+    if (this != &other) {
+      reset();
+      registry_ = std::exchange(other.registry_, nullptr);
+      id_ = other.id_;
+    }
+    return *this;
+  }
+  Registration(const Registration &) = delete;
+  Registration &operator=(const Registration &) = delete;
+  ~Registration() { reset(); }
+
+  inline void reset();
+};
+
+// 指标的集合，按 Prometheus 文本格式导出。同名同标签的指标只创建一次，
+// 返回的引用在 Registry 存活期间有效；热路径应在初始化时取得引用并保存。
+// 注册与导出加锁，更新指标本身不加锁
+class Registry {
+public:
+  enum class Type { Counter, Gauge, Histogram };
+
+private:
+  using Callback = std::function<double()>;
+  using Value = std::variant<std::unique_ptr<Counter>, std::unique_ptr<Gauge>,
+                             std::unique_ptr<Histogram>, Callback>;
+
+  struct Series {
+    std::string labels; // 已渲染的 {k="v",...}，可以为空
+    Value value;
+    uint64_t id = 0; // 回调型指标的登记号，其余为 0
+  };
+
+  struct Family {
+    std::string help;
+    Type type;
+    std::vector<Series> series;
+  };
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Family, std::less<>> families_;
+  uint64_t next_id_ = 1;
+
+public:
+  Registry() = default;
+  Registry(const Registry &) = delete;
+  Registry &operator=(const Registry &) = delete;
+
+  // 进程级的默认实例，永不销毁
+  static Registry &global() {
+    static auto *registry = new Registry;
+    return *registry;
+  }
+
+  // 同名指标的类型不一致时抛出 std::invalid_argument
+  Counter &counter(std::string_view name, std::string_view help,
+                   std::initializer_list<Label> labels = {}) {
+    return get<Counter>(name, help, Type::Counter, labels);
+  }
+
+  Gauge &gauge(std::string_view name, std::string_view help,
+               std::initializer_list<Label> labels = {}) {
+    return get<Gauge>(name, help, Type::Gauge, labels);
+  }
+
+  Histogram &histogram(std::string_view name, std::string_view help,
+                       std::initializer_list<Label> labels = {}) {
+    return get<Histogram>(name, help, Type::Histogram, labels);
+  }
+
+  // 导出时才求值的计数器或仪表，例如队列长度、外部维护的计数。type 不能是 Histogram
+  [[nodiscard]] Registration callback(std::string_view name, std::string_view help, Type type,
+                                      Callback read, std::initializer_list<Label> labels = {}) {
+    if (type == Type::Histogram) {
+      throw std::invalid_argument("callback metrics cannot be histograms");
+    }
+    std::lock_guard lock(mutex_);
+    auto &family = family_of(name, help, type);
+    const uint64_t id = next_id_++;
+    family.series.push_back(Series{render_labels(labels), std::move(read), id});
+    return Registration(this, id);
+  }
+
+  // Prometheus 文本格式（0.0.4）。直方图的时间单位换算为秒，桶边界取 1 µs 到约 34 s 之间的 2 的幂纳秒
+  [[nodiscard]] std::string expose() const {
+    std::string out;
+    std::lock_guard lock(mutex_);
+    for (const auto &[name, family] : families_) {
+      if (family.series.empty()) {
+        continue;
+      }
+      out += "# HELP ";
+      out += name;
+      out += ' ';
+      out += family.help;
+      out += "\n# TYPE ";
+      out += name;
+      out += family.type == Type::Counter ? " counter\n"
+             : family.type == Type::Gauge ? " gauge\n"
+                                          : " histogram\n";
+      for (const auto &series : family.series) {
+        write_series(out, name, series);
+      }
+    }
+    return out;
+  }
+
+private:
+  friend class Registration;
+
+  void remove(uint64_t id) {
+    std::lock_guard lock(mutex_);
+    for (auto &[name, family] : families_) {
+      std::erase_if(family.series, [id](const Series &series) { return series.id == id; });
+    }
+  }
+
+  template <typename T>
+  T &get(std::string_view name, std::string_view help, Type type,
+         std::initializer_list<Label> labels) {
+    auto rendered = render_labels(labels);
+    std::lock_guard lock(mutex_);
+    auto &family = family_of(name, help, type);
+    for (auto &series : family.series) {
+      if (series.labels == rendered) {
+        if (auto *existing = std::get_if<std::unique_ptr<T>>(&series.value)) {
+          return **existing;
+        }
+        throw std::invalid_argument("metric registered as a callback: " + std::string(name));
+      }
+    }
+    auto metric = std::make_unique<T>();
+    auto &ref = *metric;
+    family.series.push_back(Series{std::move(rendered), std::move(metric), 0});
+    return ref;
+  }
+
+  Family &family_of(std::string_view name, std::string_view help, Type type) {
+    auto it = families_.find(name);
+    if (it == families_.end()) {
+      it = families_.emplace(std::string(name), Family{std::string(help), type, {}}).first;
+    } else if (it->second.type != type) {
+      throw std::invalid_argument("metric type mismatch: " + std::string(name));
+    }
+    return it->second;
+  }
+
+  static std::string render_labels(std::initializer_list<Label> labels) {
+    std::string out;
+    for (const auto &[key, value] : labels) {
+      out += out.empty() ? "{" : ",";
+      out += key;
+      out += "=\"";
+      for (const char c : value) {
+        if (c == '\\' || c == '"') {
+          out += '\\';
+          out += c;
+        } else if (c == '\n') {
+          out += "\\n";
+        } else {
+          out += c;
+        }
+      }
+      out += '"';
+    }
+    if (!out.empty()) {
+      out += '}';
+    }
+    return out;
+  }
+
+  // 在已渲染的标签里追加一个 le
+  static std::string with_le(const std::string &labels, std::string_view le) {
+    std::string out = labels.empty() ? "{" : labels.substr(0, labels.size() - 1) + ",";
+    out += "le=\"";
+    out += le;
+    out += "\"}";
+    return out;
+  }
+
+  static void append_number(std::string &out, double value) {
+    char buf[32];
+    const int n = std::snprintf(buf, sizeof(buf), "%.17g", value);
+    out.append(buf, static_cast<size_t>(n));
+  }
+
+  static void append_line(std::string &out, std::string_view name, std::string_view suffix,
+                          std::string_view labels, double value) {
+    out += name;
+    out += suffix;
+    out += labels;
+    out += ' ';
+    append_number(out, value);
+    out += '\n';
+  }
+
+  static void write_series(std::string &out, std::string_view name, const Series &series) {
+    if (const auto *counter = std::get_if<std::unique_ptr<Counter>>(&series.value)) {
+      append_line(out, name, "", series.labels, static_cast<double>((*counter)->value()));
+    } else if (const auto *gauge = std::get_if<std::unique_ptr<Gauge>>(&series.value)) {
+      append_line(out, name, "", series.labels, static_cast<double>((*gauge)->value()));
+    } else if (const auto *read = std::get_if<Callback>(&series.value)) {
+      append_line(out, name, "", series.labels, (*read)());
+    } else {
+      const auto snapshot = std::get<std::unique_ptr<Histogram>>(series.value)->snapshot();
+      char le[32];
+      for (int exponent = 10; exponent < Histogram::kMaxExponent; ++exponent) {
+        const uint64_t limit = uint64_t{1} << exponent;
+        std::snprintf(le, sizeof(le), "%.9g", static_cast<double>(limit) / 1e9);
+        append_line(out, name, "_bucket", with_le(series.labels, le),
+                    static_cast<double>(snapshot.count_below(limit)));
+      }
+      append_line(out, name, "_bucket", with_le(series.labels, "+Inf"),
+                  static_cast<double>(snapshot.count));
+      append_line(out, name, "_sum", series.labels, static_cast<double>(snapshot.sum) / 1e9);
+      append_line(out, name, "_count", series.labels, static_cast<double>(snapshot.count));
+    }
+  }
+};
+
+inline void Registration::reset() {
+  if (registry_ != nullptr) {
+    registry_->remove(id_);
+    registry_ = nullptr;
+  }
+}
+
+} // namespace metrics
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace http::parser {
+
+// 请求级的单调内存池。先从预先分配的首块里顺序切分，用完后向上游按块申请；
+// deallocate 是空操作，reset() 一步丢弃全部内容并回到首块。
+// 连接持有一个，在已排队的响应全部写出后 reset，同一连接上的请求反复使用同一块内存
+class RequestArena {
+  std::unique_ptr<std::byte[]> initial_;
+  size_t initial_size_;
+  std::pmr::monotonic_buffer_resource resource_;
+
+public:
+  static constexpr size_t kDefaultInitialSize = 8 * 1024;
+
+  explicit RequestArena(size_t initial_size = kDefaultInitialSize,
+                        std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+      : initial_(std::make_unique_for_overwrite<std::byte[]>(initial_size)),
+        initial_size_(initial_size), resource_(initial_.get(), initial_size_, upstream) {}
+
+  RequestArena(const RequestArena &) = delete;
+  RequestArena &operator=(const RequestArena &) = delete;
+
+  [[nodiscard]] std::pmr::memory_resource *resource() { return &resource_; }
+
+  // 调用前必须确保没有对象还在使用池里的内存
+  void reset() { resource_.release(); }
+};
+
+} // namespace http::parser
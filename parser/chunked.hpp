@@ -0,0 +1,159 @@
+#pragma once
+#include "types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace http::parser {
+
+// chunked 传输编码（RFC 9112 §7.1）的增量解码器。逐字节推进的状态机，输入可以在任意位置
+// 被切断，下一次 feed 从断点继续。解码出的数据通过回调交出，解码器本身不缓存数据。
+// chunk 扩展与 trailer 字段会被校验长度后丢弃
+class ChunkedDecoder {
+  enum class State { Size, Ext, SizeLF, Data, DataCR, DataLF, TrailerStart, Trailer, TrailerLF, FinalLF, Done };
+
+  static constexpr size_t kMaxSizeDigits = 15; // 防止 chunk 大小溢出
+  static constexpr size_t kMaxLineSize = 4096;
+  static constexpr size_t kMaxTrailerSize = 8 * 1024;
+
+  State state_ = State::Size;
+  uint64_t remaining_ = 0; // 当前 chunk 尚未交出的数据字节
+  size_t digits_ = 0;
+  size_t line_size_ = 0;
+  size_t trailer_size_ = 0;
+  uint64_t decoded_ = 0;
+
+  static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+      return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+      return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+      return c - 'A' + 10;
+    }
+    return -1;
+  }
+
+public:
+  // on_data(std::string_view) 返回 ParseResult<void>，出错时解码立即停止并返回该错误。
+  // 返回消耗的字节数；done() 之后的字节不会被消耗，属于下一个请求
+  template <typename F> ParseResult<size_t> feed(std::string_view in, F &&on_data) {
+    size_t i = 0;
+    while (i < in.size() && state_ != State::Done) {
+      const char c = in[i];
+      switch (state_) {
+      case State::Size:
+        if (const int v = hex_value(c); v >= 0) {
+          if (++digits_ > kMaxSizeDigits) {
+            return std::unexpected(ParseError::MalformedRequest);
+          }
+          remaining_ = remaining_ * 16 + static_cast<uint64_t>(v);
+        } else if (digits_ > 0 && (c == ';' || c == ' ' || c == '\t')) {
+          state_ = State::Ext;
+          line_size_ = 0;
+        } else if (digits_ > 0 && c == '\r') {
+          state_ = State::SizeLF;
+        } else {
+          return std::unexpected(ParseError::MalformedRequest);
+        }
+        ++i;
+        break;
+      case State::Ext:
+        if (c == '\r') {
+          state_ = State::SizeLF;
+        } else if (c == '\n' || ++line_size_ > kMaxLineSize) {
+          return std::unexpected(ParseError::MalformedRequest);
+        }
+        ++i;
+        break;
+      case State::SizeLF:
+        if (c != '\n') {
+          return std::unexpected(ParseError::MalformedRequest);
+        }
+        state_ = remaining_ == 0 ? State::TrailerStart : State::Data;
+        ++i;
+        break;
+      case State::Data: {
+        const auto n = static_cast<size_t>(std::min<uint64_t>(remaining_, in.size() - i));
+        if (auto r = on_data(in.substr(i, n)); !r) {
+          return std::unexpected(r.error());
+        }
+        remaining_ -= n;
+        decoded_ += n;
+        i += n;
+        if (remaining_ == 0) {
+          state_ = State::DataCR;
+        }
+        break;
+      }
+      case State::DataCR:
+        if (c != '\r') {
+          return std::unexpected(ParseError::MalformedRequest);
+        }
+        state_ = State::DataLF;
+        ++i;
+        break;
+      case State::DataLF:
+        if (c != '\n') {
+          return std::unexpected(ParseError::MalformedRequest);
+        }
+        state_ = State::Size;
+        digits_ = 0;
+        ++i;
+        break;
+      case State::TrailerStart:
+        state_ = c == '\r' ? State::FinalLF : State::Trailer;
+        line_size_ = 0;
+        if (state_ == State::FinalLF) {
+          ++i;
+        }
+        break;
+      case State::Trailer:
+        if (c == '\r') {
+          state_ = State::TrailerLF;
+        } else if (c == '\n' || ++line_size_ > kMaxLineSize ||
+                   ++trailer_size_ > kMaxTrailerSize) {
+          return std::unexpected(ParseError::MalformedRequest);
+        }
+        ++i;
+        break;
+      case State::TrailerLF:
+        if (c != '\n') {
+          return std::unexpected(ParseError::MalformedRequest);
+        }
+        state_ = State::TrailerStart;
+        ++i;
+        break;
+      case State::FinalLF:
+        if (c != '\n') {
+          return std::unexpected(ParseError::MalformedRequest);
+        }
+        state_ = State::Done;
+        ++i;
+        break;
+      case State::Done:
+        break;
+      }
+    }
+    return i;
+  }
+
+  [[nodiscard]] bool done() const { return state_ == State::Done; }
+
+  // 已交出的数据字节总数
+  [[nodiscard]] uint64_t decoded() const { return decoded_; }
+
+  void reset() { *this = ChunkedDecoder{}; }
+};
+
+// Transfer-Encoding 只接受单独的 chunked（大小写不敏感，允许两侧空白）；
+// 其他编码或编码列表都视为无法处理
+inline bool is_chunked_encoding(std::string_view value) {
+  const auto begin = value.find_first_not_of(" \t");
+  const auto end = value.find_last_not_of(" \t");
+  return begin != std::string_view::npos && iequals(value.substr(begin, end - begin + 1), "chunked");
+}
+
+} // namespace http::parser
@@ -1,20 +1,48 @@
 #pragma once
+#include "scan.hpp"
 #include "types.hpp"
+#include <algorithm>
+#include <concepts>
 #include <expected>
 #include <functional>
 #include <string_view>
+#include <type_traits>
 #include <variant>
+#include <vector>
 
 namespace http::parser::combinator {
 
 template <typename T>
-using Parser =
-    std::function<std::expected<std::pair<T, std::string_view>, ParseError>(
-        std::string_view)>;
+using ParseOutput = std::expected<std::pair<T, std::string_view>, ParseError>;
 
-inline Parser<char> one_char() {
-  return [](std::string_view input)
-             -> std::expected<std::pair<char, std::string_view>, ParseError> {
+// 类型擦除的解析器：仅在需要运行时组合（如存入容器）时通过 erase() 使用
+template <typename T>
+using Parser = std::function<ParseOutput<T>(std::string_view)>;
+
+template <typename R> struct is_parse_output : std::false_type {};
+
+template <typename T>
+struct is_parse_output<ParseOutput<T>> : std::true_type {
+  using value_type = T;
+};
+
+// 任何 `(std::string_view) -> ParseOutput<T>` 的可调用对象都是解析器。
+// 组合子直接返回具体的 lambda 类型，组合结果可以被编译器完全内联
+template <typename P>
+concept ParserLike =
+    std::invocable<const P &, std::string_view> &&
+    is_parse_output<std::remove_cvref_t<std::invoke_result_t<const P &, std::string_view>>>::value;
+
+template <ParserLike P>
+using parser_value_t = typename is_parse_output<
+    std::remove_cvref_t<std::invoke_result_t<const P &, std::string_view>>>::value_type;
+
+template <ParserLike P> Parser<parser_value_t<P>> erase(P p) {
+  return Parser<parser_value_t<P>>(std::move(p));
+}
+
+constexpr auto one_char() {
+  return [](std::string_view input) -> ParseOutput<char> {
     if (input.empty()) {
       return std::unexpected(ParseError::IncompleteRequest);
     }
@@ -22,60 +50,59 @@ inline Parser<char> one_char() {
   };
 }
 
-inline Parser<char> satisfy(std::function<bool(char)> predicate) {
-  return [predicate](std::string_view input) 
-    ->std::expected<std::pair<char, std::string_view>, ParseError> {
-      return one_char()(input).and_then(
-          [&](auto pair)
-              -> std::expected<std::pair<char, std::string_view>, ParseError> {
-            auto [ch, rest] = pair;
-            if (predicate(ch)) {
-              return std::pair{ch, rest};
-            }
-            return std::unexpected(ParseError::MalformedRequest);
-          });
-    };
-  }
-
-  inline Parser<std::string_view>
-  string(std::string_view target) {
-    return [target](std::string_view input)
-               -> std::expected<std::pair<std::string_view, std::string_view>,
-                                ParseError> {
-      if (input.starts_with(target)) {
-        return std::pair{target, input.substr(target.size())};
-      }
-      return std::unexpected(ParseError::MalformedRequest);
-    };
-  }
-
-  template <typename A, typename B>
-  Parser<std::pair<A, B>> sequence(Parser<A> pa, Parser<B> pb) {
-    return [pa = std::move(pa), pb = std::move(pb)](std::string_view input) {
-      return pa(input).and_then([&](auto first_result) {
-        auto [a, rest1] = first_result;
-        return pb(rest1).transform([&](auto second_result) {
-          auto [b, rest2] = second_result;
-          return std::pair{std::pair{std::move(a), std::move(b)}, rest2};
-        });
-      });
-    };
-  }
-
-  template <typename T> Parser<T> choice(Parser<T> p1, Parser<T> p2) {
-    return [p1 = std::move(p1), p2 = std::move(p2)](std::string_view input) {
-      auto r = p1(input);
-      if (r) {
-        return r;
-      }
-      return p2(input);
-    };
-  }
-
-template<typename T>
-Parser<T> choice(std::vector<Parser<T>> parsers) {
-  return [parsers = std::move(parsers)](std::string_view input)
-             -> std::expected<std::pair<T, std::string_view>, ParseError> {
+template <typename Pred> constexpr auto satisfy(Pred predicate) {
+  return [predicate = std::move(predicate)](std::string_view input) -> ParseOutput<char> {
+    if (input.empty()) {
+      return std::unexpected(ParseError::IncompleteRequest);
+    }
+    if (predicate(input[0])) {
+      return std::pair{input[0], input.substr(1)};
+    }
+    return std::unexpected(ParseError::MalformedRequest);
+  };
+}
+
+constexpr auto string(std::string_view target) {
+  return [target](std::string_view input) -> ParseOutput<std::string_view> {
+    if (input.starts_with(target)) {
+      return std::pair{target, input.substr(target.size())};
+    }
+    return std::unexpected(ParseError::MalformedRequest);
+  };
+}
+
+template <ParserLike PA, ParserLike PB> constexpr auto sequence(PA pa, PB pb) {
+  using A = parser_value_t<PA>;
+  using B = parser_value_t<PB>;
+  return [pa = std::move(pa), pb = std::move(pb)](
+             std::string_view input) -> ParseOutput<std::pair<A, B>> {
+    auto first = pa(input);
+    if (!first) {
+      return std::unexpected(first.error());
+    }
+    auto second = pb(first->second);
+    if (!second) {
+      return std::unexpected(second.error());
+    }
+    return std::pair{std::pair{std::move(first->first), std::move(second->first)},
+                     second->second};
+  };
+}
+
+// 按顺序尝试每个备选项，全部失败时返回最后一个备选项的错误
+template <ParserLike P, ParserLike... Ps>
+  requires(std::same_as<parser_value_t<P>, parser_value_t<Ps>> && ...)
+constexpr auto choice(P p, Ps... ps) {
+  using T = parser_value_t<P>;
+  return [p = std::move(p), ... ps = std::move(ps)](std::string_view input) -> ParseOutput<T> {
+    ParseOutput<T> result = p(input);
+    (void)(result.has_value() || ... || (result = ps(input)).has_value());
+    return result;
+  };
+}
+
+template <typename T> Parser<T> choice(std::vector<Parser<T>> parsers) {
+  return [parsers = std::move(parsers)](std::string_view input) -> ParseOutput<T> {
     for (const auto &p : parsers) {
       auto result = p(input);
       if (result) {
@@ -86,22 +113,21 @@ Parser<T> choice(std::vector<Parser<T>> parsers) {
   };
 }
 
-template <typename A, typename F> auto map(Parser<A> pa, F f) {
-  using B = decltype(f(std::declval<A>()));
-  return Parser<B>(
-      [pa = std::move(pa), f = std::move(f)](std::string_view input)
-          -> std::expected<std::pair<B, std::string_view>, ParseError> {
-        return pa(input).transform([&](auto pair) {
-          auto [a, rest] = pair;
-          return std::pair{f(std::move(a)), rest};
-        });
-      });
+template <ParserLike PA, typename F> constexpr auto map(PA pa, F f) {
+  using A = parser_value_t<PA>;
+  using B = std::invoke_result_t<const F &, A>;
+  return [pa = std::move(pa), f = std::move(f)](std::string_view input) -> ParseOutput<B> {
+    auto result = pa(input);
+    if (!result) {
+      return std::unexpected(result.error());
+    }
+    return std::pair{f(std::move(result->first)), result->second};
+  };
 }
 
-template <typename T> Parser<std::vector<T>> many(Parser<T> p) {
-  return [p = std::move(p)](std::string_view input)
-             -> std::expected<std::pair<std::vector<T>, std::string_view>,
-                              ParseError> {
+template <ParserLike P> constexpr auto many(P p) {
+  using T = parser_value_t<P>;
+  return [p = std::move(p)](std::string_view input) -> ParseOutput<std::vector<T>> {
     std::vector<T> results;
     auto current_input = input;
 
@@ -110,36 +136,41 @@ template <typename T> Parser<std::vector<T>> many(Parser<T> p) {
       if (!result) {
         break;
       }
-      auto [value, rest] = *result;
-      results.push_back(std::move(value));
-      current_input = rest;
+      results.push_back(std::move(result->first));
+      current_input = result->second;
     }
 
     return std::pair{std::move(results), current_input};
   };
 }
 
-template <typename T> Parser<std::vector<T>> many1(Parser<T> p) {
-  return [p = std::move(p)](std::string_view input) {
-    return p(input).and_then([&](auto first_result) {
-      auto [first, rest1] = first_result;
-      auto many_result = many(p)(rest1);
-
-      return many_result.transform([&](auto many_pair) {
-        auto [rest_vec, final_rest] = many_pair;
-        std::vector<T> all_results;
-        all_results.push_back(std::move(first));
-        all_results.insert(all_results.end(), rest_vec.begin(), rest_vec.end());
-        return std::pair{std::move(all_results), final_rest};
-      });
-    });
+template <ParserLike P> constexpr auto many1(P p) {
+  using T = parser_value_t<P>;
+  return [p = std::move(p)](std::string_view input) -> ParseOutput<std::vector<T>> {
+    auto first = p(input);
+    if (!first) {
+      return std::unexpected(first.error());
+    }
+
+    std::vector<T> results;
+    results.push_back(std::move(first->first));
+    auto current_input = first->second;
+
+    while (true) {
+      auto result = p(current_input);
+      if (!result) {
+        break;
+      }
+      results.push_back(std::move(result->first));
+      current_input = result->second;
+    }
+
+    return std::pair{std::move(results), current_input};
   };
 }
 
-inline Parser<std::monostate> spaces() {
-  return [](std::string_view input)
-             -> std::expected<std::pair<std::monostate, std::string_view>,
-                              ParseError> {
+constexpr auto spaces() {
+  return [](std::string_view input) -> ParseOutput<std::monostate> {
     auto it = std::find_if_not(input.begin(), input.end(),
                                [](unsigned char c) { return std::isspace(c); });
     auto count = std::distance(input.begin(), it);
@@ -147,10 +178,8 @@ inline Parser<std::monostate> spaces() {
   };
 }
 
-inline Parser<std::string_view> take_until(char delimiter) {
-  return [delimiter](std::string_view input)
-             -> std::expected<std::pair<std::string_view, std::string_view>,
-                              ParseError> {
+constexpr auto take_until(char delimiter) {
+  return [delimiter](std::string_view input) -> ParseOutput<std::string_view> {
     auto pos = input.find(delimiter);
     if (pos == std::string_view::npos) {
       return std::unexpected(ParseError::IncompleteRequest);
@@ -159,4 +188,27 @@ inline Parser<std::string_view> take_until(char delimiter) {
   };
 }
 
+// 以下原语使用 scan.hpp 中的向量化内核，一次处理 16/32 字节
+
+inline constexpr auto take_until_crlf() {
+  return [](std::string_view input) -> ParseOutput<std::string_view> {
+    auto pos = scan::find_crlf(input);
+    if (pos == scan::npos) {
+      return std::unexpected(ParseError::IncompleteRequest);
+    }
+    return std::pair{input.substr(0, pos), input.substr(pos)};
+  };
+}
+
+// 1*tchar（RFC 9110 token），如 header 名称、方法名
+inline constexpr auto take_token() {
+  return [](std::string_view input) -> ParseOutput<std::string_view> {
+    auto pos = std::min(scan::find_non_tchar(input), input.size());
+    if (pos == 0) {
+      return std::unexpected(ParseError::MalformedRequest);
+    }
+    return std::pair{input.substr(0, pos), input.substr(pos)};
+  };
+}
+
 } // namespace http::parser::combinator
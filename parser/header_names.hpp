@@ -0,0 +1,170 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+namespace http::parser {
+
+// 常见 header 名称的编译期表。解析时把名称映射为枚举 ID，之后的查找是一次数组下标；
+// 不在表中的 header 退回到大小写不敏感的比较
+enum class HeaderId : uint8_t {
+  Unknown,
+  Accept,
+  AcceptEncoding,
+  AcceptLanguage,
+  Authorization,
+  CacheControl,
+  Connection,
+  ContentEncoding,
+  ContentLength,
+  ContentType,
+  Cookie,
+  Expect,
+  Host,
+  IfModifiedSince,
+  IfNoneMatch,
+  Origin,
+  Range,
+  Referer,
+  TransferEncoding,
+  Upgrade,
+  UserAgent,
+  XForwardedFor,
+  Count
+};
+
+inline constexpr size_t kKnownHeaderCount = static_cast<size_t>(HeaderId::Count);
+
+inline constexpr std::array<std::string_view, kKnownHeaderCount> header_names = {
+    "",
+    "Accept",
+    "Accept-Encoding",
+    "Accept-Language",
+    "Authorization",
+    "Cache-Control",
+    "Connection",
+    "Content-Encoding",
+    "Content-Length",
+    "Content-Type",
+    "Cookie",
+    "Expect",
+    "Host",
+    "If-Modified-Since",
+    "If-None-Match",
+    "Origin",
+    "Range",
+    "Referer",
+    "Transfer-Encoding",
+    "Upgrade",
+    "User-Agent",
+    "X-Forwarded-For",
+};
+
+constexpr std::string_view header_name(HeaderId id) {
+  return header_names[static_cast<size_t>(id)];
+}
+
+constexpr char ascii_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr bool iequals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (ascii_lower(a[i]) != ascii_lower(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// (长度, 首字母小写) 在表内唯一确定至多两个候选，整个查找不分配、不哈希整串
+constexpr HeaderId lookup_header(std::string_view name) {
+  if (name.empty()) {
+    return HeaderId::Unknown;
+  }
+  auto check = [name](HeaderId id) { return iequals(name, header_name(id)) ? id : HeaderId::Unknown; };
+  const char first = ascii_lower(name[0]);
+
+  switch (name.size()) {
+  case 4:
+    return first == 'h' ? check(HeaderId::Host) : HeaderId::Unknown;
+  case 5:
+    return first == 'r' ? check(HeaderId::Range) : HeaderId::Unknown;
+  case 6:
+    switch (first) {
+    case 'a': return check(HeaderId::Accept);
+    case 'c': return check(HeaderId::Cookie);
+    case 'e': return check(HeaderId::Expect);
+    case 'o': return check(HeaderId::Origin);
+    default: return HeaderId::Unknown;
+    }
+  case 7:
+    switch (first) {
+    case 'r': return check(HeaderId::Referer);
+    case 'u': return check(HeaderId::Upgrade);
+    default: return HeaderId::Unknown;
+    }
+  case 10:
+    switch (first) {
+    case 'c': return check(HeaderId::Connection);
+    case 'u': return check(HeaderId::UserAgent);
+    default: return HeaderId::Unknown;
+    }
+  case 12:
+    return first == 'c' ? check(HeaderId::ContentType) : HeaderId::Unknown;
+  case 13:
+    switch (first) {
+    case 'a': return check(HeaderId::Authorization);
+    case 'c': return check(HeaderId::CacheControl);
+    case 'i': return check(HeaderId::IfNoneMatch);
+    default: return HeaderId::Unknown;
+    }
+  case 14:
+    return first == 'c' ? check(HeaderId::ContentLength) : HeaderId::Unknown;
+  case 15:
+    switch (first) {
+    case 'a': {
+      auto id = check(HeaderId::AcceptEncoding);
+      return id != HeaderId::Unknown ? id : check(HeaderId::AcceptLanguage);
+    }
+    case 'x': return check(HeaderId::XForwardedFor);
+    default: return HeaderId::Unknown;
+    }
+  case 16:
+    return first == 'c' ? check(HeaderId::ContentEncoding) : HeaderId::Unknown;
+  case 17:
+    switch (first) {
+    case 'i': return check(HeaderId::IfModifiedSince);
+    case 't': return check(HeaderId::TransferEncoding);
+    default: return HeaderId::Unknown;
+    }
+  default:
+    return HeaderId::Unknown;
+  }
+}
+
+// 大小写不敏感、支持 std::string_view 异构查找的哈希与比较，用于 Headers
+struct CaseInsensitiveHash {
+  using is_transparent = void;
+
+  size_t operator()(std::string_view s) const {
+    size_t h = 14695981039346656037ull;
+    for (char c : s) {
+      h = (h ^ static_cast<unsigned char>(ascii_lower(c))) * 1099511628211ull;
+    }
+    return h;
+  }
+};
+
+struct CaseInsensitiveEqual {
+  using is_transparent = void;
+
+  bool operator()(std::string_view a, std::string_view b) const { return iequals(a, b); }
+};
+
+} // namespace http::parser
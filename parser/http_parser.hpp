@@ -1,154 +1,175 @@
 #pragma once
+#include "chunked.hpp"
 #include "combinaor.hpp"
 #include "types.hpp"
 #include <cctype>
 
 namespace http::parser {
 
-  // using namespace combinaor;
-
-  inline combinator::Parser<http::parser::Method> parse_method() {
-    return combinator::choice<http::parser::Method>(
-        {combinator::map(combinator::string("GET"), [](auto) { return http::parser::Method::Get; }),
-         combinator::map(combinator::string("POST"), [](auto) { return http::parser::Method::Post; }),
-         combinator::map(combinator::string("HEAD"), [](auto) { return http::parser::Method::Head; }),
-         combinator::map(combinator::string("PUT"), [](auto) { return http::parser::Method::Put; }),
-         combinator::map(combinator::string("DELETE"),
-             [](auto) { return http::parser::Method::Delete; }),
-         combinator::map(combinator::string("OPTIONS"),
-             [](auto) { return http::parser::Method::Options; }),
-         combinator::map(combinator::string("TRACE"), [](auto) { return http::parser::Method::Trace; }),
-         combinator::map(combinator::string("CONNECT"),
-             [](auto) { return http::parser::Method::Connect; }),
-         combinator::map(combinator::string("PATCH"),
-             [](auto) { return http::parser::Method::Patch; })});
-  }
+  // 语法中的解析器对象只构造一次（constexpr），每个请求复用同一个对象，
+  // 组合后的类型是具体的 lambda，不经过 std::function
+  namespace grammar {
+
+    template <auto Value> inline constexpr auto constant = [](auto) { return Value; };
 
-  inline combinator::Parser<std::string> parse_uri() {
-    return [](std::string_view input)
-               -> std::expected<std::pair<std::string, std::string_view>,
-                                http::parser::ParseError> {
-      auto it = std::find_if(input.begin(), input.end(),
-                            [](unsigned char c) { return std::isspace(c); });
-      auto count = std::distance(input.begin(), it);
+    // 按首字节分派，每个请求至多做一次定长比较，而不是依次尝试九个字符串解析器
+    inline constexpr auto method = [](std::string_view input)
+        -> combinator::ParseOutput<Method> {
+      auto expect = [input](std::string_view name, Method m) -> combinator::ParseOutput<Method> {
+        if (!input.starts_with(name)) {
+          return std::unexpected(ParseError::InvalidMethod);
+        }
+        return std::pair{m, input.substr(name.size())};
+      };
+
+      if (input.empty()) {
+        return std::unexpected(ParseError::IncompleteRequest);
+      }
+      switch (input[0]) {
+      case 'G': return expect("GET", Method::Get);
+      case 'H': return expect("HEAD", Method::Head);
+      case 'D': return expect("DELETE", Method::Delete);
+      case 'O': return expect("OPTIONS", Method::Options);
+      case 'T': return expect("TRACE", Method::Trace);
+      case 'C': return expect("CONNECT", Method::Connect);
+      case 'P':
+        if (input.size() > 1) {
+          switch (input[1]) {
+          case 'O': return expect("POST", Method::Post);
+          case 'U': return expect("PUT", Method::Put);
+          case 'A': return expect("PATCH", Method::Patch);
+          default: break;
+          }
+        }
+        return std::unexpected(ParseError::InvalidMethod);
+      default:
+        return std::unexpected(ParseError::InvalidMethod);
+      }
+    };
+
+    inline constexpr auto uri = [](std::string_view input)
+        -> combinator::ParseOutput<std::string_view> {
+      auto count = std::min(scan::find_uri_end(input), input.size());
 
       if (count == 0) {
-        return std::unexpected(http::parser::ParseError::InvalidUri);
+        return std::unexpected(ParseError::InvalidUri);
       }
 
-      auto uri = std::string(input.substr(0, count));
-      return std::pair{std::move(uri), input.substr(count)};
+      return std::pair{input.substr(0, count), input.substr(count)};
     };
-  }
 
-  inline combinator::Parser<http::parser::Version> parse_version() {
-    return combinator::choice<http::parser::Version>(
-        {combinator::map(combinator::string("HTTP/1.0"), [](auto) { return http::parser::Version::Http10; }),
-         combinator::map(combinator::string("HTTP/1.1"), [](auto) { return http::parser::Version::Http11; })});
-  }
+    inline constexpr auto version = combinator::choice(
+        combinator::map(combinator::string("HTTP/1.0"), constant<Version::Http10>),
+        combinator::map(combinator::string("HTTP/1.1"), constant<Version::Http11>));
+
+    inline constexpr auto crlf =
+        combinator::map(combinator::string("\r\n"), constant<std::monostate{}>);
+
+    inline constexpr auto sp =
+        combinator::map(combinator::string(" "), constant<std::monostate{}>);
+
+    inline constexpr auto request_line = combinator::map(
+        combinator::sequence(
+            combinator::sequence(combinator::sequence(method, sp), uri),
+            combinator::sequence(combinator::sequence(sp, version), crlf)),
+        [](auto parts) {
+          auto [method_sp_uri, sp_version_crlf] = parts;
+          auto [method_sp, uri_value] = method_sp_uri;
+          return RequestLineView{method_sp.first, uri_value,
+                                 sp_version_crlf.first.second};
+        });
+
+    inline constexpr auto is_ows = [](char c) { return c == ' ' || c == '\t'; };
+
+    // field-name 必须是 token 且紧跟 ':'；field-value 在查找行尾的同一次扫描中
+    // 拒绝除 HTAB 以外的控制字符（包括裸 LF 和 NUL）
+    inline constexpr auto header = [](std::string_view input)
+        -> combinator::ParseOutput<HeaderView> {
+      auto colon_pos = scan::find_non_tchar(input);
+      if (colon_pos == 0 || colon_pos == scan::npos || input[colon_pos] != ':') {
+        return std::unexpected(ParseError::InvalidHeader);
+      }
+      auto key = input.substr(0, colon_pos);
+      auto rest = input.substr(colon_pos + 1);
+      auto skipped = std::distance(rest.begin(), std::find_if_not(rest.begin(), rest.end(), is_ows));
+      rest = rest.substr(skipped);
+
+      auto end = scan::find_field_ctl(rest);
+      if (end == scan::npos || rest[end] != '\r' || end + 1 >= rest.size() ||
+          rest[end + 1] != '\n') {
+        return std::unexpected(ParseError::InvalidHeader);
+      }
+      auto value = rest.substr(0, end);
+      while (!value.empty() && is_ows(value.back())) {
+        value.remove_suffix(1);
+      }
 
-  inline combinator::Parser<std::monostate> crlf() {
-    return combinator::map(combinator::string("\r\n"), [](auto) { return std::monostate{}; });
-  }
+      return std::pair{HeaderView{key, value, lookup_header(key)}, rest.substr(end + 2)};
+    };
 
-  inline combinator::Parser<std::monostate> sp() {
-    return combinator::map(combinator::string(" "), [](auto) { return std::monostate{}; });
-  }
+  } // namespace grammar
 
-  inline combinator::Parser<http::parser::RequestLine> parse_request_line() {
-    return [](std::string_view input)
-               -> std::expected<
-                   std::pair<http::parser::RequestLine, std::string_view>,
-                   http::parser::ParseError> {
-      auto method_result = parse_method()(input);
-      if (!method_result) {
-        return std::unexpected(method_result.error());
-      }
-      auto [method, rest1] = *method_result;
+  constexpr auto parse_method() { return grammar::method; }
 
-      auto sp1_result = sp()(rest1);
-      if (!sp1_result) {
-        return std::unexpected(sp1_result.error());
-      }
-      auto [sp1, rest2] = *sp1_result;
+  constexpr auto parse_uri_view() { return grammar::uri; }
 
-      auto uri_result = parse_uri()(rest2);
-      if (!uri_result) {
-        return std::unexpected(uri_result.error());
-      }
-      auto [uri, rest3] = *uri_result;
+  constexpr auto parse_uri() {
+    return combinator::map(grammar::uri, [](std::string_view uri) { return std::string(uri); });
+  }
 
-      auto sp2_result = sp()(rest3);
-      if (!sp2_result) {
-        return std::unexpected(sp2_result.error());
-      }
-      auto [sp2, rest4] = *sp2_result;
+  constexpr auto parse_version() { return grammar::version; }
 
-      auto version_result = parse_version()(rest4);
-      if (!version_result) {
-        return std::unexpected(version_result.error());
-      }
-      auto [version, rest5] = *version_result;
+  constexpr auto crlf() { return grammar::crlf; }
 
-      auto crlf_result = crlf()(rest5);
-      if (!crlf_result) {
-        return std::unexpected(crlf_result.error());
-      }
-      auto [crlf, rest6] = *crlf_result;
+  constexpr auto sp() { return grammar::sp; }
 
-      return std::pair{http::parser::RequestLine{method, uri, version}, rest6};
-    };
+  constexpr auto parse_request_line_view() { return grammar::request_line; }
+
+  constexpr auto parse_request_line() {
+    return combinator::map(grammar::request_line, [](const RequestLineView &line) {
+      return RequestLine{line.method, std::string(line.uri), line.version};
+    });
   }
 
-  inline combinator::Parser<std::pair<std::string, std::string>> parse_header() {
-    return
-        [](std::string_view input)
-            -> std::expected<std::pair<std::pair<std::string, std::string>, std::string_view>,
-                             http::parser::ParseError> {
-          auto colon_pos = input.find(':');
-          if (colon_pos == std::string_view::npos) {
-            return std::unexpected(http::parser::ParseError::InvalidHeader);
-          }
-          auto key = std::string(input.substr(0, colon_pos));
-          auto rest = input.substr(colon_pos + 1);
-          auto it = std::find_if_not(rest.begin(), rest.end(),
-                                     [](unsigned char c) { return std::isspace(c) && c != '\r'; });
-          auto skipped = std::distance(rest.begin(), it);
-          rest = rest.substr(skipped);
-          auto crlf_pos = rest.find("\r\n");
-          if (crlf_pos == std::string_view::npos) {
-            return std::unexpected(http::parser::ParseError::InvalidHeader);
-          }
-          auto value = std::string(rest.substr(0, crlf_pos));
-          rest = rest.substr(crlf_pos + 2);
+  constexpr auto parse_header_view() { return grammar::header; }
 
-          return std::pair{std::pair{std::move(key), std::move(value)}, rest};
-        };
+  constexpr auto parse_header() {
+    return combinator::map(grammar::header, [](const HeaderView &h) {
+      return std::pair{std::string(h.key), std::string(h.value)};
+    });
   }
 
-  inline combinator::Parser<http::parser::Headers> parse_headers() {
-    return [](std::string_view input)
-               -> std::expected<std::pair<Headers, std::string_view>,
-                                http::parser::ParseError> {
+  // Content-Length 与 Transfer-Encoding 合计只允许出现一次，与 RequestParser 的判断一致：
+  // Headers 只保留重复 header 的第一个值，两个解析器对同一输入的分帧不能不同（请求走私）
+  constexpr auto parse_headers() {
+    return [](std::string_view input) -> combinator::ParseOutput<Headers> {
       Headers headers;
       auto current_input = input;
+      int framing_headers = 0;
 
       while (true) {
         if (current_input.starts_with("\r\n")) {
           return std::pair{std::move(headers), current_input.substr(2)};
         }
-        auto header_result = parse_header()(current_input);
+        auto header_result = grammar::header(current_input);
         if (!header_result) {
           return std::unexpected(header_result.error());
         }
-        auto [header_pair, rest] = *header_result;
-        headers.insert(std::move(header_pair));
+        auto [header, rest] = *header_result;
+        if (header.id == HeaderId::ContentLength || header.id == HeaderId::TransferEncoding) {
+          if (++framing_headers > 1) {
+            return std::unexpected(ParseError::MalformedRequest);
+          }
+        }
+        headers.emplace(header.key, header.value);
         current_input = rest;
       }
     };
   }
 
-  inline ParseResult<http::parser::HttpRequest> parse_http_request(std::string_view input) {
+  // 解析 input 开头的一个完整请求，返回请求与其后未消耗的字节（管线化的下一个请求）。
+  // body 恰好读取 Content-Length 个字节或解码 chunked 编码，数据不足时返回 IncompleteRequest
+  inline combinator::ParseOutput<http::parser::HttpRequest> parse_http_request_prefix(std::string_view input) {
     auto request_line_result = parse_request_line()(input);
     if (!request_line_result) {
       return std::unexpected(request_line_result.error());
@@ -161,10 +182,50 @@ namespace http::parser {
     }
     auto [headers, rest2] = *headers_result;
 
-    std::vector<uint8_t> body(rest2.begin(), rest2.end());
+    HttpRequest request{std::move(request_line), std::move(headers), {}};
+    const auto transfer_encoding = request.header(HeaderId::TransferEncoding);
+    const auto content_length = request.header(HeaderId::ContentLength);
+
+    if (transfer_encoding) {
+      if (content_length || !is_chunked_encoding(*transfer_encoding)) {
+        return std::unexpected(ParseError::MalformedRequest);
+      }
+      ChunkedDecoder decoder;
+      auto consumed = decoder.feed(rest2, [&](std::string_view data) -> ParseResult<void> {
+        request.body.insert(request.body.end(), data.begin(), data.end());
+        return {};
+      });
+      if (!consumed) {
+        return std::unexpected(consumed.error());
+      }
+      if (!decoder.done()) {
+        return std::unexpected(ParseError::IncompleteRequest);
+      }
+      return std::pair{std::move(request), rest2.substr(*consumed)};
+    }
 
-    return HttpRequest{std::move(request_line), std::move(headers),
-                       std::move(body)};
+    size_t length = 0;
+    if (content_length) {
+      auto parsed = parse_content_length(*content_length);
+      if (!parsed) {
+        return std::unexpected(ParseError::MalformedRequest);
+      }
+      length = *parsed;
+    }
+    if (rest2.size() < length) {
+      return std::unexpected(ParseError::IncompleteRequest);
+    }
+    request.body.assign(rest2.begin(), rest2.begin() + static_cast<std::ptrdiff_t>(length));
+    return std::pair{std::move(request), rest2.substr(length)};
+  }
+
+  // 解析单个完整请求；请求之后的多余字节被忽略，需要它们时使用 parse_http_request_prefix
+  inline ParseResult<http::parser::HttpRequest> parse_http_request(std::string_view input) {
+    auto parsed = parse_http_request_prefix(input);
+    if (!parsed) {
+      return std::unexpected(parsed.error());
+    }
+    return std::move(parsed->first);
   }
 
 } // namespace http::parser
@@ -0,0 +1,340 @@
+#pragma once
+#include "chunked.hpp"
+#include "http_parser.hpp"
+#include "types.hpp"
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace http::parser {
+
+enum class ParseState { RequestLine, Headers, Body, Complete };
+
+struct ParserLimits {
+  size_t max_header_size = 64 * 1024;
+  size_t max_body_size = 8 * 1024 * 1024;
+};
+
+// 流式 body 的接收端：按到达顺序收到解码后的每一段数据，返回错误时解析失败
+using BodySink = std::function<ParseResult<void>(std::string_view)>;
+
+// 请求头完整时调用，决定这个请求的 body 交给谁；返回空的 BodySink 表示照常缓存
+using BodySinkFactory = std::function<BodySink(const HttpRequestView &)>;
+
+// 增量解析器：每次 feed 只扫描新到达的字节，已解析的请求行 / header
+// 会保留在内部状态中，不会因为 IncompleteRequest 而从头重新解析。
+// 解析结果以偏移量记录，缓冲区扩容搬迁后依然有效，完成时再生成零拷贝视图。
+// body 恰好读取 Content-Length 个字节，或按 chunked 编码解码（原地压缩到 body 起始处），
+// 之后的字节留给下一个请求，因此同一个解析器可以依次处理管线化的多个请求。
+// 设置了 BodySinkFactory 时，body 可以边到达边交给 sink 并从缓冲区移除，
+// 缓冲区只保留请求头和一次读入的数据，不随 body 大小增长
+class RequestParser {
+  struct Slice {
+    size_t offset;
+    size_t size;
+  };
+
+  struct HeaderSlice {
+    Slice key;
+    Slice value;
+    HeaderId id;
+  };
+
+  std::string buffer_;
+  size_t start_ = 0;    // 已完成请求占用的前缀，过半时才从缓冲区删除
+  size_t pos_ = 0;      // 下一个待解析元素（行或 body）的起始位置
+  size_t scan_pos_ = 0; // CRLF 查找的续扫位置
+  ParseState state_ = ParseState::RequestLine;
+  ParserLimits limits_;
+
+  Method method_ = Method::Get;
+  Version version_ = Version::Http11;
+  Slice uri_{};
+  std::vector<HeaderSlice> header_slices_;
+  std::vector<HeaderView> header_views_;
+  KnownHeaderIndex known_{};
+  Slice body_{};
+  size_t body_size_ = 0;     // Content-Length，或 chunked 模式下已解码的字节数
+  size_t framing_headers_ = 0; // Content-Length 与 Transfer-Encoding 出现的总次数
+  bool chunked_ = false;
+  ChunkedDecoder decoder_;
+  size_t chunk_pos_ = 0; // chunked 模式下下一个待解码的原始字节
+  BodySinkFactory sink_factory_;
+  BodySink sink_; // 当前请求的流式接收端，为空时缓存 body
+
+public:
+  explicit RequestParser(ParserLimits limits = {}) : limits_(limits) {}
+
+  // bytes 可以为空：用于在 take() 之后继续解析缓冲区里剩余的字节
+  ParseResult<ParseState> feed(std::string_view bytes) {
+    buffer_.append(bytes);
+    return advance();
+  }
+
+  // 对之后每个请求的请求头调用 factory。流式交出的 body 不受 max_body_size 限制，
+  // 完成后 view().body 为空
+  void set_body_sink_factory(BodySinkFactory factory) { sink_factory_ = std::move(factory); }
+
+  [[nodiscard]] ParseState state() const { return state_; }
+  [[nodiscard]] bool complete() const { return state_ == ParseState::Complete; }
+
+  // 已缓冲但尚未属于任何已完成请求的字节数
+  [[nodiscard]] size_t buffered() const { return buffer_.size() - pos_; }
+
+  // 仅在 complete() 时调用；返回的视图在下一次 feed/consume/take/reset 前有效
+  HttpRequestView view() {
+    header_views_.clear();
+    for (const auto &[key, value, id] : header_slices_) {
+      header_views_.push_back(HeaderView{slice(key), slice(value), id});
+    }
+    const auto body = slice(body_);
+    return HttpRequestView{
+        RequestLineView{method_, slice(uri_), version_},
+        header_views_,
+        std::span(reinterpret_cast<const uint8_t *>(body.data()), body.size()),
+        &known_};
+  }
+
+  // 丢弃已完成的请求并复位状态；之后到达的字节保留给下一个请求。
+  // 已完成的部分超过缓冲区一半时才整体前移，管线化的大量请求不会每个都搬一次剩余字节
+  void consume() {
+    start_ = pos_;
+    if (start_ * 2 >= buffer_.size()) {
+      buffer_.erase(0, start_);
+      start_ = 0;
+    }
+    reset_state();
+  }
+
+  HttpRequest take() {
+    HttpRequest out = view().to_request();
+    consume();
+    return out;
+  }
+
+  void reset() {
+    buffer_.clear();
+    start_ = 0;
+    reset_state();
+  }
+
+private:
+  void reset_state() {
+    pos_ = start_;
+    scan_pos_ = start_;
+    state_ = ParseState::RequestLine;
+    uri_ = {};
+    header_slices_.clear();
+    known_.fill(0);
+    body_ = {};
+    body_size_ = 0;
+    framing_headers_ = 0;
+    chunked_ = false;
+    decoder_.reset();
+    chunk_pos_ = 0;
+    sink_ = nullptr;
+  }
+
+  [[nodiscard]] std::string_view slice(Slice s) const {
+    return std::string_view(buffer_).substr(s.offset, s.size);
+  }
+
+  [[nodiscard]] Slice slice_of(std::string_view part) const {
+    return Slice{static_cast<size_t>(part.data() - buffer_.data()), part.size()};
+  }
+
+  // 返回下一个完整行（含 CRLF）的结束位置；不完整时记录续扫位置
+  std::optional<size_t> next_line_end() {
+    const auto from = std::max(pos_, scan_pos_);
+    const auto crlf = scan::find_crlf(buffer_, from);
+    if (crlf == scan::npos) {
+      // 末尾可能是半个 CRLF，回退一个字节
+      scan_pos_ = buffer_.empty() ? 0 : std::max(pos_, buffer_.size() - 1);
+      return std::nullopt;
+    }
+    scan_pos_ = crlf + 2;
+    return crlf + 2;
+  }
+
+  ParseResult<ParseState> advance() {
+    while (true) {
+      switch (state_) {
+      case ParseState::RequestLine:
+      case ParseState::Headers: {
+        auto line_end = next_line_end();
+        if (!line_end) {
+          if (buffer_.size() - pos_ > limits_.max_header_size) {
+            return std::unexpected(ParseError::HeadersTooLarge);
+          }
+          return state_;
+        }
+        if (*line_end - start_ > limits_.max_header_size) {
+          return std::unexpected(ParseError::HeadersTooLarge);
+        }
+
+        const auto line = std::string_view(buffer_).substr(pos_, *line_end - pos_);
+        if (auto r = state_ == ParseState::RequestLine ? on_request_line(line)
+                                                       : on_header_line(line);
+            !r) {
+          return std::unexpected(r.error());
+        }
+        pos_ = *line_end;
+        break;
+      }
+      case ParseState::Body: {
+        if (sink_) {
+          if (auto r = stream_body(); !r) {
+            return std::unexpected(r.error());
+          }
+          if (state_ != ParseState::Complete) {
+            return state_;
+          }
+          break;
+        }
+        if (chunked_) {
+          if (auto r = decode_chunks(); !r) {
+            return std::unexpected(r.error());
+          }
+          if (!decoder_.done()) {
+            return state_;
+          }
+          body_ = Slice{pos_, body_size_};
+          pos_ = chunk_pos_;
+          state_ = ParseState::Complete;
+          break;
+        }
+        if (buffer_.size() - pos_ < body_size_) {
+          return state_;
+        }
+        body_ = Slice{pos_, body_size_};
+        pos_ += body_size_;
+        state_ = ParseState::Complete;
+        break;
+      }
+      case ParseState::Complete:
+        return state_;
+      }
+    }
+  }
+
+  ParseResult<void> on_request_line(std::string_view line) {
+    // RFC 9112 §2.2：请求行之前的空行应当忽略
+    if (line == "\r\n") {
+      return {};
+    }
+    auto result = parse_request_line_view()(line);
+    if (!result) {
+      return std::unexpected(result.error());
+    }
+    if (!result->second.empty()) {
+      return std::unexpected(ParseError::MalformedRequest);
+    }
+    method_ = result->first.method;
+    version_ = result->first.version;
+    uri_ = slice_of(result->first.uri);
+    state_ = ParseState::Headers;
+    return {};
+  }
+
+  ParseResult<void> on_header_line(std::string_view line) {
+    if (line == "\r\n") {
+      return on_headers_end();
+    }
+    auto result = parse_header_view()(line);
+    if (!result) {
+      return std::unexpected(result.error());
+    }
+    const auto &[key, value, id] = result->first;
+    if (id == HeaderId::ContentLength || id == HeaderId::TransferEncoding) {
+      ++framing_headers_;
+    }
+    auto &slot = known_[static_cast<size_t>(id)];
+    if (id != HeaderId::Unknown && slot == 0 && header_slices_.size() < UINT16_MAX) {
+      slot = static_cast<uint16_t>(header_slices_.size() + 1);
+    }
+    header_slices_.push_back(HeaderSlice{slice_of(key), slice_of(value), id});
+    return {};
+  }
+
+  // 决定 body 的长度（RFC 9112 §6.3）。Content-Length 与 Transfer-Encoding 同时出现、
+  // 或任一重复出现时拒绝请求：前后端对长度理解不一致正是请求走私的来源
+  ParseResult<void> on_headers_end() {
+    if (framing_headers_ > 1) {
+      return std::unexpected(ParseError::MalformedRequest);
+    }
+    if (auto slot = known_[static_cast<size_t>(HeaderId::TransferEncoding)]; slot != 0) {
+      if (!is_chunked_encoding(slice(header_slices_[slot - 1].value))) {
+        return std::unexpected(ParseError::MalformedRequest);
+      }
+      chunked_ = true;
+      chunk_pos_ = pos_ + 2; // 跳过结束 header 的空行
+    } else if (auto slot = known_[static_cast<size_t>(HeaderId::ContentLength)]; slot != 0) {
+      auto length = parse_content_length(slice(header_slices_[slot - 1].value));
+      if (!length) {
+        return std::unexpected(ParseError::MalformedRequest);
+      }
+      body_size_ = *length;
+    }
+    if (!chunked_ && body_size_ == 0) {
+      state_ = ParseState::Complete;
+      return {};
+    }
+    if (sink_factory_) {
+      sink_ = sink_factory_(view());
+    }
+    if (!sink_ && body_size_ > limits_.max_body_size) {
+      return std::unexpected(ParseError::BodyTooLarge);
+    }
+    state_ = ParseState::Body;
+    return {};
+  }
+
+  // 流式模式：已到达的 body 数据交给 sink 后立即从缓冲区删除，之后的字节前移到 pos_。
+  // Content-Length 模式下 body_size_ 记录尚未交出的字节数
+  ParseResult<void> stream_body() {
+    const auto available = std::string_view(buffer_).substr(pos_);
+    size_t consumed = 0;
+    if (chunked_) {
+      auto r = decoder_.feed(available, sink_);
+      if (!r) {
+        return std::unexpected(r.error());
+      }
+      consumed = *r;
+    } else {
+      consumed = std::min(body_size_, available.size());
+      if (consumed > 0) {
+        if (auto r = sink_(available.substr(0, consumed)); !r) {
+          return std::unexpected(r.error());
+        }
+      }
+      body_size_ -= consumed;
+    }
+    buffer_.erase(pos_, consumed);
+    if (chunked_ ? decoder_.done() : body_size_ == 0) {
+      body_ = Slice{pos_, 0};
+      state_ = ParseState::Complete;
+    }
+    return {};
+  }
+
+  // 解码出的数据向前搬到 pos_ + body_size_；写入位置永远不超过读取位置，可以原地进行
+  ParseResult<void> decode_chunks() {
+    const auto input = std::string_view(buffer_).substr(chunk_pos_);
+    auto consumed = decoder_.feed(input, [this](std::string_view data) -> ParseResult<void> {
+      if (body_size_ + data.size() > limits_.max_body_size) {
+        return std::unexpected(ParseError::BodyTooLarge);
+      }
+      std::memmove(buffer_.data() + pos_ + body_size_, data.data(), data.size());
+      body_size_ += data.size();
+      return {};
+    });
+    if (!consumed) {
+      return std::unexpected(consumed.error());
+    }
+    chunk_pos_ += *consumed;
+    return {};
+  }
+};
+
+} // namespace http::parser
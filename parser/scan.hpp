@@ -0,0 +1,305 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// 向量化的字节扫描内核，供 HTTP 解析器查找 CRLF / 分隔符并在同一次扫描中
+// 校验非法字节。按编译目标选择实现：AVX2（32 字节）→ SSE2/SSSE3（16 字节）
+// → NEON（16 字节）→ 标量，尾部不足一个向量的字节统一走标量路径
+namespace http::parser::scan {
+
+inline constexpr size_t npos = std::string_view::npos;
+
+namespace detail {
+
+// RFC 9110 §5.6.2 tchar
+constexpr bool is_tchar(unsigned char c) {
+  if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+    return true;
+  }
+  switch (c) {
+  case '!': case '#': case '$': case '%': case '&': case '\'': case '*':
+  case '+': case '-': case '.': case '^': case '_': case '`': case '|': case '~':
+    return true;
+  default:
+    return false;
+  }
+}
+
+// field-value 中不允许出现的控制字符（HTAB 除外）
+constexpr bool is_field_ctl(unsigned char c) { return (c < 0x20 && c != '\t') || c == 0x7f; }
+
+// request-target 的结束：空白或控制字符
+constexpr bool is_uri_end(unsigned char c) { return c <= 0x20 || c == 0x7f; }
+
+// tchar 的 nibble 查找表：lo_lut[c & 0xf] 的第 (c >> 4) 位表示 c 是否为 tchar。
+// 高半字节 >= 8 的字节在 hi_lut 中为 0，因此非 ASCII 字节一律判为非法
+inline constexpr auto tchar_lo_lut = [] {
+  std::array<uint8_t, 16> lut{};
+  for (unsigned c = 0; c < 128; ++c) {
+    if (is_tchar(static_cast<unsigned char>(c))) {
+      lut[c & 0xf] |= static_cast<uint8_t>(1u << (c >> 4));
+    }
+  }
+  return lut;
+}();
+
+inline constexpr std::array<uint8_t, 16> tchar_hi_lut = {1, 2, 4, 8, 16, 32, 64, 128,
+                                                          0, 0, 0, 0, 0, 0, 0, 0};
+
+template <typename Pred>
+inline size_t scalar_find(const char *data, size_t from, size_t size, Pred pred) {
+  for (size_t i = from; i < size; ++i) {
+    if (pred(static_cast<unsigned char>(data[i]))) {
+      return i;
+    }
+  }
+  return npos;
+}
+
+#if defined(__AVX2__)
+inline __m256i load32(const char *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+// 无符号 v <= limit
+inline __m256i le32(__m256i v, char limit) {
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(limit)), v);
+}
+
+inline uint32_t field_ctl_mask32(__m256i v) {
+  const __m256i ctl = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                                          le32(v, 0x1f));
+  const __m256i del = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f));
+  return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(ctl, del)));
+}
+
+inline uint32_t uri_end_mask32(__m256i v) {
+  const __m256i del = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f));
+  return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(le32(v, 0x20), del)));
+}
+
+inline uint32_t non_tchar_mask32(__m256i v) {
+  const __m256i lo_lut = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(tchar_lo_lut.data())));
+  const __m256i hi_lut = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(tchar_hi_lut.data())));
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  const __m256i lo = _mm256_and_si256(v, nibble);
+  const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+  const __m256i bits = _mm256_and_si256(_mm256_shuffle_epi8(lo_lut, lo),
+                                        _mm256_shuffle_epi8(hi_lut, hi));
+  return static_cast<uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(bits, _mm256_setzero_si256())));
+}
+#endif
+
+#if defined(__SSE2__)
+inline __m128i load16(const char *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+inline __m128i le16(__m128i v, char limit) {
+  return _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(limit)), v);
+}
+
+inline uint32_t field_ctl_mask16(__m128i v) {
+  const __m128i ctl = _mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), le16(v, 0x1f));
+  const __m128i del = _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f));
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(ctl, del)));
+}
+
+inline uint32_t uri_end_mask16(__m128i v) {
+  const __m128i del = _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f));
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(le16(v, 0x20), del)));
+}
+
+#if defined(__SSSE3__)
+inline uint32_t non_tchar_mask16(__m128i v) {
+  const __m128i lo_lut = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tchar_lo_lut.data()));
+  const __m128i hi_lut = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tchar_hi_lut.data()));
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  const __m128i lo = _mm_and_si128(v, nibble);
+  const __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+  const __m128i bits = _mm_and_si128(_mm_shuffle_epi8(lo_lut, lo), _mm_shuffle_epi8(hi_lut, hi));
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bits, _mm_setzero_si128())));
+}
+#endif
+#endif
+
+#if defined(__ARM_NEON)
+// 每个字节压缩为 4 位的掩码，countr_zero / 4 即为字节下标
+inline uint64_t neon_mask(uint8x16_t m) {
+  return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+}
+
+inline uint64_t field_ctl_mask16(uint8x16_t v) {
+  const uint8x16_t ctl = vandq_u8(vcleq_u8(v, vdupq_n_u8(0x1f)),
+                                  vmvnq_u8(vceqq_u8(v, vdupq_n_u8('\t'))));
+  return neon_mask(vorrq_u8(ctl, vceqq_u8(v, vdupq_n_u8(0x7f))));
+}
+
+inline uint64_t uri_end_mask16(uint8x16_t v) {
+  return neon_mask(vorrq_u8(vcleq_u8(v, vdupq_n_u8(0x20)), vceqq_u8(v, vdupq_n_u8(0x7f))));
+}
+
+inline uint64_t non_tchar_mask16(uint8x16_t v) {
+  const uint8x16_t lo = vandq_u8(v, vdupq_n_u8(0x0f));
+  const uint8x16_t hi = vshrq_n_u8(v, 4);
+  const uint8x16_t bits = vandq_u8(vqtbl1q_u8(vld1q_u8(tchar_lo_lut.data()), lo),
+                                   vqtbl1q_u8(vld1q_u8(tchar_hi_lut.data()), hi));
+  return neon_mask(vceqq_u8(bits, vdupq_n_u8(0)));
+}
+
+inline uint8x16_t load_neon(const char *p) { return vld1q_u8(reinterpret_cast<const uint8_t *>(p)); }
+#endif
+
+} // namespace detail
+
+// 第一个 "\r\n" 的位置
+inline size_t find_crlf(std::string_view s, size_t from = 0) {
+  const char *data = s.data();
+  const size_t size = s.size();
+  size_t i = from;
+
+#if defined(__AVX2__)
+  for (; i + 33 <= size; i += 32) {
+    const uint32_t cr = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(detail::load32(data + i), _mm256_set1_epi8('\r'))));
+    const uint32_t lf = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(detail::load32(data + i + 1), _mm256_set1_epi8('\n'))));
+    if (const uint32_t m = cr & lf) {
+      return i + static_cast<size_t>(std::countr_zero(m));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  for (; i + 17 <= size; i += 16) {
+    const uint32_t cr = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(detail::load16(data + i), _mm_set1_epi8('\r'))));
+    const uint32_t lf = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(detail::load16(data + i + 1), _mm_set1_epi8('\n'))));
+    if (const uint32_t m = cr & lf) {
+      return i + static_cast<size_t>(std::countr_zero(m));
+    }
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 17 <= size; i += 16) {
+    const uint8x16_t cr = vceqq_u8(detail::load_neon(data + i), vdupq_n_u8('\r'));
+    const uint8x16_t lf = vceqq_u8(detail::load_neon(data + i + 1), vdupq_n_u8('\n'));
+    if (const uint64_t m = detail::neon_mask(vandq_u8(cr, lf))) {
+      return i + static_cast<size_t>(std::countr_zero(m)) / 4;
+    }
+  }
+#endif
+
+  for (; i + 1 < size; ++i) {
+    if (data[i] == '\r' && data[i + 1] == '\n') {
+      return i;
+    }
+  }
+  return npos;
+}
+
+// 第一个不是 tchar 的字节：对合法的 header 行应当正好是 ':'
+inline size_t find_non_tchar(std::string_view s) {
+  const char *data = s.data();
+  const size_t size = s.size();
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  for (; i + 32 <= size; i += 32) {
+    if (const uint32_t m = detail::non_tchar_mask32(detail::load32(data + i))) {
+      return i + static_cast<size_t>(std::countr_zero(m));
+    }
+  }
+#endif
+#if defined(__SSSE3__)
+  for (; i + 16 <= size; i += 16) {
+    if (const uint32_t m = detail::non_tchar_mask16(detail::load16(data + i))) {
+      return i + static_cast<size_t>(std::countr_zero(m));
+    }
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 16 <= size; i += 16) {
+    if (const uint64_t m = detail::non_tchar_mask16(detail::load_neon(data + i))) {
+      return i + static_cast<size_t>(std::countr_zero(m)) / 4;
+    }
+  }
+#endif
+
+  return detail::scalar_find(data, i, size,
+                             [](unsigned char c) { return !detail::is_tchar(c); });
+}
+
+// 第一个 field-value 中非法的控制字符；对合法的 header 值应当正好是行尾 CRLF 的 '\r'，
+// 因此同一次扫描既定位了行尾，也完成了非法字节校验
+inline size_t find_field_ctl(std::string_view s) {
+  const char *data = s.data();
+  const size_t size = s.size();
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  for (; i + 32 <= size; i += 32) {
+    if (const uint32_t m = detail::field_ctl_mask32(detail::load32(data + i))) {
+      return i + static_cast<size_t>(std::countr_zero(m));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  for (; i + 16 <= size; i += 16) {
+    if (const uint32_t m = detail::field_ctl_mask16(detail::load16(data + i))) {
+      return i + static_cast<size_t>(std::countr_zero(m));
+    }
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 16 <= size; i += 16) {
+    if (const uint64_t m = detail::field_ctl_mask16(detail::load_neon(data + i))) {
+      return i + static_cast<size_t>(std::countr_zero(m)) / 4;
+    }
+  }
+#endif
+
+  return detail::scalar_find(data, i, size, detail::is_field_ctl);
+}
+
+// request-target 的结束位置：第一个空白或控制字符
+inline size_t find_uri_end(std::string_view s) {
+  const char *data = s.data();
+  const size_t size = s.size();
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  for (; i + 32 <= size; i += 32) {
+    if (const uint32_t m = detail::uri_end_mask32(detail::load32(data + i))) {
+      return i + static_cast<size_t>(std::countr_zero(m));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  for (; i + 16 <= size; i += 16) {
+    if (const uint32_t m = detail::uri_end_mask16(detail::load16(data + i))) {
+      return i + static_cast<size_t>(std::countr_zero(m));
+    }
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 16 <= size; i += 16) {
+    if (const uint64_t m = detail::uri_end_mask16(detail::load_neon(data + i))) {
+      return i + static_cast<size_t>(std::countr_zero(m)) / 4;
+    }
+  }
+#endif
+
+  return detail::scalar_find(data, i, size, detail::is_uri_end);
+}
+
+} // namespace http::parser::scan
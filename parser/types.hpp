@@ -1,8 +1,14 @@
 #pragma once
+#include "header_names.hpp"
 #include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
 #include <cstdint>
 #include <expected>
+#include <memory_resource>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -23,6 +29,21 @@ enum class Method {
   Patch
 };
 
+constexpr std::string_view method_name(Method method) {
+  switch (method) {
+  case Method::Get: return "GET";
+  case Method::Post: return "POST";
+  case Method::Head: return "HEAD";
+  case Method::Put: return "PUT";
+  case Method::Delete: return "DELETE";
+  case Method::Options: return "OPTIONS";
+  case Method::Trace: return "TRACE";
+  case Method::Connect: return "CONNECT";
+  case Method::Patch: return "PATCH";
+  }
+  return "";
+}
+
 enum class Version {
   Http10,
   Http11,
@@ -34,38 +55,151 @@ struct RequestLine {
   Version version;
 };
 
-using Headers = std::unordered_map<std::string, std::string>;
+// header 名称大小写不敏感（RFC 9110 §5.1），并支持以 std::string_view 直接查找。
+// 使用 std::pmr 分配器，可以整体分配在 RequestArena 里
+using Headers = std::pmr::unordered_map<std::pmr::string, std::pmr::string, CaseInsensitiveHash,
+                                        CaseInsensitiveEqual>;
+
+inline std::optional<size_t> parse_content_length(std::string_view s) {
+  if (s.empty() || !std::all_of(s.begin(), s.end(),
+                                [](unsigned char c) { return std::isdigit(c); })) {
+    return std::nullopt;
+  }
+  size_t value = 0;
+  auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  if (ec != std::errc{} || ptr != s.data() + s.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+// 逗号分隔的 header 取值里是否含有 token（大小写不敏感），例如 "keep-alive, Upgrade"
+inline bool has_token(std::string_view list, std::string_view token) {
+  while (!list.empty()) {
+    const auto comma = std::min(list.find(','), list.size());
+    auto item = list.substr(0, comma);
+    list.remove_prefix(std::min(comma + 1, list.size()));
+    const auto begin = item.find_first_not_of(" \t");
+    const auto end = item.find_last_not_of(" \t");
+    if (begin != std::string_view::npos && iequals(item.substr(begin, end - begin + 1), token)) {
+      return true;
+    }
+  }
+  return false;
+}
 
+// RFC 9112 §9.3：HTTP/1.1 默认保持连接，除非 Connection 含 close；
+// HTTP/1.0 只有显式 Connection: keep-alive 时才保持
+inline bool wants_keep_alive(Version version, std::optional<std::string_view> connection) {
+  if (version == Version::Http11) {
+    return !connection || !has_token(*connection, "close");
+  }
+  return connection && has_token(*connection, "keep-alive");
+}
+
+// headers 与 body 的分配器在构造时确定：HttpRequestView::to_request(resource) 把它们放进
+// 请求内存池，复制出的 HttpRequest 总是使用默认（堆）分配器
 struct HttpRequest {
   RequestLine request_line;
   Headers headers;
-  std::vector<uint8_t> body;
+  std::pmr::vector<uint8_t> body;
 
   std::optional<std::string_view> header(std::string_view key) const {
-    auto it = headers.find(std::string(key));
+    auto it = headers.find(key);
     return (it != headers.end()) ? std::optional<std::string_view>{it->second}
                                  : std::nullopt;
   }
 
+  std::optional<std::string_view> header(HeaderId id) const { return header(header_name(id)); }
+
+  size_t content_length() const {
+    return header(HeaderId::ContentLength).and_then(parse_content_length).value_or(0);
+  }
+
+  bool keep_alive() const {
+    return wants_keep_alive(request_line.version, header(HeaderId::Connection));
+  }
+};
+
+struct RequestLineView {
+  Method method;
+  std::string_view uri;
+  Version version;
+};
+
+struct HeaderView {
+  std::string_view key;
+  std::string_view value;
+  HeaderId id = HeaderId::Unknown;
+};
+
+// 已知 header 在 headers 中的下标 + 1，0 表示不存在；同名 header 取第一个
+using KnownHeaderIndex = std::array<uint16_t, kKnownHeaderCount>;
+
+// 零拷贝请求视图：所有字段都指向接收缓冲区，只在产生它的缓冲区存活期间有效
+struct HttpRequestView {
+  RequestLineView request_line;
+  std::span<const HeaderView> headers;
+  std::span<const uint8_t> body;
+  // 由 RequestParser 提供；为空时按名称线性查找
+  const KnownHeaderIndex *known = nullptr;
+  // 服务器为本次请求提供的内存池，只在同步处理期间有效；为空时不使用
+  std::pmr::memory_resource *arena = nullptr;
+
+  std::optional<std::string_view> header(HeaderId id) const {
+    if (known != nullptr) {
+      auto slot = (*known)[static_cast<size_t>(id)];
+      return slot != 0 ? std::optional<std::string_view>{headers[slot - 1].value}
+                       : std::nullopt;
+    }
+    return find_header(header_name(id));
+  }
+
+  std::optional<std::string_view> header(std::string_view key) const {
+    auto id = lookup_header(key);
+    return id != HeaderId::Unknown ? header(id) : find_header(key);
+  }
+
   size_t content_length() const {
-    auto is_valid_number = [](std::string_view s) -> bool {
-      return !s.empty() && s[0] != '-' &&
-             std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isdigit(c); });
-    };
-
-    return header("Content-Length")
-        .transform([](auto v) { return std::string(v); })
-        .and_then([&](const std::string& s) -> std::optional<size_t> {
-          if (!is_valid_number(s)) {
-            return std::nullopt;
-          }
-          try {
-            return std::stoul(s);
-          } catch (...) {
-            return std::nullopt;
-          }
-        })
-        .value_or(0);
+    return header(HeaderId::ContentLength).and_then(parse_content_length).value_or(0);
+  }
+
+  bool keep_alive() const {
+    return wants_keep_alive(request_line.version, header(HeaderId::Connection));
+  }
+
+  std::optional<std::string_view> find_header(std::string_view key) const {
+    auto it = std::find_if(headers.begin(), headers.end(),
+                           [key](const HeaderView &h) { return iequals(h.key, key); });
+    return (it != headers.end()) ? std::optional<std::string_view>{it->value}
+                                 : std::nullopt;
+  }
+
+  // headers 与 body 从 resource 分配；结果不能比 resource 活得长
+  HttpRequest to_request(
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const {
+    HttpRequest req{
+        RequestLine{request_line.method, std::string(request_line.uri),
+                    request_line.version},
+        Headers(headers.size(), resource),
+        std::pmr::vector<uint8_t>(body.begin(), body.end(), resource)};
+    for (const auto &[key, value, id] : headers) {
+      req.headers.emplace(key, value);
+    }
+    return req;
+  }
+
+  // storage 用于存放 header 视图，调用方需保证它与 req 的生命周期一致
+  static HttpRequestView of(const HttpRequest &req, std::vector<HeaderView> &storage) {
+    storage.clear();
+    for (const auto &[key, value] : req.headers) {
+      storage.push_back(HeaderView{key, value, lookup_header(key)});
+    }
+    return HttpRequestView{
+        RequestLineView{req.request_line.method, req.request_line.uri,
+                        req.request_line.version},
+        storage,
+        req.body};
   }
 };
 
@@ -75,9 +209,26 @@ enum class ParseError {
   InvalidVersion,
   InvalidHeader,
   IncompleteRequest,
-  MalformedRequest
+  MalformedRequest,
+  HeadersTooLarge,
+  BodyTooLarge
 };
 
+// 指标标签等处使用的名称
+constexpr std::string_view parse_error_name(ParseError error) {
+  switch (error) {
+  case ParseError::InvalidMethod: return "invalid_method";
+  case ParseError::InvalidUri: return "invalid_uri";
+  case ParseError::InvalidVersion: return "invalid_version";
+  case ParseError::InvalidHeader: return "invalid_header";
+  case ParseError::IncompleteRequest: return "incomplete_request";
+  case ParseError::MalformedRequest: return "malformed_request";
+  case ParseError::HeadersTooLarge: return "headers_too_large";
+  case ParseError::BodyTooLarge: return "body_too_large";
+  }
+  return "";
+}
+
 template <typename T> using ParseResult = std::expected<T, ParseError>;
 
 } // namespace http::parser
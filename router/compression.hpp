@@ -0,0 +1,366 @@
+#pragma once
+#include "types.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <expected>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <zlib.h>
+
+// brotli 是可选依赖，由 CMake 在找到 libbrotlienc 时定义 FP_WEBSERVER_BROTLI=1
+#ifndef FP_WEBSERVER_BROTLI
+#define FP_WEBSERVER_BROTLI 0
+#endif
+#if FP_WEBSERVER_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace http::router {
+
+enum class ContentCoding : uint8_t { Identity, Gzip, Brotli };
+
+inline constexpr bool kBrotliAvailable = FP_WEBSERVER_BROTLI;
+
+inline std::string_view coding_name(ContentCoding coding) {
+  switch (coding) {
+  case ContentCoding::Gzip:
+    return "gzip";
+  case ContentCoding::Brotli:
+    return "br";
+  default:
+    return "identity";
+  }
+}
+
+struct CompressionOptions {
+  size_t min_size = 1024; // 更小的 body 压缩后省下的字节抵不上 CPU 开销
+  int gzip_level = 6;     // 1–9
+  int brotli_quality = 4; // 0–11，动态压缩用较低的质量
+};
+
+// RFC 9110 §12.4.2 的 qvalue，返回千分数；格式错误按 0 处理
+inline int parse_qvalue(std::string_view params) {
+  while (!params.empty()) {
+    const auto semi = std::min(params.find(';'), params.size());
+    auto param = params.substr(0, semi);
+    params.remove_prefix(std::min(semi + 1, params.size()));
+    const auto begin = param.find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+      continue;
+    }
+    param = param.substr(begin, param.find_last_not_of(" \t") - begin + 1);
+    if (param.size() < 2 || (param[0] != 'q' && param[0] != 'Q') || param[1] != '=') {
+      continue;
+    }
+    auto value = param.substr(2);
+    if (value.empty() || (value[0] != '0' && value[0] != '1')) {
+      return 0;
+    }
+    int q = (value[0] - '0') * 1000;
+    if (value.size() > 1) {
+      if (value[1] != '.' || value.size() > 5) {
+        return 0;
+      }
+      int scale = 100;
+      for (char c : value.substr(2)) {
+        if (c < '0' || c > '9') {
+          return 0;
+        }
+        q += (c - '0') * scale;
+        scale /= 10;
+      }
+    }
+    return std::min(q, 1000);
+  }
+  return 1000;
+}
+
+// 按 Accept-Encoding 选出 q 值最高的可用编码（RFC 9110 §12.5.3），同分时 br 优先；
+// "*" 作用于没有单独列出的编码。没有 header 或都不可接受时返回 Identity
+inline ContentCoding negotiate_coding(std::optional<std::string_view> accept_encoding) {
+  if (!accept_encoding) {
+    return ContentCoding::Identity;
+  }
+  int gzip = -1;
+  int brotli = -1;
+  int any = -1;
+  for (auto list = *accept_encoding; !list.empty();) {
+    const auto comma = std::min(list.find(','), list.size());
+    auto item = list.substr(0, comma);
+    list.remove_prefix(std::min(comma + 1, list.size()));
+    const auto semi = std::min(item.find(';'), item.size());
+    auto name = item.substr(0, semi);
+    const auto begin = name.find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+      continue;
+    }
+    name = name.substr(begin, name.find_last_not_of(" \t") - begin + 1);
+    const int q = parse_qvalue(item.substr(std::min(semi + 1, item.size())));
+    if (parser::iequals(name, "gzip") || parser::iequals(name, "x-gzip")) {
+      gzip = std::max(gzip, q);
+    } else if (parser::iequals(name, "br")) {
+      brotli = std::max(brotli, q);
+    } else if (name == "*") {
+      any = q;
+    }
+  }
+  gzip = gzip < 0 ? any : gzip;
+  brotli = !kBrotliAvailable ? 0 : brotli < 0 ? any : brotli;
+  if (brotli > 0 && brotli >= gzip) {
+    return ContentCoding::Brotli;
+  }
+  return gzip > 0 ? ContentCoding::Gzip : ContentCoding::Identity;
+}
+
+// 文本类内容才值得压缩；图片、字体、压缩包本身已经是压缩格式
+inline bool compressible_type(std::string_view content_type) {
+  const auto type = content_type.substr(0, content_type.find(';'));
+  if (type.starts_with("text/")) {
+    return true;
+  }
+  static constexpr std::string_view kTypes[] = {
+      "application/json", "application/javascript", "application/xml", "application/wasm",
+      "image/svg+xml",    "font/ttf",               "font/otf"};
+  for (const auto known : kTypes) {
+    if (parser::iequals(type, known)) {
+      return true;
+    }
+  }
+  return type.ends_with("+json") || type.ends_with("+xml");
+}
+
+// 每个线程一份的压缩上下文。z_stream 只在第一次使用或级别变化时初始化，
+// 之后每个响应只 deflateReset。brotli 的编码器结束后不能复用，
+// 因此改为复用它的内存：分配函数从线程内的空闲块里取相同大小的块
+class Compressor {
+  z_stream zlib_{};
+  int zlib_level_ = -1; // -1 表示尚未初始化
+
+#if FP_WEBSERVER_BROTLI
+  struct alignas(std::max_align_t) BlockHeader {
+    size_t size;
+  };
+  static constexpr size_t kMaxPooledBytes = 16 * 1024 * 1024;
+  std::vector<BlockHeader *> free_blocks_;
+  size_t pooled_bytes_ = 0;
+#endif
+
+  Compressor() = default;
+
+public:
+  Compressor(const Compressor &) = delete;
+  Compressor &operator=(const Compressor &) = delete;
+
+  ~Compressor() {
+    if (zlib_level_ >= 0) {
+      deflateEnd(&zlib_);
+    }
+#if FP_WEBSERVER_BROTLI
+    for (auto *block : free_blocks_) {
+      std::free(block);
+    }
+#endif
+  }
+
+  static Compressor &local() {
+    thread_local Compressor compressor;
+    return compressor;
+  }
+
+  std::expected<std::vector<uint8_t>, std::string> encode(ContentCoding coding,
+                                                          std::span<const uint8_t> input,
+                                                          const CompressionOptions &options) {
+    switch (coding) {
+    case ContentCoding::Gzip:
+      return gzip(input, options.gzip_level);
+    case ContentCoding::Brotli:
+      return brotli(input, options.brotli_quality);
+    default:
+      return std::vector<uint8_t>(input.begin(), input.end());
+    }
+  }
+
+  std::expected<std::vector<uint8_t>, std::string> gzip(std::span<const uint8_t> input,
+                                                        int level) {
+    if (input.size() > UINT_MAX) {
+      return std::unexpected("input too large for zlib");
+    }
+    if (zlib_level_ != level) {
+      if (zlib_level_ >= 0) {
+        deflateEnd(&zlib_);
+        zlib_level_ = -1;
+      }
+      zlib_ = z_stream{};
+      // windowBits 15 + 16：输出 gzip 封装而不是 zlib 封装
+      if (deflateInit2(&zlib_, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return std::unexpected("deflateInit2 failed");
+      }
+      zlib_level_ = level;
+    } else {
+      deflateReset(&zlib_);
+    }
+
+    std::vector<uint8_t> out(deflateBound(&zlib_, static_cast<uLong>(input.size())));
+    zlib_.next_in = const_cast<Bytef *>(input.data());
+    zlib_.avail_in = static_cast<uInt>(input.size());
+    zlib_.next_out = out.data();
+    zlib_.avail_out = static_cast<uInt>(out.size());
+    if (deflate(&zlib_, Z_FINISH) != Z_STREAM_END) {
+      return std::unexpected("deflate failed");
+    }
+    out.resize(zlib_.total_out);
+    return out;
+  }
+
+  std::expected<std::vector<uint8_t>, std::string> brotli(std::span<const uint8_t> input,
+                                                          int quality) {
+#if FP_WEBSERVER_BROTLI
+    const size_t bound = BrotliEncoderMaxCompressedSize(input.size());
+    if (bound == 0) {
+      return std::unexpected("input too large for brotli");
+    }
+    auto *state = BrotliEncoderCreateInstance(&Compressor::allocate, &Compressor::release, this);
+    if (state == nullptr) {
+      return std::unexpected("BrotliEncoderCreateInstance failed");
+    }
+    BrotliEncoderSetParameter(state, BROTLI_PARAM_QUALITY, static_cast<uint32_t>(quality));
+    BrotliEncoderSetParameter(state, BROTLI_PARAM_LGWIN, window_bits(input.size()));
+    BrotliEncoderSetParameter(state, BROTLI_PARAM_SIZE_HINT,
+                              static_cast<uint32_t>(std::min<size_t>(input.size(), 1u << 30)));
+
+    std::vector<uint8_t> out(bound);
+    size_t avail_in = input.size();
+    const uint8_t *next_in = input.data();
+    size_t avail_out = out.size();
+    uint8_t *next_out = out.data();
+    const bool ok = BrotliEncoderCompressStream(state, BROTLI_OPERATION_FINISH, &avail_in,
+                                                &next_in, &avail_out, &next_out, nullptr) &&
+                    BrotliEncoderIsFinished(state);
+    BrotliEncoderDestroyInstance(state);
+    if (!ok) {
+      return std::unexpected("brotli compression failed");
+    }
+    out.resize(out.size() - avail_out);
+    return out;
+#else
+    (void)input;
+    (void)quality;
+    return std::unexpected("brotli support not compiled in");
+#endif
+  }
+
+private:
+#if FP_WEBSERVER_BROTLI
+  // 窗口不必超过输入本身，小响应因此只分配小的环形缓冲
+  static uint32_t window_bits(size_t size) {
+    uint32_t bits = BROTLI_MIN_WINDOW_BITS;
+    while (bits < BROTLI_DEFAULT_WINDOW && (size_t{1} << bits) - 16 < size) {
+      ++bits;
+    }
+    return bits;
+  }
+
+  static void *allocate(void *opaque, size_t size) {
+    auto &self = *static_cast<Compressor *>(opaque);
+    for (auto it = self.free_blocks_.begin(); it != self.free_blocks_.end(); ++it) {
+      if ((*it)->size == size) {
+        auto *block = *it;
+        *it = self.free_blocks_.back();
+        self.free_blocks_.pop_back();
+        self.pooled_bytes_ -= size;
+        return block + 1;
+      }
+    }
+    auto *block = static_cast<BlockHeader *>(std::malloc(sizeof(BlockHeader) + size));
+    if (block == nullptr) {
+      return nullptr;
+    }
+    block->size = size;
+    return block + 1;
+  }
+
+  static void release(void *opaque, void *address) {
+    if (address == nullptr) {
+      return;
+    }
+    auto &self = *static_cast<Compressor *>(opaque);
+    auto *block = static_cast<BlockHeader *>(address) - 1;
+    if (self.pooled_bytes_ + block->size > kMaxPooledBytes) {
+      std::free(block);
+      return;
+    }
+    self.pooled_bytes_ += block->size;
+    self.free_blocks_.push_back(block);
+  }
+#endif
+};
+
+// Vary 里追加一个 header 名，已经存在（或为 "*"）时不重复
+inline void add_vary(ResponseHeaders &headers, std::string_view name) {
+  auto &vary = headers["Vary"];
+  if (vary.empty()) {
+    vary = name;
+  } else if (vary != "*" && !parser::has_token(vary, name)) {
+    vary += ", ";
+    vary += name;
+  }
+}
+
+// 强 ETag 标识一个具体的表示，压缩后的 body 要用不同的值，例如 "abc" → "abc-gzip"
+inline std::string coded_etag(std::string_view etag, ContentCoding coding) {
+  if (coding == ContentCoding::Identity || etag.size() < 2 || etag.back() != '"') {
+    return std::string(etag);
+  }
+  std::string out(etag.substr(0, etag.size() - 1));
+  out += '-';
+  out += coding_name(coding);
+  out += '"';
+  return out;
+}
+
+// 在原地压缩一个内存中的响应。流式与文件响应、已经编码过的、带 no-transform 的、
+// 过小的和非文本类型的 body 保持原样；压缩后没有变小时也保持原样
+inline void compress_response(HttpResponse &response, const parser::HttpRequest &req,
+                              const CompressionOptions &options) {
+  if (req.request_line.method == parser::Method::Head || response.stream || response.file ||
+      response.status_code < 200 || response.status_code == 204 ||
+      response.status_code == 304 || response.body_bytes().size() < options.min_size ||
+      response.headers.contains("Content-Encoding")) {
+    return;
+  }
+  auto type = response.header("Content-Type");
+  if (!type || !compressible_type(*type)) {
+    return;
+  }
+  if (auto cc = response.header("Cache-Control"); cc && parser::has_token(*cc, "no-transform")) {
+    return;
+  }
+
+  add_vary(response.headers, "Accept-Encoding");
+  const auto coding = negotiate_coding(req.header(parser::HeaderId::AcceptEncoding));
+  if (coding == ContentCoding::Identity) {
+    return;
+  }
+  const auto input = response.body_bytes();
+  auto encoded = Compressor::local().encode(coding, input, options);
+  if (!encoded || encoded->size() >= input.size()) {
+    return;
+  }
+  response.body = std::move(*encoded);
+  response.shared_body = nullptr;
+  response.headers["Content-Encoding"] = coding_name(coding);
+  std::erase_if(response.headers, [](const auto &field) {
+    return parser::iequals(field.first, "Content-Length");
+  });
+  if (auto etag = response.headers.find("ETag"); etag != response.headers.end()) {
+    etag->second = coded_etag(etag->second, coding);
+  }
+}
+
+} // namespace http::router
@@ -1,77 +1,256 @@
 #pragma once
 #include "types.hpp"
+#include <algorithm>
+#include <memory>
 #include <optional>
-#include <regex>
+#include <stdexcept>
 
 namespace http::router {
 
-class PathPattern {
-  std::string pattern_;
-  std::regex regex_;
-  std::vector<std::string> param_names_;
+template <typename T> class FrozenRadixTree;
+
+// 压缩前缀树（radix tree）的构建端：静态路径段按公共前缀合并，`:name` 匹配到下一个 '/'
+// 为止的非空段，`*name` 匹配剩余的全部路径。插入完成后用 freeze() 生成只读的匹配结构
+template <typename T> class RadixTree {
+  friend class FrozenRadixTree<T>;
+
+  struct Leaf {
+    std::vector<std::string> names;
+    T value;
+  };
+
+  struct Node {
+    std::string prefix;                          // 从父节点到本节点的静态边
+    std::string indices;                         // 各静态子节点 prefix 的首字节
+    std::vector<std::unique_ptr<Node>> children; // 与 indices 一一对应
+    std::unique_ptr<Node> param;
+    std::unique_ptr<Node> wildcard;
+    std::optional<Leaf> leaf;
+  };
+
+  Node root_;
 
 public:
-  PathPattern() = default;
+  // 同一路径形状重复插入时覆盖旧值；模式非法时抛出 std::invalid_argument
+  void insert(std::string_view pattern, T value) {
+    Node *node = &root_;
+    std::vector<std::string> names;
 
-  explicit PathPattern(std::string_view pattern) : pattern_(pattern) {
-    std::string regex_str = "^";
-    std::string current_segment;
-    bool in_param = false;
-
-    for (size_t i = 0; i < pattern.size(); ++i) {
-      const char c = pattern[i];
-
-      if (c == ':') {
-        in_param = true;
-        current_segment.clear();
-      } else if (c == '/' || i == pattern.size() - 1) {
-        if (in_param) {
-          if (i == pattern.size() - 1 && c != '/') {
-            current_segment += c;
-          }
-          param_names_.push_back(current_segment);
-          regex_str += "([^/]+)";
-          in_param = false;
+    while (!pattern.empty()) {
+      if (pattern[0] == ':' || pattern[0] == '*') {
+        const bool wildcard = pattern[0] == '*';
+        auto end = wildcard ? pattern.size() : std::min(pattern.find('/'), pattern.size());
+        auto name = pattern.substr(1, end - 1);
+        if (name.empty() && !wildcard) {
+          throw std::invalid_argument("route parameter without a name");
         }
-        if (c == '/') {
-          regex_str += '/';
-        } else if (c == '*') {
-          param_names_.push_back("wildcard");
-          regex_str += "(.*)";
-          break;
-        } else {
-          if (in_param) {
-            current_segment += c;
-          } else {
-            if (c == '.' || c == '?' || c == '+') {
-              regex_str += '\\';
-            }
-            regex_str += c;
-          }
+        names.emplace_back(name.empty() ? "wildcard" : name);
+
+        auto &slot = wildcard ? node->wildcard : node->param;
+        if (!slot) {
+          slot = std::make_unique<Node>();
         }
+        node = slot.get();
+        pattern.remove_prefix(end);
+      } else {
+        auto end = std::min(pattern.find_first_of(":*"), pattern.size());
+        node = insert_static(node, pattern.substr(0, end));
+        pattern.remove_prefix(end);
+      }
+    }
+
+    if (names.size() > RouteParams::kMaxParams) {
+      throw std::invalid_argument("too many route parameters");
+    }
+    node->leaf.emplace(Leaf{std::move(names), std::move(value)});
+  }
+
+  [[nodiscard]] FrozenRadixTree<T> freeze() && { return FrozenRadixTree<T>(std::move(*this)); }
+
+private:
+  static Node *insert_static(Node *node, std::string_view segment) {
+    while (!segment.empty()) {
+      auto idx = node->indices.find(segment[0]);
+      if (idx == std::string::npos) {
+        auto child = std::make_unique<Node>();
+        child->prefix = std::string(segment);
+        node->indices.push_back(segment[0]);
+        node->children.push_back(std::move(child));
+        return node->children.back().get();
+      }
+
+      auto &child = node->children[idx];
+      auto common = static_cast<size_t>(
+          std::mismatch(child->prefix.begin(), child->prefix.end(), segment.begin(), segment.end())
+              .first -
+          child->prefix.begin());
+
+      if (common < child->prefix.size()) {
+        // 拆分边：child 的公共前缀成为新的中间节点
+        auto mid = std::make_unique<Node>();
+        mid->prefix = child->prefix.substr(0, common);
+        child->prefix.erase(0, common);
+        mid->indices.push_back(child->prefix[0]);
+        mid->children.push_back(std::move(child));
+        child = std::move(mid);
+      }
+      node = child.get();
+      segment.remove_prefix(common);
+    }
+    return node;
+  }
+};
+
+// 只读的扁平化基数树：节点按广度优先顺序存放在一个数组里，同一节点的静态子节点连续排列，
+// 所有前缀拼接在一个字符串池中。匹配耗时只与路径长度有关，与路由数量无关。
+// 同一位置上优先级为 静态 > 参数 > 通配符，失败时回溯到下一个候选
+template <typename T> class FrozenRadixTree {
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  struct Node {
+    uint32_t prefix_begin = 0;
+    uint32_t prefix_size = 0;
+    uint32_t children_begin = 0;
+    uint32_t children_size = 0;
+    uint32_t param = kNone;
+    uint32_t wildcard = kNone;
+    uint32_t leaf = kNone;
+  };
+
+  using Leaf = typename RadixTree<T>::Leaf;
+  using Captures = std::array<std::string_view, RouteParams::kMaxParams>;
+
+  std::vector<Node> nodes_;
+  std::string first_bytes_; // first_bytes_[i] 为 nodes_[i] 前缀的首字节
+  std::string prefixes_;
+  std::vector<Leaf> leaves_;
+
+public:
+  FrozenRadixTree() : nodes_(1), first_bytes_(1, '\0') {}
+
+  explicit FrozenRadixTree(RadixTree<T> &&tree) {
+    using BuildNode = typename RadixTree<T>::Node;
+    std::vector<std::pair<BuildNode *, uint32_t>> queue{{&tree.root_, 0}};
+    nodes_.emplace_back();
+    first_bytes_.push_back('\0');
+
+    auto append = [&](BuildNode *child) {
+      auto index = static_cast<uint32_t>(nodes_.size());
+      nodes_.emplace_back();
+      first_bytes_.push_back(child->prefix.empty() ? '\0' : child->prefix[0]);
+      queue.emplace_back(child, index);
+      return index;
+    };
+
+    for (size_t i = 0; i < queue.size(); ++i) {
+      auto [src, index] = queue[i];
+      Node node;
+      node.prefix_begin = static_cast<uint32_t>(prefixes_.size());
+      node.prefix_size = static_cast<uint32_t>(src->prefix.size());
+      prefixes_ += src->prefix;
+
+      node.children_begin = static_cast<uint32_t>(nodes_.size());
+      node.children_size = static_cast<uint32_t>(src->children.size());
+      for (auto &child : src->children) {
+        append(child.get());
       }
+      if (src->param) {
+        node.param = append(src->param.get());
+      }
+      if (src->wildcard) {
+        node.wildcard = append(src->wildcard.get());
+      }
+      if (src->leaf) {
+        node.leaf = static_cast<uint32_t>(leaves_.size());
+        leaves_.push_back(std::move(*src->leaf));
+      }
+      nodes_[index] = node;
     }
-    regex_str += "$";
-    regex_ = std::regex(regex_str);
   }
-  [[nodiscard]] std::optional<std::unordered_map<std::string, std::string>> match(std::string_view path) const {
-    std::smatch matches;
-    const std::string path_str(path);
-
-    if(std::regex_match(path_str, matches, regex_)) {
-      std::unordered_map<std::string, std::string> params;
-      for (size_t i = 1; i < matches.size(); ++i) {
-        if (i - 1 < param_names_.size()) {
-          params[param_names_[i - 1]] = matches[i].str();
+
+  // 成功时 params 中的名称指向树内存储，取值指向 path
+  [[nodiscard]] const T *find(std::string_view path, RouteParams &params) const {
+    Captures captures;
+    const Leaf *leaf = match(0, path, captures, 0);
+    if (leaf == nullptr) {
+      return nullptr;
+    }
+    params.clear();
+    for (size_t i = 0; i < leaf->names.size(); ++i) {
+      params.push(leaf->names[i], captures[i]);
+    }
+    return &leaf->value;
+  }
+
+private:
+  [[nodiscard]] std::string_view prefix(const Node &node) const {
+    return std::string_view(prefixes_).substr(node.prefix_begin, node.prefix_size);
+  }
+
+  const Leaf *match(uint32_t index, std::string_view path, Captures &captures,
+                    size_t depth) const {
+    const Node &node = nodes_[index];
+    if (path.empty() && node.leaf != kNone) {
+      return &leaves_[node.leaf];
+    }
+
+    if (!path.empty()) {
+      auto bytes = std::string_view(first_bytes_).substr(node.children_begin, node.children_size);
+      if (auto pos = bytes.find(path[0]); pos != std::string_view::npos) {
+        auto child = static_cast<uint32_t>(node.children_begin + pos);
+        auto child_prefix = prefix(nodes_[child]);
+        if (path.starts_with(child_prefix)) {
+          if (auto leaf = match(child, path.substr(child_prefix.size()), captures, depth)) {
+            return leaf;
+          }
+        }
+      }
+
+      if (node.param != kNone && depth < captures.size()) {
+        auto end = std::min(path.find('/'), path.size());
+        if (end > 0) {
+          captures[depth] = path.substr(0, end);
+          if (auto leaf = match(node.param, path.substr(end), captures, depth + 1)) {
+            return leaf;
+          }
         }
       }
-      return params;
     }
-    return std::nullopt;
+
+    if (node.wildcard != kNone && depth < captures.size()) {
+      const Node &wildcard = nodes_[node.wildcard];
+      if (wildcard.leaf != kNone) {
+        captures[depth] = path;
+        return &leaves_[wildcard.leaf];
+      }
+    }
+    return nullptr;
   }
-  [[nodiscard]] const std::string& pattern() const { return pattern_; }
 };
 
-} // namespace http::router
+// 单个路径模式，语法与 Router 相同
+class PathPattern {
+  std::string pattern_;
+  FrozenRadixTree<std::monostate> tree_;
 
-// namespace PathPattern
+public:
+  PathPattern() = default;
+
+  explicit PathPattern(std::string_view pattern) : pattern_(pattern) {
+    RadixTree<std::monostate> tree;
+    tree.insert(pattern, std::monostate{});
+    tree_ = std::move(tree).freeze();
+  }
+
+  [[nodiscard]] std::optional<RouteParams> match(std::string_view path) const {
+    RouteParams params;
+    if (tree_.find(path, params) == nullptr) {
+      return std::nullopt;
+    }
+    return params;
+  }
+
+  [[nodiscard]] const std::string &pattern() const { return pattern_; }
+};
+
+} // namespace http::router
@@ -1,52 +1,207 @@
 #pragma once
+#include "../logger/logger.hpp"
+#include "compression.hpp"
+#include "response_cache.hpp"
+#include "static_files.hpp"
 #include "types.hpp"
+#include <concepts>
 #include <functional>
-#include <iostream>
+#include <memory>
 #include <numeric>
+#include <tuple>
+#include <utility>
 
 namespace http::router::middleware {
 
   using Middleware = std::function<Handler(Handler)>;
 
-  inline Middleware logging() {
-    return [](Handler next) -> Handler {
-      return [next = std::move(next)](const parser::HttpRequest &req) -> HttpResponse {
-        std::cout << "[" << static_cast<int>(req.request_line.method) << "]"
-                  << req.request_line.uri << '\n';
+  // 静态中间件层：operator()(req, next) 在调用 next(req) 前后做自己的事，next 的类型是模板参数。
+  // 同一个层既可以放进 pipeline() 在编译期组合，也可以用 layer() 包成 Middleware 交给 compose()
+  template <typename L>
+  concept Layer = std::copy_constructible<L> &&
+                  requires(const L &l, const parser::HttpRequest &req,
+                           HttpResponse (*next)(const parser::HttpRequest &)) {
+                    { l(req, next) } -> std::same_as<HttpResponse>;
+                  };
 
-        auto response = next(req);
+  // 默认的访问日志：经 AsyncSink 写到标准输出，请求线程只把参数复制进本线程的缓冲
+  inline const logger::Logger &access_log() {
+    static const auto log = logger::Logger(logger::Level::Info)
+                                .with_sink(std::make_shared<logger::AsyncSink>(
+                                    std::make_unique<logger::ConsoleSink>()));
+    return log;
+  }
+
+  struct LoggingLayer {
+    logger::Logger log = access_log();
+
+    template <typename Next>
+    HttpResponse operator()(const parser::HttpRequest &req, Next &&next) const {
+      auto response = next(req);
+      LOGF_INFO(log, "{} {} -> {}", parser::method_name(req.request_line.method),
+                req.request_line.uri, response.status_code);
+      return response;
+    }
+  };
+
+  template <typename Check> struct AuthLayer {
+    Check check;
+
+    template <typename Next>
+    HttpResponse operator()(const parser::HttpRequest &req, Next &&next) const {
+      if (!check(req)) {
+        return HttpResponse{401, "Unauthorized", {}, {}}.with_text("Authentication required");
+      }
+      return next(req);
+    }
+  };
+
+  // 两个 CORS 头在构造时渲染一次，之后每个响应只记一个指针
+  struct CorsLayer {
+    const StaticHeaders *headers;
+
+    explicit CorsLayer(std::string_view origin = "*",
+                       std::string_view methods = "GET, POST, PUT, DELETE")
+        : headers(&StaticHeaders::intern({{"Access-Control-Allow-Origin", origin},
+                                          {"Access-Control-Allow-Methods", methods}})) {}
+
+    template <typename Next>
+    HttpResponse operator()(const parser::HttpRequest &req, Next &&next) const {
+      return next(req).with_static_headers(*headers);
+    }
+  };
+
+  // 缓存在层的所有副本之间共享
+  struct StaticFilesLayer {
+    std::shared_ptr<StaticFileCache> cache;
+
+    explicit StaticFilesLayer(std::filesystem::path root, StaticFileOptions options = {})
+        : cache(std::make_shared<StaticFileCache>(std::move(root), std::move(options))) {}
+
+    template <typename Next>
+    HttpResponse operator()(const parser::HttpRequest &req, Next &&next) const {
+      if (auto response = cache->serve(req)) {
+        return std::move(*response);
+      }
+      return next(req);
+    }
+  };
+
+  struct CacheLayer {
+    std::shared_ptr<ResponseCache> cache;
+
+    CacheLayer(std::chrono::milliseconds ttl, size_t max_bytes)
+        : cache(std::make_shared<ResponseCache>(ttl, max_bytes)) {}
+
+    template <typename Next>
+    HttpResponse operator()(const parser::HttpRequest &req, Next &&next) const {
+      if (!ResponseCache::cacheable(req)) {
+        return next(req);
+      }
+      const auto directives = req.header(parser::HeaderId::CacheControl)
+                                  .transform(CacheDirectives::parse)
+                                  .value_or(CacheDirectives{});
+      if (directives.no_store) {
+        return next(req);
+      }
+      auto key = ResponseCache::key_of(req);
+      if (!directives.no_cache) {
+        if (auto hit = cache->lookup(key)) {
+          return std::move(*hit);
+        }
+      }
+      auto response = next(req);
+      cache->store(std::move(key), response);
+      return response;
+    }
+  };
+
+  struct CompressLayer {
+    CompressionOptions options;
+
+    template <typename Next>
+    HttpResponse operator()(const parser::HttpRequest &req, Next &&next) const {
+      auto response = next(req);
+      compress_response(response, req, options);
+      return response;
+    }
+  };
+
+  // 编译期组合的处理链：各层按给出的顺序由外到内嵌套，层与层之间是可内联的直接调用，
+  // 没有 std::function，也不在请求路径上分配。可以直接注册为 Handler
+  template <typename Final, Layer... Layers> class Pipeline {
+    std::tuple<Layers...> layers_;
+    Final final_;
 
-        std::cout << " -> " << response.status_code << '\n';
+  public:
+    Pipeline(std::tuple<Layers...> layers, Final final_handler)
+        : layers_(std::move(layers)), final_(std::move(final_handler)) {}
 
-        return response;
+    HttpResponse operator()(const parser::HttpRequest &req) const { return call<0>(req); }
+
+  private:
+    template <size_t I> HttpResponse call(const parser::HttpRequest &req) const {
+      if constexpr (I == sizeof...(Layers)) {
+        return final_(req);
+      } else {
+        return std::get<I>(layers_)(
+            req, [this](const parser::HttpRequest &r) { return call<I + 1>(r); });
+      }
+    }
+  };
+
+  template <Layer... Layers> class Stack {
+    std::tuple<Layers...> layers_;
+
+  public:
+    explicit Stack(Layers... layers) : layers_(std::move(layers)...) {}
+
+    template <typename Final> auto operator()(Final final_handler) const {
+      return Pipeline<Final, Layers...>(layers_, std::move(final_handler));
+    }
+  };
+
+  // pipeline(LoggingLayer{}, CorsLayer{})(handler)，与 compose({logging(), cors()}, handler) 等价
+  template <Layer... Layers> Stack<Layers...> pipeline(Layers... layers) {
+    return Stack<Layers...>(std::move(layers)...);
+  }
+
+  // 把静态层包装成 std::function 形式的中间件
+  template <Layer L> Middleware layer(L l) {
+    return [l = std::move(l)](Handler next) -> Handler {
+      return [l, next = std::move(next)](const parser::HttpRequest &req) -> HttpResponse {
+        return l(req, next);
       };
     };
   }
 
-  inline Middleware require_auth(std::function<bool(const parser::HttpRequest &)> check) {
-    return [check = std::move(check)](Handler next) -> Handler {
-      return
-          [next = std::move(next), check](const parser::HttpRequest &req) -> HttpResponse {
-            if (!check(req)) {
-              return HttpResponse{401, "Unauthorized", {}, {}}.with_text(
-                  "Authentication required");
-            }
-            return next(req);
-          };
-    };
+  inline Middleware logging(logger::Logger log = access_log()) {
+    return layer(LoggingLayer{std::move(log)});
   }
 
-  inline Middleware cors() {
-    return [](Handler next) -> Handler {
-      return [next = std::move(next)](const parser::HttpRequest &req) -> HttpResponse {
-        auto response = next(req);
+  template <typename Check = std::function<bool(const parser::HttpRequest &)>>
+  Middleware require_auth(Check check) {
+    return layer(AuthLayer<Check>{std::move(check)});
+  }
 
-        return std::move(response)
-            .with_header("Access-Control-Allow-Origin", "*")
-            .with_header("Access-Control-Allow-Methods",
-                         "GET, POST, PUT, DELETE");
-      };
-    };
+  inline Middleware cors() { return layer(CorsLayer{}); }
+
+  // 把 URI 映射到 root 下的文件并直接应答，找不到文件时交给 next。
+  // 缓存在返回的中间件的所有副本之间共享
+  inline Middleware static_files(std::filesystem::path root, StaticFileOptions options = {}) {
+    return layer(StaticFilesLayer(std::move(root), std::move(options)));
+  }
+
+  // 缓存 GET/HEAD 的完整响应，键为方法 + URI（加上协商出的内容编码）。响应的 Cache-Control（no-store、no-cache、
+  // private、max-age）决定是否保存与保存多久；请求带 no-cache 时跳过查找，带 no-store 时完全绕过
+  inline Middleware response_cache(std::chrono::milliseconds ttl, size_t max_bytes) {
+    return layer(CacheLayer(ttl, max_bytes));
+  }
+
+  // 按 Accept-Encoding 压缩内存中的文本响应，压缩上下文每个线程一份、跨响应复用。
+  // 放在 response_cache 外层时每次命中都要重新压缩，放在内层则压缩结果按编码分别缓存
+  inline Middleware compress(CompressionOptions options = {}) {
+    return layer(CompressLayer{options});
   }
 
   inline Handler compose(std::vector<Middleware> middlewares,
@@ -0,0 +1,296 @@
+#pragma once
+#include "compression.hpp"
+#include "types.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace http::router {
+
+// Cache-Control 中与缓存决策有关的指令（RFC 9111 §5.2）
+struct CacheDirectives {
+  bool no_store = false;
+  bool no_cache = false;
+  bool is_private = false;
+  std::optional<std::chrono::seconds> max_age; // 响应侧优先使用 s-maxage
+
+  static CacheDirectives parse(std::string_view value) {
+    CacheDirectives d;
+    while (!value.empty()) {
+      const auto comma = std::min(value.find(','), value.size());
+      auto item = value.substr(0, comma);
+      value.remove_prefix(std::min(comma + 1, value.size()));
+      const auto begin = item.find_first_not_of(" \t");
+      if (begin == std::string_view::npos) {
+        continue;
+      }
+      item = item.substr(begin, item.find_last_not_of(" \t") - begin + 1);
+
+      const auto eq = item.find('=');
+      const auto name = item.substr(0, eq);
+      if (parser::iequals(name, "no-store")) {
+        d.no_store = true;
+      } else if (parser::iequals(name, "no-cache")) {
+        d.no_cache = true;
+      } else if (parser::iequals(name, "private")) {
+        d.is_private = true;
+      } else if (eq != std::string_view::npos &&
+                 (parser::iequals(name, "max-age") || parser::iequals(name, "s-maxage"))) {
+        auto arg = item.substr(eq + 1);
+        if (arg.size() >= 2 && arg.front() == '"' && arg.back() == '"') {
+          arg = arg.substr(1, arg.size() - 2);
+        }
+        long seconds = 0;
+        if (std::from_chars(arg.data(), arg.data() + arg.size(), seconds).ec == std::errc{} &&
+            (!d.max_age || parser::iequals(name, "s-maxage"))) {
+          d.max_age = std::chrono::seconds(std::max(0L, seconds));
+        }
+      }
+    }
+    return d;
+  }
+};
+
+// 按方法 + URI 缓存完整响应的共享缓存。分成若干分片，每片一把锁、一个 CLOCK 环和
+// max_bytes / kShards 的字节预算：命中只置位访问标记，淘汰时指针扫过环，
+// 跳过（并清除）最近被访问过的条目。过期条目在命中时或被指针扫到时删除
+class ResponseCache {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t kShards = 16;
+
+private:
+  struct Entry {
+    std::string key;
+    HttpResponse response;
+    Clock::time_point expires;
+    size_t bytes;
+    bool referenced;
+  };
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::vector<std::optional<Entry>> ring; // CLOCK 环，空位可复用
+    std::vector<size_t> free_slots;
+    std::unordered_map<std::string, size_t> index; // key → ring 下标
+    size_t hand = 0;
+    size_t bytes = 0;
+  };
+
+  std::chrono::milliseconds ttl_;
+  size_t shard_budget_;
+  std::array<Shard, kShards> shards_;
+
+public:
+  ResponseCache(std::chrono::milliseconds ttl, size_t max_bytes)
+      : ttl_(ttl), shard_budget_(max_bytes / kShards) {}
+
+  // 键里带上协商出的内容编码：内层的 compress() 因 Accept-Encoding 不同而返回不同的 body
+  static std::string key_of(const parser::HttpRequest &req) {
+    std::string key(parser::method_name(req.request_line.method));
+    key += ' ';
+    key += req.request_line.uri;
+    if (const auto coding = negotiate_coding(req.header(parser::HeaderId::AcceptEncoding));
+        coding != ContentCoding::Identity) {
+      key += ' ';
+      key += coding_name(coding);
+    }
+    return key;
+  }
+
+  // 只缓存 GET/HEAD；带 Authorization 的请求属于单个用户，不进入共享缓存
+  static bool cacheable(const parser::HttpRequest &req) {
+    const auto method = req.request_line.method;
+    return (method == parser::Method::Get || method == parser::Method::Head) &&
+           !req.header(parser::HeaderId::Authorization);
+  }
+
+  std::optional<HttpResponse> lookup(const std::string &key, Clock::time_point now = Clock::now()) {
+    auto &shard = shard_of(key);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+      return std::nullopt;
+    }
+    auto &entry = *shard.ring[it->second];
+    if (entry.expires <= now) {
+      remove(shard, it->second);
+      return std::nullopt;
+    }
+    entry.referenced = true;
+    return entry.response;
+  }
+
+  // 根据响应的状态码与 Cache-Control 决定是否保存以及保存多久
+  void store(std::string key, const HttpResponse &response, Clock::time_point now = Clock::now()) {
+    const auto ttl = ttl_for(response);
+    if (!ttl) {
+      return;
+    }
+    const size_t bytes = size_of(key, response);
+    if (bytes > shard_budget_) {
+      return;
+    }
+
+    auto &shard = shard_of(key);
+    std::lock_guard lock(shard.mutex);
+    if (auto it = shard.index.find(key); it != shard.index.end()) {
+      remove(shard, it->second);
+    }
+    while (shard.bytes + bytes > shard_budget_) {
+      evict_one(shard, now);
+    }
+
+    size_t slot;
+    if (!shard.free_slots.empty()) {
+      slot = shard.free_slots.back();
+      shard.free_slots.pop_back();
+    } else {
+      slot = shard.ring.size();
+      shard.ring.emplace_back();
+    }
+    shard.index.emplace(key, slot);
+    shard.ring[slot] = Entry{std::move(key), response, now + *ttl, bytes, false};
+    shard.bytes += bytes;
+  }
+
+  [[nodiscard]] size_t size() {
+    size_t n = 0;
+    for (auto &shard : shards_) {
+      std::lock_guard lock(shard.mutex);
+      n += shard.index.size();
+    }
+    return n;
+  }
+
+  [[nodiscard]] size_t bytes() {
+    size_t n = 0;
+    for (auto &shard : shards_) {
+      std::lock_guard lock(shard.mutex);
+      n += shard.bytes;
+    }
+    return n;
+  }
+
+private:
+  Shard &shard_of(const std::string &key) {
+    return shards_[std::hash<std::string>{}(key) % kShards];
+  }
+
+  // RFC 9110 §15.1 中默认可缓存的状态码；流式响应无法保存
+  std::optional<Clock::duration> ttl_for(const HttpResponse &response) const {
+    constexpr int kCacheable[] = {200, 203, 204, 300, 301, 404, 405, 410, 414, 501};
+    if (response.stream ||
+        std::find(std::begin(kCacheable), std::end(kCacheable), response.status_code) ==
+            std::end(kCacheable)) {
+      return std::nullopt;
+    }
+    // Set-Cookie 属于单个用户；缓存键只区分协商后的编码，Vary 了别的请求头就不能共用
+    if (find_header(response, "Set-Cookie") || !varies_only_by_encoding(response)) {
+      return std::nullopt;
+    }
+    Clock::duration ttl = ttl_;
+    if (auto value = find_header(response, "Cache-Control")) {
+      const auto directives = CacheDirectives::parse(*value);
+      if (directives.no_store || directives.no_cache || directives.is_private) {
+        return std::nullopt;
+      }
+      if (directives.max_age) {
+        ttl = *directives.max_age;
+      }
+    }
+    if (ttl <= Clock::duration::zero()) {
+      return std::nullopt;
+    }
+    return ttl;
+  }
+
+  // 按名称查找响应头，大小写不敏感，静态头块也算在内
+  static std::optional<std::string_view> find_header(const HttpResponse &response,
+                                                     std::string_view name) {
+    for (const auto &[key, value] : response.headers) {
+      if (parser::iequals(key, name)) {
+        return value;
+      }
+    }
+    for (const auto *block : response.static_headers) {
+      if (block == nullptr) {
+        break;
+      }
+      for (const auto &[key, value] : block->fields()) {
+        if (parser::iequals(key, name)) {
+          return value;
+        }
+      }
+    }
+    return std::nullopt;
+  }
+
+  static bool varies_only_by_encoding(const HttpResponse &response) {
+    auto vary = find_header(response, "Vary");
+    if (!vary) {
+      return true;
+    }
+    auto list = *vary;
+    while (!list.empty()) {
+      const auto comma = std::min(list.find(','), list.size());
+      auto item = list.substr(0, comma);
+      list.remove_prefix(std::min(comma + 1, list.size()));
+      const auto begin = item.find_first_not_of(" \t");
+      if (begin == std::string_view::npos) {
+        continue;
+      }
+      item = item.substr(begin, item.find_last_not_of(" \t") - begin + 1);
+      if (!parser::iequals(item, "Accept-Encoding")) {
+        return false; // 包括 "*"
+      }
+    }
+    return true;
+  }
+
+  static size_t size_of(const std::string &key, const HttpResponse &response) {
+    size_t bytes = sizeof(Entry) + key.size() + response.status_text.size() +
+                   response.body_bytes().size();
+    for (const auto &[name, value] : response.headers) {
+      bytes += name.size() + value.size() + 32;
+    }
+    return bytes;
+  }
+
+  void evict_one(Shard &shard, Clock::time_point now) {
+    while (true) {
+      if (shard.hand >= shard.ring.size()) {
+        shard.hand = 0;
+      }
+      const size_t slot = shard.hand++;
+      auto &entry = shard.ring[slot];
+      if (!entry) {
+        continue;
+      }
+      if (entry->referenced && entry->expires > now) {
+        entry->referenced = false;
+        continue;
+      }
+      remove(shard, slot);
+      return;
+    }
+  }
+
+  static void remove(Shard &shard, size_t slot) {
+    auto &entry = shard.ring[slot];
+    shard.bytes -= entry->bytes;
+    shard.index.erase(entry->key);
+    entry.reset();
+    shard.free_slots.push_back(slot);
+  }
+};
+
+} // namespace http::router
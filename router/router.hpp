@@ -1,75 +1,418 @@
 #pragma once
+#include "../metrics/metrics.hpp"
 #include "matcher.hpp"
 #include "types.hpp"
-#include <map>
+#include <atomic>
 #include <memory>
 
 namespace http::router {
+
+struct RouteDefinition {
+  parser::Method method;
+  std::string pattern;
+  RouteHandler handler;
+};
+
+class RouterBuilder;
+
+// 不可变路由表。Router 之间共享同一份冻结后的匹配结构，复制只增加引用计数
 class Router {
-  using RouteKey = std::pair<parser::Method, std::string>;
-  using RouteTable = std::map<RouteKey, std::pair<PathPattern, Handler>>;
+  friend class RouterBuilder;
+
+  static constexpr size_t kMethodCount = static_cast<size_t>(parser::Method::Patch) + 1;
+
+  struct Route {
+    RouteHandler handler;
+    metrics::Histogram *duration = nullptr;
+  };
+
+  // definitions 保留注册顺序，用于在已有路由表的基础上继续构建；trees 每个方法一棵。
+  // registry 非空时 match_time 和每条路由的 duration 都指向其中的直方图
+  struct Routes {
+    std::vector<RouteDefinition> definitions;
+    std::array<FrozenRadixTree<Route>, kMethodCount> trees;
+    metrics::Registry *registry = nullptr;
+    metrics::Histogram *match_time = nullptr;
+  };
 
-  std::shared_ptr<const RouteTable> routes_;
+  std::shared_ptr<const Routes> routes_;
+
+  explicit Router(std::shared_ptr<const Routes> routes) : routes_(std::move(routes)) {}
 
 public:
-  Router() : routes_(std::make_shared<RouteTable>()) {}
+  Router() : routes_(std::make_shared<Routes>()) {}
 
+  // 链式注册每次都会重建整个路由表；大量路由请使用 RouterBuilder
   [[nodiscard]] Router route(parser::Method method, std::string_view pattern,
                              Handler handler) const {
-    auto new_routes = std::make_shared<RouteTable>(*routes_);
+    return add_route(method, pattern, std::move(handler));
+  }
 
-    RouteKey key{method, std::string(pattern)};
-    (*new_routes)[key] = {PathPattern(pattern), std::move(handler)};
+  [[nodiscard]] Router route(parser::Method method, std::string_view pattern,
+                             ViewHandler handler) const {
+    return add_route(method, pattern, std::move(handler));
+  }
 
-    Router new_router;
-    new_router.routes_ = new_routes;
-    return new_router;
+  [[nodiscard]] Router route(parser::Method method, std::string_view pattern,
+                             AsyncHandler handler) const {
+    return add_route(method, pattern, std::move(handler));
   }
 
-  [[nodiscard]] Router get(std::string_view pattern, Handler handler) const {
+  [[nodiscard]] Router route(parser::Method method, std::string_view pattern,
+                             StreamHandler handler) const {
+    return add_route(method, pattern, std::move(handler));
+  }
+
+  template <typename H>
+  [[nodiscard]] Router get(std::string_view pattern, H handler) const {
     return route(parser::Method::Get, pattern, std::move(handler));
   }
 
-  [[nodiscard]] Router post(std::string_view pattern, Handler handler) const {
+  template <typename H>
+  [[nodiscard]] Router post(std::string_view pattern, H handler) const {
     return route(parser::Method::Post, pattern, std::move(handler));
   }
 
-  [[nodiscard]] Router put(std::string_view pattern, Handler handler) const {
+  template <typename H>
+  [[nodiscard]] Router put(std::string_view pattern, H handler) const {
     return route(parser::Method::Put, pattern, std::move(handler));
   }
 
-  [[nodiscard]] Router delete_(std::string_view pattern, Handler handler) const {
+  template <typename H>
+  [[nodiscard]] Router delete_(std::string_view pattern, H handler) const {
     return route(parser::Method::Delete, pattern, std::move(handler));
   }
 
+  // 在 registry 中记录路由匹配耗时（http_route_match_duration_seconds）和每条路由的
+  // handler 耗时（http_handler_duration_seconds{method,route}）。之后在这个路由表上继续
+  // 添加的路由同样被记录；registry 必须比路由表活得长
+  [[nodiscard]] Router instrument(metrics::Registry &registry) const;
+
+  [[nodiscard]] const std::vector<RouteDefinition> &definitions() const {
+    return routes_->definitions;
+  }
+
+  [[nodiscard]] metrics::Registry *registry() const { return routes_->registry; }
+
+  // 只匹配 URI 的路径部分，查询串不参与路由
+  [[nodiscard]] std::optional<RouteMatch> find(parser::Method method,
+                                               std::string_view uri) const {
+    const auto path = uri.substr(0, uri.find('?'));
+    const auto &tree = routes_->trees[static_cast<size_t>(method)];
+    const int64_t start = routes_->match_time != nullptr ? metrics::now_ns() : 0;
+
+    RouteMatch match;
+    const Route *route = tree.find(path, match.params);
+    if (routes_->match_time != nullptr) {
+      routes_->match_time->observe_since(start);
+    }
+    if (route == nullptr) {
+      return std::nullopt;
+    }
+    match.handler = &route->handler;
+    match.duration = route->duration;
+    return match;
+  }
+
   [[nodiscard]] std::optional<RouteMatch> find(const parser::HttpRequest &req) const {
-    for (const auto &[key, value] : *routes_) {
-      const auto &[method, _] = key;
-      const auto &[pattern, handler] = value;
+    return find(req.request_line.method, req.request_line.uri);
+  }
+
+  // 同步处理；协程 handler 在调用线程上 sync_wait，服务器内部使用 respond()
+  HttpResponse handle(const parser::HttpRequest &req) const {
+    const auto match = find(req);
+    auto invoke = [&](const auto &h) -> HttpResponse {
+      using H = std::decay_t<decltype(h)>;
+      if constexpr (std::is_same_v<H, Handler>) {
+        return h(req);
+      } else if constexpr (std::is_same_v<H, ViewHandler>) {
+        std::vector<parser::HeaderView> storage;
+        return h(parser::HttpRequestView::of(req, storage));
+      } else if constexpr (std::is_same_v<H, StreamHandler>) {
+        std::vector<parser::HeaderView> storage;
+        return read_whole_body(h, parser::HttpRequestView::of(req, storage));
+      } else {
+        return threadpool::coro::sync_wait(run_async(h, req, match->duration));
+      }
+    };
+    return dispatch<HttpResponse>(match, [&](const RouteHandler &handler) {
+      return std::visit(invoke, handler);
+    });
+  }
 
-      if (method != req.request_line.method) {
-        continue;
+  HttpResponse handle(const parser::HttpRequestView &req) const {
+    auto reply = respond(req);
+    if (auto *pending = std::get_if<PendingResponse>(&reply)) {
+      try {
+        return threadpool::coro::sync_wait(std::move(*pending));
+      } catch (const std::exception &e) {
+        return handler_error(e.what());
       }
+    }
+    return std::get<HttpResponse>(std::move(reply));
+  }
 
-      if (auto params = pattern.match(req.request_line.uri)) {
-        return RouteMatch{handler, *params};
+  // 同步 handler 直接得到响应；协程 handler 返回尚未启动的 PendingResponse，
+  // 由调用方决定在哪里运行。协程内部抛出的异常在 co_await 时重新抛出
+  std::variant<HttpResponse, PendingResponse> respond(const parser::HttpRequestView &req) const {
+    using Reply = std::variant<HttpResponse, PendingResponse>;
+    const auto match = find(req.request_line.method, req.request_line.uri);
+    auto invoke = [&](const auto &h) -> Reply {
+      using H = std::decay_t<decltype(h)>;
+      if constexpr (std::is_same_v<H, ViewHandler>) {
+        return h(req);
+      } else if constexpr (std::is_same_v<H, Handler>) {
+        // 同步 handler 返回前请求就销毁了，可以放进服务器提供的请求内存池
+        return h(req.to_request(req.arena ? req.arena : std::pmr::get_default_resource()));
+      } else if constexpr (std::is_same_v<H, StreamHandler>) {
+        return read_whole_body(h, req);
+      } else {
+        // 协程帧比这次调用活得长，只能用堆
+        return run_async(h, req.to_request(), match->duration);
       }
+    };
+    return dispatch<Reply>(match, [&](const RouteHandler &handler) {
+      return std::visit(invoke, handler);
+    });
+  }
+
+  // 请求头到达时调用：路由是流式 handler 时返回它的 BodyReader，否则返回 nullopt。
+  // handler 抛出的异常原样传出
+  std::optional<BodyReader> body_reader(const parser::HttpRequestView &req) const {
+    auto match = find(req.request_line.method, req.request_line.uri);
+    if (!match) {
+      return std::nullopt;
+    }
+    if (const auto *h = std::get_if<StreamHandler>(match->handler)) {
+      return (*h)(req);
     }
     return std::nullopt;
   }
 
-  HttpResponse handle(const parser::HttpRequest &req) const {
-    auto match = find(req);
+  // handler 抛出异常时返回的 500 响应
+  static HttpResponse handler_error(std::string_view what) {
+    return HttpResponse::internal_server_error().with_text("Handler error: " + std::string(what));
+  }
 
+private:
+  // 协程 lambda 的捕获存放在闭包对象里而不在协程帧里，而路由表可能在协程挂起期间被替换，
+  // 所以由外层协程帧持有一份 handler，直到协程结束。duration 记录从开始运行到完成的时间，
+  // 直方图属于 registry，不随路由表释放
+  static PendingResponse run_async(AsyncHandler handler, parser::HttpRequest req,
+                                   metrics::Histogram *duration) {
+    const int64_t start = duration != nullptr ? metrics::now_ns() : 0;
+    auto response = co_await handler(std::move(req));
+    if (duration != nullptr) {
+      duration->observe_since(start);
+    }
+    co_return response;
+  }
+
+  // body 已经完整缓存时，一次交给流式 handler
+  static HttpResponse read_whole_body(const StreamHandler &handler,
+                                      const parser::HttpRequestView &req) {
+    auto reader = handler(req);
+    if (!req.body.empty()) {
+      reader.on_data(std::string_view(reinterpret_cast<const char *>(req.body.data()),
+                                      req.body.size()));
+    }
+    return reader.finish();
+  }
+
+  [[nodiscard]] Router add_route(parser::Method method, std::string_view pattern,
+                                 RouteHandler handler) const;
+
+  // 同步 handler 的耗时在这里记录；协程 handler 此时只是创建了 PendingResponse，由 run_async 记录
+  template <typename R, typename F>
+  static R dispatch(const std::optional<RouteMatch> &match, F &&invoke) {
     if (!match) {
       return HttpResponse::not_found().with_text("Route not found");
     }
+    const bool timed = match->duration != nullptr &&
+                       !std::holds_alternative<AsyncHandler>(*match->handler);
+    const int64_t start = timed ? metrics::now_ns() : 0;
+    struct Observe {
+      metrics::Histogram *histogram;
+      int64_t start;
+      ~Observe() {
+        if (histogram != nullptr) {
+          histogram->observe_since(start);
+        }
+      }
+    } observe{timed ? match->duration : nullptr, start};
     try {
-      return match->handler(req);
+      return invoke(*match->handler);
     } catch (const std::exception &e) {
-      return HttpResponse::internal_server_error().with_text(
-          std::string("Handler error: ") + e.what());
+      return handler_error(e.what());
     }
   }
 };
+
+// 可变的路由收集器：注册只追加定义，build() 一次性生成冻结的匹配结构，
+// 注册 N 条路由的总开销为 O(N)。同一方法下形状相同的模式以最后注册的为准
+class RouterBuilder {
+  std::vector<RouteDefinition> definitions_;
+  metrics::Registry *registry_ = nullptr;
+
+public:
+  RouterBuilder() = default;
+
+  // 以已有路由表为基础继续添加，沿用它的指标设置
+  explicit RouterBuilder(const Router &base)
+      : definitions_(base.definitions()), registry_(base.registry()) {}
+
+  // 见 Router::instrument()
+  RouterBuilder &instrument(metrics::Registry &registry) {
+    registry_ = &registry;
+    return *this;
+  }
+
+  RouterBuilder &route(parser::Method method, std::string_view pattern, Handler handler) {
+    definitions_.push_back({method, std::string(pattern), std::move(handler)});
+    return *this;
+  }
+
+  RouterBuilder &route(parser::Method method, std::string_view pattern, ViewHandler handler) {
+    definitions_.push_back({method, std::string(pattern), std::move(handler)});
+    return *this;
+  }
+
+  RouterBuilder &route(parser::Method method, std::string_view pattern, AsyncHandler handler) {
+    definitions_.push_back({method, std::string(pattern), std::move(handler)});
+    return *this;
+  }
+
+  RouterBuilder &route(parser::Method method, std::string_view pattern, StreamHandler handler) {
+    definitions_.push_back({method, std::string(pattern), std::move(handler)});
+    return *this;
+  }
+
+  template <typename H> RouterBuilder &get(std::string_view pattern, H handler) {
+    return route(parser::Method::Get, pattern, std::move(handler));
+  }
+
+  template <typename H> RouterBuilder &post(std::string_view pattern, H handler) {
+    return route(parser::Method::Post, pattern, std::move(handler));
+  }
+
+  template <typename H> RouterBuilder &put(std::string_view pattern, H handler) {
+    return route(parser::Method::Put, pattern, std::move(handler));
+  }
+
+  template <typename H> RouterBuilder &delete_(std::string_view pattern, H handler) {
+    return route(parser::Method::Delete, pattern, std::move(handler));
+  }
+
+  [[nodiscard]] size_t size() const { return definitions_.size(); }
+
+  // 模式非法时抛出 std::invalid_argument
+  [[nodiscard]] Router build() const & { return build(std::vector(definitions_), registry_); }
+
+  [[nodiscard]] Router build() && { return build(std::move(definitions_), registry_); }
+
+private:
+  static Router build(std::vector<RouteDefinition> definitions, metrics::Registry *registry) {
+    std::array<RadixTree<Router::Route>, Router::kMethodCount> trees;
+    for (const auto &def : definitions) {
+      metrics::Histogram *duration = nullptr;
+      if (registry != nullptr) {
+        duration = &registry->histogram("http_handler_duration_seconds",
+                                        "Time spent in route handlers",
+                                        {{"method", parser::method_name(def.method)},
+                                         {"route", def.pattern}});
+      }
+      trees[static_cast<size_t>(def.method)].insert(def.pattern, {def.handler, duration});
+    }
+
+    auto routes = std::make_shared<Router::Routes>();
+    routes->definitions = std::move(definitions);
+    routes->registry = registry;
+    if (registry != nullptr) {
+      routes->match_time = &registry->histogram("http_route_match_duration_seconds",
+                                                "Time spent matching request paths to routes");
+    }
+    for (size_t i = 0; i < trees.size(); ++i) {
+      routes->trees[i] = std::move(trees[i]).freeze();
+    }
+    return Router(std::move(routes));
+  }
+};
+
+inline Router Router::add_route(parser::Method method, std::string_view pattern,
+                                RouteHandler handler) const {
+  RouterBuilder builder(*this);
+  std::visit([&](auto &&h) { builder.route(method, pattern, std::move(h)); }, handler);
+  return std::move(builder).build();
+}
+
+inline Router Router::instrument(metrics::Registry &registry) const {
+  RouterBuilder builder(*this);
+  builder.instrument(registry);
+  return std::move(builder).build();
+}
+
+// 以 Prometheus 文本格式返回 registry 中的全部指标，例如 router.get("/metrics", metrics_handler(registry))
+inline ViewHandler metrics_handler(const metrics::Registry &registry) {
+  return [&registry](const parser::HttpRequestView &) {
+    auto response = HttpResponse::ok().with_text(registry.expose());
+    response.headers["Content-Type"] = "text/plain; version=0.0.4; charset=utf-8";
+    return response;
+  };
+}
+
+// 运行时可原子替换的路由表句柄。每个请求取一份快照处理，
+// store() 不会阻塞正在处理的请求，旧快照在最后一个使用者结束后释放
+class RouterHandle {
+  std::atomic<std::shared_ptr<const Router>> current_;
+  // 每次 store 后递增，供 RouterSnapshot 判断是否需要重新 load
+  std::atomic<uint64_t> version_{0};
+
+public:
+  explicit RouterHandle(Router router = {})
+      : current_(std::make_shared<const Router>(std::move(router))) {}
+
+  RouterHandle(const RouterHandle &) = delete;
+  RouterHandle &operator=(const RouterHandle &) = delete;
+
+  [[nodiscard]] std::shared_ptr<const Router> load() const {
+    return current_.load(std::memory_order_acquire);
+  }
+
+  void store(Router router) {
+    current_.store(std::make_shared<const Router>(std::move(router)), std::memory_order_release);
+    version_.fetch_add(1, std::memory_order_release);
+  }
+
+  [[nodiscard]] uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+  HttpResponse handle(const parser::HttpRequest &req) const { return load()->handle(req); }
+
+  HttpResponse handle(const parser::HttpRequestView &req) const { return load()->handle(req); }
+
+  std::variant<HttpResponse, PendingResponse> respond(const parser::HttpRequestView &req) const {
+    return load()->respond(req);
+  }
+};
+
+// 单线程持有的路由快照：只在 RouterHandle 的版本号变化后才重新 load。
+// load() 每次都要修改共享的引用计数，多个 reactor 同时调用时这条缓存行会在核间来回迁移；
+// 这里平时只读一个几乎不变的版本号。返回的引用在下一次 get() 之前有效
+class RouterSnapshot {
+  const RouterHandle &handle_;
+  uint64_t version_;
+  std::shared_ptr<const Router> router_;
+
+public:
+  explicit RouterSnapshot(const RouterHandle &handle)
+      : handle_(handle), version_(handle.version()), router_(handle.load()) {}
+
+  [[nodiscard]] const Router &get() {
+    if (const auto version = handle_.version(); version != version_) {
+      router_ = handle_.load();
+      version_ = version;
+    }
+    return *router_;
+  }
+};
+
 } // namespace http::router
@@ -0,0 +1,520 @@
+#pragma once
+#include "compression.hpp"
+#include "types.hpp"
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/inotify.h>
+#include <unordered_map>
+
+namespace http::router {
+
+struct StaticFileOptions {
+  std::string url_prefix = "";              // 映射到 root 之前从 URI 路径去掉的前缀，例如 "/static"
+  std::string index_file = "index.html";    // 以 / 结尾的路径
+  size_t max_cache_bytes = 64 * 1024 * 1024; // 缓存在内存里的文件内容总量
+  size_t max_entries = 4096;
+  size_t max_inline_size = 64 * 1024; // 更大的文件只缓存描述符，发送时走 sendfile
+  // 可压缩类型的文件按 Accept-Encoding 协商出的编码各压缩一次，压缩结果与文件一起缓存。
+  // 只压缩一次，所以默认用比动态压缩更高的级别
+  bool precompress = true;
+  CompressionOptions compression = {.min_size = 1024, .gzip_level = 9, .brotli_quality = 9};
+  size_t max_compress_size = 8 * 1024 * 1024;
+};
+
+// RFC 9110 §5.6.7 的 IMF-fixdate，例如 "Sun, 06 Nov 1994 08:49:37 GMT"
+inline std::string format_http_date(std::time_t t) {
+  std::tm tm{};
+  ::gmtime_r(&t, &tm);
+  char buf[32];
+  const auto n = std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  return std::string(buf, n);
+}
+
+inline std::optional<std::time_t> parse_http_date(std::string_view value) {
+  std::tm tm{};
+  const std::string text(value);
+  const char *end = ::strptime(text.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  if (end == nullptr || *end != '\0') {
+    return std::nullopt;
+  }
+  return ::timegm(&tm);
+}
+
+// 静态文件的热点缓存。每个条目预先算好 Content-Type、ETag、Last-Modified 等 header：
+// 小文件内容放在内存里，大文件只保留打开的描述符，由服务器用 sendfile 发送。
+// 命中与条件请求（304）都不访问磁盘；文件变化通过 inotify 通知，在下一次请求时失效对应条目。
+// inotify 不可用时每次命中都 stat 一次校验。读文件和 gzip/br 压缩都在锁外进行，压缩版本
+// 在第一次被请求时生成，之后直接从缓存发送。命中时响应与缓存共享 body，不复制内容。线程安全
+class StaticFileCache {
+  using Bytes = std::shared_ptr<const std::vector<uint8_t>>;
+
+  struct Entry {
+    std::string path;
+    ResponseHeaders headers;                 // 200 响应的 header，Content-Type 除外
+    const StaticHeaders *type = nullptr;     // Content-Type，按类型驻留
+    std::string etag;
+    std::time_t mtime = 0;
+    size_t size = 0;
+    Bytes body;                              // 小文件的内容
+    std::shared_ptr<const FileBody> file;    // 大文件的描述符
+    bool compressible = false;               // 是否提供 gzip/br 版本
+    // gzip 与 br 版本，按需生成；nullptr 表示尚未生成，空 vector 表示压缩后没有变小，只发送原文件
+    std::array<Bytes, 2> encoded = {};
+
+    [[nodiscard]] size_t memory_size() const {
+      size_t bytes = body ? body->size() : 0;
+      for (const auto &variant : encoded) {
+        bytes += variant ? variant->size() : 0;
+      }
+      return bytes;
+    }
+  };
+  using Lru = std::list<Entry>;
+
+  std::filesystem::path root_;
+  StaticFileOptions options_;
+
+  std::mutex mutex_;
+  Lru lru_; // 最近使用的在前
+  std::unordered_map<std::string, Lru::iterator> index_;
+  size_t cached_bytes_ = 0;
+  uint64_t generation_ = 0; // 每收到一批 inotify 事件加一，锁外读到的文件据此判断是否过时
+
+  int inotify_fd_;
+  std::unordered_map<int, std::string> watched_dirs_; // watch 描述符 → 目录
+
+public:
+  explicit StaticFileCache(std::filesystem::path root, StaticFileOptions options = {})
+      : root_(std::move(root)), options_(std::move(options)),
+        inotify_fd_(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+
+  StaticFileCache(const StaticFileCache &) = delete;
+  StaticFileCache &operator=(const StaticFileCache &) = delete;
+
+  ~StaticFileCache() {
+    if (inotify_fd_ >= 0) {
+      ::close(inotify_fd_);
+    }
+  }
+
+  // 只处理 GET/HEAD；路径不在 url_prefix 下、包含 ".."、或文件不存在时返回 nullopt
+  std::optional<HttpResponse> serve(const parser::HttpRequest &req) {
+    const auto method = req.request_line.method;
+    if (method != parser::Method::Get && method != parser::Method::Head) {
+      return std::nullopt;
+    }
+    auto path = resolve(req.request_line.uri);
+    if (!path) {
+      return std::nullopt;
+    }
+
+    const auto coding = options_.precompress
+                            ? negotiate_coding(req.header(parser::HeaderId::AcceptEncoding))
+                            : ContentCoding::Identity;
+
+    // inotify 不可用时命中要校验文件是否变化，stat 放在锁外
+    struct stat st{};
+    const bool checked = inotify_fd_ < 0;
+    if (checked && ::stat(path->c_str(), &st) != 0) {
+      return std::nullopt;
+    }
+
+    Entry entry;
+    uint64_t generation = 0;
+    {
+      std::lock_guard lock(mutex_);
+      drain_events();
+      if (const Entry *cached = find(*path, checked ? &st : nullptr)) {
+        if (!needs_encoding(*cached, coding)) {
+          return respond(*cached, coding, method, req);
+        }
+        entry = *cached; // body 共享，只复制几个 header
+      }
+      generation = generation_;
+    }
+
+    // 读文件与压缩都可能耗时较长，在锁外进行；同时到达的几个请求可能各做一次，只保留第一份
+    const bool fresh = entry.path.empty();
+    if (fresh) {
+      auto read = read_file(*path);
+      if (!read) {
+        return std::nullopt;
+      }
+      entry = std::move(*read);
+    }
+    if (needs_encoding(entry, coding)) {
+      entry.encoded[slot_of(coding)] = encode(entry, coding);
+    }
+
+    std::lock_guard lock(mutex_);
+    drain_events();
+    if (auto it = index_.find(*path); it != index_.end() && it->second->etag == entry.etag) {
+      auto &cached = *it->second;
+      for (size_t i = 0; i < cached.encoded.size(); ++i) {
+        if (!cached.encoded[i] && entry.encoded[i]) {
+          cached.encoded[i] = std::move(entry.encoded[i]);
+          cached_bytes_ += cached.encoded[i]->size();
+        }
+      }
+      auto response = respond(cached, coding, method, req);
+      trim();
+      return response;
+    }
+    auto response = respond(entry, coding, method, req);
+    // 读取之后收到过 inotify 事件时不缓存：内容可能已经过时
+    if (fresh && generation == generation_) {
+      insert(std::move(entry));
+    }
+    return response;
+  }
+
+  [[nodiscard]] size_t cached_entries() {
+    std::lock_guard lock(mutex_);
+    return index_.size();
+  }
+
+  [[nodiscard]] size_t cached_bytes() {
+    std::lock_guard lock(mutex_);
+    return cached_bytes_;
+  }
+
+private:
+  std::optional<std::string> resolve(std::string_view uri) const {
+    auto path = percent_decode(uri.substr(0, uri.find('?')));
+    if (!path || !path->starts_with(options_.url_prefix)) {
+      return std::nullopt;
+    }
+    path->erase(0, options_.url_prefix.size());
+    if (path->empty() || path->back() == '/') {
+      *path += options_.index_file;
+    }
+    std::filesystem::path relative;
+    for (auto rest = std::string_view(*path); !rest.empty();) {
+      const auto slash = std::min(rest.find('/'), rest.size());
+      const auto segment = rest.substr(0, slash);
+      rest.remove_prefix(std::min(slash + 1, rest.size()));
+      if (segment == "..") {
+        return std::nullopt;
+      }
+      if (!segment.empty() && segment != ".") {
+        relative /= segment;
+      }
+    }
+    if (relative.empty()) {
+      return std::nullopt;
+    }
+    return (root_ / relative).string();
+  }
+
+  static std::optional<std::string> percent_decode(std::string_view in) {
+    const auto hex = [](char c) {
+      return c >= '0' && c <= '9' ? c - '0'
+             : c >= 'a' && c <= 'f' ? c - 'a' + 10
+             : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                    : -1;
+    };
+    std::string out;
+    out.reserve(in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+      if (in[i] != '%') {
+        out += in[i];
+        continue;
+      }
+      const int hi = i + 2 < in.size() ? hex(in[i + 1]) : -1;
+      const int lo = hi >= 0 ? hex(in[i + 2]) : -1;
+      if (lo < 0 || (hi == 0 && lo == 0)) {
+        return std::nullopt;
+      }
+      out += static_cast<char>(hi * 16 + lo);
+      i += 2;
+    }
+    return out;
+  }
+
+  static size_t slot_of(ContentCoding coding) { return coding == ContentCoding::Gzip ? 0 : 1; }
+
+  static bool needs_encoding(const Entry &entry, ContentCoding coding) {
+    return entry.compressible && coding != ContentCoding::Identity &&
+           !entry.encoded[slot_of(coding)];
+  }
+
+  // 文件的压缩版本；coding 为 identity、尚未生成或压缩无效时返回 nullptr
+  static Bytes variant_of(const Entry &entry, ContentCoding coding) {
+    if (!entry.compressible || coding == ContentCoding::Identity) {
+      return nullptr;
+    }
+    const auto &variant = entry.encoded[slot_of(coding)];
+    return variant && !variant->empty() ? variant : nullptr;
+  }
+
+  // 总是返回非空指针，压缩失败或没有变小时指向空 vector
+  Bytes encode(const Entry &entry, ContentCoding coding) const {
+    std::vector<uint8_t> contents;
+    if (entry.file && !entry.file->read_all(contents)) {
+      return std::make_shared<const std::vector<uint8_t>>();
+    }
+    const std::span<const uint8_t> input = entry.file ? contents : *entry.body;
+    auto encoded = Compressor::local().encode(coding, input, options_.compression);
+    if (!encoded || encoded->size() >= input.size()) {
+      return std::make_shared<const std::vector<uint8_t>>();
+    }
+    return std::make_shared<const std::vector<uint8_t>>(std::move(*encoded));
+  }
+
+  static HttpResponse respond(const Entry &entry, ContentCoding coding, parser::Method method,
+                              const parser::HttpRequest &req) {
+    const auto variant = variant_of(entry, coding);
+    const auto etag = variant ? coded_etag(entry.etag, coding) : entry.etag;
+    const size_t size = variant ? variant->size() : entry.size;
+    if (not_modified(entry, etag, req)) {
+      HttpResponse response{304, "Not Modified", {}, {}};
+      response.headers = {{"ETag", etag},
+                          {"Last-Modified", entry.headers.at("Last-Modified")},
+                          {"Content-Length", std::to_string(size)}};
+      if (entry.compressible) {
+        response.headers["Vary"] = "Accept-Encoding";
+      }
+      return response;
+    }
+    auto response = HttpResponse{200, "OK", entry.headers, {}}.with_static_headers(*entry.type);
+    if (variant) {
+      response.headers["ETag"] = etag;
+      response.headers["Content-Encoding"] = coding_name(coding);
+    }
+    if (method == parser::Method::Head) {
+      response.headers["Content-Length"] = std::to_string(size);
+    } else if (variant) {
+      response.shared_body = variant;
+    } else if (entry.file) {
+      response.file = entry.file;
+    } else {
+      response.shared_body = entry.body;
+    }
+    return response;
+  }
+
+  static bool not_modified(const Entry &entry, std::string_view etag,
+                           const parser::HttpRequest &req) {
+    // RFC 9110 §13.1.2：同时出现时 If-None-Match 优先
+    if (auto tags = req.header(parser::HeaderId::IfNoneMatch)) {
+      return parser::has_token(*tags, etag) || parser::has_token(*tags, "*");
+    }
+    if (auto since = req.header(parser::HeaderId::IfModifiedSince)) {
+      auto time = parse_http_date(*since);
+      return time && entry.mtime <= *time;
+    }
+    return false;
+  }
+
+  // st 不为空时是调用方刚取得的文件状态，与条目不一致说明文件已经变化
+  const Entry *find(const std::string &path, const struct stat *st) {
+    auto it = index_.find(path);
+    if (it == index_.end()) {
+      return nullptr;
+    }
+    if (st != nullptr && (st->st_mtime != it->second->mtime ||
+                          static_cast<size_t>(st->st_size) != it->second->size)) {
+      erase(it->second);
+      return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return &*it->second;
+  }
+
+  // 在锁外调用，只有注册 inotify 监听时短暂持锁
+  std::optional<Entry> read_file(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return std::nullopt;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      ::close(fd);
+      return std::nullopt;
+    }
+    // 先注册监听再读内容：读取期间发生的修改会让 serve() 放弃缓存这次读到的内容
+    {
+      std::lock_guard lock(mutex_);
+      watch_parent(path);
+    }
+
+    Entry entry;
+    entry.path = path;
+    entry.etag = make_etag(st);
+    entry.mtime = st.st_mtime;
+    entry.size = static_cast<size_t>(st.st_size);
+    const auto type = content_type(path);
+    entry.type = &StaticHeaders::intern({{"Content-Type", type}});
+    entry.compressible = options_.precompress && compressible_type(type) &&
+                         entry.size >= options_.compression.min_size &&
+                         entry.size <= options_.max_compress_size;
+    if (entry.size <= options_.max_inline_size) {
+      std::vector<uint8_t> contents(entry.size);
+      size_t done = 0;
+      while (done < entry.size) {
+        const auto n = ::pread(fd, contents.data() + done, entry.size - done,
+                               static_cast<off_t>(done));
+        if (n <= 0) {
+          break;
+        }
+        done += static_cast<size_t>(n);
+      }
+      ::close(fd);
+      if (done != entry.size) {
+        return std::nullopt;
+      }
+      entry.body = std::make_shared<const std::vector<uint8_t>>(std::move(contents));
+    } else {
+      entry.file = std::make_shared<const FileBody>(fd, entry.size);
+    }
+    entry.headers = {{"ETag", entry.etag},
+                     {"Last-Modified", format_http_date(entry.mtime)}};
+    if (entry.compressible) {
+      entry.headers["Vary"] = "Accept-Encoding";
+    }
+    return entry;
+  }
+
+  // 超出预算的单个文件也照常返回，只是插入后立即被淘汰
+  void insert(Entry entry) {
+    if (auto it = index_.find(entry.path); it != index_.end()) {
+      erase(it->second);
+    }
+    cached_bytes_ += entry.memory_size();
+    lru_.push_front(std::move(entry));
+    index_[lru_.front().path] = lru_.begin();
+    trim();
+  }
+
+  void trim() {
+    while (cached_bytes_ > options_.max_cache_bytes || index_.size() > options_.max_entries) {
+      erase(std::prev(lru_.end()));
+    }
+  }
+
+  void erase(Lru::iterator it) {
+    cached_bytes_ -= it->memory_size();
+    index_.erase(it->path);
+    lru_.erase(it);
+  }
+
+  void watch_parent(const std::string &path) {
+    if (inotify_fd_ < 0) {
+      return;
+    }
+    const auto dir = std::filesystem::path(path).parent_path().string();
+    const int wd = ::inotify_add_watch(inotify_fd_, dir.c_str(),
+                                       IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE |
+                                           IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF |
+                                           IN_MOVE_SELF);
+    if (wd >= 0) {
+      watched_dirs_[wd] = dir;
+    }
+  }
+
+  // 非阻塞地读出所有已到达的 inotify 事件并失效对应条目
+  void drain_events() {
+    if (inotify_fd_ < 0) {
+      return;
+    }
+    alignas(inotify_event) char buf[4096];
+    while (true) {
+      const auto n = ::read(inotify_fd_, buf, sizeof(buf));
+      if (n <= 0) {
+        return;
+      }
+      ++generation_;
+      for (ssize_t offset = 0; offset < n;) {
+        const auto *event = reinterpret_cast<const inotify_event *>(buf + offset);
+        offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        if (event->mask & IN_Q_OVERFLOW) {
+          clear();
+          continue;
+        }
+        auto dir = watched_dirs_.find(event->wd);
+        if (dir == watched_dirs_.end()) {
+          continue;
+        }
+        if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+          erase_under(dir->second);
+          if (event->mask & IN_IGNORED) {
+            watched_dirs_.erase(dir);
+          }
+          continue;
+        }
+        if (event->len > 0) {
+          if (auto it = index_.find(dir->second + '/' + event->name); it != index_.end()) {
+            erase(it->second);
+          }
+        }
+      }
+    }
+  }
+
+  void erase_under(const std::string &dir) {
+    for (auto it = lru_.begin(); it != lru_.end();) {
+      auto next = std::next(it);
+      if (std::filesystem::path(it->path).parent_path() == dir) {
+        erase(it);
+      }
+      it = next;
+    }
+  }
+
+  void clear() {
+    lru_.clear();
+    index_.clear();
+    cached_bytes_ = 0;
+  }
+
+  static std::string make_etag(const struct stat &st) {
+    char buf[64];
+    const int n = std::snprintf(buf, sizeof(buf), "\"%lx-%lx%09lx\"",
+                                static_cast<unsigned long>(st.st_size),
+                                static_cast<unsigned long>(st.st_mtim.tv_sec),
+                                static_cast<unsigned long>(st.st_mtim.tv_nsec));
+    return std::string(buf, static_cast<size_t>(n));
+  }
+
+  static std::string_view content_type(std::string_view path) {
+    static constexpr std::pair<std::string_view, std::string_view> kTypes[] = {
+        {".html", "text/html; charset=utf-8"},
+        {".htm", "text/html; charset=utf-8"},
+        {".css", "text/css; charset=utf-8"},
+        {".js", "text/javascript; charset=utf-8"},
+        {".mjs", "text/javascript; charset=utf-8"},
+        {".json", "application/json"},
+        {".map", "application/json"},
+        {".txt", "text/plain; charset=utf-8"},
+        {".xml", "application/xml"},
+        {".svg", "image/svg+xml"},
+        {".png", "image/png"},
+        {".jpg", "image/jpeg"},
+        {".jpeg", "image/jpeg"},
+        {".gif", "image/gif"},
+        {".webp", "image/webp"},
+        {".ico", "image/x-icon"},
+        {".wasm", "application/wasm"},
+        {".woff", "font/woff"},
+        {".woff2", "font/woff2"},
+        {".pdf", "application/pdf"},
+    };
+    for (const auto &[ext, type] : kTypes) {
+      if (path.ends_with(ext)) {
+        return type;
+      }
+    }
+    return "application/octet-stream";
+  }
+};
+
+} // namespace http::router
@@ -1,20 +1,146 @@
 #pragma once
+#include "../metrics/metrics.hpp"
 #include "../parser/types.hpp"
+#include "../threadpool/coro.hpp"
+#include <algorithm>
+#include <array>
 #include <expected>
+#include <fcntl.h>
 #include <functional>
-#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
 #include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <variant>
 #include <vector>
 
 namespace http::router {
 
+// 流式响应体：每次调用向 out 追加下一段数据，返回 false 表示这是最后一段。
+// 连接在写缓冲排空后才拉取下一段，内存占用与响应总大小无关；在 loop 线程上调用，不应阻塞
+using BodySource = std::function<bool(std::string &out)>;
+
+// 来自文件的响应体：服务器用 sendfile 把页缓存直接写入套接字，数据不经过用户态。
+// 响应的副本共享同一个描述符；sendfile 使用显式偏移，不修改文件位置
+class FileBody {
+  int fd_;
+  size_t size_;
+
+public:
+  FileBody(int fd, size_t size) : fd_(fd), size_(size) {}
+  FileBody(const FileBody &) = delete;
+  FileBody &operator=(const FileBody &) = delete;
+  ~FileBody() { ::close(fd_); }
+
+  // 只接受普通文件，打开失败或不是普通文件时返回 nullptr
+  static std::shared_ptr<const FileBody> open(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return nullptr;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      ::close(fd);
+      return nullptr;
+    }
+    return std::make_shared<const FileBody>(fd, static_cast<size_t>(st.st_size));
+  }
+
+  [[nodiscard]] int fd() const { return fd_; }
+  [[nodiscard]] size_t size() const { return size_; }
+
+  // 把整个文件读进 out，只用于需要内容本身的场合（例如压缩）；发送时应走 sendfile
+  [[nodiscard]] bool read_all(std::vector<uint8_t> &out) const {
+    out.resize(size_);
+    size_t done = 0;
+    while (done < size_) {
+      const auto n = ::pread(fd_, out.data() + done, size_ - done, static_cast<off_t>(done));
+      if (n <= 0) {
+        return false;
+      }
+      done += static_cast<size_t>(n);
+    }
+    return true;
+  }
+};
+
+// 支持用 string_view / 字面量直接查找，contains("Content-Encoding") 不必先构造 std::string
+struct HeaderNameHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+};
+using ResponseHeaders =
+    std::unordered_map<std::string, std::string, HeaderNameHash, std::equal_to<>>;
+
+// 响应头名称大小写不敏感：handler 可能写成 "content-length"，先按原样查再逐个比较
+inline bool has_header(const ResponseHeaders &headers, std::string_view name) {
+  if (headers.contains(name)) {
+    return true;
+  }
+  return std::ranges::any_of(headers,
+                             [&](const auto &field) { return parser::iequals(field.first, name); });
+}
+
+// 预先渲染好的一组响应头，文本为 "Name: value\r\n..."。intern() 按内容去重并且永不释放，
+// 响应里只保存指针：加上一组静态头不分配、不复制字符串，缓存的响应也不会悬空。
+// 不要放 Content-Length、Connection 这类决定报文定界的头，它们只从 headers 里识别
+class StaticHeaders {
+  std::string text_;
+  std::vector<std::pair<std::string, std::string>> fields_;
+
+  StaticHeaders() = default;
+
+public:
+  using Field = std::pair<std::string_view, std::string_view>;
+
+  static const StaticHeaders &intern(std::initializer_list<Field> fields) {
+    StaticHeaders headers;
+    for (const auto &[name, value] : fields) {
+      headers.fields_.emplace_back(name, value);
+      headers.text_.append(name).append(": ").append(value).append("\r\n");
+    }
+    static std::mutex mutex;
+    static auto *table = new std::unordered_map<std::string, std::unique_ptr<StaticHeaders>>;
+    std::lock_guard lock(mutex);
+    auto &slot = (*table)[headers.text_];
+    if (!slot) {
+      slot.reset(new StaticHeaders(std::move(headers)));
+    }
+    return *slot;
+  }
+
+  [[nodiscard]] std::string_view text() const { return text_; }
+  [[nodiscard]] const std::vector<std::pair<std::string, std::string>> &fields() const {
+    return fields_;
+  }
+
+  [[nodiscard]] std::optional<std::string_view> find(std::string_view name) const {
+    for (const auto &[key, value] : fields_) {
+      if (key == name) {
+        return value;
+      }
+    }
+    return std::nullopt;
+  }
+};
+
 struct HttpResponse {
   int status_code;
   std::string status_text;
-  std::unordered_map<std::string, std::string> headers;
+  ResponseHeaders headers;
   std::vector<uint8_t> body;
+  BodySource stream = nullptr; // 设置后取代 body
+  std::shared_ptr<const FileBody> file = nullptr; // 设置后取代 body
+  // 设置后取代 body：多个响应共享同一份不可变的内容，例如缓存里的小文件
+  std::shared_ptr<const std::vector<uint8_t>> shared_body = nullptr;
+  // 写在 headers 之后；槽位用完时退回逐个插入 headers
+  std::array<const StaticHeaders *, 4> static_headers{};
 
   static HttpResponse ok() { return {200, "OK", {}, {}}; }
 
@@ -31,11 +157,73 @@ struct HttpResponse {
     return std::move(*this);
   }
 
+  HttpResponse with_static_headers(const StaticHeaders &block) && {
+    for (auto &slot : static_headers) {
+      if (slot == nullptr || slot == &block) {
+        slot = &block;
+        return std::move(*this);
+      }
+    }
+    for (const auto &[name, value] : block.fields()) {
+      headers.emplace(name, value);
+    }
+    return std::move(*this);
+  }
+
+  // 依次查找 headers 和静态头，名称区分大小写
+  [[nodiscard]] std::optional<std::string_view> header(std::string_view name) const {
+    if (auto it = headers.find(name); it != headers.end()) {
+      return it->second;
+    }
+    for (const auto *block : static_headers) {
+      if (block == nullptr) {
+        break;
+      }
+      if (auto value = block->find(name)) {
+        return value;
+      }
+    }
+    return std::nullopt;
+  }
+
   HttpResponse with_body(std::vector<uint8_t> body) && {
     this->body = std::move(body);
     return std::move(*this);
   }
 
+  // 复制任意字节序列，例如分配在请求内存池里的 HttpRequest::body
+  HttpResponse with_body(std::span<const uint8_t> bytes) && {
+    body.assign(bytes.begin(), bytes.end());
+    return std::move(*this);
+  }
+
+  // 文件无法打开时变成 404
+  HttpResponse with_file(const std::string &path) && {
+    file = FileBody::open(path);
+    if (!file) {
+      return not_found().with_text("File not found");
+    }
+    body.clear();
+    shared_body = nullptr;
+    return std::move(*this);
+  }
+
+  // 内存中的 body，共享的内容优先
+  [[nodiscard]] std::span<const uint8_t> body_bytes() const {
+    return shared_body ? std::span<const uint8_t>(*shared_body) : std::span<const uint8_t>(body);
+  }
+
+  [[nodiscard]] size_t body_size() const { return file ? file->size() : body_bytes().size(); }
+
+  // 未设置 Content-Length 时以 chunked 编码发送（HTTP/1.0 客户端则写到连接关闭）
+  HttpResponse with_stream(BodySource source) && {
+    stream = std::move(source);
+    file = nullptr;
+    shared_body = nullptr;
+    body.clear();
+    return std::move(*this);
+  }
+
   HttpResponse with_text(std::string text) && {
     body = std::vector<uint8_t>(text.begin(), text.end());
     headers["Content-Type"] = "text/plain";
@@ -57,13 +245,65 @@ struct HttpResponse {
 
 using Handler = std::function<HttpResponse(const parser::HttpRequest &)>;
 
-using AsyncHandler = std::function<std::future<HttpResponse>(const parser::HttpRequest &)>;
+// 直接读取接收缓冲区的零拷贝 handler，只读几个 header 的 handler 不产生任何分配
+using ViewHandler = std::function<HttpResponse(const parser::HttpRequestView &)>;
+
+// 协程 handler：请求按值传入，保存在协程帧里，挂起期间不依赖接收缓冲区。
+// 由服务器启动后不占用线程；需要计算时 co_await pool.schedule() 切到线程池
+using PendingResponse = threadpool::coro::Task<HttpResponse>;
+using AsyncHandler = std::function<PendingResponse(parser::HttpRequest)>;
+
+// 流式请求体 handler：请求头到达后调用一次，返回的 BodyReader 按到达顺序收到 body 的每一段，
+// body 结束后由 finish 生成响应。body 不在内存中累积，也不受 max_body_size 限制
+struct BodyReader {
+  std::function<void(std::string_view)> on_data;
+  std::function<HttpResponse()> finish;
+};
+using StreamHandler = std::function<BodyReader(const parser::HttpRequestView &)>;
+
+using RouteHandler = std::variant<Handler, ViewHandler, AsyncHandler, StreamHandler>;
 
 enum class RouterError { NotFound, MethodNotAllowed, InternalError };
 
+// 路径参数：名称指向路由表，取值指向请求 URI，容量固定、不分配。
+// 只在产生它的 Router 和请求都存活期间有效
+class RouteParams {
+public:
+  static constexpr size_t kMaxParams = 8;
+
+  struct Param {
+    std::string_view name;
+    std::string_view value;
+  };
+
+  void push(std::string_view name, std::string_view value) { items_[size_++] = {name, value}; }
+
+  void clear() { size_ = 0; }
+
+  [[nodiscard]] std::optional<std::string_view> get(std::string_view name) const {
+    auto it = std::find_if(begin(), end(), [name](const Param &p) { return p.name == name; });
+    return it != end() ? std::optional<std::string_view>{it->value} : std::nullopt;
+  }
+
+  // 不存在时返回空串
+  std::string_view operator[](std::string_view name) const { return get(name).value_or(""); }
+
+  [[nodiscard]] size_t size() const { return size_; }
+  [[nodiscard]] bool empty() const { return size_ == 0; }
+  [[nodiscard]] const Param *begin() const { return items_.data(); }
+  [[nodiscard]] const Param *end() const { return items_.data() + size_; }
+
+private:
+  std::array<Param, kMaxParams> items_{};
+  size_t size_ = 0;
+};
+
+// handler 指向路由表里的那一份，不做复制；与 params 一样只在 Router 存活期间有效。
+// duration 是这条路由的 handler 耗时直方图，路由表没有接入指标时为空
 struct RouteMatch {
-  Handler handler;
-  std::unordered_map<std::string, std::string> params;
+  const RouteHandler *handler = nullptr;
+  RouteParams params;
+  metrics::Histogram *duration = nullptr;
 };
 
 } // namespace http::router
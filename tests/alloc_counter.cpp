@@ -0,0 +1,71 @@
+#include "alloc_counter.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<size_t> g_total{0};
+thread_local size_t t_count = 0;
+
+void *allocate(size_t size) noexcept {
+  g_total.fetch_add(1, std::memory_order_relaxed);
+  ++t_count;
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void *allocate(size_t size, std::align_val_t align) noexcept {
+  g_total.fetch_add(1, std::memory_order_relaxed);
+  ++t_count;
+  // aligned_alloc 要求大小是对齐的整数倍
+  const auto alignment = static_cast<size_t>(align);
+  return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void *checked(void *p) {
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+} // namespace
+
+namespace alloc_counter {
+
+size_t total() { return g_total.load(std::memory_order_relaxed); }
+
+size_t this_thread() { return t_count; }
+
+} // namespace alloc_counter
+
+void *operator new(size_t size) { return checked(allocate(size)); }
+void *operator new[](size_t size) { return checked(allocate(size)); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void *operator new(size_t size, std::align_val_t align) { return checked(allocate(size, align)); }
+void *operator new[](size_t size, std::align_val_t align) {
+  return checked(allocate(size, align));
+}
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+  return allocate(size, align);
+}
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+  return allocate(size, align);
+}
+
+// malloc 与 aligned_alloc 的结果都由 free 释放
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+
+// 测试用的全局分配计数。alloc_counter.cpp 替换了整组全局 operator new/delete
+// （普通、数组、对齐、nothrow），链接了它的测试程序里每次 operator new 都被计入。
+// 定义放在单独的翻译单元里，调用点看不到 malloc/free，不会误报 -Wmismatched-new-delete
+namespace alloc_counter {
+
+// 所有线程累计的分配次数
+size_t total();
+
+// 当前线程累计的分配次数，不受后台线程影响
+size_t this_thread();
+
+} // namespace alloc_counter
@@ -273,3 +273,44 @@ TEST(CombinatorTest, ComplexComposition_KeyValuePair) {
   EXPECT_EQ(key, "Host");
   EXPECT_EQ(value, "localhost");
 }
+
+// Static composition
+TEST(CombinatorTest, Choice_Variadic) {
+  auto parser = choice(string("GET"), string("PUT"), string("POST"));
+
+  EXPECT_EQ(parser("POST /")->first, "POST");
+  EXPECT_EQ(parser("PUT /")->first, "PUT");
+  EXPECT_FALSE(parser("DELETE /").has_value());
+}
+
+TEST(CombinatorTest, Choice_VectorOfErased) {
+  std::vector<Parser<std::string_view>> alternatives{erase(string("a")), erase(string("b"))};
+  auto parser = choice(std::move(alternatives));
+
+  EXPECT_EQ(parser("b!")->first, "b");
+  EXPECT_EQ(parser("c!").error(), ParseError::MalformedRequest);
+}
+
+TEST(CombinatorTest, Erase_PreservesBehaviour) {
+  auto typed = map(sequence(string("k"), take_until(';')), [](auto p) { return p.second; });
+  Parser<std::string_view> erased = erase(typed);
+
+  EXPECT_EQ(typed("key;")->first, "ey");
+  EXPECT_EQ(erased("key;")->first, "ey");
+  EXPECT_EQ(erased("key;")->second, ";");
+}
+
+TEST(CombinatorTest, ComposedParsersAreNotTypeErased) {
+  auto parser = map(sequence(one_char(), spaces()), [](auto p) { return p.first; });
+
+  static_assert(ParserLike<decltype(parser)>);
+  static_assert(!std::is_same_v<decltype(parser), Parser<char>>);
+  static_assert(std::is_same_v<parser_value_t<decltype(parser)>, char>);
+  EXPECT_EQ(parser("x   y")->second, "y");
+}
+
+TEST(CombinatorTest, ConstexprConstruction) {
+  static constexpr auto parser = choice(string("HTTP/1.0"), string("HTTP/1.1"));
+
+  EXPECT_EQ(parser("HTTP/1.1\r\n")->second, "\r\n");
+}
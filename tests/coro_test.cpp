@@ -0,0 +1,187 @@
+#include "http/async_io.hpp"
+#include "threadpool/coro.hpp"
+#include "threadpool/pool.hpp"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <thread>
+
+using namespace threadpool;
+using threadpool::coro::sync_wait;
+using http::server::EventLoop;
+using http::server::UniqueFd;
+
+namespace {
+
+coro::Task<int> answer() { co_return 42; }
+
+coro::Task<int> add_answers() {
+  const int a = co_await answer();
+  const int b = co_await answer();
+  co_return a + b;
+}
+
+coro::Task<void> fail() {
+  throw std::runtime_error("broken");
+  co_return;
+}
+
+coro::Task<int> sum_chain(int depth) {
+  int total = 0;
+  for (int i = 0; i < depth; ++i) {
+    total += co_await answer();
+  }
+  co_return total;
+}
+
+// 在后台线程运行的 event loop
+struct LoopThread {
+  std::shared_ptr<EventLoop> loop = *EventLoop::create();
+  std::jthread thread{[this](std::stop_token stoken) { loop->run(stoken); }};
+};
+
+} // namespace
+
+TEST(CoroTaskTest, ReturnsValuesThroughAwaitChain) {
+  EXPECT_EQ(sync_wait(answer()), 42);
+  EXPECT_EQ(sync_wait(add_answers()), 84);
+}
+
+TEST(CoroTaskTest, IsLazyUntilAwaited) {
+  bool ran = false;
+  auto task = [](bool &flag) -> coro::Task<void> {
+    flag = true;
+    co_return;
+  }(ran);
+  EXPECT_FALSE(ran);
+  sync_wait(std::move(task));
+  EXPECT_TRUE(ran);
+}
+
+TEST(CoroTaskTest, ExceptionsPropagateToAwaiter) {
+  EXPECT_THROW(sync_wait(fail()), std::runtime_error);
+
+  auto caught = []() -> coro::Task<std::string> {
+    try {
+      co_await fail();
+    } catch (const std::exception &e) {
+      co_return e.what();
+    }
+    co_return "";
+  };
+  EXPECT_EQ(sync_wait(caught()), "broken");
+}
+
+TEST(CoroTaskTest, LongAwaitChainsDoNotGrowTheStack) {
+  EXPECT_EQ(sync_wait(sum_chain(200000)), 42 * 200000);
+}
+
+TEST(CoroTaskTest, StartDeliversTaskResult) {
+  TaskResult<int> value = std::unexpected("unset");
+  coro::start(answer(), [&](TaskResult<int> r) { value = std::move(r); });
+  ASSERT_TRUE(value.has_value());
+  EXPECT_EQ(*value, 42);
+
+  TaskResult<void> failure;
+  coro::start(fail(), [&](TaskResult<void> r) { failure = std::move(r); });
+  ASSERT_FALSE(failure.has_value());
+  EXPECT_EQ(failure.error(), "broken");
+}
+
+TEST(CoroScheduleTest, HopsOntoPoolWorker) {
+  ThreadPool pool(2);
+  const auto caller = std::this_thread::get_id();
+
+  auto task = [](ThreadPool &p) -> coro::Task<std::thread::id> {
+    co_await p.schedule();
+    co_return std::this_thread::get_id();
+  }(pool);
+  EXPECT_NE(sync_wait(std::move(task)), caller);
+}
+
+TEST(CoroScheduleTest, ManyTasksInFlightOnFewThreads) {
+  ThreadPool pool(2);
+  LoopThread io;
+  constexpr int kTasks = 2000;
+
+  std::atomic<int> done{0};
+  for (int i = 0; i < kTasks; ++i) {
+    coro::start(
+        [](ThreadPool &p, EventLoop &loop, int id) -> coro::Task<int> {
+          co_await p.schedule();
+          co_await http::server::sleep_for(loop, std::chrono::milliseconds(5));
+          co_await p.schedule();
+          co_return id;
+        }(pool, *io.loop, i),
+        [&](TaskResult<int> r) {
+          if (r) {
+            done.fetch_add(1);
+            done.notify_one();
+          }
+        });
+  }
+  for (int n = done.load(); n < kTasks; n = done.load()) {
+    done.wait(n);
+  }
+  EXPECT_EQ(done.load(), kTasks);
+}
+
+TEST(AsyncIoTest, ReadAndWriteOverSocketPair) {
+  LoopThread io;
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+  UniqueFd a(fds[0]);
+  UniqueFd b(fds[1]);
+
+  // 读方先挂起等待数据，写方稍后才写入
+  auto reader = [](EventLoop &loop, int fd) -> coro::Task<std::string> {
+    char buf[64];
+    auto n = co_await http::server::async_read(loop, fd, buf);
+    co_return n ? std::string(buf, *n) : std::string("error");
+  }(*io.loop, a.get());
+
+  std::string received;
+  std::atomic<bool> finished{false};
+  coro::start(std::move(reader), [&](TaskResult<std::string> r) {
+    received = r.value_or("failed");
+    finished = true;
+    finished.notify_one();
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_FALSE(finished.load());
+
+  const std::string message = "ping over the loop";
+  auto written = sync_wait(http::server::async_write(*io.loop, b.get(), message));
+  ASSERT_TRUE(written.has_value());
+  EXPECT_EQ(*written, message.size());
+
+  finished.wait(false);
+  EXPECT_EQ(received, message);
+}
+
+TEST(AsyncIoTest, SleepForWaitsAtLeastTheDelay) {
+  LoopThread io;
+  const auto begin = std::chrono::steady_clock::now();
+  sync_wait([](EventLoop &loop) -> coro::Task<void> {
+    co_await http::server::sleep_for(loop, std::chrono::milliseconds(20));
+  }(*io.loop));
+  EXPECT_GE(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(20));
+}
+
+TEST(AsyncIoTest, TimersFireInDeadlineOrder) {
+  LoopThread io;
+  std::vector<int> order;
+  std::atomic<bool> finished{false};
+  io.loop->post([&] {
+    io.loop->run_after(std::chrono::milliseconds(15), [&] {
+      order.push_back(3);
+      finished = true;
+      finished.notify_one();
+    });
+    io.loop->run_after(std::chrono::milliseconds(1), [&] { order.push_back(1); });
+    io.loop->run_after(std::chrono::milliseconds(5), [&] { order.push_back(2); });
+  });
+  finished.wait(false);
+  EXPECT_EQ(order, (std::vector<int>{1, 2, 3}));
+}
@@ -1,3 +1,4 @@
+#include "arena.hpp"
 #include "http_parser.hpp"
 #include "types.hpp"
 #include <gtest/gtest.h>
@@ -318,7 +319,7 @@ TEST(HttpParserIntegrationTest, CompletePOSTRequest) {
     "POST /api/data HTTP/1.1\r\n"
     "Host: api.example.com\r\n"
     "Content-Type: application/json\r\n"
-    "Content-Length: 18\r\n"
+    "Content-Length: 15\r\n"
     "\r\n"
     "{\"key\":\"value\"}";
 
@@ -329,7 +330,7 @@ TEST(HttpParserIntegrationTest, CompletePOSTRequest) {
 
   EXPECT_EQ(req.request_line.method, Method::Post);
   EXPECT_EQ(req.request_line.uri, "/api/data");
-  EXPECT_EQ(req.content_length(), 18);
+  EXPECT_EQ(req.content_length(), 15);
 
   std::string body_str(req.body.begin(), req.body.end());
   EXPECT_EQ(body_str, "{\"key\":\"value\"}");
@@ -398,3 +399,188 @@ TEST(HttpParserEdgeCaseTest, LargeBody) {
   ASSERT_TRUE(result.has_value());
   EXPECT_EQ(result->body.size(), 10000);
 }
+
+// Zero-copy views
+TEST(HttpParserViewTest, RequestLineView) {
+  std::string_view input = "GET /items?id=7 HTTP/1.1\r\n";
+  auto result = parse_request_line_view()(input);
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->first.uri, "/items?id=7");
+  EXPECT_GE(result->first.uri.data(), input.data());
+  EXPECT_LT(result->first.uri.data(), input.data() + input.size());
+}
+
+TEST(HttpParserViewTest, HeaderView) {
+  std::string_view input = "Accept:  text/html\r\nrest";
+  auto result = parse_header_view()(input);
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->first.key, "Accept");
+  EXPECT_EQ(result->first.value, "text/html");
+  EXPECT_EQ(result->first.value.data(), input.data() + 9);
+  EXPECT_EQ(result->second, "rest");
+}
+
+TEST(HttpRequestViewTest, OfOwnedRequest) {
+  HttpRequest req{RequestLine{Method::Put, "/doc", Version::Http10}, {}, {'a', 'b'}};
+  req.headers.emplace("Content-Length", "2");
+
+  std::vector<HeaderView> storage;
+  auto view = HttpRequestView::of(req, storage);
+
+  EXPECT_EQ(view.request_line.method, Method::Put);
+  EXPECT_EQ(view.request_line.uri, "/doc");
+  EXPECT_EQ(view.content_length(), 2);
+  EXPECT_EQ(view.body.size(), 2);
+}
+
+// 统计上游分配次数的内存资源
+class CountingResource : public std::pmr::memory_resource {
+public:
+  size_t allocations = 0;
+
+private:
+  void *do_allocate(size_t bytes, size_t align) override {
+    ++allocations;
+    return std::pmr::new_delete_resource()->allocate(bytes, align);
+  }
+  void do_deallocate(void *p, size_t bytes, size_t align) override {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+  }
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+TEST(HttpRequestViewTest, ToRequestAllocatesFromArena) {
+  const HeaderView headers[] = {
+      {"Host", "example.com", HeaderId::Host},
+      {"User-Agent", "Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101 Firefox/124.0",
+       HeaderId::Unknown},
+      {"Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8",
+       HeaderId::Unknown},
+  };
+  const uint8_t body[] = {'h', 'i'};
+  const HttpRequestView view{{Method::Post, "/form", Version::Http11}, headers, body};
+
+  CountingResource upstream;
+  RequestArena arena(RequestArena::kDefaultInitialSize, &upstream);
+  {
+    const auto req = view.to_request(arena.resource());
+    EXPECT_EQ(req.headers.get_allocator().resource(), arena.resource());
+    EXPECT_EQ(req.header("user-agent"), headers[1].value);
+    EXPECT_EQ(std::string(req.body.begin(), req.body.end()), "hi");
+
+    // 复制出的请求不再引用内存池
+    const HttpRequest copy = req;
+    EXPECT_EQ(copy.headers.get_allocator().resource(), std::pmr::get_default_resource());
+    EXPECT_EQ(copy.header("Host"), "example.com");
+  }
+  EXPECT_EQ(upstream.allocations, 0u); // 全部落在首块里
+
+  // reset 之后回到首块，反复使用同一块内存
+  arena.reset();
+  const void *first = arena.resource()->allocate(64);
+  arena.reset();
+  EXPECT_EQ(arena.resource()->allocate(64), first);
+  EXPECT_EQ(upstream.allocations, 0u);
+
+  // 首块用完后才向上游申请
+  arena.reset();
+  (void)arena.resource()->allocate(RequestArena::kDefaultInitialSize * 2);
+  EXPECT_GT(upstream.allocations, 0u);
+}
+
+// Message framing
+TEST(HttpParserIntegrationTest, PrefixReturnsRemainder) {
+  auto result = parse_http_request_prefix("POST /a HTTP/1.1\r\nContent-Length: 2\r\n\r\nokGET /b");
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(std::string(result->first.body.begin(), result->first.body.end()), "ok");
+  EXPECT_EQ(result->second, "GET /b");
+}
+
+TEST(HttpParserIntegrationTest, ChunkedBodyDecoded) {
+  auto result = parse_http_request("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                   "3\r\nabc\r\n2\r\nde\r\n0\r\n\r\n");
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(std::string(result->body.begin(), result->body.end()), "abcde");
+}
+
+TEST(HttpParserIntegrationTest, FramingErrors) {
+  auto short_body = parse_http_request("POST / HTTP/1.1\r\nContent-Length: 10\r\n\r\nabc");
+  ASSERT_FALSE(short_body.has_value());
+  EXPECT_EQ(short_body.error(), ParseError::IncompleteRequest);
+
+  auto both = parse_http_request("POST / HTTP/1.1\r\nContent-Length: 5\r\n"
+                                 "Transfer-Encoding: chunked\r\n\r\n0\r\n\r\n");
+  ASSERT_FALSE(both.has_value());
+  EXPECT_EQ(both.error(), ParseError::MalformedRequest);
+}
+
+TEST(HttpParserIntegrationTest, RepeatedFramingHeadersRejected) {
+  // 与 RequestParser 一样拒绝，而不是按第一个值分帧
+  auto lengths = parse_http_request_prefix("POST / HTTP/1.1\r\nContent-Length: 5\r\n"
+                                           "Content-Length: 50\r\n\r\nhello");
+  ASSERT_FALSE(lengths.has_value());
+  EXPECT_EQ(lengths.error(), ParseError::MalformedRequest);
+
+  auto encodings = parse_http_request("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+                                      "transfer-encoding: chunked\r\n\r\n0\r\n\r\n");
+  ASSERT_FALSE(encodings.has_value());
+  EXPECT_EQ(encodings.error(), ParseError::MalformedRequest);
+}
+
+// Method dispatch and header names
+TEST(HttpParserTest, ParseMethod_InvalidMethodError) {
+  EXPECT_EQ(parse_method()("BOGUS /").error(), ParseError::InvalidMethod);
+  EXPECT_EQ(parse_method()("PX /").error(), ParseError::InvalidMethod);
+  EXPECT_EQ(parse_method()("P").error(), ParseError::InvalidMethod);
+  EXPECT_EQ(parse_method()("").error(), ParseError::IncompleteRequest);
+}
+
+TEST(HttpParserTest, MethodNameRoundTrip) {
+  for (auto m : {Method::Get, Method::Post, Method::Head, Method::Put, Method::Delete,
+                 Method::Options, Method::Trace, Method::Connect, Method::Patch}) {
+    auto result = parse_method()(std::string(method_name(m)) + " /");
+    ASSERT_TRUE(result.has_value()) << method_name(m);
+    EXPECT_EQ(result->first, m);
+  }
+}
+
+TEST(HeaderNamesTest, LookupIsCaseInsensitive) {
+  static_assert(lookup_header("Content-Length") == HeaderId::ContentLength);
+  static_assert(lookup_header("content-length") == HeaderId::ContentLength);
+  static_assert(lookup_header("X-Custom") == HeaderId::Unknown);
+
+  for (size_t i = 1; i < kKnownHeaderCount; ++i) {
+    auto id = static_cast<HeaderId>(i);
+    std::string upper(header_name(id));
+    std::transform(upper.begin(), upper.end(), upper.begin(),
+                   [](unsigned char c) { return std::toupper(c); });
+    EXPECT_EQ(lookup_header(header_name(id)), id) << header_name(id);
+    EXPECT_EQ(lookup_header(upper), id) << upper;
+  }
+  EXPECT_EQ(lookup_header("Content-Lengthx"), HeaderId::Unknown);
+  EXPECT_EQ(lookup_header("Hosx"), HeaderId::Unknown);
+  EXPECT_EQ(lookup_header(""), HeaderId::Unknown);
+}
+
+TEST(HeaderNamesTest, OwnedHeadersAreCaseInsensitive) {
+  auto result = parse_http_request("GET / HTTP/1.1\r\ncontent-length: 0\r\nX-Trace: t\r\n\r\n");
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->header("Content-Length"), "0");
+  EXPECT_EQ(result->header(HeaderId::ContentLength), "0");
+  EXPECT_EQ(result->header("x-trace"), "t");
+  EXPECT_FALSE(result->header("Host").has_value());
+}
+
+TEST(HeaderNamesTest, HeaderViewCarriesId) {
+  auto result = parse_header_view()("HOST: a\r\n");
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->first.id, HeaderId::Host);
+}
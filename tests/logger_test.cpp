@@ -0,0 +1,379 @@
+#include "logger/logger.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace logger;
+
+namespace {
+
+// 只保留消息文本与处理它的线程
+class CaptureSink : public Sink {
+public:
+  std::mutex mutex;
+  std::vector<std::string> messages;
+  std::vector<std::thread::id> threads;
+
+  void write(const LogEntry &entry) override {
+    std::lock_guard lock(mutex);
+    messages.push_back(entry.message);
+    threads.push_back(std::this_thread::get_id());
+  }
+
+  void write_record(const LogRecord &record) override {
+    std::lock_guard lock(mutex);
+    messages.push_back(record.to_entry().message);
+    threads.push_back(std::this_thread::get_id());
+  }
+
+  void flush() override {}
+
+  size_t size() {
+    std::lock_guard lock(mutex);
+    return messages.size();
+  }
+};
+
+uint32_t site(std::string_view format, Level level = Level::Info) {
+  return SiteRegistry::instance().add(LogSite{level, format, "test.cpp", 7, "fn"});
+}
+
+std::string message_of(const LogRecord &record) { return record.to_entry().message; }
+
+} // namespace
+
+TEST(LogRecordTest, FormatsArgumentsWhenRendered) {
+  const auto id = site("user {} from {} ok={} ratio={} ch={} {{literal}} missing={}");
+  const std::string host = "10.0.0.1";
+  const LogRecord record(id, Level::Info, std::chrono::system_clock::now(), 42, host, true, 0.5,
+                         'x');
+  EXPECT_EQ(message_of(record),
+            "user 42 from 10.0.0.1 ok=true ratio=0.5 ch=x {literal} missing={}");
+
+  const auto entry = record.to_entry();
+  EXPECT_EQ(entry.file, "test.cpp");
+  EXPECT_EQ(entry.line, 7);
+  EXPECT_EQ(entry.level, Level::Info);
+
+  std::string line;
+  append_record(line, record);
+  EXPECT_TRUE(line.ends_with(" [INFO] test.cpp:7 user 42 from 10.0.0.1 ok=true ratio=0.5 ch=x "
+                             "{literal} missing={}\n"))
+      << line;
+}
+
+TEST(LogRecordTest, LongArgumentsAreTruncatedToCapacity) {
+  const auto id = site("{} {}");
+  const LogRecord record(id, Level::Warn, std::chrono::system_clock::now(),
+                         std::string(1000, 'a'), -1);
+  EXPECT_LE(record.bytes().size(), LogRecord::kCapacity);
+  EXPECT_TRUE(record.header().flags & LogRecord::kTruncated);
+  const auto message = message_of(record);
+  EXPECT_TRUE(message.starts_with("aaaa"));
+  EXPECT_TRUE(message.ends_with("{}...")) << message;
+}
+
+TEST(LoggerTest, LogfRegistersSiteOnceAndFiltersByLevel) {
+  auto sink = std::make_shared<CaptureSink>();
+  const auto log = Logger(Level::Info).with_sink(sink);
+  const auto sites = SiteRegistry::instance().size();
+
+  for (int i = 0; i < 3; ++i) {
+    LOGF_INFO(log, "request {} took {}us", i, 120u + i);
+    LOGF_DEBUG(log, "not shown {}", i);
+  }
+  LOGF_ERROR(log, "no arguments");
+
+  EXPECT_EQ(SiteRegistry::instance().size(), sites + 2); // DEBUG 调用点从未执行到登记
+  ASSERT_EQ(sink->messages.size(), 4);
+  EXPECT_EQ(sink->messages[0], "request 0 took 120us");
+  EXPECT_EQ(sink->messages[2], "request 2 took 122us");
+  EXPECT_EQ(sink->messages[3], "no arguments");
+}
+
+TEST(LoggerTest, DisabledLevelsSkipArgumentEvaluation) {
+  auto sink = std::make_shared<CaptureSink>();
+  const auto log = Logger(Level::Info).with_sink(sink);
+  int evaluated = 0;
+  const auto message = [&] {
+    ++evaluated;
+    return std::string("built");
+  };
+
+  LOG_DEBUG(log, message());
+  LOGF_DEBUG(log, "value {}", message());
+  EXPECT_EQ(evaluated, 0);
+  LOG_INFO(log, message());
+  LOGF_WARN(log, "value {}", message());
+  EXPECT_EQ(evaluated, 2);
+  ASSERT_EQ(sink->size(), 2u);
+  EXPECT_EQ(sink->messages[1], "value built");
+
+  // 自定义 Filter 在级别检查之后生效
+  const auto filtered = log.with_filter([](const LogEntry &entry) { return entry.line != 0; });
+  filtered.info("no line");
+  filtered.debug("below level", "main.cpp", 1);
+  filtered.info("kept", "main.cpp", 2);
+  ASSERT_EQ(sink->size(), 3u);
+  EXPECT_EQ(sink->messages[2], "kept");
+}
+
+TEST(LoggerTest, RotatingFileSinkRotatesOnDayChangeOnly) {
+  const auto dir = std::filesystem::temp_directory_path() /
+                   ("logger_rotate_" + std::to_string(::getpid()));
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  const auto files = [&] {
+    return std::distance(std::filesystem::directory_iterator(dir),
+                         std::filesystem::directory_iterator{});
+  };
+  const auto entry = [](std::chrono::system_clock::time_point time) {
+    return LogEntry{Level::Info, "line", time, "main.cpp", 1, "fn", {}};
+  };
+  const auto now = std::chrono::system_clock::now();
+  {
+    RotatingFileSink sink(dir.string(), "app");
+    sink.write(entry(now));
+    EXPECT_EQ(files(), 1);
+    sink.write(entry(now + std::chrono::hours(24)));
+    EXPECT_EQ(files(), 2);
+    // 批量交来的记录可能略早于换日时间，不应再次轮转
+    sink.write(entry(now));
+    sink.write(entry(now + std::chrono::hours(24)));
+    EXPECT_EQ(files(), 2);
+  }
+  std::filesystem::remove_all(dir);
+}
+
+TEST(LoggerTest, MmapFileSinkRotatesBySizeAndAge) {
+  const auto dir = std::filesystem::temp_directory_path() /
+                   ("logger_mmap_" + std::to_string(::getpid()));
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  // 按文件名里的序号排序后拼接所有段
+  const auto segments = [&] {
+    std::vector<std::pair<int, std::string>> found;
+    for (const auto &file : std::filesystem::directory_iterator(dir)) {
+      const auto name = file.path().stem().string();
+      std::ifstream in(file.path(), std::ios::binary);
+      found.emplace_back(std::stoi(name.substr(name.rfind('_') + 1)),
+                         std::string(std::istreambuf_iterator<char>(in), {}));
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+  };
+  const auto now = std::chrono::system_clock::now();
+
+  {
+    MmapFileSink sink(dir.string(), "app", {.segment_bytes = 4096, .max_age = {}});
+    const auto id = site("request {} done");
+    for (int i = 0; i < 200; ++i) {
+      sink.write_record(LogRecord(id, Level::Info, now, i));
+    }
+  }
+  auto found = segments();
+  ASSERT_GE(found.size(), 3u);
+  std::string all;
+  for (const auto &[sequence, content] : found) {
+    EXPECT_LE(content.size(), 4096u);
+    EXPECT_TRUE(content.ends_with('\n')); // 行不跨段，截断后没有尾部的 0
+    all += content;
+  }
+  EXPECT_EQ(std::count(all.begin(), all.end(), '\n'), 200);
+  EXPECT_NE(all.find("request 0 done\n"), std::string::npos);
+  EXPECT_TRUE(all.ends_with(" request 199 done\n"));
+
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  {
+    MmapFileSink sink(dir.string(), "app",
+                      {.segment_bytes = 1 << 20, .max_age = std::chrono::seconds(60)});
+    const auto entry = [](std::chrono::system_clock::time_point time, std::string message) {
+      return LogEntry{Level::Info, std::move(message), time, "main.cpp", 1, "fn", {}};
+    };
+    sink.write(entry(now, "first"));
+    sink.write(entry(now + std::chrono::seconds(30), "second"));
+    sink.write(entry(now + std::chrono::seconds(61), "third"));
+  }
+  found = segments();
+  ASSERT_EQ(found.size(), 2u);
+  EXPECT_NE(found[0].second.find("second"), std::string::npos);
+  EXPECT_TRUE(found[1].second.ends_with(" third\n"));
+  std::filesystem::remove_all(dir);
+}
+
+TEST(LoggerTest, AsyncSinkFormatsRecordsOnWorkerThread) {
+  auto capture = std::make_unique<CaptureSink>();
+  auto *inner = capture.get();
+  const auto log = Logger(Level::Info).with_sink(std::make_shared<AsyncSink>(std::move(capture)));
+
+  for (int i = 0; i < 100; ++i) {
+    LOGF_INFO(log, "n={}", i);
+  }
+  log.info("plain", "main.cpp", 1);
+  log.flush(); // 屏障：返回时之前的日志都已交给 inner
+  std::lock_guard lock(inner->mutex);
+  ASSERT_EQ(inner->messages.size(), 101u);
+  EXPECT_EQ(inner->messages[99], "n=99");
+  EXPECT_EQ(inner->messages[100], "plain");
+  EXPECT_NE(inner->threads[0], std::this_thread::get_id());
+}
+
+TEST(LoggerTest, AsyncSinkHandsOverBatches) {
+  // 在 write_batch 里记录每批的大小，第一批交出前阻塞，让后续记录在缓冲里攒起来
+  struct BatchSink : CaptureSink {
+    std::vector<size_t> batches;
+    std::atomic<bool> release{false};
+
+    void write_batch(std::span<const RecordView> records) override {
+      release.wait(false);
+      {
+        std::lock_guard lock(mutex);
+        batches.push_back(records.size());
+      }
+      Sink::write_batch(records);
+    }
+  };
+  auto capture = std::make_unique<BatchSink>();
+  auto *inner = capture.get();
+  AsyncSink sink(std::move(capture));
+  const auto id = site("batch {}");
+
+  for (int i = 0; i < 50; ++i) {
+    sink.write_record(LogRecord(id, Level::Info, std::chrono::system_clock::now(), i));
+  }
+  inner->release = true;
+  inner->release.notify_all();
+  sink.flush();
+
+  std::lock_guard lock(inner->mutex);
+  ASSERT_EQ(inner->messages.size(), 50u);
+  EXPECT_EQ(inner->messages[49], "batch 49");
+  EXPECT_LT(inner->batches.size(), 50u);
+  EXPECT_GT(*std::max_element(inner->batches.begin(), inner->batches.end()), 1u);
+  EXPECT_EQ(sink.dropped(), 0u);
+}
+
+TEST(LoggerTest, AsyncSinkBackpressure) {
+  // inner 在放行前一直阻塞，缓冲很快写满
+  struct StallSink : CaptureSink {
+    std::atomic<bool> release{false};
+
+    void write_batch(std::span<const RecordView> records) override {
+      release.wait(false);
+      Sink::write_batch(records);
+    }
+  };
+  const auto id = site("payload {}");
+  const std::string payload(100, 'p');
+  constexpr size_t kCount = 1000; // 约 130 KB，远超 4 KB 的缓冲
+
+  for (const auto overflow : {Overflow::Drop, Overflow::Block}) {
+    auto capture = std::make_unique<StallSink>();
+    auto *inner = capture.get();
+    AsyncSink sink(std::move(capture), {.ring_bytes = 4096, .overflow = overflow});
+    std::thread releaser([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      inner->release = true;
+      inner->release.notify_all();
+    });
+    for (size_t i = 0; i < kCount; ++i) {
+      sink.write_record(LogRecord(id, Level::Info, std::chrono::system_clock::now(), payload));
+    }
+    releaser.join();
+    sink.flush();
+    if (overflow == Overflow::Drop) {
+      EXPECT_GT(sink.dropped(), 0u);
+      EXPECT_EQ(inner->size() + sink.dropped(), kCount);
+    } else {
+      EXPECT_EQ(sink.dropped(), 0u);
+      EXPECT_EQ(inner->size(), kCount);
+    }
+  }
+
+  // 大于缓冲一半的帧直接丢弃
+  auto capture = std::make_unique<CaptureSink>();
+  auto *inner = capture.get();
+  AsyncSink sink(std::move(capture), {.ring_bytes = 4096, .overflow = Overflow::Block});
+  sink.write(LogEntry{Level::Info, std::string(3000, 'x'), std::chrono::system_clock::now(),
+                      "main.cpp", 1, "fn", {}});
+  sink.flush();
+  EXPECT_EQ(sink.dropped(), 1u);
+  EXPECT_EQ(inner->size(), 0u);
+}
+
+TEST(LoggerTest, AsyncSinkFlushCoversAllThreads) {
+  auto capture = std::make_unique<CaptureSink>();
+  auto *inner = capture.get();
+  const auto log = Logger(Level::Info).with_sink(std::make_shared<AsyncSink>(
+      std::move(capture), AsyncSinkOptions{.overflow = Overflow::Block}));
+
+  constexpr size_t kThreads = 4;
+  constexpr int kPerThread = 2000;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kPerThread; ++i) {
+        LOGF_INFO(log, "thread {} n={}", t, i);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join(); // 线程退出后它的缓冲仍要被排空
+  }
+  log.flush();
+  EXPECT_EQ(inner->size(), kThreads * kPerThread);
+
+  // 每个线程内部保持顺序
+  std::lock_guard lock(inner->mutex);
+  std::vector<int> next(kThreads, 0);
+  for (const auto &message : inner->messages) {
+    int t = 0, n = 0;
+    ASSERT_EQ(std::sscanf(message.c_str(), "thread %d n=%d", &t, &n), 2) << message;
+    EXPECT_EQ(n, next[t]++);
+  }
+}
+
+TEST(LoggerTest, BinaryFileRoundTripsThroughDecoder) {
+  const auto path = std::filesystem::temp_directory_path() /
+                    ("logger_test_" + std::to_string(::getpid()) + ".blog");
+  std::filesystem::remove(path);
+
+  // 两次运行追加到同一个文件，每段有自己的调用点表
+  for (int run = 0; run < 2; ++run) {
+    const auto log = Logger(Level::Info).with_sink(std::make_shared<BinaryFileSink>(path));
+    LOGF_INFO(log, "run {} ready on port {}", run, 8080);
+    LOGF_WARN(log, "slow {}", std::string_view("query"));
+    log.info("plain entry", "main.cpp", 3);
+    log.flush();
+  }
+
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream out;
+  EXPECT_TRUE(BinaryLogDecoder{}.decode(in, out));
+  std::vector<std::string> lines;
+  std::istringstream text(out.str());
+  for (std::string line; std::getline(text, line);) {
+    lines.push_back(line.substr(20)); // 去掉时间戳
+  }
+  ASSERT_EQ(lines.size(), 6);
+  EXPECT_TRUE(lines[0].starts_with("[INFO] ")) << lines[0];
+  EXPECT_NE(lines[0].find("logger_test.cpp:"), std::string::npos) << lines[0];
+  EXPECT_TRUE(lines[0].ends_with(" run 0 ready on port 8080")) << lines[0];
+  EXPECT_TRUE(lines[1].starts_with("[WARN] ") && lines[1].ends_with(" slow query")) << lines[1];
+  EXPECT_EQ(lines[2], "[INFO] main.cpp:3 plain entry");
+  EXPECT_TRUE(lines[3].ends_with(" run 1 ready on port 8080")) << lines[3];
+
+  // 截断在帧中间的文件：已完整的帧照常输出，返回 false
+  const auto size = std::filesystem::file_size(path);
+  std::filesystem::resize_file(path, size - 3);
+  std::ifstream truncated(path, std::ios::binary);
+  std::ostringstream partial;
+  EXPECT_FALSE(BinaryLogDecoder{}.decode(truncated, partial));
+  EXPECT_FALSE(partial.str().empty());
+  std::filesystem::remove(path);
+}
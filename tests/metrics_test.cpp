@@ -0,0 +1,192 @@
+#include "metrics/metrics.hpp"
+#include "logger/logger.hpp"
+#include "threadpool/pool.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace metrics;
+
+namespace {
+
+// 导出文本中某一行的值；找不到时为 -1
+double sample(const std::string &text, std::string_view series) {
+  std::string prefix(series);
+  prefix += ' ';
+  for (size_t pos = 0; pos < text.size();) {
+    const auto end = text.find('\n', pos);
+    const auto line = std::string_view(text).substr(pos, end - pos);
+    if (line.starts_with(prefix)) {
+      return std::stod(std::string(line.substr(prefix.size())));
+    }
+    pos = end == std::string::npos ? text.size() : end + 1;
+  }
+  return -1;
+}
+
+} // namespace
+
+TEST(CounterTest, SumsShardsFromManyThreads) {
+  Counter counter;
+  std::vector<std::jthread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&counter] {
+      for (int i = 0; i < 10000; ++i) {
+        counter.add();
+      }
+    });
+  }
+  threads.clear();
+  counter.add(5);
+
+  EXPECT_EQ(counter.value(), 80005u);
+}
+
+TEST(GaugeTest, SetAndAdd) {
+  Gauge gauge;
+  gauge.set(10);
+  gauge.add(-3);
+
+  EXPECT_EQ(gauge.value(), 7);
+}
+
+TEST(HistogramTest, BucketBoundsCoverEveryValue) {
+  EXPECT_EQ(Histogram::bucket_of(0), 0u);
+  EXPECT_EQ(Histogram::bucket_of(7), 7u);
+  for (uint64_t value : {8ull, 9ull, 15ull, 16ull, 1000ull, 123456789ull, (1ull << 36) - 1}) {
+    const auto bucket = Histogram::bucket_of(value);
+    EXPECT_LE(Histogram::lower_bound(bucket), value);
+    EXPECT_GT(Histogram::lower_bound(bucket + 1), value);
+  }
+  EXPECT_EQ(Histogram::bucket_of(uint64_t{1} << 40), Histogram::kBuckets - 1);
+  EXPECT_EQ(Histogram::lower_bound(Histogram::kBuckets), uint64_t{1} << 36);
+}
+
+TEST(HistogramTest, QuantilesWithinBucketPrecision) {
+  Histogram histogram;
+  for (uint64_t i = 1; i <= 1000; ++i) {
+    histogram.observe(i * 1000); // 1 µs 到 1 ms
+  }
+  const auto snapshot = histogram.snapshot();
+
+  EXPECT_EQ(snapshot.count, 1000u);
+  EXPECT_EQ(snapshot.sum, 500500u * 1000);
+  for (const double q : {0.5, 0.9, 0.99}) {
+    const double exact = q * 1e6;
+    EXPECT_NEAR(static_cast<double>(snapshot.quantile(q)), exact, exact * 0.125) << q;
+  }
+  EXPECT_EQ(snapshot.count_below(uint64_t{1} << 20), 1000u);
+  EXPECT_EQ(Histogram().snapshot().quantile(0.5), 0u);
+}
+
+TEST(HistogramTest, ConcurrentObserversAllCounted) {
+  Histogram histogram;
+  std::vector<std::jthread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&histogram, t] {
+      for (int i = 0; i < 5000; ++i) {
+        histogram.observe(static_cast<uint64_t>(t * 1000 + i));
+      }
+    });
+  }
+  threads.clear();
+
+  EXPECT_EQ(histogram.snapshot().count, 40000u);
+}
+
+TEST(RegistryTest, SameNameAndLabelsReturnSameMetric) {
+  Registry registry;
+  auto &a = registry.counter("requests_total", "Requests", {{"route", "/a"}});
+  auto &b = registry.counter("requests_total", "Requests", {{"route", "/b"}});
+
+  EXPECT_EQ(&a, &registry.counter("requests_total", "Requests", {{"route", "/a"}}));
+  EXPECT_NE(&a, &b);
+  EXPECT_THROW(registry.gauge("requests_total", "Requests"), std::invalid_argument);
+}
+
+TEST(RegistryTest, ExposesPrometheusText) {
+  Registry registry;
+  registry.counter("errors_total", "Errors", {{"kind", "say \"hi\""}}).add(3);
+  registry.gauge("depth", "Queue depth").set(-2);
+  auto &latency = registry.histogram("latency_seconds", "Latency", {{"route", "/"}});
+  latency.observe(1500);      // 1.5 µs
+  latency.observe(3'000'000); // 3 ms
+
+  const auto text = registry.expose();
+
+  EXPECT_NE(text.find("# HELP errors_total Errors\n# TYPE errors_total counter\n"), std::string::npos);
+  EXPECT_EQ(sample(text, R"(errors_total{kind="say \"hi\""})"), 3);
+  EXPECT_NE(text.find("# TYPE depth gauge\n"), std::string::npos);
+  EXPECT_EQ(sample(text, "depth"), -2);
+  EXPECT_NE(text.find("# TYPE latency_seconds histogram\n"), std::string::npos);
+  EXPECT_EQ(sample(text, R"(latency_seconds_bucket{route="/",le="1.024e-06"})"), 0);
+  EXPECT_EQ(sample(text, R"(latency_seconds_bucket{route="/",le="2.048e-06"})"), 1);
+  EXPECT_EQ(sample(text, R"(latency_seconds_bucket{route="/",le="0.004194304"})"), 2);
+  EXPECT_EQ(sample(text, R"(latency_seconds_bucket{route="/",le="+Inf"})"), 2);
+  EXPECT_EQ(sample(text, R"(latency_seconds_count{route="/"})"), 2);
+  EXPECT_DOUBLE_EQ(sample(text, R"(latency_seconds_sum{route="/"})"), 0.0030015);
+}
+
+TEST(RegistryTest, CallbackRemovedWithRegistration) {
+  Registry registry;
+  int depth = 4;
+  {
+    auto registration = registry.callback("depth", "Queue depth", Registry::Type::Gauge,
+                                          [&depth] { return static_cast<double>(depth); });
+    EXPECT_EQ(sample(registry.expose(), "depth"), 4);
+    auto moved = std::move(registration);
+    depth = 5;
+    EXPECT_EQ(sample(registry.expose(), "depth"), 5);
+  }
+
+  EXPECT_EQ(registry.expose().find("depth"), std::string::npos);
+  EXPECT_THROW((void)registry.callback("h", "", Registry::Type::Histogram, [] { return 0.0; }),
+               std::invalid_argument);
+}
+
+TEST(InstrumentTest, ThreadPoolRecordsWaitRunAndDepth) {
+  Registry registry;
+  {
+    threadpool::ThreadPool pool(2);
+    pool.instrument(registry, "test");
+    std::vector<std::future<threadpool::TaskResult<int>>> futures;
+    for (int i = 0; i < 100; ++i) {
+      futures.push_back(pool.submit([i] { return i; }));
+    }
+    for (auto &future : futures) {
+      ASSERT_TRUE(future.get().has_value());
+    }
+    const auto text = registry.expose();
+
+    // 排队时间在任务开始前记录；执行时间在 future 就绪之后才记录，析构后再检查
+    EXPECT_EQ(sample(text, R"(threadpool_task_wait_seconds_count{pool="test"})"), 100);
+    EXPECT_GE(sample(text, R"(threadpool_pending_tasks{pool="test"})"), 0);
+  }
+  // 线程池析构时注销队列长度的回调，直方图留在 registry 里
+  const auto text = registry.expose();
+  EXPECT_EQ(text.find("threadpool_pending_tasks{"), std::string::npos);
+  EXPECT_EQ(sample(text, R"(threadpool_task_run_seconds_count{pool="test"})"), 100);
+}
+
+TEST(InstrumentTest, AsyncSinkExposesDrops) {
+  class Discard : public logger::Sink {
+  public:
+    void write(const logger::LogEntry &) override {}
+    void flush() override {}
+  };
+
+  Registry registry;
+  logger::AsyncSinkOptions options;
+  options.overflow = logger::Overflow::Drop;
+  options.ring_bytes = 4096;
+  auto sink = std::make_shared<logger::AsyncSink>(std::make_unique<Discard>(), options);
+  sink->instrument(registry, "test");
+  auto log = logger::Logger(logger::Level::Info).with_sink(sink);
+
+  LOG_INFO(log, std::string(3000, 'x')); // 超过缓冲的一半，必定丢弃
+  sink->flush();
+
+  EXPECT_EQ(sample(registry.expose(), R"(log_dropped_total{sink="test"})"),
+            static_cast<double>(sink->dropped()));
+  EXPECT_GE(sink->dropped(), 1u);
+}
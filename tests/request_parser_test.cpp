@@ -0,0 +1,266 @@
+#include "request_parser.hpp"
+#include "types.hpp"
+#include <gtest/gtest.h>
+
+using namespace http::parser;
+
+TEST(RequestParserTest, SingleFeed) {
+  RequestParser parser;
+  auto state = parser.feed("GET /index.html HTTP/1.1\r\nHost: localhost\r\n\r\n");
+
+  ASSERT_TRUE(state.has_value());
+  EXPECT_EQ(*state, ParseState::Complete);
+
+  auto req = parser.take();
+  EXPECT_EQ(req.request_line.method, Method::Get);
+  EXPECT_EQ(req.request_line.uri, "/index.html");
+  EXPECT_EQ(req.headers["Host"], "localhost");
+}
+
+TEST(RequestParserTest, ByteByByte) {
+  const std::string request =
+    "POST /api HTTP/1.1\r\n"
+    "Host: example.com\r\n"
+    "Content-Length: 5\r\n"
+    "\r\n"
+    "hello";
+
+  RequestParser parser;
+  for (size_t i = 0; i + 1 < request.size(); ++i) {
+    auto state = parser.feed(std::string_view(&request[i], 1));
+    ASSERT_TRUE(state.has_value()) << "at byte " << i;
+    ASSERT_NE(*state, ParseState::Complete) << "at byte " << i;
+  }
+  auto state = parser.feed(std::string_view(&request.back(), 1));
+  ASSERT_TRUE(state.has_value());
+  EXPECT_EQ(*state, ParseState::Complete);
+
+  auto req = parser.take();
+  EXPECT_EQ(req.request_line.method, Method::Post);
+  EXPECT_EQ(req.headers.size(), 2);
+  EXPECT_EQ(std::string(req.body.begin(), req.body.end()), "hello");
+}
+
+TEST(RequestParserTest, StateProgression) {
+  RequestParser parser;
+
+  EXPECT_EQ(*parser.feed("GET / HTTP/1.1\r"), ParseState::RequestLine);
+  EXPECT_EQ(*parser.feed("\nHost: a\r\n"), ParseState::Headers);
+  EXPECT_EQ(*parser.feed("Content-Length: 3\r\n\r\n"), ParseState::Body);
+  EXPECT_EQ(*parser.feed("ab"), ParseState::Body);
+  EXPECT_EQ(*parser.feed("c"), ParseState::Complete);
+}
+
+TEST(RequestParserTest, LeadingEmptyLinesIgnored) {
+  RequestParser parser;
+  auto state = parser.feed("\r\n\r\nGET / HTTP/1.1\r\n\r\n");
+
+  ASSERT_TRUE(state.has_value());
+  EXPECT_EQ(*state, ParseState::Complete);
+}
+
+TEST(RequestParserTest, KeepsBytesOfNextRequest) {
+  RequestParser parser;
+  auto state = parser.feed("GET /a HTTP/1.1\r\n\r\nGET /b HT");
+
+  ASSERT_TRUE(state.has_value());
+  ASSERT_EQ(*state, ParseState::Complete);
+  EXPECT_EQ(parser.take().request_line.uri, "/a");
+  EXPECT_EQ(parser.buffered(), 9);
+
+  state = parser.feed("TP/1.1\r\n\r\n");
+  ASSERT_TRUE(state.has_value());
+  ASSERT_EQ(*state, ParseState::Complete);
+  EXPECT_EQ(parser.take().request_line.uri, "/b");
+}
+
+TEST(RequestParserTest, LongPipelineInOneFeed) {
+  RequestParser parser(ParserLimits{.max_header_size = 64, .max_body_size = 1024});
+  std::string input;
+  for (int i = 0; i < 100; ++i) {
+    input += "GET /" + std::to_string(i) + " HTTP/1.1\r\n\r\n";
+  }
+  auto state = parser.feed(input);
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(state.has_value());
+    ASSERT_EQ(*state, ParseState::Complete);
+    EXPECT_EQ(parser.take().request_line.uri.substr(1), std::to_string(i));
+    state = parser.feed({});
+  }
+  ASSERT_TRUE(state.has_value());
+  EXPECT_EQ(*state, ParseState::RequestLine);
+  EXPECT_EQ(parser.buffered(), 0);
+
+  // 头部长度从当前请求算起，不含已消费的前缀
+  state = parser.feed("GET / HTTP/1.1\r\nX-Long: " + std::string(100, 'a'));
+  ASSERT_FALSE(state.has_value());
+  EXPECT_EQ(state.error(), ParseError::HeadersTooLarge);
+}
+
+TEST(RequestParserTest, ChunkedBodyAcrossFeeds) {
+  RequestParser parser;
+  EXPECT_EQ(*parser.feed("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n4\r\nWi"),
+            ParseState::Body);
+  EXPECT_EQ(*parser.feed("ki\r\n5;name=v\r\npedia\r\n0\r\nX-Trailer: t\r"), ParseState::Body);
+  auto state = parser.feed("\n\r\nGET /next HTTP/1.1\r\n\r\n");
+
+  ASSERT_TRUE(state.has_value());
+  ASSERT_EQ(*state, ParseState::Complete);
+  auto view = parser.view();
+  EXPECT_EQ(std::string(view.body.begin(), view.body.end()), "Wikipedia");
+
+  // 同一缓冲区里的下一个请求不需要新的输入
+  parser.consume();
+  state = parser.feed({});
+  ASSERT_TRUE(state.has_value());
+  ASSERT_EQ(*state, ParseState::Complete);
+  EXPECT_EQ(parser.view().request_line.uri, "/next");
+}
+
+TEST(RequestParserTest, RejectsAmbiguousFraming) {
+  for (const char *request : {"POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n",
+                              "POST / HTTP/1.1\r\nContent-Length: 1\r\nTransfer-Encoding: chunked\r\n\r\n",
+                              "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n",
+                              "POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+                              "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n"}) {
+    RequestParser parser;
+    auto state = parser.feed(request);
+    ASSERT_FALSE(state.has_value()) << request;
+    EXPECT_EQ(state.error(), ParseError::MalformedRequest) << request;
+  }
+}
+
+TEST(RequestParserTest, StreamedBodyIsNotBuffered) {
+  RequestParser parser(ParserLimits{.max_header_size = 1024, .max_body_size = 4});
+  std::string received;
+  parser.set_body_sink_factory([&](const HttpRequestView &req) -> BodySink {
+    if (req.request_line.uri != "/upload") {
+      return nullptr;
+    }
+    return [&](std::string_view data) -> ParseResult<void> {
+      received += data;
+      return {};
+    };
+  });
+
+  // 超过 max_body_size 的 body 也可以流式接收，缓冲区里只剩下一个请求的字节
+  EXPECT_EQ(*parser.feed("POST /upload HTTP/1.1\r\nContent-Length: 10\r\n\r\n0123"),
+            ParseState::Body);
+  EXPECT_EQ(received, "0123");
+  auto state = parser.feed("456789GET / HTTP/1.1\r\n\r\n");
+  ASSERT_TRUE(state.has_value());
+  ASSERT_EQ(*state, ParseState::Complete);
+  EXPECT_EQ(received, "0123456789");
+  EXPECT_TRUE(parser.view().body.empty());
+  EXPECT_EQ(parser.view().request_line.uri, "/upload");
+
+  parser.consume();
+  EXPECT_EQ(*parser.feed({}), ParseState::Complete);
+  EXPECT_EQ(parser.view().request_line.uri, "/");
+
+  // chunked body 同样逐段交出；未选择流式的请求照常受 max_body_size 限制
+  parser.consume();
+  received.clear();
+  state = parser.feed("POST /upload HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                      "6\r\nstream\r\n3\r\ned!\r\n0\r\n\r\n");
+  ASSERT_TRUE(state.has_value());
+  ASSERT_EQ(*state, ParseState::Complete);
+  EXPECT_EQ(received, "streamed!");
+  EXPECT_EQ(parser.buffered(), 0);
+
+  parser.consume();
+  state = parser.feed("POST /other HTTP/1.1\r\nContent-Length: 10\r\n\r\n");
+  ASSERT_FALSE(state.has_value());
+  EXPECT_EQ(state.error(), ParseError::BodyTooLarge);
+}
+
+TEST(RequestParserTest, InvalidMethod) {
+  RequestParser parser;
+  auto state = parser.feed("BOGUS / HTTP/1.1\r\n");
+
+  EXPECT_FALSE(state.has_value());
+}
+
+TEST(RequestParserTest, InvalidHeader) {
+  RequestParser parser;
+  auto state = parser.feed("GET / HTTP/1.1\r\nNoColon\r\n");
+
+  ASSERT_FALSE(state.has_value());
+  EXPECT_EQ(state.error(), ParseError::InvalidHeader);
+}
+
+TEST(RequestParserTest, HeadersTooLarge) {
+  RequestParser parser(ParserLimits{.max_header_size = 64, .max_body_size = 1024});
+  auto state = parser.feed("GET / HTTP/1.1\r\nX-Long: " + std::string(100, 'a'));
+
+  ASSERT_FALSE(state.has_value());
+  EXPECT_EQ(state.error(), ParseError::HeadersTooLarge);
+}
+
+TEST(RequestParserTest, BodyTooLarge) {
+  RequestParser parser(ParserLimits{.max_header_size = 1024, .max_body_size = 10});
+  auto state = parser.feed("POST / HTTP/1.1\r\nContent-Length: 11\r\n\r\n");
+
+  ASSERT_FALSE(state.has_value());
+  EXPECT_EQ(state.error(), ParseError::BodyTooLarge);
+}
+
+TEST(RequestParserTest, ViewPointsIntoBuffer) {
+  RequestParser parser;
+  auto state = parser.feed(
+    "POST /upload HTTP/1.1\r\n"
+    "Host: example.com\r\n"
+    "Content-Length: 4\r\n"
+    "\r\n"
+    "data");
+  ASSERT_TRUE(state.has_value());
+  ASSERT_EQ(*state, ParseState::Complete);
+
+  auto view = parser.view();
+  EXPECT_EQ(view.request_line.method, Method::Post);
+  EXPECT_EQ(view.request_line.uri, "/upload");
+  ASSERT_EQ(view.headers.size(), 2);
+  EXPECT_EQ(view.headers[0].key, "Host");
+  EXPECT_EQ(view.headers[0].value, "example.com");
+  EXPECT_EQ(view.header("Content-Length"), "4");
+  EXPECT_EQ(view.content_length(), 4);
+  EXPECT_EQ(std::string(view.body.begin(), view.body.end()), "data");
+}
+
+TEST(RequestParserTest, ViewSurvivesBufferGrowth) {
+  RequestParser parser;
+  ASSERT_TRUE(parser.feed("GET /first HTTP/1.1\r\n").has_value());
+  ASSERT_TRUE(parser.feed("X-Pad: " + std::string(4096, 'p') + "\r\n").has_value());
+  auto state = parser.feed("Host: a\r\n\r\n");
+  ASSERT_TRUE(state.has_value());
+  ASSERT_EQ(*state, ParseState::Complete);
+
+  auto view = parser.view();
+  EXPECT_EQ(view.request_line.uri, "/first");
+  EXPECT_EQ(view.header("X-Pad")->size(), 4096);
+  EXPECT_EQ(view.header("Host"), "a");
+
+  auto req = view.to_request();
+  EXPECT_EQ(req.request_line.uri, "/first");
+  EXPECT_EQ(req.headers["Host"], "a");
+}
+
+TEST(RequestParserTest, KnownHeadersIndexedCaseInsensitively) {
+  RequestParser parser;
+  auto state = parser.feed("POST / HTTP/1.1\r\nhost: a\r\nX-Custom: c\r\n"
+                           "content-length: 2\r\nHost: b\r\n\r\nok");
+  ASSERT_TRUE(state.has_value());
+  ASSERT_EQ(*state, ParseState::Complete);
+
+  auto view = parser.view();
+  EXPECT_EQ(view.header(HeaderId::Host), "a");
+  EXPECT_EQ(view.header("HOST"), "a");
+  EXPECT_EQ(view.header("x-custom"), "c");
+  EXPECT_FALSE(view.header(HeaderId::Cookie).has_value());
+  EXPECT_EQ(view.content_length(), 2);
+  EXPECT_EQ(std::string(view.body.begin(), view.body.end()), "ok");
+
+  parser.consume();
+  ASSERT_TRUE(parser.feed("GET / HTTP/1.1\r\n\r\n").has_value());
+  EXPECT_FALSE(parser.view().header(HeaderId::Host).has_value());
+}
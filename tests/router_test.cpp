@@ -0,0 +1,861 @@
+#include "alloc_counter.hpp"
+#include "router/middleware.hpp"
+#include "router/router.hpp"
+#include <filesystem>
+#include <fstream>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <zlib.h>
+
+using namespace http::router;
+using namespace http::parser;
+
+namespace {
+
+HttpResponse text(std::string body) { return HttpResponse::ok().with_text(std::move(body)); }
+
+std::string body_of(const HttpResponse &response) {
+  const auto body = response.body_bytes();
+  return std::string(body.begin(), body.end());
+}
+
+HttpRequest request(Method method, std::string uri) {
+  return HttpRequest{RequestLine{method, std::move(uri), Version::Http11}, {}, {}};
+}
+
+} // namespace
+
+TEST(PathPatternTest, StaticAndParams) {
+  PathPattern pattern("/users/:id/posts/:post_id");
+
+  auto result = pattern.match("/users/123/posts/456");
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ((*result)["id"], "123");
+  EXPECT_EQ((*result)["post_id"], "456");
+
+  EXPECT_FALSE(pattern.match("/users/123").has_value());
+  EXPECT_FALSE(pattern.match("/users/123/comments/4").has_value());
+  EXPECT_FALSE(pattern.match("/users//posts/4").has_value());
+}
+
+TEST(PathPatternTest, ParamsPointIntoPath) {
+  std::string path = "/files/report.pdf";
+  PathPattern pattern("/files/:name");
+
+  auto result = pattern.match(path);
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->get("name")->data(), path.data() + 7);
+  EXPECT_FALSE(result->get("missing").has_value());
+}
+
+TEST(PathPatternTest, Wildcard) {
+  PathPattern named("/static/*path");
+  EXPECT_EQ((*named.match("/static/css/style.css"))["path"], "css/style.css");
+  EXPECT_EQ((*named.match("/static/"))["path"], "");
+
+  PathPattern unnamed("/assets/*");
+  EXPECT_EQ((*unnamed.match("/assets/a/b"))["wildcard"], "a/b");
+  EXPECT_FALSE(unnamed.match("/other").has_value());
+}
+
+TEST(PathPatternTest, LiteralCharacters) {
+  PathPattern pattern("/v1.0/a+b");
+  EXPECT_TRUE(pattern.match("/v1.0/a+b").has_value());
+  EXPECT_FALSE(pattern.match("/v1x0/a+b").has_value());
+}
+
+TEST(PathPatternTest, RejectsInvalidPatterns) {
+  EXPECT_THROW(PathPattern("/users/:/x"), std::invalid_argument);
+  EXPECT_THROW(PathPattern("/:a/:b/:c/:d/:e/:f/:g/:h/:i"), std::invalid_argument);
+}
+
+TEST(RadixTreeTest, SharedPrefixesSplitEdges) {
+  RadixTree<int> tree;
+  tree.insert("/search", 1);
+  tree.insert("/support", 2);
+  tree.insert("/s", 3);
+  tree.insert("/blog/:post", 4);
+  tree.insert("/blog/:post/comments", 5);
+
+  auto frozen = std::move(tree).freeze();
+  RouteParams params;
+  auto value = [&](std::string_view path) {
+    const int *v = frozen.find(path, params);
+    return v ? *v : 0;
+  };
+  EXPECT_EQ(value("/search"), 1);
+  EXPECT_EQ(value("/support"), 2);
+  EXPECT_EQ(value("/s"), 3);
+  EXPECT_EQ(value("/su"), 0);
+  EXPECT_EQ(value("/searchx"), 0);
+  EXPECT_EQ(value("/blog/hello"), 4);
+  EXPECT_EQ(params["post"], "hello");
+  EXPECT_EQ(value("/blog/hello/comments"), 5);
+  EXPECT_EQ(params["post"], "hello");
+}
+
+TEST(RadixTreeTest, StaticBeatsParamAndBacktracks) {
+  RadixTree<int> tree;
+  tree.insert("/users/new", 1);
+  tree.insert("/users/:id", 2);
+  tree.insert("/users/new/:step", 3);
+  tree.insert("/users/:id/edit", 4);
+  tree.insert("/*rest", 5);
+
+  auto frozen = std::move(tree).freeze();
+  RouteParams params;
+  auto value = [&](std::string_view path) {
+    const int *v = frozen.find(path, params);
+    return v ? *v : 0;
+  };
+  EXPECT_EQ(value("/users/new"), 1);
+  EXPECT_EQ(value("/users/42"), 2);
+  EXPECT_EQ(params["id"], "42");
+  EXPECT_EQ(value("/users/new/2"), 3);
+  // 静态分支 "new" 没有 /edit，回溯到参数分支
+  EXPECT_EQ(value("/users/new/edit"), 3);
+  EXPECT_EQ(value("/users/newbie/edit"), 4);
+  EXPECT_EQ(params["id"], "newbie");
+  EXPECT_EQ(value("/anything/else"), 5);
+  EXPECT_EQ(params["rest"], "anything/else");
+}
+
+TEST(RouterTest, DispatchesByMethodAndPath) {
+  auto router = Router{}
+                    .get("/users", [](const HttpRequest &) { return text("list"); })
+                    .post("/users", [](const HttpRequest &) { return text("create"); })
+                    .get("/users/:id", [](const HttpRequest &) { return text("one"); });
+
+  EXPECT_EQ(body_of(router.handle(request(Method::Get, "/users"))), "list");
+  EXPECT_EQ(body_of(router.handle(request(Method::Post, "/users"))), "create");
+  EXPECT_EQ(body_of(router.handle(request(Method::Get, "/users/7"))), "one");
+  EXPECT_EQ(router.handle(request(Method::Delete, "/users")).status_code, 404);
+  EXPECT_EQ(router.handle(request(Method::Get, "/nope")).status_code, 404);
+}
+
+TEST(RouterTest, FindReturnsParamsAndIgnoresQuery) {
+  auto router = Router{}.get("/users/:id", [](const HttpRequest &) { return text("one"); });
+
+  auto match = router.find(Method::Get, "/users/123?verbose=1");
+  ASSERT_TRUE(match.has_value());
+  EXPECT_EQ(match->params["id"], "123");
+  EXPECT_EQ(match->params.size(), 1);
+}
+
+TEST(RouterTest, FindPointsIntoRouteTable) {
+  auto router = Router{}.get("/users/:id", [](const HttpRequest &) { return text("one"); });
+
+  auto first = router.find(Method::Get, "/users/1");
+  auto second = router.find(Method::Get, "/users/2");
+  ASSERT_TRUE(first && second);
+  ASSERT_NE(first->handler, nullptr);
+  EXPECT_EQ(first->handler, second->handler); // 同一份 handler，没有复制
+  EXPECT_EQ(second->params["id"], "2");
+}
+
+TEST(RouterTest, ReRegisteringReplacesHandler) {
+  auto router = Router{}
+                    .get("/", [](const HttpRequest &) { return text("old"); })
+                    .get("/", [](const HttpRequest &) { return text("new"); });
+
+  EXPECT_EQ(body_of(router.handle(request(Method::Get, "/"))), "new");
+}
+
+TEST(RouterTest, ImmutableRegistration) {
+  auto base = Router{}.get("/a", [](const HttpRequest &) { return text("a"); });
+  auto extended = base.get("/b", [](const HttpRequest &) { return text("b"); });
+
+  EXPECT_EQ(base.handle(request(Method::Get, "/b")).status_code, 404);
+  EXPECT_EQ(body_of(extended.handle(request(Method::Get, "/b"))), "b");
+  EXPECT_EQ(body_of(extended.handle(request(Method::Get, "/a"))), "a");
+}
+
+TEST(RouterTest, ManyRoutes) {
+  Router router;
+  for (int i = 0; i < 300; ++i) {
+    router = router.get("/api/v1/resource" + std::to_string(i) + "/:id",
+                        [i](const HttpRequest &) { return text(std::to_string(i)); });
+  }
+
+  EXPECT_EQ(body_of(router.handle(request(Method::Get, "/api/v1/resource0/x"))), "0");
+  EXPECT_EQ(body_of(router.handle(request(Method::Get, "/api/v1/resource150/x"))), "150");
+  EXPECT_EQ(body_of(router.handle(request(Method::Get, "/api/v1/resource299/x"))), "299");
+  EXPECT_EQ(router.handle(request(Method::Get, "/api/v1/resource300/x")).status_code, 404);
+}
+
+TEST(RouterBuilderTest, BuildsFrozenRouter) {
+  RouterBuilder builder;
+  for (int i = 0; i < 1000; ++i) {
+    builder.get("/items/" + std::to_string(i),
+                [i](const HttpRequest &) { return text(std::to_string(i)); });
+  }
+  builder.post("/items/:id", [](const HttpRequest &) { return text("post"); });
+  auto router = std::move(builder).build();
+
+  EXPECT_EQ(router.definitions().size(), 1001);
+  EXPECT_EQ(body_of(router.handle(request(Method::Get, "/items/0"))), "0");
+  EXPECT_EQ(body_of(router.handle(request(Method::Get, "/items/999"))), "999");
+  EXPECT_EQ(body_of(router.handle(request(Method::Post, "/items/5"))), "post");
+  EXPECT_EQ(router.handle(request(Method::Get, "/items/1000")).status_code, 404);
+}
+
+TEST(RouterBuilderTest, ExtendsExistingRouter) {
+  auto base = RouterBuilder{}
+                  .get("/a", [](const HttpRequest &) { return text("a"); })
+                  .build();
+  auto extended = RouterBuilder(base)
+                      .get("/b", [](const HttpRequest &) { return text("b"); })
+                      .get("/a", [](const HttpRequest &) { return text("a2"); })
+                      .build();
+
+  EXPECT_EQ(body_of(base.handle(request(Method::Get, "/a"))), "a");
+  EXPECT_EQ(base.handle(request(Method::Get, "/b")).status_code, 404);
+  EXPECT_EQ(body_of(extended.handle(request(Method::Get, "/a"))), "a2");
+  EXPECT_EQ(body_of(extended.handle(request(Method::Get, "/b"))), "b");
+}
+
+TEST(RouterBuilderTest, InvalidPatternThrowsOnBuild) {
+  RouterBuilder builder;
+  builder.get("/users/:", [](const HttpRequest &) { return text(""); });
+  EXPECT_THROW((void)builder.build(), std::invalid_argument);
+}
+
+TEST(RouterBuilderTest, AsyncHandlersAreDeferred) {
+  auto router = RouterBuilder{}
+                    .get("/sync", [](const HttpRequest &) { return text("sync"); })
+                    .get("/async",
+                         [](HttpRequest req) -> PendingResponse {
+                           co_return text("async " + req.request_line.uri);
+                         })
+                    .build();
+
+  // 同步接口直接等待协程完成
+  EXPECT_EQ(body_of(router.handle(request(Method::Get, "/async"))), "async /async");
+
+  std::vector<HeaderView> storage;
+  auto req = request(Method::Get, "/async");
+  auto reply = router.respond(HttpRequestView::of(req, storage));
+  ASSERT_TRUE(std::holds_alternative<PendingResponse>(reply));
+  auto response = threadpool::coro::sync_wait(std::get<PendingResponse>(std::move(reply)));
+  EXPECT_EQ(body_of(response), "async /async");
+
+  auto sync_req = request(Method::Get, "/sync");
+  EXPECT_TRUE(std::holds_alternative<HttpResponse>(
+      router.respond(HttpRequestView::of(sync_req, storage))));
+}
+
+TEST(RouterBuilderTest, StreamHandlersReceiveBodyPieces) {
+  auto count_bytes = [](const HttpRequestView &) {
+    auto total = std::make_shared<size_t>(0);
+    return BodyReader{[total](std::string_view data) { *total += data.size(); },
+                      [total] { return text(std::to_string(*total)); }};
+  };
+  auto router = RouterBuilder{}
+                    .post("/upload", count_bytes)
+                    .get("/plain", [](const HttpRequest &) { return text("plain"); })
+                    .build();
+
+  auto req = request(Method::Post, "/upload");
+  req.body.assign(1000, 'x');
+  EXPECT_EQ(body_of(router.handle(req)), "1000");
+
+  std::vector<HeaderView> storage;
+  auto reader = router.body_reader(HttpRequestView::of(req, storage));
+  ASSERT_TRUE(reader.has_value());
+  reader->on_data("abc");
+  reader->on_data("de");
+  EXPECT_EQ(body_of(reader->finish()), "5");
+
+  auto plain = request(Method::Get, "/plain");
+  EXPECT_FALSE(router.body_reader(HttpRequestView::of(plain, storage)).has_value());
+}
+
+TEST(RouterTest, SyncHandlersGetRequestFromViewArena) {
+  std::pmr::memory_resource *seen = nullptr;
+  auto router = RouterBuilder{}
+                    .post("/echo",
+                          [&](const HttpRequest &req) {
+                            seen = req.body.get_allocator().resource();
+                            return HttpResponse::ok().with_body(req.body);
+                          })
+                    .build();
+  const uint8_t body[] = {'o', 'k'};
+  std::pmr::monotonic_buffer_resource arena;
+  HttpRequestView view{{Method::Post, "/echo", Version::Http11}, {}, body};
+  view.arena = &arena;
+
+  EXPECT_EQ(body_of(router.handle(view)), "ok");
+  EXPECT_EQ(seen, &arena);
+
+  view.arena = nullptr;
+  EXPECT_EQ(body_of(router.handle(view)), "ok");
+  EXPECT_EQ(seen, std::pmr::get_default_resource());
+}
+
+TEST(RouterTest, InstrumentTimesMatchesAndHandlersPerRoute) {
+  metrics::Registry registry;
+  auto router = RouterBuilder{}
+                    .get("/users/:id", [](const HttpRequest &) { return text("one"); })
+                    .get("/async",
+                         [](HttpRequest) -> PendingResponse { co_return text("async"); })
+                    .instrument(registry)
+                    .build()
+                    // 在接入指标的路由表上继续添加的路由同样被记录
+                    .post("/users", [](const HttpRequest &) { return text("create"); });
+  auto handler_time = [&](std::string_view method, std::string_view route) {
+    return registry
+        .histogram("http_handler_duration_seconds", "", {{"method", method}, {"route", route}})
+        .snapshot()
+        .count;
+  };
+
+  router.handle(request(Method::Get, "/users/1"));
+  router.handle(request(Method::Get, "/users/2"));
+  router.handle(request(Method::Post, "/users"));
+  router.handle(request(Method::Get, "/async"));
+  router.handle(request(Method::Get, "/missing"));
+
+  EXPECT_EQ(handler_time("GET", "/users/:id"), 2u);
+  EXPECT_EQ(handler_time("POST", "/users"), 1u);
+  EXPECT_EQ(handler_time("GET", "/async"), 1u);
+  EXPECT_EQ(registry.histogram("http_route_match_duration_seconds", "").snapshot().count, 5u);
+  EXPECT_EQ(Router{}.registry(), nullptr);
+}
+
+TEST(RouterTest, MetricsHandlerServesExposition) {
+  metrics::Registry registry;
+  registry.counter("hits_total", "Hits").add(2);
+  auto router = Router{}.get("/metrics", metrics_handler(registry));
+
+  auto response = router.handle(request(Method::Get, "/metrics"));
+
+  EXPECT_EQ(response.status_code, 200);
+  EXPECT_EQ(response.header("Content-Type"), "text/plain; version=0.0.4; charset=utf-8");
+  EXPECT_NE(body_of(response).find("hits_total 2\n"), std::string::npos);
+}
+
+TEST(RouterHandleTest, SwapKeepsInFlightSnapshot) {
+  RouterHandle handle(Router{}.get("/", [](const HttpRequest &) { return text("v1"); }));
+
+  auto snapshot = handle.load();
+  handle.store(Router{}.get("/", [](const HttpRequest &) { return text("v2"); }));
+
+  EXPECT_EQ(body_of(snapshot->handle(request(Method::Get, "/"))), "v1");
+  EXPECT_EQ(body_of(handle.handle(request(Method::Get, "/"))), "v2");
+}
+
+TEST(RouterHandleTest, ConcurrentReload) {
+  RouterHandle handle(Router{}.get("/", [](const HttpRequest &) { return text("0"); }));
+  std::atomic<bool> done{false};
+
+  std::thread reader([&] {
+    while (!done.load()) {
+      auto response = handle.handle(request(Method::Get, "/"));
+      ASSERT_EQ(response.status_code, 200);
+    }
+  });
+  for (int i = 1; i <= 200; ++i) {
+    handle.store(Router{}.get("/", [i](const HttpRequest &) { return text(std::to_string(i)); }));
+  }
+  done = true;
+  reader.join();
+
+  EXPECT_EQ(body_of(handle.handle(request(Method::Get, "/"))), "200");
+}
+
+namespace {
+
+// 每个测试独占的临时静态文件目录
+class StaticFilesTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    root_ = std::filesystem::temp_directory_path() /
+            ("static_files_test_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(root_ / "css");
+    write("index.html", "<h1>home</h1>");
+    write("css/site.css", "body{}");
+  }
+
+  void TearDown() override { std::filesystem::remove_all(root_); }
+
+  void write(const std::string &name, const std::string &content) {
+    std::ofstream(root_ / name, std::ios::binary | std::ios::trunc) << content;
+  }
+
+  static HttpRequest get(std::string uri,
+                         std::vector<std::pair<std::string, std::string>> headers = {}) {
+    auto req = request(Method::Get, std::move(uri));
+    for (auto &[key, value] : headers) {
+      req.headers.emplace(key, value);
+    }
+    return req;
+  }
+
+  std::filesystem::path root_;
+};
+
+} // namespace
+
+TEST_F(StaticFilesTest, ServesFilesWithPrecomputedHeaders) {
+  StaticFileCache cache(root_, {.url_prefix = "/static"});
+
+  auto response = cache.serve(get("/static/css/site.css?v=3"));
+  ASSERT_TRUE(response.has_value());
+  EXPECT_EQ(response->status_code, 200);
+  EXPECT_EQ(body_of(*response), "body{}");
+  EXPECT_EQ(response->header("Content-Type"), "text/css; charset=utf-8");
+  EXPECT_FALSE(response->headers["ETag"].empty());
+  EXPECT_TRUE(response->headers["Last-Modified"].ends_with(" GMT"));
+
+  EXPECT_EQ(body_of(*cache.serve(get("/static/"))), "<h1>home</h1>");
+  EXPECT_EQ(cache.cached_entries(), 2);
+
+  EXPECT_FALSE(cache.serve(get("/static/missing.js")).has_value());
+  EXPECT_FALSE(cache.serve(get("/static/../etc/passwd")).has_value());
+  EXPECT_FALSE(cache.serve(get("/static/%2e%2e/etc/passwd")).has_value());
+  EXPECT_FALSE(cache.serve(get("/other/index.html")).has_value());
+  EXPECT_FALSE(cache.serve(request(Method::Post, "/static/index.html")).has_value());
+
+  auto head = cache.serve(request(Method::Head, "/static/index.html"));
+  ASSERT_TRUE(head.has_value());
+  EXPECT_TRUE(head->body.empty());
+  EXPECT_EQ(head->headers["Content-Length"], "13");
+}
+
+TEST_F(StaticFilesTest, ConditionalRequestsGetNotModified) {
+  StaticFileCache cache(root_);
+  auto first = *cache.serve(get("/index.html"));
+  const auto etag = first.headers["ETag"];
+
+  auto by_etag = cache.serve(get("/index.html", {{"If-None-Match", "\"other\", " + etag}}));
+  EXPECT_EQ(by_etag->status_code, 304);
+  EXPECT_TRUE(by_etag->body.empty());
+  EXPECT_EQ(by_etag->headers["ETag"], etag);
+
+  auto by_date = cache.serve(get("/index.html", {{"If-Modified-Since", first.headers["Last-Modified"]}}));
+  EXPECT_EQ(by_date->status_code, 304);
+
+  auto stale = cache.serve(get("/index.html", {{"If-None-Match", "\"other\""}}));
+  EXPECT_EQ(stale->status_code, 200);
+  auto old = cache.serve(get("/index.html", {{"If-Modified-Since", "Sun, 06 Nov 1994 08:49:37 GMT"}}));
+  EXPECT_EQ(old->status_code, 200);
+}
+
+TEST_F(StaticFilesTest, ChangedFilesAreInvalidated) {
+  StaticFileCache cache(root_);
+  EXPECT_EQ(body_of(*cache.serve(get("/css/site.css"))), "body{}");
+
+  write("css/site.css", "body{color:red}");
+  EXPECT_EQ(body_of(*cache.serve(get("/css/site.css"))), "body{color:red}");
+
+  std::filesystem::remove(root_ / "css/site.css");
+  EXPECT_FALSE(cache.serve(get("/css/site.css")).has_value());
+}
+
+TEST_F(StaticFilesTest, LargeFilesKeepDescriptorAndBudgetEvicts) {
+  write("big.bin", std::string(200, 'b'));
+  StaticFileCache cache(root_, {.max_cache_bytes = 16, .max_inline_size = 100});
+
+  auto big = cache.serve(get("/big.bin"));
+  ASSERT_TRUE(big.has_value());
+  ASSERT_NE(big->file, nullptr);
+  EXPECT_EQ(big->body_size(), 200);
+  EXPECT_EQ(cache.cached_bytes(), 0);
+
+  // 内存预算只容得下一个小文件
+  EXPECT_EQ(body_of(*cache.serve(get("/index.html"))), "<h1>home</h1>");
+  EXPECT_EQ(body_of(*cache.serve(get("/css/site.css"))), "body{}");
+  EXPECT_LE(cache.cached_bytes(), 16);
+}
+
+TEST_F(StaticFilesTest, MiddlewareFallsThroughToNext) {
+  auto handler = middleware::compose({middleware::static_files(root_)},
+                                     [](const HttpRequest &) { return text("fallback"); });
+  EXPECT_EQ(body_of(handler(get("/index.html"))), "<h1>home</h1>");
+  EXPECT_EQ(body_of(handler(get("/api/users"))), "fallback");
+}
+
+namespace {
+
+std::string gunzip(std::span<const uint8_t> data) {
+  z_stream zs{};
+  inflateInit2(&zs, 15 + 16);
+  std::string out(1024 * 1024, '\0');
+  zs.next_in = const_cast<Bytef *>(data.data());
+  zs.avail_in = static_cast<uInt>(data.size());
+  zs.next_out = reinterpret_cast<Bytef *>(out.data());
+  zs.avail_out = static_cast<uInt>(out.size());
+  const int rc = inflate(&zs, Z_FINISH);
+  out.resize(rc == Z_STREAM_END ? zs.total_out : 0);
+  inflateEnd(&zs);
+  return out;
+}
+
+HttpRequest accepting(std::string uri, std::string encodings) {
+  auto req = request(Method::Get, std::move(uri));
+  req.headers["Accept-Encoding"] = std::move(encodings);
+  return req;
+}
+
+} // namespace
+
+TEST(CompressionTest, NegotiatesByQValue) {
+  const auto br = kBrotliAvailable ? ContentCoding::Brotli : ContentCoding::Gzip;
+  EXPECT_EQ(negotiate_coding(std::nullopt), ContentCoding::Identity);
+  EXPECT_EQ(negotiate_coding("gzip"), ContentCoding::Gzip);
+  EXPECT_EQ(negotiate_coding("gzip, deflate, br"), br);
+  EXPECT_EQ(negotiate_coding("br;q=0.5, gzip;q=0.8"), ContentCoding::Gzip);
+  EXPECT_EQ(negotiate_coding("gzip;q=0, br;q=0"), ContentCoding::Identity);
+  EXPECT_EQ(negotiate_coding("*"), br);
+  EXPECT_EQ(negotiate_coding("*;q=0.1, gzip;q=1"), ContentCoding::Gzip);
+  EXPECT_EQ(negotiate_coding("identity, deflate"), ContentCoding::Identity);
+  EXPECT_EQ(negotiate_coding("X-GZIP ; Q=1.000"), ContentCoding::Gzip);
+
+  EXPECT_TRUE(compressible_type("text/html; charset=utf-8"));
+  EXPECT_TRUE(compressible_type("application/problem+json"));
+  EXPECT_FALSE(compressible_type("image/png"));
+}
+
+TEST(CompressionTest, CompressesTextBodiesAboveThreshold) {
+  const std::string payload(4096, 'a');
+  auto handler = middleware::compose(
+      {middleware::compress({.min_size = 1024})}, [&payload](const HttpRequest &req) {
+        if (req.request_line.uri == "/small") {
+          return text("tiny");
+        }
+        if (req.request_line.uri == "/png") {
+          return HttpResponse::ok()
+              .with_header("Content-Type", "image/png")
+              .with_body({payload.begin(), payload.end()});
+        }
+        if (req.request_line.uri == "/sized") {
+          return text(payload).with_header("content-length", std::to_string(payload.size()));
+        }
+        return text(payload).with_header("ETag", "\"v1\"");
+      });
+
+  auto gzip = handler(accepting("/text", "gzip"));
+  EXPECT_EQ(gzip.headers["Content-Encoding"], "gzip");
+  EXPECT_EQ(gzip.headers["Vary"], "Accept-Encoding");
+  EXPECT_EQ(gzip.headers["ETag"], "\"v1-gzip\"");
+  EXPECT_LT(gzip.body.size(), payload.size());
+  EXPECT_EQ(gunzip(gzip.body), payload);
+  // 同一线程上的压缩上下文被复用，结果保持一致
+  EXPECT_EQ(gunzip(handler(accepting("/text", "gzip")).body), payload);
+
+  auto plain = handler(request(Method::Get, "/text"));
+  EXPECT_FALSE(plain.headers.contains("Content-Encoding"));
+  EXPECT_EQ(plain.headers["Vary"], "Accept-Encoding");
+  EXPECT_EQ(body_of(plain), payload);
+
+  EXPECT_EQ(body_of(handler(accepting("/small", "gzip"))), "tiny");
+  // handler 自己写的长度（任意大小写）在压缩后失效，必须去掉
+  auto sized = handler(accepting("/sized", "gzip"));
+  EXPECT_EQ(sized.headers["Content-Encoding"], "gzip");
+  EXPECT_FALSE(has_header(sized.headers, "Content-Length"));
+  EXPECT_FALSE(handler(accepting("/png", "gzip")).headers.contains("Content-Encoding"));
+
+  if (kBrotliAvailable) {
+    auto br = handler(accepting("/text", "br"));
+    EXPECT_EQ(br.headers["Content-Encoding"], "br");
+    EXPECT_LT(br.body.size(), payload.size());
+  }
+}
+
+TEST(CompressionTest, ResponseCacheKeysByNegotiatedCoding) {
+  int calls = 0;
+  auto handler = middleware::compose(
+      {middleware::response_cache(std::chrono::seconds(60), 1 << 20), middleware::compress()},
+      [&calls](const HttpRequest &) {
+        ++calls;
+        return text(std::string(2048, 'z'));
+      });
+
+  EXPECT_EQ(handler(accepting("/", "gzip")).headers["Content-Encoding"], "gzip");
+  EXPECT_EQ(body_of(handler(request(Method::Get, "/"))), std::string(2048, 'z'));
+  EXPECT_EQ(handler(accepting("/", "gzip;q=1")).headers["Content-Encoding"], "gzip");
+  EXPECT_EQ(calls, 2);
+}
+
+TEST_F(StaticFilesTest, ServesPrecompressedVariants) {
+  const std::string css = std::string(3000, ' ') + "body{}";
+  write("app.css", css);
+  write("big.js", std::string(200 * 1024, ';'));
+  StaticFileCache cache(root_, {.max_inline_size = 64 * 1024});
+
+  auto first = *cache.serve(accepting("/app.css", "gzip"));
+  EXPECT_EQ(first.headers["Content-Encoding"], "gzip");
+  EXPECT_EQ(first.headers["Vary"], "Accept-Encoding");
+  EXPECT_EQ(gunzip(first.body_bytes()), css);
+  const size_t with_variant = cache.cached_bytes();
+  EXPECT_EQ(with_variant, css.size() + first.body_size());
+
+  // 之后的请求直接使用缓存的压缩结果，与缓存共享同一份内容
+  auto second = *cache.serve(accepting("/app.css", "gzip"));
+  EXPECT_EQ(second.shared_body, first.shared_body);
+  EXPECT_EQ(cache.cached_bytes(), with_variant);
+
+  const auto etag = second.headers["ETag"];
+  auto not_modified = accepting("/app.css", "gzip");
+  not_modified.headers["If-None-Match"] = etag;
+  EXPECT_EQ(cache.serve(not_modified)->status_code, 304);
+  // 原文件的 ETag 与压缩版本不同，不能拿来验证压缩版本
+  auto identity = *cache.serve(get("/app.css"));
+  EXPECT_EQ(identity.shared_body, cache.serve(get("/app.css"))->shared_body);
+  EXPECT_FALSE(identity.headers.contains("Content-Encoding"));
+  EXPECT_NE(identity.headers["ETag"], etag);
+  EXPECT_EQ(body_of(identity), css);
+
+  // 超过 max_inline_size 的文件原样发送时走 sendfile，压缩版本放在内存里
+  auto big = *cache.serve(get("/big.js"));
+  EXPECT_NE(big.file, nullptr);
+  auto big_gzip = *cache.serve(accepting("/big.js", "gzip"));
+  EXPECT_EQ(big_gzip.file, nullptr);
+  EXPECT_EQ(gunzip(big_gzip.body_bytes()).size(), 200 * 1024);
+
+  // 文件变化后旧的压缩版本随条目一起失效
+  write("app.css", css + "a{}");
+  EXPECT_EQ(gunzip(cache.serve(accepting("/app.css", "gzip"))->body_bytes()), css + "a{}");
+}
+
+TEST_F(StaticFilesTest, SharedBodiesCompressDynamically) {
+  const std::string css = std::string(3000, ' ') + "body{}";
+  write("app.css", css);
+  auto handler = middleware::compose(
+      {middleware::compress(), middleware::static_files(root_, {.precompress = false})},
+      [](const HttpRequest &) { return text("fallback"); });
+
+  // 缓存的 body 是共享的，动态压缩替换响应的 body，不改动缓存里的内容
+  auto gzip = handler(accepting("/app.css", "gzip"));
+  EXPECT_EQ(gzip.headers["Content-Encoding"], "gzip");
+  EXPECT_EQ(gzip.shared_body, nullptr);
+  EXPECT_EQ(gunzip(gzip.body_bytes()), css);
+  EXPECT_EQ(body_of(handler(get("/app.css"))), css);
+}
+
+TEST(ResponseCacheTest, CachesIdempotentResponses) {
+  int calls = 0;
+  auto handler = middleware::compose(
+      {middleware::response_cache(std::chrono::seconds(60), 1 << 20)},
+      [&calls](const HttpRequest &req) {
+        ++calls;
+        if (req.request_line.uri == "/private") {
+          return text("secret").with_header("Cache-Control", "private");
+        }
+        if (req.request_line.uri == "/error") {
+          return HttpResponse::internal_server_error();
+        }
+        return text(req.request_line.uri + " #" + std::to_string(calls));
+      });
+
+  EXPECT_EQ(body_of(handler(request(Method::Get, "/a"))), "/a #1");
+  EXPECT_EQ(body_of(handler(request(Method::Get, "/a"))), "/a #1");
+  EXPECT_EQ(body_of(handler(request(Method::Get, "/a?x=1"))), "/a?x=1 #2");
+  EXPECT_EQ(body_of(handler(request(Method::Post, "/a"))), "/a #3");
+  EXPECT_EQ(body_of(handler(request(Method::Post, "/a"))), "/a #4");
+
+  handler(request(Method::Get, "/private"));
+  handler(request(Method::Get, "/private"));
+  handler(request(Method::Get, "/error"));
+  handler(request(Method::Get, "/error"));
+  EXPECT_EQ(calls, 8);
+
+  // 请求侧 no-cache 强制回源并刷新缓存
+  auto fresh = request(Method::Get, "/a");
+  fresh.headers["Cache-Control"] = "no-cache";
+  EXPECT_EQ(body_of(handler(fresh)), "/a #9");
+  EXPECT_EQ(body_of(handler(request(Method::Get, "/a"))), "/a #9");
+
+  auto authorized = request(Method::Get, "/a");
+  authorized.headers["Authorization"] = "Bearer t";
+  EXPECT_EQ(body_of(handler(authorized)), "/a #10");
+}
+
+TEST(ResponseCacheTest, ExpiresByTtlAndMaxAge) {
+  ResponseCache cache(std::chrono::seconds(10), 1 << 20);
+  const auto now = ResponseCache::Clock::now();
+
+  cache.store("GET /ttl", text("t"), now);
+  cache.store("GET /short", text("s").with_header("Cache-Control", "public, max-age=1"), now);
+  cache.store("GET /none", text("n").with_header("Cache-Control", "max-age=0"), now);
+  cache.store("GET /nostore", text("n").with_header("Cache-Control", "no-store"), now);
+  EXPECT_EQ(cache.size(), 2);
+
+  EXPECT_TRUE(cache.lookup("GET /short", now + std::chrono::milliseconds(500)).has_value());
+  EXPECT_FALSE(cache.lookup("GET /short", now + std::chrono::seconds(2)).has_value());
+  EXPECT_TRUE(cache.lookup("GET /ttl", now + std::chrono::seconds(9)).has_value());
+  EXPECT_FALSE(cache.lookup("GET /ttl", now + std::chrono::seconds(11)).has_value());
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(ResponseCacheTest, SkipsPerUserAndVaryingResponses) {
+  ResponseCache cache(std::chrono::seconds(10), 1 << 20);
+
+  cache.store("GET /lower", text("l").with_header("cache-control", "no-store"));
+  cache.store("GET /cookie", text("c").with_header("Set-Cookie", "sid=1"));
+  cache.store("GET /cookie2", text("c").with_header("set-cookie", "sid=2"));
+  cache.store("GET /agent", text("a").with_header("Vary", "Accept-Encoding, User-Agent"));
+  cache.store("GET /star", text("s").with_header("vary", "*"));
+  EXPECT_EQ(cache.size(), 0);
+
+  cache.store("GET /coded", text("e").with_header("vary", "accept-encoding"));
+  cache.store("GET /short", text("s").with_header("CACHE-CONTROL", "max-age=1"));
+  EXPECT_EQ(cache.size(), 2);
+  const auto later = ResponseCache::Clock::now() + std::chrono::seconds(2);
+  EXPECT_TRUE(cache.lookup("GET /coded", later).has_value());
+  EXPECT_FALSE(cache.lookup("GET /short", later).has_value());
+}
+
+TEST(ResponseCacheTest, ClockEvictionKeepsByteBudget) {
+  constexpr size_t kBudget = ResponseCache::kShards * 4096;
+  ResponseCache cache(std::chrono::seconds(60), kBudget);
+
+  cache.store("GET /hot", text(std::string(1000, 'h')));
+  for (int i = 0; i < 2000; ++i) {
+    ASSERT_TRUE(cache.lookup("GET /hot").has_value()) << i;
+    cache.store("GET /cold/" + std::to_string(i), text(std::string(1000, 'c')));
+  }
+  EXPECT_LE(cache.bytes(), kBudget);
+  EXPECT_GT(cache.size(), 0);
+
+  // 超过单个分片预算的响应不保存
+  cache.store("GET /huge", text(std::string(8192, 'x')));
+  EXPECT_FALSE(cache.lookup("GET /huge").has_value());
+}
+
+TEST(ResponseCacheTest, ConcurrentAccess) {
+  ResponseCache cache(std::chrono::seconds(60), 1 << 16);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, t] {
+      for (int i = 0; i < 2000; ++i) {
+        const auto key = "GET /" + std::to_string((i * 7 + t) % 300);
+        if (!cache.lookup(key)) {
+          cache.store(key, text(std::string(100, 'v')));
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_LE(cache.bytes(), size_t{1} << 16);
+}
+
+namespace {
+
+struct CountingSink : logger::Sink {
+  std::atomic<int> records{0};
+  void write(const logger::LogEntry &) override { ++records; }
+  void write_record(const logger::LogRecord &) override { ++records; }
+  void flush() override {}
+};
+
+// 记录进入与离开的顺序
+struct TraceLayer {
+  std::string name;
+  std::vector<std::string> *events;
+
+  template <typename Next>
+  HttpResponse operator()(const HttpRequest &req, Next &&next) const {
+    events->push_back(name + ">");
+    auto response = next(req);
+    events->push_back("<" + name);
+    return response;
+  }
+};
+
+struct PoweredByLayer {
+  const StaticHeaders *headers;
+
+  template <typename Next>
+  HttpResponse operator()(const HttpRequest &req, Next &&next) const {
+    return next(req).with_static_headers(*headers);
+  }
+};
+
+} // namespace
+
+TEST(MiddlewareTest, PipelineNestsLayersLikeCompose) {
+  std::vector<std::string> composed;
+  std::vector<std::string> pipelined;
+  const auto final_handler = [](const HttpRequest &) { return text("done"); };
+
+  auto dynamic = middleware::compose({middleware::layer(TraceLayer{"a", &composed}),
+                                      middleware::layer(TraceLayer{"b", &composed})},
+                                     final_handler);
+  auto fixed = middleware::pipeline(TraceLayer{"a", &pipelined},
+                                    TraceLayer{"b", &pipelined})(final_handler);
+
+  EXPECT_EQ(body_of(dynamic(request(Method::Get, "/"))), "done");
+  EXPECT_EQ(body_of(fixed(request(Method::Get, "/"))), "done");
+  EXPECT_EQ(composed, (std::vector<std::string>{"a>", "b>", "<b", "<a"}));
+  EXPECT_EQ(pipelined, composed);
+
+  // 静态组合的链可以直接注册为路由
+  auto router = Router{}.get("/", fixed);
+  EXPECT_EQ(body_of(router.handle(request(Method::Get, "/"))), "done");
+}
+
+TEST(MiddlewareTest, CorsUsesInternedStaticHeaders) {
+  auto handler = middleware::compose({middleware::cors()},
+                                     [](const HttpRequest &) { return HttpResponse::ok(); });
+  const auto first = handler(request(Method::Get, "/"));
+  const auto second = handler(request(Method::Get, "/"));
+
+  EXPECT_TRUE(first.headers.empty());
+  EXPECT_EQ(first.header("Access-Control-Allow-Origin"), "*");
+  EXPECT_EQ(first.header("Access-Control-Allow-Methods"), "GET, POST, PUT, DELETE");
+  EXPECT_EQ(first.static_headers[0], second.static_headers[0]);
+  EXPECT_EQ(first.static_headers[0], middleware::CorsLayer{}.headers);
+  EXPECT_NE(middleware::CorsLayer{"https://a.example"}.headers, first.static_headers[0]);
+  EXPECT_EQ(first.static_headers[0]->text(),
+            "Access-Control-Allow-Origin: *\r\n"
+            "Access-Control-Allow-Methods: GET, POST, PUT, DELETE\r\n");
+
+  // 槽位用完后退回普通 header
+  auto response = HttpResponse::ok();
+  for (int i = 0; i < 5; ++i) {
+    const auto value = std::to_string(i);
+    response = std::move(response).with_static_headers(
+        StaticHeaders::intern({{"X-Slot-" + value, value}}));
+  }
+  EXPECT_EQ(response.header("X-Slot-0"), "0");
+  EXPECT_EQ(response.headers.at("X-Slot-4"), "4");
+}
+
+TEST(MiddlewareTest, FiveLayerPipelineDoesNotAllocate) {
+  auto counting = std::make_unique<CountingSink>();
+  auto *records = &counting->records;
+  auto sink = std::make_shared<logger::AsyncSink>(std::move(counting));
+  const auto log = logger::Logger(logger::Level::Info).with_sink(sink);
+  const auto powered_by = &StaticHeaders::intern({{"X-Powered-By", "fp"}});
+
+  auto handler = middleware::pipeline(
+      middleware::LoggingLayer{log}, middleware::CorsLayer{},
+      middleware::AuthLayer{[](const HttpRequest &req) {
+        return req.header(HeaderId::Authorization).has_value();
+      }},
+      PoweredByLayer{powered_by}, middleware::CompressLayer{})([](const HttpRequest &) {
+    return HttpResponse{204, "No Content", {}, {}};
+  });
+
+  auto req = request(Method::Get, "/items");
+  req.headers.emplace("Authorization", "Bearer t");
+  (void)handler(req); // 本线程的日志缓冲在第一次写入时分配
+
+  // 只统计本线程的分配，AsyncSink 后台线程的分配不算在内
+  const size_t before = alloc_counter::this_thread();
+  int ok = 0;
+  for (int i = 0; i < 100; ++i) {
+    const auto response = handler(req);
+    ok += response.status_code == 204 && response.header("X-Powered-By") == "fp" &&
+          response.header("Access-Control-Allow-Origin") == "*";
+  }
+  EXPECT_EQ(alloc_counter::this_thread() - before, 0u);
+  EXPECT_EQ(ok, 100);
+
+  sink->flush();
+  EXPECT_EQ(records->load(), 101);
+}
@@ -0,0 +1,114 @@
+#include "scan.hpp"
+#include "http_parser.hpp"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace http::parser;
+
+namespace {
+
+template <typename Pred> size_t reference_find(std::string_view s, Pred pred) {
+  for (size_t i = 0; i < s.size(); ++i) {
+    if (pred(static_cast<unsigned char>(s[i]))) {
+      return i;
+    }
+  }
+  return scan::npos;
+}
+
+// 把每一种字节值放到每一个位置上，覆盖向量主体、向量边界和标量尾部
+template <typename Kernel, typename Pred>
+void check_every_byte_at_every_offset(Kernel kernel, Pred pred, char filler) {
+  for (size_t len : {1, 15, 16, 17, 31, 32, 33, 64, 70}) {
+    for (size_t pos = 0; pos < len; ++pos) {
+      for (int b = 0; b < 256; ++b) {
+        std::string s(len, filler);
+        s[pos] = static_cast<char>(b);
+        ASSERT_EQ(kernel(s), reference_find(s, pred))
+            << "len=" << len << " pos=" << pos << " byte=" << b;
+      }
+    }
+  }
+}
+
+} // namespace
+
+TEST(ScanTest, FindNonTchar) {
+  check_every_byte_at_every_offset(
+      [](std::string_view s) { return scan::find_non_tchar(s); },
+      [](unsigned char c) { return !scan::detail::is_tchar(c); }, 'a');
+}
+
+TEST(ScanTest, FindFieldCtl) {
+  check_every_byte_at_every_offset(
+      [](std::string_view s) { return scan::find_field_ctl(s); }, scan::detail::is_field_ctl, 'v');
+}
+
+TEST(ScanTest, FindUriEnd) {
+  check_every_byte_at_every_offset(
+      [](std::string_view s) { return scan::find_uri_end(s); }, scan::detail::is_uri_end, '/');
+}
+
+TEST(ScanTest, FindCrlfMatchesStringFind) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> pick(0, 3);
+  const char alphabet[] = {'\r', '\n', 'x', ' '};
+
+  for (int iter = 0; iter < 2000; ++iter) {
+    std::string s(static_cast<size_t>(iter % 97), 'x');
+    for (auto &c : s) {
+      c = alphabet[pick(rng)];
+    }
+    for (size_t from : {size_t{0}, size_t{1}, s.size() / 2}) {
+      ASSERT_EQ(scan::find_crlf(s, from), std::string_view(s).find("\r\n", from))
+          << "iteration " << iter << " from " << from;
+    }
+  }
+}
+
+TEST(ScanTest, FindCrlfAcrossVectorBoundary) {
+  for (size_t pos = 0; pos < 70; ++pos) {
+    std::string s(72, 'a');
+    s[pos] = '\r';
+    s[pos + 1] = '\n';
+    EXPECT_EQ(scan::find_crlf(s), pos);
+  }
+  EXPECT_EQ(scan::find_crlf(std::string(64, 'a') + "\r"), scan::npos);
+}
+
+TEST(ScanTest, HeaderRejectsIllegalBytes) {
+  EXPECT_FALSE(parse_header_view()("Bad Name: v\r\n").has_value());
+  EXPECT_FALSE(parse_header_view()("Na(me: v\r\n").has_value());
+  EXPECT_FALSE(parse_header_view()(": v\r\n").has_value());
+  EXPECT_FALSE(parse_header_view()("Name: a\nb\r\n").has_value());
+  EXPECT_FALSE(parse_header_view()(std::string_view("Name: a\0b\r\n", 12)).has_value());
+  EXPECT_FALSE(parse_header_view()("Name: a\rb\r\n").has_value());
+}
+
+TEST(ScanTest, HeaderAcceptsLongCookie) {
+  std::string cookie(1500, 'c');
+  cookie[700] = '\t';
+  cookie[701] = ';';
+  std::string line = "Cookie: " + cookie + "  \r\n";
+
+  auto result = parse_header_view()(line);
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->first.key, "Cookie");
+  EXPECT_EQ(result->first.value, cookie);
+}
+
+TEST(ScanTest, TakeToken) {
+  auto result = combinator::take_token()("Content-Type: x");
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->first, "Content-Type");
+  EXPECT_EQ(result->second, ": x");
+  EXPECT_FALSE(combinator::take_token()(":x").has_value());
+}
+
+TEST(ScanTest, TakeUntilCrlf) {
+  auto result = combinator::take_until_crlf()("line\r\nnext");
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->first, "line");
+  EXPECT_EQ(result->second, "\r\nnext");
+  EXPECT_EQ(combinator::take_until_crlf()("line\r").error(), ParseError::IncompleteRequest);
+}
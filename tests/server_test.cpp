@@ -0,0 +1,961 @@
+#include "http/server.hpp"
+#include "threadpool/pool.hpp"
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <gtest/gtest.h>
+
+using namespace http::server;
+using namespace http::router;
+using namespace http::parser;
+
+namespace {
+
+UniqueFd connect_to(uint16_t port) {
+  UniqueFd fd(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  if (::connect(fd.get(), reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+    return UniqueFd{};
+  }
+  return fd;
+}
+
+void send_all(int fd, std::string_view data) {
+  while (!data.empty()) {
+    const auto n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (n <= 0) {
+      return;
+    }
+    data.remove_prefix(static_cast<size_t>(n));
+  }
+}
+
+std::string read_until_close(int fd) {
+  std::string out;
+  char buf[4096];
+  while (true) {
+    const auto n = ::recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) {
+      break;
+    }
+    out.append(buf, static_cast<size_t>(n));
+  }
+  return out;
+}
+
+// 读一个 Content-Length 定界的响应，连接保持打开；多读到的字节留在 rest 里给下一个响应
+std::string read_response(int fd, std::string &rest) {
+  char buf[4096];
+  while (true) {
+    if (const auto end = rest.find("\r\n\r\n"); end != std::string::npos) {
+      const auto cl = rest.find("Content-Length: ");
+      const size_t size = end + 4 + (cl < end ? std::stoul(rest.substr(cl + 16)) : 0);
+      if (rest.size() >= size) {
+        auto out = rest.substr(0, size);
+        rest.erase(0, size);
+        return out;
+      }
+    }
+    const auto n = ::recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) {
+      return std::exchange(rest, {});
+    }
+    rest.append(buf, static_cast<size_t>(n));
+  }
+}
+
+std::string read_response(int fd) {
+  std::string rest;
+  return read_response(fd, rest);
+}
+
+// HTTP/1.1 连接默认保持，关闭写端后服务器应答完即关闭
+std::string round_trip(uint16_t port, std::string_view request) {
+  auto fd = connect_to(port);
+  if (!fd) {
+    return {};
+  }
+  send_all(fd.get(), request);
+  ::shutdown(fd.get(), SHUT_WR);
+  return read_until_close(fd.get());
+}
+
+// 非阻塞地反复发送 request，直到对端 200ms 不再接收或发出 limit 字节。
+// 返回完整发出的请求数；最后一个请求没发完的部分在 rest 里
+size_t pipeline_until_blocked(int fd, std::string_view request, size_t limit, std::string &rest) {
+  std::string batch;
+  for (size_t i = 0; i < 1024; ++i) {
+    batch += request;
+  }
+  const int flags = ::fcntl(fd, F_GETFL);
+  ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  size_t sent = 0;
+  size_t offset = 0; // batch 里下一个待发送的字节
+  auto last_progress = std::chrono::steady_clock::now();
+  while (sent < limit &&
+         std::chrono::steady_clock::now() - last_progress < std::chrono::milliseconds(200)) {
+    const auto n = ::send(fd, batch.data() + offset, batch.size() - offset, MSG_NOSIGNAL);
+    if (n <= 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    sent += static_cast<size_t>(n);
+    offset = (offset + static_cast<size_t>(n)) % batch.size();
+    last_progress = std::chrono::steady_clock::now();
+  }
+  ::fcntl(fd, F_SETFL, flags);
+  const size_t partial = sent % request.size();
+  rest = partial > 0 ? std::string(request.substr(partial)) : std::string();
+  return sent / request.size() + (partial > 0 ? 1 : 0);
+}
+
+Router test_router() {
+  const auto hello = [](const HttpRequest &) { return HttpResponse::ok().with_text("hello"); };
+  const auto sized = [](const HttpRequest &) {
+    return HttpResponse::ok().with_header("Content-Length", "6").with_stream(
+        [i = 0](std::string &out) mutable {
+          out += i == 0 ? "abc" : "def";
+          return ++i < 2;
+        });
+  };
+  return Router()
+      .get("/", hello)
+      .route(Method::Head, "/", hello)
+      .post("/echo", [](const HttpRequest &req) {
+        return HttpResponse::ok().with_body(req.body);
+      })
+      .get("/agent", [](const HttpRequestView &req) {
+        return HttpResponse::ok().with_text(std::string(req.header("User-Agent").value_or("-")));
+      })
+      .get("/sized", sized)
+      .route(Method::Head, "/sized", sized);
+}
+
+// 同一组用例分别跑在两个 I/O 后端上；不支持 io_uring 的内核上第二组实际退回 epoll
+class ServerTest : public ::testing::TestWithParam<IoBackend> {
+protected:
+  void SetUp() override {
+    ServerConfig config;
+    config.host = "127.0.0.1";
+    config.port = 0;
+    config.num_reactors = 2;
+    config.io_backend = GetParam();
+    server_ = std::make_unique<Server>(config, test_router());
+    ASSERT_TRUE(server_->start().has_value());
+  }
+
+  void TearDown() override { server_->stop(); }
+
+  std::unique_ptr<Server> server_;
+};
+
+} // namespace
+
+INSTANTIATE_TEST_SUITE_P(Backends, ServerTest,
+                         ::testing::Values(IoBackend::Epoll, IoBackend::IoUring),
+                         [](const auto &info) {
+                           return info.param == IoBackend::Epoll ? "Epoll" : "IoUring";
+                         });
+
+TEST_P(ServerTest, SimpleGet) {
+  auto response = round_trip(server_->port(), "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+
+  EXPECT_TRUE(response.starts_with("HTTP/1.1 200 OK\r\n"));
+  EXPECT_NE(response.find("Content-Length: 5\r\n"), std::string::npos);
+  EXPECT_TRUE(response.ends_with("\r\n\r\nhello"));
+}
+
+TEST_P(ServerTest, NotFound) {
+  auto response = round_trip(server_->port(), "GET /missing HTTP/1.1\r\n\r\n");
+
+  EXPECT_TRUE(response.starts_with("HTTP/1.1 404 Not Found\r\n"));
+}
+
+TEST_P(ServerTest, MalformedRequest) {
+  auto response = round_trip(server_->port(), "BOGUS / HTTP/1.1\r\n\r\n");
+
+  EXPECT_TRUE(response.starts_with("HTTP/1.1 400 Bad Request\r\n"));
+}
+
+TEST_P(ServerTest, BodySplitAcrossWrites) {
+  auto fd = connect_to(server_->port());
+  ASSERT_TRUE(fd);
+
+  send_all(fd.get(), "POST /echo HTTP/1.1\r\nContent-Le");
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  send_all(fd.get(), "ngth: 11\r\n\r\nhello ");
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  send_all(fd.get(), "world");
+
+  auto response = read_response(fd.get());
+  EXPECT_TRUE(response.starts_with("HTTP/1.1 200 OK\r\n"));
+  EXPECT_TRUE(response.ends_with("\r\n\r\nhello world"));
+}
+
+TEST_P(ServerTest, ViewHandler) {
+  auto response = round_trip(server_->port(), "GET /agent HTTP/1.1\r\nUser-Agent: gtest\r\n\r\n");
+
+  EXPECT_TRUE(response.starts_with("HTTP/1.1 200 OK\r\n"));
+  EXPECT_TRUE(response.ends_with("\r\n\r\ngtest"));
+}
+
+TEST_P(ServerTest, ManyConnections) {
+  for (int i = 0; i < 50; ++i) {
+    auto response = round_trip(server_->port(), "GET / HTTP/1.1\r\n\r\n");
+    ASSERT_TRUE(response.ends_with("hello")) << "iteration " << i;
+  }
+}
+
+TEST_P(ServerTest, HotReloadRoutes) {
+  server_->reload(RouterBuilder{}
+                      .get("/", [](const HttpRequest &) { return HttpResponse::ok().with_text("v2"); })
+                      .build());
+
+  auto response = round_trip(server_->port(), "GET / HTTP/1.1\r\n\r\n");
+  EXPECT_TRUE(response.ends_with("\r\n\r\nv2"));
+  response = round_trip(server_->port(), "GET /agent HTTP/1.1\r\n\r\n");
+  EXPECT_TRUE(response.starts_with("HTTP/1.1 404 Not Found\r\n"));
+}
+
+TEST_P(ServerTest, AsyncHandlerRunsOnPool) {
+  threadpool::ThreadPool pool(2);
+  server_->reload(
+      RouterBuilder{}
+          .get("/async",
+               [&pool](HttpRequest req) -> PendingResponse {
+                 co_await pool.schedule();
+                 co_return HttpResponse::ok().with_text("async " + req.request_line.uri);
+               })
+          .get("/throws",
+               [](HttpRequest) -> PendingResponse {
+                 throw std::runtime_error("downstream failed");
+                 co_return HttpResponse::ok();
+               })
+          .build());
+
+  auto response = round_trip(server_->port(), "GET /async HTTP/1.1\r\n\r\n");
+  EXPECT_TRUE(response.starts_with("HTTP/1.1 200 OK\r\n"));
+  EXPECT_TRUE(response.ends_with("\r\n\r\nasync /async"));
+
+  response = round_trip(server_->port(), "GET /throws HTTP/1.1\r\n\r\n");
+  EXPECT_TRUE(response.starts_with("HTTP/1.1 500 Internal Server Error\r\n"));
+  EXPECT_TRUE(response.ends_with("Handler error: downstream failed"));
+}
+
+TEST_P(ServerTest, KeepAliveServesSequentialRequests) {
+  auto fd = connect_to(server_->port());
+  ASSERT_TRUE(fd);
+
+  for (int i = 0; i < 3; ++i) {
+    send_all(fd.get(), "GET / HTTP/1.1\r\n\r\n");
+    auto response = read_response(fd.get());
+    EXPECT_NE(response.find("Connection: keep-alive\r\n"), std::string::npos);
+    EXPECT_TRUE(response.ends_with("\r\n\r\nhello")) << "request " << i;
+  }
+}
+
+TEST_P(ServerTest, PipelinedRequestsAnsweredInOrder) {
+  auto fd = connect_to(server_->port());
+  ASSERT_TRUE(fd);
+
+  send_all(fd.get(), "GET / HTTP/1.1\r\n\r\n"
+                     "POST /echo HTTP/1.1\r\nContent-Length: 4\r\n\r\nping"
+                     "GET /agent HTTP/1.1\r\nUser-Agent: third\r\nConnection: close\r\n\r\n"
+                     "GET / HTTP/1.1\r\n\r\n");
+
+  auto response = read_until_close(fd.get());
+  const auto first = response.find("hello");
+  const auto second = response.find("\r\n\r\nping");
+  const auto third = response.find("\r\n\r\nthird");
+  ASSERT_NE(first, std::string::npos);
+  ASSERT_NE(second, std::string::npos);
+  ASSERT_NE(third, std::string::npos);
+  EXPECT_LT(first, second);
+  EXPECT_LT(second, third);
+  // Connection: close 之后的请求不再处理
+  EXPECT_TRUE(response.ends_with("third"));
+}
+
+TEST_P(ServerTest, StreamWithContentLengthIsSentRaw) {
+  auto fd = connect_to(server_->port());
+  ASSERT_TRUE(fd);
+
+  send_all(fd.get(), "GET /sized HTTP/1.1\r\n\r\nGET / HTTP/1.1\r\nConnection: close\r\n\r\n");
+  auto response = read_until_close(fd.get());
+  const auto second = response.find("HTTP/1.1", 1);
+  ASSERT_NE(second, std::string::npos);
+  const auto first = response.substr(0, second);
+  EXPECT_EQ(first.find("Transfer-Encoding"), std::string::npos);
+  EXPECT_NE(first.find("Content-Length: 6\r\n"), std::string::npos);
+  EXPECT_TRUE(first.ends_with("\r\n\r\nabcdef"));
+  EXPECT_TRUE(response.ends_with("\r\n\r\nhello"));
+}
+
+TEST_P(ServerTest, PipelinedHeadResponsesHaveNoBody) {
+  auto fd = connect_to(server_->port());
+  ASSERT_TRUE(fd);
+
+  send_all(fd.get(), "HEAD / HTTP/1.1\r\n\r\n"
+                     "HEAD /nope HTTP/1.1\r\n\r\n"
+                     "HEAD /sized HTTP/1.1\r\n\r\n"
+                     "GET / HTTP/1.1\r\nConnection: close\r\n\r\n");
+  auto response = read_until_close(fd.get());
+  std::vector<std::string> heads;
+  for (size_t start = 0; start < response.size();) {
+    const auto end = response.find("\r\n\r\n", start);
+    ASSERT_NE(end, std::string::npos);
+    heads.push_back(response.substr(start, end + 4 - start));
+    start = end + 4;
+    if (heads.size() == 4) {
+      EXPECT_EQ(response.substr(start), "hello");
+      break;
+    }
+  }
+  ASSERT_EQ(heads.size(), 4);
+  // 长度仍然按 GET 时的 body 给出
+  EXPECT_NE(heads[0].find("Content-Length: 5\r\n"), std::string::npos);
+  EXPECT_TRUE(heads[1].starts_with("HTTP/1.1 404 Not Found\r\n"));
+  EXPECT_NE(heads[1].find("Content-Length: 15\r\n"), std::string::npos);
+  EXPECT_NE(heads[2].find("Content-Length: 6\r\n"), std::string::npos);
+  EXPECT_TRUE(heads[3].starts_with("HTTP/1.1 200 OK\r\n"));
+}
+
+TEST_P(ServerTest, Http10ClosesByDefault) {
+  auto fd = connect_to(server_->port());
+  ASSERT_TRUE(fd);
+
+  send_all(fd.get(), "GET / HTTP/1.0\r\n\r\n");
+  auto response = read_until_close(fd.get());
+  EXPECT_NE(response.find("Connection: close\r\n"), std::string::npos);
+  EXPECT_TRUE(response.ends_with("\r\n\r\nhello"));
+}
+
+TEST_P(ServerTest, ChunkedRequestBody) {
+  auto fd = connect_to(server_->port());
+  ASSERT_TRUE(fd);
+
+  send_all(fd.get(), "POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhel");
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  send_all(fd.get(), "lo\r\n6;ext=1\r\n world\r\n0\r\n\r\nGET / HTTP/1.1\r\n\r\n");
+
+  std::string rest;
+  auto response = read_response(fd.get(), rest);
+  EXPECT_TRUE(response.ends_with("\r\n\r\nhello world"));
+  response = read_response(fd.get(), rest);
+  EXPECT_TRUE(response.ends_with("\r\n\r\nhello"));
+}
+
+TEST_P(ServerTest, AmbiguousFramingRejected) {
+  auto response = round_trip(server_->port(), "POST /echo HTTP/1.1\r\nContent-Length: 3\r\n"
+                                               "Transfer-Encoding: chunked\r\n\r\n0\r\n\r\n");
+  EXPECT_TRUE(response.starts_with("HTTP/1.1 400 Bad Request\r\n"));
+  EXPECT_NE(response.find("Connection: close\r\n"), std::string::npos);
+}
+
+TEST_P(ServerTest, PipelinedAsyncResponsesKeepOrder) {
+  threadpool::ThreadPool pool(2);
+  server_->reload(
+      RouterBuilder{}
+          .get("/slow",
+               [&pool](HttpRequest) -> PendingResponse {
+                 co_await pool.schedule();
+                 std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                 co_return HttpResponse::ok().with_text("slow");
+               })
+          .get("/fast", [](const HttpRequest &) { return HttpResponse::ok().with_text("fast"); })
+          .build());
+
+  auto fd = connect_to(server_->port());
+  ASSERT_TRUE(fd);
+  send_all(fd.get(), "GET /slow HTTP/1.1\r\n\r\nGET /fast HTTP/1.1\r\n\r\n");
+
+  std::string rest;
+  EXPECT_TRUE(read_response(fd.get(), rest).ends_with("\r\n\r\nslow"));
+  EXPECT_TRUE(read_response(fd.get(), rest).ends_with("\r\n\r\nfast"));
+}
+
+// 请求处理中时连接只缓冲有限的后续输入，其余留在内核缓冲区里，由 TCP 流量控制让客户端停下
+class ServerBackpressureTest : public ::testing::TestWithParam<IoBackend> {
+protected:
+  static ServerConfig config() {
+    ServerConfig config;
+    config.host = "127.0.0.1";
+    config.port = 0;
+    config.num_reactors = 1;
+    config.io_backend = GetParam();
+    config.limits.max_header_size = 1024;
+    config.limits.max_body_size = 1024;
+    config.limits.max_queued_output = 64 * 1024;
+    return config;
+  }
+
+  // 发送 first 后管线化大量小请求，直到服务器不再接收；返回随后的请求数，
+  // 最后一个请求没发完的部分留在 tail_ 里
+  size_t flood(int fd, std::string_view first) {
+    send_all(fd, first);
+    const size_t count = pipeline_until_blocked(fd, kRequest, kLimit, tail_);
+    EXPECT_LT(count * kRequest.size(), kLimit) << "server kept buffering input";
+    return count;
+  }
+
+  // 补完最后一个请求，按顺序读出 count 个 body 为 body 的响应，返回读到的个数
+  size_t drain(int fd, std::string &rest, size_t count, std::string_view body) {
+    std::jthread tail([this, fd] { send_all(fd, tail_); });
+    const auto suffix = "\r\n\r\n" + std::string(body);
+    size_t answered = 0;
+    while (answered < count && read_response(fd, rest).ends_with(suffix)) {
+      ++answered;
+    }
+    return answered;
+  }
+
+  static constexpr std::string_view kRequest = "GET / HTTP/1.1\r\nX-Pad: 0123456789abcdef\r\n\r\n";
+  static constexpr size_t kLimit = 32 * 1024 * 1024;
+  std::string tail_;
+};
+
+INSTANTIATE_TEST_SUITE_P(Backends, ServerBackpressureTest,
+                         ::testing::Values(IoBackend::Epoll, IoBackend::IoUring),
+                         [](const auto &info) {
+                           return info.param == IoBackend::Epoll ? "Epoll" : "IoUring";
+                         });
+
+TEST_P(ServerBackpressureTest, PipelinedInputIsBoundedWhileHandlerPending) {
+  threadpool::ThreadPool pool(1);
+  std::promise<void> release;
+  const auto released = release.get_future().share();
+  Server server(config(),
+                test_router().get("/hold", [&pool, &released](HttpRequest) -> PendingResponse {
+                  co_await pool.schedule();
+                  released.wait();
+                  co_return HttpResponse::ok().with_text("held");
+                }));
+  ASSERT_TRUE(server.start().has_value());
+
+  auto fd = connect_to(server.port());
+  ASSERT_TRUE(fd);
+  const size_t count = flood(fd.get(), "GET /hold HTTP/1.1\r\n\r\n");
+  release.set_value();
+  if (HasFailure()) {
+    return;
+  }
+
+  // 积压解除后缓冲的和留在内核里的请求都会被处理，响应仍按顺序
+  std::string rest;
+  EXPECT_TRUE(read_response(fd.get(), rest).ends_with("\r\n\r\nheld"));
+  EXPECT_EQ(drain(fd.get(), rest, count, "hello"), count);
+}
+
+TEST_P(ServerBackpressureTest, PipelinedInputIsBoundedWhileStreaming) {
+  constexpr size_t kPieces = 2048; // 8 MiB，远大于套接字缓冲区
+  Server server(config(), test_router().get("/download", [](const HttpRequest &) {
+    return HttpResponse::ok().with_stream([i = size_t{0}](std::string &out) mutable {
+      out.assign(4096, 's');
+      return ++i < kPieces;
+    });
+  }));
+  ASSERT_TRUE(server.start().has_value());
+
+  // 客户端不读响应，流式响应一直发不完
+  auto fd = connect_to(server.port());
+  ASSERT_TRUE(fd);
+  const size_t count = flood(fd.get(), "GET /download HTTP/1.1\r\n\r\n");
+  if (HasFailure()) {
+    return;
+  }
+
+  std::string rest;
+  char buf[16 * 1024];
+  size_t head_end = 0;
+  while ((head_end = rest.find("\r\n\r\n")) == std::string::npos) {
+    const auto n = ::recv(fd.get(), buf, sizeof(buf), 0);
+    ASSERT_GT(n, 0);
+    rest.append(buf, static_cast<size_t>(n));
+  }
+  rest.erase(0, head_end + 4);
+  ChunkedDecoder decoder;
+  size_t body = 0;
+  while (true) {
+    auto consumed = decoder.feed(rest, [&body](std::string_view data) -> ParseResult<void> {
+      body += data.size();
+      return {};
+    });
+    ASSERT_TRUE(consumed.has_value());
+    rest.erase(0, *consumed);
+    if (decoder.done()) {
+      break;
+    }
+    const auto n = ::recv(fd.get(), buf, sizeof(buf), 0);
+    ASSERT_GT(n, 0);
+    rest.append(buf, static_cast<size_t>(n));
+  }
+  EXPECT_EQ(body, kPieces * 4096);
+  EXPECT_EQ(drain(fd.get(), rest, count, "hello"), count);
+}
+
+TEST(ServerStreamingTest, StreamsBodiesBothWays) {
+  ServerConfig config;
+  config.host = "127.0.0.1";
+  config.port = 0;
+  config.num_reactors = 1;
+  config.limits.max_body_size = 1024;
+
+  constexpr size_t kPieces = 200;
+  auto router =
+      RouterBuilder{}
+          .post("/upload",
+                [](const HttpRequestView &) {
+                  auto total = std::make_shared<size_t>(0);
+                  return BodyReader{[total](std::string_view data) { *total += data.size(); },
+                                    [total] {
+                                      return HttpResponse::ok().with_text(std::to_string(*total));
+                                    }};
+                })
+          .get("/download",
+               [](const HttpRequest &) {
+                 return HttpResponse::ok().with_stream(
+                     [i = size_t{0}](std::string &out) mutable {
+                       out.assign(4096, static_cast<char>('a' + i % 26));
+                       return ++i < kPieces;
+                     });
+               })
+          .build();
+  Server server(config, std::move(router));
+  ASSERT_TRUE(server.start().has_value());
+
+  // 上传远大于 max_body_size 的 body
+  auto fd = connect_to(server.port());
+  ASSERT_TRUE(fd);
+  constexpr size_t kUpload = 1 << 20;
+  send_all(fd.get(), "POST /upload HTTP/1.1\r\nContent-Length: " + std::to_string(kUpload) +
+                         "\r\n\r\n");
+  const std::string block(64 * 1024, 'u');
+  for (size_t sent = 0; sent < kUpload; sent += block.size()) {
+    send_all(fd.get(), block);
+  }
+  EXPECT_TRUE(read_response(fd.get()).ends_with("\r\n\r\n" + std::to_string(kUpload)));
+
+  // 下载按 chunked 编码分段发送，同一连接上随后的请求排在它后面
+  send_all(fd.get(), "GET /download HTTP/1.1\r\n\r\nGET /download HTTP/1.0\r\n\r\n");
+  auto response = read_until_close(fd.get());
+  const auto head_end = response.find("\r\n\r\n");
+  ASSERT_NE(head_end, std::string::npos);
+  EXPECT_NE(response.substr(0, head_end).find("Transfer-Encoding: chunked"), std::string::npos);
+
+  ChunkedDecoder decoder;
+  std::string body;
+  auto consumed = decoder.feed(std::string_view(response).substr(head_end + 4),
+                               [&](std::string_view data) -> ParseResult<void> {
+                                 body += data;
+                                 return {};
+                               });
+  ASSERT_TRUE(consumed.has_value());
+  ASSERT_TRUE(decoder.done());
+  EXPECT_EQ(body.size(), kPieces * 4096);
+  EXPECT_EQ(body.substr(4096, 3), "bbb");
+
+  // HTTP/1.0 不支持 chunked：原样写出 body 后关闭连接
+  auto rest = response.substr(head_end + 4 + *consumed);
+  const auto second_head = rest.find("\r\n\r\n");
+  ASSERT_NE(second_head, std::string::npos);
+  EXPECT_NE(rest.find("Connection: close"), std::string::npos);
+  EXPECT_EQ(rest.size() - second_head - 4, kPieces * 4096);
+}
+
+TEST(WriteQueueTest, GathersSegmentsAndFiles) {
+  int fds[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+  UniqueFd writer(fds[0]);
+  UniqueFd reader(fds[1]);
+
+  const auto path = std::filesystem::temp_directory_path() / "write_queue_test.txt";
+  std::ofstream(path) << "from a file";
+
+  WriteQueue queue;
+  queue.push_response(HttpResponse::ok().with_text("first"), true, BodyFraming::Length);
+  queue.push_response(HttpResponse::ok().with_file(path), true, BodyFraming::Length);
+  queue.push("tail");
+  ASSERT_EQ(queue.flush(writer.get()), WriteQueue::Status::Drained);
+  EXPECT_TRUE(queue.empty());
+  writer.reset();
+
+  auto out = read_until_close(reader.get());
+  const auto file_head = out.find("HTTP/1.1 200 OK", 1);
+  ASSERT_NE(file_head, std::string::npos);
+  EXPECT_TRUE(out.substr(0, file_head).ends_with("\r\n\r\nfirst"));
+  EXPECT_NE(out.find("Content-Length: 11\r\n", file_head), std::string::npos);
+  EXPECT_TRUE(out.ends_with("\r\n\r\nfrom a filetail"));
+  std::filesystem::remove(path);
+}
+
+TEST(ResponseHeadTest, WritesStaticHeadersAfterHeaders) {
+  const auto &cors = StaticHeaders::intern({{"Access-Control-Allow-Origin", "*"}});
+  const auto out = serialize(HttpResponse::ok().with_text("hi").with_static_headers(cors));
+  const auto type = out.find("Content-Type: text/plain\r\n");
+  const auto origin = out.find("Access-Control-Allow-Origin: *\r\n");
+  ASSERT_NE(type, std::string::npos);
+  ASSERT_NE(origin, std::string::npos);
+  EXPECT_LT(type, origin);
+  EXPECT_TRUE(out.ends_with("Content-Length: 2\r\nConnection: close\r\n\r\nhi"));
+}
+
+TEST(ResponseHeadTest, FramingHeadersMatchCaseInsensitively) {
+  const auto out = serialize(HttpResponse::ok()
+                                 .with_text("hi")
+                                 .with_header("content-length", "2")
+                                 .with_header("connection", "keep-alive"));
+  EXPECT_EQ(out.find("Content-Length"), std::string::npos);
+  EXPECT_EQ(out.find("Connection"), std::string::npos);
+  EXPECT_TRUE(out.ends_with("\r\n\r\nhi"));
+
+  // 流式响应带小写 content-length 时按长度发送，不改成 chunked
+  const auto stream = HttpResponse::ok()
+                          .with_header("content-length", "3")
+                          .with_stream([](std::string &piece) {
+                            piece += "abc";
+                            return false;
+                          });
+  EXPECT_EQ(framing_of(stream), BodyFraming::Length);
+}
+
+TEST_P(ServerTest, FileResponsesUseSendfile) {
+  const auto path = std::filesystem::temp_directory_path() / "server_file_test.bin";
+  std::string content(3 << 20, '\0');
+  for (size_t i = 0; i < content.size(); ++i) {
+    content[i] = static_cast<char>('a' + i % 26);
+  }
+  std::ofstream(path, std::ios::binary) << content;
+
+  server_->reload(RouterBuilder{}
+                      .get("/file",
+                           [path](const HttpRequest &) {
+                             return HttpResponse::ok().with_file(path.string());
+                           })
+                      .get("/missing",
+                           [](const HttpRequest &) {
+                             return HttpResponse::ok().with_file("/nonexistent/file");
+                           })
+                      .build());
+
+  // 文件大于套接字缓冲区，需要多次 sendfile；之后的管线化响应排在文件之后
+  auto fd = connect_to(server_->port());
+  ASSERT_TRUE(fd);
+  send_all(fd.get(), "GET /file HTTP/1.1\r\n\r\nGET /missing HTTP/1.1\r\n\r\n");
+  std::string rest;
+  auto response = read_response(fd.get(), rest);
+  EXPECT_NE(response.find("Content-Length: " + std::to_string(content.size())), std::string::npos);
+  EXPECT_TRUE(response.ends_with("\r\n\r\n" + content));
+  EXPECT_TRUE(read_response(fd.get(), rest).starts_with("HTTP/1.1 404 Not Found\r\n"));
+  std::filesystem::remove(path);
+}
+
+TEST(ServerPinningTest, ReactorsOwnPinnedThreadPools) {
+  ServerConfig config;
+  config.host = "127.0.0.1";
+  config.port = 0;
+  config.num_reactors = 2;
+  config.pin_reactors = true;
+  config.workers_per_reactor = 1;
+
+  auto router = RouterBuilder{}
+                    .get("/core",
+                         [](const HttpRequest &) {
+                           const auto &core = this_core();
+                           if (core.pool == nullptr || !core.cpu) {
+                             return HttpResponse::internal_server_error();
+                           }
+                           const int expected = static_cast<int>(core.cpu->id);
+                           const int worker_cpu =
+                               core.pool->submit([] { return ::sched_getcpu(); }).get().value();
+                           return HttpResponse::ok().with_text(
+                               worker_cpu == expected && ::sched_getcpu() == expected ? "local"
+                                                                                      : "remote");
+                         })
+                    .build();
+  Server server(config, std::move(router));
+  ASSERT_TRUE(server.start().has_value());
+
+  for (int i = 0; i < 4; ++i) {
+    auto response = round_trip(server.port(), "GET /core HTTP/1.1\r\n\r\n");
+    EXPECT_TRUE(response.ends_with("\r\n\r\nlocal")) << response;
+  }
+  EXPECT_EQ(this_core().pool, nullptr);
+}
+
+TEST(ServerMetricsTest, CountsParseTimeErrorsAndPoolQueues) {
+  metrics::Registry registry;
+  ServerConfig config;
+  config.host = "127.0.0.1";
+  config.port = 0;
+  config.num_reactors = 1;
+  config.workers_per_reactor = 1;
+  config.metrics = &registry;
+  Server server(config, test_router().get("/metrics", metrics_handler(registry)));
+  ASSERT_TRUE(server.start().has_value());
+
+  EXPECT_TRUE(round_trip(server.port(), "GET / HTTP/1.1\r\n\r\n").ends_with("hello"));
+  EXPECT_TRUE(round_trip(server.port(), "BOGUS / HTTP/1.1\r\n\r\n").starts_with("HTTP/1.1 400"));
+  auto text = round_trip(server.port(), "GET /metrics HTTP/1.1\r\n\r\n");
+
+  EXPECT_NE(text.find("http_parse_errors_total{kind=\"invalid_method\"} 1\n"), std::string::npos)
+      << text;
+  EXPECT_NE(text.find("http_parse_errors_total{kind=\"body_too_large\"} 0\n"), std::string::npos);
+  // 第三个请求在导出之前就已解析完
+  EXPECT_NE(text.find("http_parse_duration_seconds_count 2\n"), std::string::npos);
+  EXPECT_NE(text.find("threadpool_pending_tasks{pool=\"reactor0\"} 0\n"), std::string::npos);
+}
+
+namespace {
+
+// 记录触发顺序与触发时时间轮推进到的时刻
+struct Probe {
+  std::vector<int> *fired;
+  int id;
+  TimerWheel::Timer timer{[](void *self) {
+                            auto *probe = static_cast<Probe *>(self);
+                            probe->fired->push_back(probe->id);
+                          },
+                          this};
+};
+
+} // namespace
+
+TEST(TimerWheelTest, FiresInOrderAndNeverEarly) {
+  using namespace std::chrono;
+  const auto origin = TimerWheel::Clock::time_point{};
+  TimerWheel wheel(milliseconds(1), origin);
+  std::vector<int> fired;
+  // 分别落在第 0、1、2、3 层
+  std::array<Probe, 4> probes{Probe{&fired, 0}, Probe{&fired, 1}, Probe{&fired, 2}, Probe{&fired, 3}};
+  const std::array<milliseconds, 4> delays{milliseconds(5), milliseconds(300), milliseconds(70'000),
+                                           milliseconds(20'000'000)};
+  for (size_t i = 0; i < probes.size(); ++i) {
+    wheel.schedule(probes[i].timer, delays[i], origin);
+  }
+  EXPECT_EQ(wheel.size(), 4u);
+  EXPECT_EQ(wheel.next_timeout(origin), 5);
+
+  for (size_t i = 0; i < probes.size(); ++i) {
+    wheel.advance(origin + delays[i] - milliseconds(1));
+    EXPECT_EQ(fired.size(), i) << "timer " << i << " fired early";
+    wheel.advance(origin + delays[i]);
+    ASSERT_EQ(fired.size(), i + 1);
+    EXPECT_EQ(fired.back(), static_cast<int>(i));
+  }
+  EXPECT_EQ(wheel.size(), 0u);
+  EXPECT_EQ(wheel.next_timeout(origin), -1);
+}
+
+TEST(TimerWheelTest, RescheduleAndCancelAreImmediate) {
+  using namespace std::chrono;
+  const auto origin = TimerWheel::Clock::time_point{};
+  TimerWheel wheel(milliseconds(1), origin);
+  std::vector<int> fired;
+  Probe a{&fired, 1};
+  Probe b{&fired, 2};
+  wheel.schedule(a.timer, milliseconds(10), origin);
+  wheel.schedule(b.timer, milliseconds(10), origin);
+  wheel.schedule(a.timer, milliseconds(1000), origin); // 推迟
+  b.timer.cancel();
+  EXPECT_FALSE(b.timer.armed());
+  EXPECT_EQ(wheel.size(), 1u);
+  // 只剩远期定时器时超时是下一次 cascade 的时刻，不晚于它的到期时间
+  EXPECT_LE(wheel.next_timeout(origin), 1000);
+
+  wheel.advance(origin + milliseconds(999));
+  EXPECT_TRUE(fired.empty());
+  wheel.advance(origin + milliseconds(1000));
+  EXPECT_EQ(fired, std::vector<int>{1});
+  {
+    Probe scoped{&fired, 3};
+    wheel.schedule(scoped.timer, milliseconds(5), origin + milliseconds(1000));
+  } // 析构时自动取消
+  wheel.advance(origin + milliseconds(2000));
+  EXPECT_EQ(fired, std::vector<int>{1});
+}
+
+TEST(TimerWheelTest, CallbacksMayDestroyOrRescheduleTimers) {
+  using namespace std::chrono;
+  const auto origin = TimerWheel::Clock::time_point{};
+  TimerWheel wheel(milliseconds(1), origin);
+
+  struct Repeating {
+    TimerWheel *wheel;
+    int count = 0;
+    TimerWheel::Timer timer{[](void *self) {
+                              auto *r = static_cast<Repeating *>(self);
+                              if (++r->count < 3) {
+                                r->wheel->schedule(r->timer, milliseconds(100),
+                                                   TimerWheel::Clock::time_point{} +
+                                                       milliseconds(100 * r->count));
+                              }
+                            },
+                            this};
+  };
+  Repeating repeating{&wheel};
+  wheel.schedule(repeating.timer, milliseconds(100), origin);
+
+  // 回调中释放定时器本身，例如关闭拥有它的连接
+  struct SelfDeleting {
+    bool *done;
+    TimerWheel::Timer timer{[](void *self) {
+                              auto *s = static_cast<SelfDeleting *>(self);
+                              *s->done = true;
+                              delete s;
+                            },
+                            this};
+  };
+  bool done = false;
+  wheel.schedule((new SelfDeleting{&done})->timer, milliseconds(100), origin);
+
+  wheel.advance(origin + milliseconds(1000));
+  EXPECT_EQ(repeating.count, 3);
+  EXPECT_TRUE(done);
+  EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimerWheelTest, DropsOwnedTimersOnDestruction) {
+  using namespace std::chrono;
+  int dropped = 0;
+  struct Owned {
+    int *dropped;
+    TimerWheel::Timer timer{[](void *) {}, this, [](void *self) {
+                              auto *o = static_cast<Owned *>(self);
+                              ++*o->dropped;
+                              delete o;
+                            }};
+  };
+  {
+    TimerWheel wheel;
+    wheel.schedule((new Owned{&dropped})->timer, milliseconds(50));
+    wheel.schedule((new Owned{&dropped})->timer, hours(24));
+  }
+  EXPECT_EQ(dropped, 2);
+}
+
+TEST(ServerTimeoutTest, SlowHeadersGet408AndIdleConnectionsClose) {
+  ServerConfig config;
+  config.host = "127.0.0.1";
+  config.port = 0;
+  config.num_reactors = 1;
+  config.limits.header_timeout = std::chrono::milliseconds(100);
+  config.limits.idle_timeout = std::chrono::milliseconds(100);
+  Server server(config, test_router());
+  ASSERT_TRUE(server.start().has_value());
+
+  // 请求头一直不完整：数据陆续到达也不延长期限
+  const auto start = std::chrono::steady_clock::now();
+  auto slow = connect_to(server.port());
+  ASSERT_TRUE(slow);
+  send_all(slow.get(), "GET / HTTP/1.1\r\n");
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  send_all(slow.get(), "Host: x\r\n");
+  auto response = read_until_close(slow.get());
+  EXPECT_TRUE(response.starts_with("HTTP/1.1 408 Request Timeout\r\n")) << response;
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+
+  // keep-alive 连接应答之后空闲超时，服务器关闭连接
+  auto idle = connect_to(server.port());
+  ASSERT_TRUE(idle);
+  send_all(idle.get(), "GET / HTTP/1.1\r\n\r\n");
+  EXPECT_TRUE(read_response(idle.get()).ends_with("hello"));
+  EXPECT_EQ(read_until_close(idle.get()), "");
+}
+
+TEST(ServerTimeoutTest, StalledResponsesAreClosed) {
+  threadpool::ThreadPool pool(1);
+  std::promise<void> release;
+  const auto released = release.get_future().share();
+  ServerConfig config;
+  config.host = "127.0.0.1";
+  config.port = 0;
+  config.num_reactors = 1;
+  config.limits.response_timeout = std::chrono::milliseconds(300);
+  constexpr size_t kPieces = 4096; // 16 MiB，远大于套接字缓冲区
+  Server server(config, test_router()
+                            .get("/hold",
+                                 [&pool, &released](HttpRequest) -> PendingResponse {
+                                   co_await pool.schedule();
+                                   released.wait();
+                                   co_return HttpResponse::ok().with_text("held");
+                                 })
+                            .get("/download", [](const HttpRequest &) {
+                              return HttpResponse::ok().with_stream(
+                                  [i = size_t{0}](std::string &out) mutable {
+                                    out.assign(4096, 'd');
+                                    return ++i < kPieces;
+                                  });
+                            }));
+  ASSERT_TRUE(server.start().has_value());
+
+  // handler 迟迟不完成：期限到后直接关闭
+  const auto start = std::chrono::steady_clock::now();
+  auto held = connect_to(server.port());
+  ASSERT_TRUE(held);
+  send_all(held.get(), "GET /hold HTTP/1.1\r\n\r\n");
+  EXPECT_EQ(read_until_close(held.get()), "");
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(300));
+  release.set_value();
+
+  // 读得慢但一直有进展：期限随写出重新计时，停顿的总时长超过期限也能收完。
+  // 内核在发送缓冲区空出一半左右时才通知可写，所以每次停顿之间要读走足够多的数据
+  auto slow = connect_to(server.port());
+  ASSERT_TRUE(slow);
+  send_all(slow.get(), "GET /download HTTP/1.0\r\n\r\n");
+  std::string response;
+  char buf[16 * 1024];
+  for (size_t i = 1; i <= 4; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    while (response.size() < i * 1024 * 1024) {
+      const auto n = ::recv(slow.get(), buf, sizeof(buf), 0);
+      ASSERT_GT(n, 0);
+      response.append(buf, static_cast<size_t>(n));
+    }
+  }
+  response += read_until_close(slow.get());
+  const auto head_end = response.find("\r\n\r\n");
+  ASSERT_NE(head_end, std::string::npos);
+  EXPECT_EQ(response.size() - head_end - 4, kPieces * 4096);
+
+  // 不再读取：写出停滞超过期限后连接被关闭，响应不完整
+  auto stalled = connect_to(server.port());
+  ASSERT_TRUE(stalled);
+  send_all(stalled.get(), "GET /download HTTP/1.0\r\n\r\n");
+  std::this_thread::sleep_for(std::chrono::milliseconds(800));
+  EXPECT_LT(read_until_close(stalled.get()).size(), kPieces * 4096);
+}
+
+TEST(ServerUringTest, ReactorsUseIoUringAndKeepTimeouts) {
+  if (!Uring::supported()) {
+    GTEST_SKIP() << "io_uring unavailable";
+  }
+  ServerConfig config;
+  config.host = "127.0.0.1";
+  config.port = 0;
+  config.num_reactors = 1;
+  config.io_backend = IoBackend::IoUring;
+  config.uring.buffers = 4; // 少量缓冲区：大请求会用完它们，recv 需要重新提交
+  config.uring.buffer_size = 1024;
+  config.limits.header_timeout = std::chrono::milliseconds(100);
+  Server server(config, test_router().get("/backend", [](const HttpRequest &) {
+    return HttpResponse::ok().with_text(this_core().backend == IoBackend::IoUring ? "uring"
+                                                                                  : "epoll");
+  }));
+  ASSERT_TRUE(server.start().has_value());
+
+  EXPECT_TRUE(round_trip(server.port(), "GET /backend HTTP/1.1\r\n\r\n").ends_with("uring"));
+
+  const std::string body(256 * 1024, 'b');
+  auto response = round_trip(server.port(), "POST /echo HTTP/1.1\r\nContent-Length: " +
+                                                std::to_string(body.size()) + "\r\n\r\n" + body);
+  EXPECT_TRUE(response.ends_with("\r\n\r\n" + body));
+
+  // 超时关闭连接前，已经提交的 408 仍然写完
+  auto slow = connect_to(server.port());
+  ASSERT_TRUE(slow);
+  send_all(slow.get(), "GET / HTTP/1.1\r\n");
+  EXPECT_TRUE(read_until_close(slow.get()).starts_with("HTTP/1.1 408 Request Timeout\r\n"));
+}
@@ -0,0 +1,550 @@
+#include "alloc_counter.hpp"
+#include "threadpool/channel.hpp"
+#include "threadpool/pool.hpp"
+#include <gtest/gtest.h>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <set>
+
+using namespace threadpool;
+
+TEST(WorkStealingDequeTest, OwnerIsLifoThiefIsFifo) {
+  WorkStealingDeque<int> deque(2);
+  for (int i = 0; i < 10; ++i) {
+    deque.push(i);
+  }
+  EXPECT_EQ(deque.size(), 10);
+  EXPECT_EQ(deque.steal(), 0);
+  EXPECT_EQ(deque.pop(), 9);
+  EXPECT_EQ(deque.steal(), 1);
+  EXPECT_EQ(deque.pop(), 8);
+  EXPECT_EQ(deque.size(), 6);
+}
+
+TEST(WorkStealingDequeTest, ConcurrentStealsSeeEachItemOnce) {
+  constexpr int kItems = 100000;
+  WorkStealingDeque<int> deque(16);
+  std::atomic<bool> done{false};
+  std::vector<std::vector<int>> stolen(3);
+
+  std::vector<std::thread> thieves;
+  for (auto &out : stolen) {
+    thieves.emplace_back([&deque, &done, &out] {
+      while (!done.load() || !deque.empty()) {
+        if (auto v = deque.steal()) {
+          out.push_back(*v);
+        }
+      }
+    });
+  }
+
+  std::vector<int> popped;
+  for (int i = 0; i < kItems; ++i) {
+    deque.push(i);
+    if (i % 3 == 0) {
+      if (auto v = deque.pop()) {
+        popped.push_back(*v);
+      }
+    }
+  }
+  while (auto v = deque.pop()) {
+    popped.push_back(*v);
+  }
+  done = true;
+  for (auto &t : thieves) {
+    t.join();
+  }
+
+  std::vector<int> all = popped;
+  for (const auto &out : stolen) {
+    all.insert(all.end(), out.begin(), out.end());
+  }
+  std::sort(all.begin(), all.end());
+  ASSERT_EQ(all.size(), kItems);
+  for (int i = 0; i < kItems; ++i) {
+    ASSERT_EQ(all[i], i);
+  }
+}
+
+TEST(MpmcQueueTest, BoundedFifo) {
+  MpmcQueue<std::string> queue(3);
+  EXPECT_EQ(queue.capacity(), 4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.try_push(std::to_string(i)));
+  }
+  std::string rejected = "x";
+  EXPECT_FALSE(queue.try_push(std::move(rejected)));
+  EXPECT_EQ(rejected, "x");
+  EXPECT_EQ(queue.try_pop(), "0");
+  EXPECT_TRUE(queue.try_push(std::string("4")));
+  for (int i = 1; i <= 4; ++i) {
+    EXPECT_EQ(queue.try_pop(), std::to_string(i));
+  }
+  EXPECT_FALSE(queue.try_pop().has_value());
+}
+
+TEST(MpmcQueueTest, ConcurrentProducersAndConsumers) {
+  constexpr int kPerProducer = 20000;
+  MpmcQueue<int> queue(64);
+  std::atomic<long> sum{0};
+  std::atomic<int> consumed{0};
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < 2; ++p) {
+    threads.emplace_back([&queue] {
+      for (int i = 1; i <= kPerProducer; ++i) {
+        while (!queue.try_push(i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (int c = 0; c < 2; ++c) {
+    threads.emplace_back([&] {
+      while (consumed.load() < 2 * kPerProducer) {
+        if (auto v = queue.try_pop()) {
+          sum += *v;
+          ++consumed;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(sum.load(), 2L * kPerProducer * (kPerProducer + 1) / 2);
+}
+
+template <typename C> class ChannelTest : public ::testing::Test {};
+
+using ChannelTypes =
+    ::testing::Types<Channel<int>, BoundedChannel<int>, SpscChannel<int>>;
+TYPED_TEST_SUITE(ChannelTest, ChannelTypes);
+
+TYPED_TEST(ChannelTest, SendRecvAndClose) {
+  static_assert(ChannelLike<TypeParam, int>);
+  TypeParam channel(4);
+
+  EXPECT_TRUE(channel.send(1));
+  EXPECT_TRUE(channel.try_send(2));
+  EXPECT_EQ(channel.size(), 2);
+  EXPECT_EQ(channel.recv(), 1);
+  EXPECT_EQ(channel.try_recv(), 2);
+  EXPECT_FALSE(channel.try_recv().has_value());
+
+  EXPECT_TRUE(channel.send(3));
+  channel.close();
+  EXPECT_FALSE(channel.send(4));
+  EXPECT_FALSE(channel.try_send(4));
+  EXPECT_EQ(channel.recv(), 3);
+  EXPECT_FALSE(channel.recv().has_value());
+}
+
+TYPED_TEST(ChannelTest, TrySendFailsWhenFull) {
+  TypeParam channel(4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(channel.try_send(i));
+  }
+  EXPECT_FALSE(channel.try_send(99));
+  EXPECT_EQ(channel.recv(), 0);
+  EXPECT_TRUE(channel.try_send(4));
+}
+
+TYPED_TEST(ChannelTest, BlockingProducerConsumer) {
+  constexpr int kItems = 50000;
+  TypeParam channel(8);
+
+  std::thread producer([&channel] {
+    for (int i = 0; i < kItems; ++i) {
+      ASSERT_TRUE(channel.send(i));
+    }
+    channel.close();
+  });
+
+  int expected = 0;
+  while (auto value = channel.recv()) {
+    ASSERT_EQ(*value, expected++);
+  }
+  producer.join();
+  EXPECT_EQ(expected, kItems);
+}
+
+TYPED_TEST(ChannelTest, CloseWakesBlockedReceiver) {
+  TypeParam channel(4);
+  std::thread receiver([&channel] { EXPECT_FALSE(channel.recv().has_value()); });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  channel.close();
+  receiver.join();
+}
+
+TEST(BoundedChannelTest, ManyProducersManyConsumers) {
+  constexpr int kPerProducer = 10000;
+  BoundedChannel<int> channel(16);
+  std::atomic<long> sum{0};
+
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < 3; ++c) {
+    consumers.emplace_back([&] {
+      while (auto value = channel.recv()) {
+        sum += *value;
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int p = 0; p < 3; ++p) {
+    producers.emplace_back([&channel] {
+      for (int i = 1; i <= kPerProducer; ++i) {
+        channel.send(i);
+      }
+    });
+  }
+  for (auto &t : producers) {
+    t.join();
+  }
+  channel.close();
+  for (auto &t : consumers) {
+    t.join();
+  }
+  EXPECT_EQ(sum.load(), 3L * kPerProducer * (kPerProducer + 1) / 2);
+}
+
+TEST(ThreadPoolTest, SubmitReturnsValue) {
+  ThreadPool pool(2);
+  auto future = pool.submit([](int a, int b) { return a + b; }, 2, 3);
+
+  auto result = future.get();
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(*result, 5);
+}
+
+TEST(ThreadPoolTest, VoidAndTaskResultPassthrough) {
+  ThreadPool pool(2);
+  std::atomic<int> counter{0};
+
+  auto void_result = pool.submit([&counter] { ++counter; }).get();
+  EXPECT_TRUE(void_result.has_value());
+  EXPECT_EQ(counter.load(), 1);
+
+  auto error = pool.submit([]() -> TaskResult<int> { return std::unexpected("bad"); }).get();
+  ASSERT_FALSE(error.has_value());
+  EXPECT_EQ(error.error(), "bad");
+}
+
+TEST(ThreadPoolTest, ExceptionsBecomeErrors) {
+  ThreadPool pool(1);
+  auto result = pool.submit([]() -> int { throw std::runtime_error("boom"); }).get();
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(result.error(), "boom");
+}
+
+TEST(ThreadPoolTest, ManyTasksFromManyThreads) {
+  ThreadPool pool(4, 64);
+  std::vector<std::future<TaskResult<int>>> futures[3];
+
+  std::vector<std::thread> producers;
+  for (auto &out : futures) {
+    producers.emplace_back([&pool, &out] {
+      for (int i = 0; i < 2000; ++i) {
+        out.push_back(pool.submit([i] { return i; }));
+      }
+    });
+  }
+  for (auto &t : producers) {
+    t.join();
+  }
+
+  long sum = 0;
+  for (auto &out : futures) {
+    for (auto &f : out) {
+      sum += f.get().value();
+    }
+  }
+  EXPECT_EQ(sum, 3L * 1999 * 2000 / 2);
+}
+
+TEST(ThreadPoolTest, NestedSubmitUsesLocalQueue) {
+  ThreadPool pool(3);
+
+  auto outer = pool.submit([&pool] {
+    std::vector<std::future<TaskResult<int>>> children;
+    for (int i = 0; i < 100; ++i) {
+      children.push_back(pool.submit([i] { return i; }));
+    }
+    int sum = 0;
+    for (auto &child : children) {
+      sum += child.get().value();
+    }
+    return sum;
+  });
+
+  EXPECT_EQ(outer.get().value(), 4950);
+}
+
+TEST(ThreadPoolTest, SubmitAfterShutdownFails) {
+  ThreadPool pool(1);
+  pool.shutdown();
+
+  auto result = pool.submit([] { return 1; }).get();
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(result.error(), "Thread pool shut down");
+}
+
+TEST(ThreadPoolTest, PendingTasksCompleteOnDestruction) {
+  std::atomic<int> done{0};
+  std::vector<std::future<TaskResult<void>>> futures;
+  {
+    ThreadPool pool(1);
+    for (int i = 0; i < 200; ++i) {
+      futures.push_back(pool.submit([&done] { ++done; }));
+    }
+  }
+  EXPECT_EQ(done.load(), 200);
+  for (auto &f : futures) {
+    EXPECT_TRUE(f.get().has_value());
+  }
+}
+
+TEST(ThreadPoolTest, IdleWorkersWakeForNewWork) {
+  ThreadPool pool(2);
+  for (int round = 0; round < 20; ++round) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(pool.submit([round] { return round; }).get().value(), round);
+  }
+}
+
+TEST(UniqueTaskTest, InlineAndHeapCallables) {
+  int calls = 0;
+  UniqueTask small = [&calls] { ++calls; };
+  small();
+
+  std::array<char, 200> big{};
+  big[0] = 1;
+  UniqueTask large = [&calls, big] { calls += big[0]; };
+  UniqueTask moved = std::move(large);
+  EXPECT_FALSE(static_cast<bool>(large));
+  moved();
+
+  EXPECT_EQ(calls, 2);
+}
+
+TEST(UniqueTaskTest, MoveOnlyCaptureIsDestroyedOnce) {
+  auto shared = std::make_shared<int>(7);
+  {
+    UniqueTask task = [p = std::make_unique<std::shared_ptr<int>>(shared)] { **p += 1; };
+    UniqueTask other;
+    other = std::move(task);
+    other();
+    EXPECT_EQ(shared.use_count(), 2);
+  }
+  EXPECT_EQ(*shared, 8);
+  EXPECT_EQ(shared.use_count(), 1);
+}
+
+TEST(ThreadPoolTest, PostRunsWithoutFuture) {
+  ThreadPool pool(2);
+  std::atomic<int> done{0};
+
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(pool.post([&done] { ++done; }));
+  }
+  EXPECT_TRUE(pool.post([] { throw std::runtime_error("ignored"); }));
+  while (done.load() < 1000) {
+    std::this_thread::yield();
+  }
+
+  pool.shutdown();
+  EXPECT_FALSE(pool.post([] {}));
+}
+
+TEST(ThreadPoolTest, PostIsAllocationFreeInSteadyState) {
+  ThreadPool pool(1);
+  std::atomic<int> done{0};
+  auto run_batches = [&](int batches) {
+    for (int b = 0; b < batches; ++b) {
+      const int target = done.load() + 100;
+      for (int i = 0; i < 100; ++i) {
+        pool.post([&done] { done.fetch_add(1); });
+      }
+      while (done.load() < target) {
+        std::this_thread::yield();
+      }
+    }
+  };
+
+  run_batches(5);
+  const size_t before = alloc_counter::total();
+  run_batches(50);
+  EXPECT_EQ(alloc_counter::total() - before, 0);
+}
+
+TEST(ThreadPoolTest, SubmitReusesPooledState) {
+  constexpr int kBatch = 100;
+  constexpr int kBatches = 50;
+  ThreadPool pool(1);
+  std::vector<std::future<TaskResult<int>>> futures;
+  futures.reserve(kBatch);
+
+  auto run_batches = [&](int batches) {
+    for (int b = 0; b < batches; ++b) {
+      for (int i = 0; i < kBatch; ++i) {
+        futures.push_back(pool.submit([i] { return i; }));
+      }
+      for (auto &f : futures) {
+        ASSERT_TRUE(f.get().has_value());
+      }
+      futures.clear();
+    }
+  };
+
+  run_batches(20);
+  const size_t before = alloc_counter::total();
+  run_batches(kBatches);
+  // 块在线程间迁移时线程缓存可能暂时取空，只要求摊还后基本不分配
+  EXPECT_LT(alloc_counter::total() - before, static_cast<size_t>(kBatch * kBatches / 10));
+}
+
+TEST(ThreadPoolTest, SubmitBatchPreservesOrder) {
+  ThreadPool pool(3);
+  std::vector<std::function<int()>> tasks;
+  for (int i = 0; i < 500; ++i) {
+    tasks.emplace_back([i] { return i * 2; });
+  }
+
+  auto futures = pool.submit_batch(tasks);
+  ASSERT_EQ(futures.size(), tasks.size());
+  for (int i = 0; i < 500; ++i) {
+    EXPECT_EQ(futures[i].get().value(), i * 2);
+  }
+}
+
+TEST(ThreadPoolTest, SubmitBatchAfterShutdownFails) {
+  ThreadPool pool(1);
+  pool.shutdown();
+
+  std::vector<std::function<void()>> tasks(3, [] {});
+  for (auto &f : pool.submit_batch(tasks)) {
+    auto result = f.get();
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), "Thread pool shut down");
+  }
+}
+
+TEST(ThreadPoolTest, ParallelForVisitsEachIndexOnce) {
+  ThreadPool pool(4);
+  std::vector<std::atomic<int>> hits(10007);
+
+  auto result = pool.parallel_for(0, static_cast<int>(hits.size()), 64,
+                                  [&](int i) { hits[i].fetch_add(1, std::memory_order_relaxed); });
+  ASSERT_TRUE(result.has_value());
+  for (auto &h : hits) {
+    EXPECT_EQ(h.load(), 1);
+  }
+
+  EXPECT_TRUE(pool.parallel_for(5, 5, 0, [](int) { FAIL(); }).has_value());
+}
+
+TEST(ThreadPoolTest, ParallelForReportsFirstError) {
+  ThreadPool pool(2);
+  std::atomic<int> ran{0};
+
+  auto result = pool.parallel_for(size_t{0}, size_t{1000}, 1, [&](size_t i) -> TaskResult<void> {
+    ++ran;
+    if (i == 10) {
+      return std::unexpected("bad index");
+    }
+    return {};
+  });
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(result.error(), "bad index");
+  EXPECT_LT(ran.load(), 1000);
+
+  auto thrown = pool.parallel_for(0, 10, 1, [](int) { throw std::runtime_error("boom"); });
+  ASSERT_FALSE(thrown.has_value());
+  EXPECT_EQ(thrown.error(), "boom");
+}
+
+TEST(ThreadPoolTest, ParallelForInsideWorkerDoesNotDeadlock) {
+  ThreadPool pool(1);
+  auto outer = pool.submit([&pool] {
+    std::atomic<long> sum{0};
+    auto status = pool.parallel_for(0, 1000, 10, [&](int i) { sum += i; });
+    return status ? TaskResult<long>(sum.load()) : std::unexpected(status.error());
+  });
+  EXPECT_EQ(outer.get().value(), 999L * 1000 / 2);
+}
+
+TEST(ThreadPoolTest, ParallelMapKeepsOrder) {
+  ThreadPool pool(3);
+  std::vector<int> input(1000);
+  std::iota(input.begin(), input.end(), 0);
+
+  auto squares = pool.parallel_map(input, [](int x) { return x * x; });
+  ASSERT_TRUE(squares.has_value());
+  ASSERT_EQ(squares->size(), input.size());
+  for (size_t i = 0; i < input.size(); ++i) {
+    EXPECT_EQ((*squares)[i], static_cast<int>(i * i));
+  }
+
+  auto failed = pool.parallel_map(input, [](int x) -> TaskResult<std::string> {
+    if (x == 500) {
+      return std::unexpected("no");
+    }
+    return std::to_string(x);
+  });
+  ASSERT_FALSE(failed.has_value());
+  EXPECT_EQ(failed.error(), "no");
+}
+
+TEST(CpuTopologyTest, ParsesCpuLists) {
+  EXPECT_EQ(CpuTopology::parse_cpu_list("0-3,8,10-11\n"),
+            (std::vector<unsigned>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(CpuTopology::parse_cpu_list("5"), (std::vector<unsigned>{5}));
+  EXPECT_TRUE(CpuTopology::parse_cpu_list("").empty());
+}
+
+TEST(CpuTopologyTest, ReadsNodesFromSysfs) {
+  namespace fs = std::filesystem;
+  const auto root = fs::temp_directory_path() / ("topology_test_" + std::to_string(::getpid()));
+  fs::create_directories(root / "cpu");
+  fs::create_directories(root / "node" / "node0");
+  fs::create_directories(root / "node" / "node1");
+  std::ofstream(root / "cpu" / "online") << "0-3\n";
+  std::ofstream(root / "node" / "node0" / "cpulist") << "0-1\n";
+  std::ofstream(root / "node" / "node1" / "cpulist") << "2-3\n";
+
+  auto topology = CpuTopology::detect(root);
+  fs::remove_all(root);
+
+  EXPECT_EQ(topology.node_count(), 2u);
+  // 进程的亲和性掩码可能排除部分 CPU，只检查留下来的 CPU 的节点归属
+  for (const auto &cpu : topology.cpus()) {
+    EXPECT_EQ(cpu.node, cpu.id < 2 ? 0u : 1u);
+  }
+  EXPECT_EQ(topology.cpus_on(0).size() + topology.cpus_on(1).size(), topology.cpus().size());
+}
+
+TEST(ThreadPoolTest, PinnedWorkersRunOnTheirCpu) {
+  auto topology = CpuTopology::detect();
+  ASSERT_FALSE(topology.cpus().empty());
+
+  ThreadPool pool(topology.cpus());
+  EXPECT_EQ(pool.size(), topology.cpus().size());
+
+  std::vector<std::future<TaskResult<int>>> cpus;
+  for (int i = 0; i < 64; ++i) {
+    cpus.push_back(pool.submit([] { return ::sched_getcpu(); }));
+  }
+  std::set<int> allowed;
+  for (const auto &cpu : topology.cpus()) {
+    allowed.insert(static_cast<int>(cpu.id));
+  }
+  for (auto &f : cpus) {
+    EXPECT_TRUE(allowed.contains(f.get().value()));
+  }
+}
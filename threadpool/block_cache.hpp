@@ -0,0 +1,161 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace threadpool {
+
+// 按 64 字节分级的块缓存，用于任务节点和 promise 共享状态。
+// 每个线程有自己的空闲链表，分配和释放都不加锁；块常常在一个线程分配、在另一个
+// 线程释放，所以线程缓存超过上限时把一批块交给全局仓库，缓存用空时再整批取回，
+// 每 kBatch 次操作才加一次锁
+class BlockCache {
+  static constexpr size_t kGranularity = 64;
+  static constexpr size_t kClasses = 8; // 最大 512 字节
+  static constexpr size_t kBatch = 32;
+  static constexpr size_t kMaxCached = 4 * kBatch;
+
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+
+  // 全局仓库：每个元素是一条恰好 kBatch 个块的链表
+  struct Depot {
+    std::mutex mutex;
+    std::array<std::vector<FreeBlock *>, kClasses> batches;
+
+    ~Depot() {
+      for (auto &list : batches) {
+        for (auto *head : list) {
+          free_chain(head);
+        }
+      }
+    }
+  };
+
+  struct Lists {
+    std::array<FreeBlock *, kClasses> heads{};
+    std::array<size_t, kClasses> counts{};
+
+    ~Lists() {
+      destroyed() = true;
+      for (auto *head : heads) {
+        free_chain(head);
+      }
+    }
+  };
+
+  static void free_chain(FreeBlock *head) {
+    while (head != nullptr) {
+      auto *next = head->next;
+      ::operator delete(head);
+      head = next;
+    }
+  }
+
+  static Depot &depot() {
+    static Depot instance;
+    return instance;
+  }
+
+  // 线程退出时缓存先于某些对象析构，之后的分配/释放直接走系统
+  static bool &destroyed() {
+    thread_local constinit bool flag = false;
+    return flag;
+  }
+
+  static Lists *lists() {
+    if (destroyed()) {
+      return nullptr;
+    }
+    thread_local Lists instance;
+    return &instance;
+  }
+
+  static constexpr size_t class_of(size_t size) { return (size + kGranularity - 1) / kGranularity - 1; }
+
+  static bool refill(Lists &l, size_t cls) {
+    auto &d = depot();
+    std::lock_guard lock(d.mutex);
+    if (d.batches[cls].empty()) {
+      return false;
+    }
+    l.heads[cls] = d.batches[cls].back();
+    l.counts[cls] = kBatch;
+    d.batches[cls].pop_back();
+    return true;
+  }
+
+  static void spill(Lists &l, size_t cls) {
+    FreeBlock *head = l.heads[cls];
+    FreeBlock *tail = head;
+    for (size_t i = 1; i < kBatch; ++i) {
+      tail = tail->next;
+    }
+    l.heads[cls] = tail->next;
+    l.counts[cls] -= kBatch;
+    tail->next = nullptr;
+
+    auto &d = depot();
+    std::lock_guard lock(d.mutex);
+    d.batches[cls].push_back(head);
+  }
+
+public:
+  static constexpr size_t kMaxBlockSize = kGranularity * kClasses;
+
+  static void *allocate(size_t size) {
+    if (size == 0 || size > kMaxBlockSize) {
+      return ::operator new(size);
+    }
+    const size_t cls = class_of(size);
+    if (auto *l = lists(); l != nullptr && (l->heads[cls] != nullptr || refill(*l, cls))) {
+      auto *block = l->heads[cls];
+      l->heads[cls] = block->next;
+      --l->counts[cls];
+      return block;
+    }
+    return ::operator new((cls + 1) * kGranularity);
+  }
+
+  static void deallocate(void *p, size_t size) noexcept {
+    if (size == 0 || size > kMaxBlockSize) {
+      ::operator delete(p);
+      return;
+    }
+    auto *l = lists();
+    if (l == nullptr) {
+      ::operator delete(p);
+      return;
+    }
+    const size_t cls = class_of(size);
+    auto *block = static_cast<FreeBlock *>(p);
+    block->next = l->heads[cls];
+    l->heads[cls] = block;
+    if (++l->counts[cls] > kMaxCached) {
+      spill(*l, cls);
+    }
+  }
+};
+
+// 从 BlockCache 分配的标准分配器，用于 std::promise 的共享状态
+template <typename T> struct PoolAllocator {
+  using value_type = T;
+
+  PoolAllocator() = default;
+
+  template <typename U> PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+  T *allocate(size_t n) {
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+    return static_cast<T *>(BlockCache::allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, size_t n) noexcept { BlockCache::deallocate(p, n * sizeof(T)); }
+
+  template <typename U> bool operator==(const PoolAllocator<U> &) const noexcept { return true; }
+};
+
+} // namespace threadpool
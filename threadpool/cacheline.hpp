@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+
+namespace threadpool {
+
+// 并发读写的计数器各占一条缓存行，避免伪共享。
+// 不使用 std::hardware_destructive_interference_size：它在头文件中会随编译选项变化
+inline constexpr size_t kCacheLineSize = 64;
+
+// 自旋等待时提示 CPU 让出流水线资源
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+} // namespace threadpool
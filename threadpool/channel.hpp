@@ -1,4 +1,9 @@
 #pragma once
+#include "cacheline.hpp"
+#include "mpmc_queue.hpp"
+#include "spsc_queue.hpp"
+#include <atomic>
+#include <concepts>
 #include <condition_variable>
 #include <mutex>
 #include <optional>
@@ -6,6 +11,19 @@
 
 namespace threadpool {
 
+// 所有通道共有的接口：send/recv 阻塞，try_* 不阻塞，close 之后 send 失败、
+// recv 取完剩余元素后返回空
+template <typename C, typename T>
+concept ChannelLike = requires(C c, T value) {
+  { c.send(std::move(value)) } -> std::same_as<bool>;
+  { c.try_send(std::move(value)) } -> std::same_as<bool>;
+  { c.recv() } -> std::same_as<std::optional<T>>;
+  { c.try_recv() } -> std::same_as<std::optional<T>>;
+  c.close();
+  { c.size() } -> std::convertible_to<size_t>;
+};
+
+// 基于互斥锁和 std::queue 的通道，容量可以不设上限
 template <typename T> class Channel {
   std::queue<T> queue_;
   mutable std::mutex mutex_;
@@ -81,4 +99,130 @@ public:
     return queue_.size();
   }
 };
+
+namespace detail {
+
+// 先自旋，再在 atomic::wait 上休眠。等待方登记后会复查条件，
+// 唤醒方在 seq_cst 屏障后检查登记数，只有确实有人休眠时才进入内核
+class Waiter {
+  static constexpr int kSpinRounds = 128;
+
+  alignas(kCacheLineSize) std::atomic<uint32_t> epoch_{0};
+  std::atomic<uint32_t> sleepers_{0};
+
+public:
+  template <typename Ready> void wait_until(Ready ready) {
+    for (int i = 0; i < kSpinRounds; ++i) {
+      if (ready()) {
+        return;
+      }
+      cpu_relax();
+    }
+    while (true) {
+      const uint32_t epoch = epoch_.load(std::memory_order_acquire);
+      sleepers_.fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst); // 与 notify_*() 的屏障配对
+      if (ready()) {
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        return;
+      }
+      epoch_.wait(epoch, std::memory_order_acquire);
+      sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  void notify_one() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) > 0) {
+      epoch_.fetch_add(1, std::memory_order_release);
+      epoch_.notify_one();
+    }
+  }
+
+  void notify_all() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) > 0) {
+      epoch_.fetch_add(1, std::memory_order_release);
+      epoch_.notify_all();
+    }
+  }
+};
+
+} // namespace detail
+
+// 基于无锁环形队列的有界通道。生产者和消费者分别在“非满”和“非空”上等待，
+// 互相之间不会产生多余的唤醒
+template <typename T, template <typename> class Queue> class RingChannel {
+  Queue<T> queue_;
+  std::atomic<bool> closed_{false};
+  detail::Waiter not_empty_;
+  detail::Waiter not_full_;
+
+public:
+  explicit RingChannel(size_t capacity) : queue_(capacity) {}
+
+  bool send(T value) {
+    bool sent = false;
+    not_full_.wait_until([&] {
+      if (closed_.load(std::memory_order_acquire)) {
+        return true;
+      }
+      sent = queue_.try_push(std::move(value));
+      return sent;
+    });
+    if (sent) {
+      not_empty_.notify_one();
+    }
+    return sent;
+  }
+
+  bool try_send(T value) {
+    if (closed_.load(std::memory_order_acquire) || !queue_.try_push(std::move(value))) {
+      return false;
+    }
+    not_empty_.notify_one();
+    return true;
+  }
+
+  std::optional<T> recv() {
+    std::optional<T> value;
+    not_empty_.wait_until([&] {
+      value = queue_.try_pop();
+      return value.has_value() || closed_.load(std::memory_order_acquire);
+    });
+    if (!value) {
+      // 关闭与最后一次 send 可能交错，再取一次以免丢掉剩余元素
+      value = queue_.try_pop();
+    }
+    if (value) {
+      not_full_.notify_one();
+    }
+    return value;
+  }
+
+  std::optional<T> try_recv() {
+    auto value = queue_.try_pop();
+    if (value) {
+      not_full_.notify_one();
+    }
+    return value;
+  }
+
+  void close() {
+    closed_.store(true, std::memory_order_release);
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+  size_t size() const { return queue_.size(); }
+
+  size_t capacity() const { return queue_.capacity(); }
+};
+
+// 多生产者多消费者
+template <typename T> using BoundedChannel = RingChannel<T, MpmcQueue>;
+
+// 仅限一个生产者线程和一个消费者线程
+template <typename T> using SpscChannel = RingChannel<T, SpscQueue>;
+
 } // namespace threadpool
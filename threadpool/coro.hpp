@@ -0,0 +1,215 @@
+#pragma once
+#include "task.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace threadpool::coro {
+
+template <typename T = void> class Task;
+
+namespace detail {
+
+// 协程帧从 BlockCache 分配，与任务节点共用线程本地缓存
+struct FrameAllocation {
+  static void *operator new(size_t size) { return BlockCache::allocate(size); }
+  static void operator delete(void *p, size_t size) noexcept { BlockCache::deallocate(p, size); }
+};
+
+// 任务与等待者之间的交接：双方各自把 handoff 置位，后到的一方负责继续执行等待者。
+// 同步完成的任务因此不需要恢复等待者，连续的 co_await 不会增加调用栈深度
+// （GCC 在 -O0 下不保证对称转移是尾调用，所以不依赖它）
+struct FinalAwaiter {
+  bool await_ready() const noexcept { return false; }
+
+  template <typename Promise> void await_suspend(std::coroutine_handle<Promise> h) const noexcept {
+    auto &promise = h.promise();
+    if (promise.handoff.exchange(true, std::memory_order_acq_rel)) {
+      promise.continuation.resume();
+    }
+  }
+
+  void await_resume() const noexcept {}
+};
+
+struct PromiseBase : FrameAllocation {
+  std::coroutine_handle<> continuation;
+  std::exception_ptr exception;
+  std::atomic<bool> handoff{false};
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+  void rethrow_if_failed() const {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+};
+
+template <typename T> struct Promise : PromiseBase {
+  std::optional<T> value;
+
+  Task<T> get_return_object() noexcept;
+
+  template <typename U = T> void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+
+  T result() {
+    rethrow_if_failed();
+    return std::move(*value);
+  }
+};
+
+template <> struct Promise<void> : PromiseBase {
+  Task<void> get_return_object() noexcept;
+
+  void return_void() const noexcept {}
+
+  void result() const { rethrow_if_failed(); }
+};
+
+// 即发即弃的协程外壳：创建后立即运行，结束时自行销毁帧
+struct Detached {
+  struct promise_type : FrameAllocation {
+    Detached get_return_object() const noexcept { return {}; }
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept { std::terminate(); }
+  };
+};
+
+} // namespace detail
+
+// 惰性协程任务：创建时不执行，被 co_await 或交给 start()/sync_wait() 时才开始。
+// 返回值或异常保存在协程帧里，co_await 时取出（异常原样重新抛出）。只能移动
+template <typename T> class [[nodiscard]] Task {
+public:
+  using promise_type = detail::Promise<T>;
+  using value_type = T;
+
+private:
+  std::coroutine_handle<promise_type> handle_;
+
+  // 只等待完成、不取结果，供 start()/sync_wait() 使用
+  struct ReadyAwaiter {
+    std::coroutine_handle<promise_type> handle;
+
+    bool await_ready() const noexcept { return !handle || handle.done(); }
+
+    // 返回 false 表示任务已在 resume() 内同步完成，等待者直接继续
+    bool await_suspend(std::coroutine_handle<> awaiting) const noexcept {
+      auto &promise = handle.promise();
+      promise.continuation = awaiting;
+      handle.resume();
+      return !promise.handoff.exchange(true, std::memory_order_acq_rel);
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  struct Awaiter : ReadyAwaiter {
+    T await_resume() const { return this->handle.promise().result(); }
+  };
+
+public:
+  Task() = default;
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+  Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      reset();
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+
+  ~Task() { reset(); }
+
+  Awaiter operator co_await() && noexcept { return Awaiter{{handle_}}; }
+
+  [[nodiscard]] ReadyAwaiter when_ready() noexcept { return ReadyAwaiter{handle_}; }
+
+  // 仅在完成后调用：取出返回值或重新抛出异常
+  T result() && { return handle_.promise().result(); }
+
+  [[nodiscard]] bool done() const { return !handle_ || handle_.done(); }
+  explicit operator bool() const { return static_cast<bool>(handle_); }
+
+private:
+  void reset() noexcept {
+    if (handle_) {
+      handle_.destroy();
+      handle_ = {};
+    }
+  }
+};
+
+namespace detail {
+
+template <typename T> Task<T> Promise<T>::get_return_object() noexcept {
+  return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+  return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+// 与 ThreadPool 的约定相同：返回 TaskResult<U> 时原样传递，异常转为错误信息
+template <typename T> auto to_result(Task<T> &task) {
+  using Value = unwrap_task_result_t<T>;
+  try {
+    if constexpr (std::is_void_v<T>) {
+      std::move(task).result();
+      return TaskResult<Value>{};
+    } else {
+      return TaskResult<Value>(std::move(task).result());
+    }
+  } catch (const std::exception &e) {
+    return TaskResult<Value>(std::unexpected(e.what()));
+  } catch (...) {
+    return TaskResult<Value>(std::unexpected("Unknown error"));
+  }
+}
+
+} // namespace detail
+
+// 在当前线程启动 task，完成时（可能在另一个线程上）调用 on_done(TaskResult)。
+// task 的帧在 on_done 返回后释放；on_done 不应抛出异常
+template <typename T, typename F> void start(Task<T> task, F on_done) {
+  [](Task<T> t, F done) -> detail::Detached {
+    co_await t.when_ready();
+    done(detail::to_result(t));
+  }(std::move(task), std::move(on_done));
+}
+
+// 阻塞当前线程直到 task 完成，返回结果或重新抛出异常。
+// 不要在 task 需要的 worker 或 event loop 线程上调用，否则会死锁
+template <typename T> T sync_wait(Task<T> task) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool finished = false;
+
+  [](Task<T> &t, std::mutex &m, std::condition_variable &c, bool &f) -> detail::Detached {
+    co_await t.when_ready();
+    std::lock_guard lock(m);
+    f = true;
+    c.notify_one(); // 持锁通知：等待方拿到锁之前这些对象都还存活
+  }(task, mutex, cv, finished);
+
+  std::unique_lock lock(mutex);
+  cv.wait(lock, [&] { return finished; });
+  return std::move(task).result();
+}
+
+} // namespace threadpool::coro
@@ -0,0 +1,117 @@
+#pragma once
+#include "cacheline.hpp"
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace threadpool {
+
+// Chase–Lev 工作窃取双端队列（按 Lê 等人 2013 年的 C11 内存模型版本实现）。
+// 所有者线程在底部 push/pop（LIFO，缓存友好），其他线程从顶部 steal（FIFO）。
+// 元素需可平凡复制，线程池中存放的是任务指针
+template <typename T> class WorkStealingDeque {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  struct Array {
+    int64_t capacity;
+    std::unique_ptr<std::atomic<T>[]> slots;
+
+    explicit Array(int64_t cap) : capacity(cap), slots(new std::atomic<T>[cap]) {}
+
+    T load(int64_t i) const { return slots[i & (capacity - 1)].load(std::memory_order_relaxed); }
+
+    void store(int64_t i, T value) {
+      slots[i & (capacity - 1)].store(value, std::memory_order_relaxed);
+    }
+  };
+
+  alignas(kCacheLineSize) std::atomic<int64_t> top_{0};
+  alignas(kCacheLineSize) std::atomic<int64_t> bottom_{0};
+  alignas(kCacheLineSize) std::atomic<Array *> array_;
+  // 扩容后的旧数组可能仍被窃取者读取，析构前不释放；只有所有者线程访问
+  std::vector<std::unique_ptr<Array>> retired_;
+
+public:
+  explicit WorkStealingDeque(int64_t capacity = 256)
+      : array_(new Array(static_cast<int64_t>(std::bit_ceil(static_cast<uint64_t>(capacity))))) {}
+
+  ~WorkStealingDeque() { delete array_.load(std::memory_order_relaxed); }
+
+  WorkStealingDeque(const WorkStealingDeque &) = delete;
+  WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+  // 仅所有者线程调用；满时扩容为两倍
+  void push(T value) {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_acquire);
+    Array *a = array_.load(std::memory_order_relaxed);
+    if (b - t > a->capacity - 1) {
+      auto grown = std::make_unique<Array>(a->capacity * 2);
+      for (int64_t i = t; i < b; ++i) {
+        grown->store(i, a->load(i));
+      }
+      retired_.emplace_back(a);
+      a = grown.release();
+      array_.store(a, std::memory_order_release);
+    }
+    a->store(b, value);
+    // 用 release 存储代替独立的 release 屏障：x86 上同样没有额外开销，且 TSan 能识别
+    bottom_.store(b + 1, std::memory_order_release);
+  }
+
+  // 仅所有者线程调用
+  std::optional<T> pop() {
+    const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Array *a = array_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+    T value = a->load(b);
+    if (t == b) {
+      // 只剩最后一个元素：与窃取者竞争
+      const bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      if (!won) {
+        return std::nullopt;
+      }
+    }
+    return value;
+  }
+
+  // 任意线程调用；与其他窃取者或所有者竞争失败时返回空
+  std::optional<T> steal() {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+      return std::nullopt;
+    }
+    Array *a = array_.load(std::memory_order_acquire);
+    T value = a->load(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  [[nodiscard]] size_t size() const {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_relaxed);
+    return b > t ? static_cast<size_t>(b - t) : 0;
+  }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+};
+
+} // namespace threadpool
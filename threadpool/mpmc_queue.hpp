@@ -0,0 +1,106 @@
+#pragma once
+#include "cacheline.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace threadpool {
+
+// 有界无锁多生产者多消费者环形队列（Dmitry Vyukov 的算法）。
+// 每个槽位带一个序号：序号等于入队位置表示空闲，等于位置 + 1 表示已写入，
+// 生产者和消费者只在各自的位置计数器上竞争 CAS，不共享锁
+template <typename T> class MpmcQueue {
+  struct Cell {
+    std::atomic<size_t> sequence;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T *value() { return std::launder(reinterpret_cast<T *>(storage)); }
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  alignas(kCacheLineSize) std::atomic<size_t> enqueue_pos_{0};
+  alignas(kCacheLineSize) std::atomic<size_t> dequeue_pos_{0};
+
+public:
+  // 容量向上取整为 2 的幂
+  explicit MpmcQueue(size_t capacity)
+      : cells_(new Cell[std::bit_ceil(std::max<size_t>(capacity, 2))]),
+        mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1) {
+    for (size_t i = 0; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MpmcQueue() {
+    while (try_pop()) {
+    }
+  }
+
+  MpmcQueue(const MpmcQueue &) = delete;
+  MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+  // 队列满时返回 false，value 保持不变
+  template <typename U> bool try_push(U &&value) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const size_t seq = cell->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    ::new (cell->storage) T(std::forward<U>(value));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::optional<T> try_pop() {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const size_t seq = cell->sequence.load(std::memory_order_acquire);
+      const auto diff =
+          static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return std::nullopt;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    std::optional<T> result(std::move(*cell->value()));
+    cell->value()->~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return result;
+  }
+
+  // 并发修改时只是近似值
+  [[nodiscard]] size_t size() const {
+    const size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+    const size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+  [[nodiscard]] size_t capacity() const { return mask_ + 1; }
+};
+
+} // namespace threadpool
@@ -1,121 +1,581 @@
 #pragma once
-#include "channel.hpp"
+#include "../metrics/metrics.hpp"
+#include "deque.hpp"
+#include "mpmc_queue.hpp"
 #include "task.hpp"
+#include "topology.hpp"
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <coroutine>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <span>
 #include <thread>
 #include <vector>
-#include <atomic>
 
 namespace threadpool {
 
-// 检测类型是否已经是 TaskResult<T>
-template <typename T>
-struct is_task_result : std::false_type {};
+// 调用 f 并把返回值或异常统一转换为 TaskResult
+template <typename RawReturnType, typename F, typename... Args>
+TaskResult<unwrap_task_result_t<RawReturnType>> invoke_catching(F &f, Args &&...args) {
+  try {
+    if constexpr (std::is_void_v<RawReturnType>) {
+      std::invoke(f, std::forward<Args>(args)...);
+      return {};
+    } else {
+      // F 返回 TaskResult<T> 时原样返回，返回普通类型 T 时包装为 TaskResult<T>
+      return std::invoke(f, std::forward<Args>(args)...);
+    }
+  } catch (const std::exception &e) {
+    return std::unexpected(e.what());
+  } catch (...) {
+    return std::unexpected("Unknown error");
+  }
+}
 
-template <typename T>
-struct is_task_result<TaskResult<T>> : std::true_type {
-  using value_type = T;
-};
+// 工作窃取线程池：每个 worker 有自己的 Chase–Lev 双端队列，外部线程提交的任务
+// 进入无锁的注入队列；worker 内部提交的子任务直接压入本地队列。
+// 空闲 worker 先自旋窃取，再通过 atomic::wait 休眠，提交方只在有休眠者时才唤醒
+class ThreadPool {
+  struct alignas(kCacheLineSize) Worker {
+    WorkStealingDeque<TaskNode *> deque;
+    uint64_t rng_state;
+  };
 
-template <typename T>
-inline constexpr bool is_task_result_v = is_task_result<T>::value;
+  struct CurrentWorker {
+    const ThreadPool *pool = nullptr;
+    size_t index = 0;
+  };
 
-template <typename T>
-struct unwrap_task_result {
-  using type = T;
-};
+  static constexpr int kSpinRounds = 64;
+  static constexpr size_t kRecycledNodes = 1024;
 
-template <typename T>
-struct unwrap_task_result<TaskResult<T>> {
-  using type = T;
-};
+  std::vector<std::unique_ptr<Worker>> slots_;
+  MpmcQueue<TaskNode *> injector_;
+  // 执行完的节点内存在这里回收给任意线程的下一次提交；只有它满了才真正释放
+  MpmcQueue<void *> free_nodes_;
+  std::atomic<bool> running_{true};
+  alignas(kCacheLineSize) std::atomic<uint32_t> wake_epoch_{0};
+  alignas(kCacheLineSize) std::atomic<uint32_t> sleepers_{0};
+  std::atomic<size_t> starting_{0};
+  // instrument() 之后才非空；在任何任务提交前设置，入队时的同步让 worker 看到它们
+  metrics::Histogram *wait_time_ = nullptr;
+  metrics::Histogram *run_time_ = nullptr;
+  metrics::Registration pending_metric_;
+  std::vector<std::jthread> workers_;
 
-template <typename T>
-using unwrap_task_result_t = typename unwrap_task_result<T>::type;
+  static CurrentWorker &current() {
+    thread_local CurrentWorker worker;
+    return worker;
+  }
 
-class ThreadPool {
-  std::vector<std::jthread> workers_;
-  Channel<AnyTask> task_channel_;
-  std::atomic<bool> running_{true};
+  // worker 在自己的线程上创建 Worker 槽位（绑定 CPU 之后，内存落在本地节点），
+  // 全部就绪前任何 worker 都不开始窃取
+  ThreadPool(size_t num_threads, std::span<const CpuTopology::Cpu> cpus, size_t max_queue_size)
+      : injector_(max_queue_size), free_nodes_(kRecycledNodes) {
+    num_threads = std::max<size_t>(num_threads, 1);
+    slots_.resize(num_threads);
+    starting_.store(num_threads, std::memory_order_relaxed);
+
+    workers_.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+      std::optional<CpuTopology::Cpu> cpu;
+      if (!cpus.empty()) {
+        cpu = cpus[i % cpus.size()];
+      }
+      workers_.emplace_back([this, i, cpu] {
+        if (cpu) {
+          bind_current_thread(*cpu);
+        }
+        slots_[i] = std::make_unique<Worker>();
+        slots_[i]->rng_state = 0x9E3779B97F4A7C15ull * (i + 1);
+        if (starting_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          starting_.notify_all();
+        }
+        wait_started();
+        worker_loop(i);
+      });
+    }
+    wait_started();
+  }
+
+  void wait_started() const {
+    for (size_t n = starting_.load(std::memory_order_acquire); n != 0;
+         n = starting_.load(std::memory_order_acquire)) {
+      starting_.wait(n, std::memory_order_acquire);
+    }
+  }
 
 public:
+  // max_queue_size 是注入队列的容量（向上取整为 2 的幂），队列满时 submit 会等待
   explicit ThreadPool(size_t num_threads, size_t max_queue_size = 10000)
-      : task_channel_(max_queue_size) {
+      : ThreadPool(num_threads, {}, max_queue_size) {}
 
-    workers_.reserve(num_threads);
+  // 每个 CPU 一个 worker：worker 绑定到该 CPU，并优先从所在 NUMA 节点分配内存，
+  // 包括它的任务队列和线程本地的块缓存
+  explicit ThreadPool(std::span<const CpuTopology::Cpu> cpus, size_t max_queue_size = 10000)
+      : ThreadPool(cpus.size(), cpus, max_queue_size) {}
 
-    for (size_t i = 0; i < num_threads; ++i) {
-      workers_.emplace_back(
-          [this](std::stop_token stoken) { worker_loop(stoken); });
+  // 等待 worker 退出后，在析构线程上执行仍未被取走的任务，保证每个 future 都有结果
+  ~ThreadPool() {
+    pending_metric_.reset();
+    shutdown();
+    workers_.clear();
+    while (auto raw = injector_.try_pop()) {
+      run_node(*raw);
+    }
+    for (auto &slot : slots_) {
+      while (auto raw = slot->deque.pop()) {
+        run_node(*raw);
+      }
+    }
+    while (auto block = free_nodes_.try_pop()) {
+      BlockCache::deallocate(*block, sizeof(TaskNode));
     }
   }
 
-  ~ThreadPool() { shutdown(); }
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
 
+  // 任务节点循环复用，promise 共享状态来自线程本地缓存，小的可调用对象内联存放在节点里，
+  // 稳态下提交不调用 malloc
   template <typename F, typename... Args>
   [[nodiscard]] auto submit(F &&f, Args &&...args)
       -> std::future<TaskResult<unwrap_task_result_t<std::invoke_result_t<F, Args...>>>> {
-    using RawReturnType = std::invoke_result_t<F, Args...>;
-    using UnwrappedType = unwrap_task_result_t<RawReturnType>;
+    using UnwrappedType = unwrap_task_result_t<std::invoke_result_t<F, Args...>>;
+    auto [node, future] = package(std::forward<F>(f), std::forward<Args>(args)...);
+    if (!schedule(node)) {
+      free_node(node);
+      return shut_down_future<UnwrappedType>();
+    }
+    return std::move(future);
+  }
 
-    Task<UnwrappedType> bound_task = [f = std::forward<F>(f),
-                       ... args = std::forward<Args>(
-                           args)]() mutable -> TaskResult<UnwrappedType> {
-      try {
-        if constexpr (std::is_void_v<RawReturnType>) {
-          std::invoke(f, std::move(args)...);
-          return {};
-        } else if constexpr (is_task_result_v<RawReturnType>) {
-          // F 已经返回 TaskResult<T>，直接返回
-          return std::invoke(f, std::move(args)...);
-        } else {
-          // F 返回普通类型 T，包装为 TaskResult<T>
-          return std::invoke(f, std::move(args)...);
+  // 一次提交一组无参任务：全部入队后只唤醒一次。结果顺序与 tasks 一致
+  template <std::ranges::input_range R>
+  [[nodiscard]] auto submit_batch(R &&tasks) {
+    using Fn = std::ranges::range_reference_t<R>;
+    using Value = unwrap_task_result_t<std::invoke_result_t<Fn>>;
+
+    std::vector<std::future<TaskResult<Value>>> futures;
+    std::vector<TaskNode *> nodes;
+    if constexpr (std::ranges::sized_range<R>) {
+      futures.reserve(std::ranges::size(tasks));
+      nodes.reserve(std::ranges::size(tasks));
+    }
+    for (auto &&task : tasks) {
+      auto [node, future] = package(std::forward<decltype(task)>(task));
+      nodes.push_back(node);
+      futures.push_back(std::move(future));
+    }
+
+    const size_t scheduled = schedule_batch(nodes);
+    for (size_t i = scheduled; i < nodes.size(); ++i) {
+      free_node(nodes[i]);
+      futures[i] = shut_down_future<Value>();
+    }
+    return futures;
+  }
+
+  // 把 [begin, end) 按 grain 切块并行执行 f(i)，阻塞到全部完成，返回第一个错误。
+  // 调用线程自己也领取分块执行，因此在 worker 内部调用也不会死锁；grain 为 0 时自动选择。
+  // f 可以返回 void、TaskResult<void> 或其他值（忽略）；出错后尚未开始的分块会被跳过
+  template <std::integral I, typename F>
+  TaskResult<void> parallel_for(I begin, I end, size_t grain, F &&f) {
+    if (end <= begin) {
+      return {};
+    }
+    const auto count = static_cast<size_t>(end - begin);
+    if (grain == 0) {
+      grain = std::max<size_t>(1, count / (slots_.size() * 4));
+    }
+
+    struct State {
+      I begin;
+      size_t count;
+      size_t grain;
+      size_t chunks;
+      std::decay_t<F> f;
+      std::atomic<size_t> next{0};
+      std::atomic<size_t> done{0};
+      std::atomic<bool> failed{false};
+      std::mutex error_mutex;
+      std::string error;
+
+      void fail(std::string message) {
+        std::lock_guard lock(error_mutex);
+        if (!failed.exchange(true)) {
+          error = std::move(message);
+        }
+      }
+
+      // 领取分块直到取完；每个分块无论执行与否都计入 done
+      void run() {
+        size_t chunk;
+        while ((chunk = next.fetch_add(1, std::memory_order_relaxed)) < chunks) {
+          if (!failed.load(std::memory_order_relaxed)) {
+            const size_t first = chunk * grain;
+            const size_t last = std::min(count, first + grain);
+            for (size_t i = first; i < last && !failed.load(std::memory_order_relaxed); ++i) {
+              using Ret = std::invoke_result_t<std::decay_t<F> &, I>;
+              auto result = invoke_catching<Ret>(f, static_cast<I>(begin + static_cast<I>(i)));
+              if (!result) {
+                fail(std::move(result.error()));
+              }
+            }
+          }
+          if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == chunks) {
+            done.notify_all();
+          }
         }
-      } catch (const std::exception &e) {
-        return std::unexpected(e.what());
-      } catch (...) {
-        return std::unexpected("Unknown error");
       }
     };
 
-    std::promise<TaskResult<UnwrappedType>> promise;
-    auto future = promise.get_future();
+    const size_t chunks = (count + grain - 1) / grain;
+    auto state = std::allocate_shared<State>(PoolAllocator<State>{}, begin, count, grain, chunks,
+                                             std::forward<F>(f));
+
+    // 分块比 worker 多时才需要帮手；帮手持有 state，晚启动的帮手只会发现没有剩余分块
+    const size_t helpers = std::min(chunks, slots_.size() + 1) - 1;
+    std::vector<TaskNode *> nodes;
+    nodes.reserve(helpers);
+    for (size_t i = 0; i < helpers; ++i) {
+      nodes.push_back(new_node([state] { state->run(); }));
+    }
+    const size_t scheduled = schedule_batch(nodes);
+    for (size_t i = scheduled; i < nodes.size(); ++i) {
+      free_node(nodes[i]);
+    }
 
-    auto any_task = AnyTask::create(std::move(bound_task), std::move(promise));
+    state->run();
+    for (size_t done = state->done.load(std::memory_order_acquire); done < chunks;
+         done = state->done.load(std::memory_order_acquire)) {
+      state->done.wait(done, std::memory_order_acquire);
+    }
 
-    if (!task_channel_.send(std::move(any_task))) {
-      std::promise<TaskResult<UnwrappedType>> error_promise;
-      error_promise.set_value(std::unexpected("Thread pool shut down"));
-      return error_promise.get_future();
+    if (state->failed.load(std::memory_order_acquire)) {
+      std::lock_guard lock(state->error_mutex);
+      return std::unexpected(state->error);
     }
+    return {};
+  }
+
+  // 对随机访问区间的每个元素并行调用 f，结果按原顺序放入 vector。
+  // f 返回 TaskResult<U> 时结果类型为 U，任何一个错误都会使整体失败
+  template <std::ranges::random_access_range R, typename F>
+  auto parallel_map(const R &input, F &&f, size_t grain = 0)
+      -> TaskResult<std::vector<
+          unwrap_task_result_t<std::invoke_result_t<F &, std::ranges::range_reference_t<const R>>>>> {
+    using Raw = std::invoke_result_t<F &, std::ranges::range_reference_t<const R>>;
+    using Value = unwrap_task_result_t<Raw>;
+    static_assert(std::default_initializable<Value>, "parallel_map 的结果类型需要可默认构造");
+
+    const auto n = static_cast<size_t>(std::ranges::size(input));
+    std::vector<Value> output(n);
+    auto first = std::ranges::begin(input);
 
-    return future;
+    auto status = parallel_for(size_t{0}, n, grain, [&](size_t i) -> TaskResult<void> {
+      if constexpr (is_task_result_v<Raw>) {
+        auto result = std::invoke(f, first[i]);
+        if (!result) {
+          return std::unexpected(std::move(result.error()));
+        }
+        output[i] = std::move(*result);
+      } else {
+        output[i] = std::invoke(f, first[i]);
+      }
+      return {};
+    });
+    if (!status) {
+      return std::unexpected(std::move(status.error()));
+    }
+    return output;
   }
 
+  // 不需要结果的任务：不创建 future，异常被吞掉。线程池已关闭时返回 false
+  template <typename F, typename... Args> bool post(F &&f, Args &&...args) {
+    auto *node = new_node(
+        [f = std::forward<F>(f), ... args = std::forward<Args>(args)]() mutable {
+          try {
+            std::invoke(f, std::move(args)...);
+          } catch (...) {
+          }
+        });
+
+    if (!schedule(node)) {
+      free_node(node);
+      return false;
+    }
+    return true;
+  }
+
+  // co_await pool.schedule()：挂起当前协程，由某个 worker 恢复执行。
+  // 线程池已关闭时不挂起，协程在当前线程继续
+  class ScheduleAwaiter {
+    ThreadPool &pool_;
+
+  public:
+    explicit ScheduleAwaiter(ThreadPool &pool) : pool_(pool) {}
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> h) { return pool_.post([h] { h.resume(); }); }
+    void await_resume() const noexcept {}
+  };
+
+  [[nodiscard]] ScheduleAwaiter schedule() { return ScheduleAwaiter(*this); }
+
+  // 停止接收新任务；已提交的任务仍会执行完
   void shutdown() {
     if (running_.exchange(false)) {
-      task_channel_.close();
+      wake_epoch_.fetch_add(1, std::memory_order_seq_cst);
+      wake_epoch_.notify_all();
+    }
+  }
 
-      for (auto &worker : workers_) {
-        worker.request_stop();
-      }
+  size_t pending_tasks() const {
+    size_t pending = injector_.size();
+    for (const auto &slot : slots_) {
+      pending += slot->deque.size();
     }
+    return pending;
   }
 
-  size_t pending_tasks() const { return task_channel_.size(); }
+  [[nodiscard]] size_t size() const { return slots_.size(); }
+
+  // 在 registry 中登记任务的排队时间、执行时间和 pending_tasks()，标签 pool="name"。
+  // 必须在提交任何任务之前调用，registry 必须比线程池活得长
+  void instrument(metrics::Registry &registry, std::string_view name = "default") {
+    wait_time_ = &registry.histogram("threadpool_task_wait_seconds",
+                                     "Time tasks spend queued before a worker picks them up",
+                                     {{"pool", name}});
+    run_time_ = &registry.histogram("threadpool_task_run_seconds", "Time tasks spend running",
+                                    {{"pool", name}});
+    pending_metric_ = registry.callback(
+        "threadpool_pending_tasks", "Tasks queued but not yet started", metrics::Registry::Type::Gauge,
+        [this] { return static_cast<double>(pending_tasks()); }, {{"pool", name}});
+  }
 
 private:
-  void worker_loop(std::stop_token stoken) {
-    while (!stoken.stop_requested()) {
-      auto task = task_channel_.recv();
+  // 把调用和它的 promise 打包进一个任务节点
+  template <typename F, typename... Args> auto package(F &&f, Args &&...args) {
+    using RawReturnType = std::invoke_result_t<F, Args...>;
+    using UnwrappedType = unwrap_task_result_t<RawReturnType>;
 
-      if (!task) {
-        break;
+    auto promise = make_promise<TaskResult<UnwrappedType>>();
+    auto future = promise.get_future();
+
+    auto *node = new_node(
+        [f = std::forward<F>(f), ... args = std::forward<Args>(args),
+         promise = std::move(promise)]() mutable {
+          promise.set_value(invoke_catching<RawReturnType>(f, std::move(args)...));
+        });
+    return std::pair{node, std::move(future)};
+  }
+
+  template <typename T> static std::future<TaskResult<T>> shut_down_future() {
+    auto promise = make_promise<TaskResult<T>>();
+    promise.set_value(std::unexpected("Thread pool shut down"));
+    return promise.get_future();
+  }
+
+  template <typename F> TaskNode *new_node(F &&f) {
+    void *block = free_nodes_.try_pop().value_or(nullptr);
+    if (block == nullptr) {
+      block = BlockCache::allocate(sizeof(TaskNode));
+    }
+    try {
+      return ::new (block) TaskNode(std::forward<F>(f));
+    } catch (...) {
+      BlockCache::deallocate(block, sizeof(TaskNode));
+      throw;
+    }
+  }
+
+  void free_node(TaskNode *node) noexcept {
+    node->~TaskNode();
+    if (!free_nodes_.try_push(static_cast<void *>(node))) {
+      BlockCache::deallocate(node, sizeof(TaskNode));
+    }
+  }
+
+  // 任务自身负责处理异常，这里只保证节点被回收
+  void run_node(TaskNode *node) {
+    struct Recycle {
+      ThreadPool *pool;
+      TaskNode *node;
+      ~Recycle() { pool->free_node(node); }
+    } recycle{this, node};
+    if (run_time_ == nullptr) {
+      (*node)();
+      return;
+    }
+    const int64_t start = metrics::now_ns();
+    wait_time_->observe(static_cast<uint64_t>(std::max<int64_t>(start - node->enqueued_ns, 0)));
+    (*node)();
+    run_time_->observe_since(start);
+  }
+
+  // 池内线程压入自己的本地队列，外部线程进入注入队列；返回 false 时节点仍归调用方所有
+  bool schedule(TaskNode *node) {
+    if (!running_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    if (wait_time_ != nullptr) {
+      node->enqueued_ns = metrics::now_ns();
+    }
+    const auto &self = current();
+    if (self.pool == this) {
+      slots_[self.index]->deque.push(node);
+    } else {
+      while (!injector_.try_push(node)) {
+        if (!running_.load(std::memory_order_acquire)) {
+          return false;
+        }
+        std::this_thread::yield();
+      }
+    }
+    wake_one();
+    return true;
+  }
+
+  // 返回成功入队的前缀长度，其余节点仍归调用方所有
+  size_t schedule_batch(std::span<TaskNode *const> nodes) {
+    if (nodes.empty() || !running_.load(std::memory_order_acquire)) {
+      return 0;
+    }
+    if (wait_time_ != nullptr) {
+      const int64_t now = metrics::now_ns();
+      for (auto *node : nodes) {
+        node->enqueued_ns = now;
+      }
+    }
+    const auto &self = current();
+    size_t pushed = 0;
+    if (self.pool == this) {
+      for (auto *node : nodes) {
+        slots_[self.index]->deque.push(node);
+      }
+      pushed = nodes.size();
+    } else {
+      for (auto *node : nodes) {
+        while (!injector_.try_push(node)) {
+          // 注入队列满：先唤醒 worker 消费，再等待
+          wake_all();
+          if (!running_.load(std::memory_order_acquire)) {
+            return pushed;
+          }
+          std::this_thread::yield();
+        }
+        ++pushed;
+      }
+    }
+    if (pushed == 1) {
+      wake_one();
+    } else {
+      wake_all();
+    }
+    return pushed;
+  }
+
+  // 与 park() 配对：任务入队后的 seq_cst 屏障保证，要么这里看到休眠者并唤醒，
+  // 要么休眠者在登记之后的复查中看到这个任务
+  void wake_one() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) > 0) {
+      wake_epoch_.fetch_add(1, std::memory_order_release);
+      wake_epoch_.notify_one();
+    }
+  }
+
+  void wake_all() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) > 0) {
+      wake_epoch_.fetch_add(1, std::memory_order_release);
+      wake_epoch_.notify_all();
+    }
+  }
+
+  std::optional<TaskNode *> find_task(size_t index) {
+    auto &self = *slots_[index];
+    if (auto raw = self.deque.pop()) {
+      return raw;
+    }
+    if (auto raw = injector_.try_pop()) {
+      return raw;
+    }
+
+    // xorshift 选择起始受害者，避免所有空闲 worker 同时窃取同一个队列
+    self.rng_state ^= self.rng_state << 13;
+    self.rng_state ^= self.rng_state >> 7;
+    self.rng_state ^= self.rng_state << 17;
+    const size_t n = slots_.size();
+    const size_t start = static_cast<size_t>(self.rng_state % n);
+    for (size_t i = 0; i < n; ++i) {
+      const size_t victim = (start + i) % n;
+      if (victim == index) {
+        continue;
+      }
+      if (auto raw = slots_[victim]->deque.steal()) {
+        return raw;
+      }
+    }
+    return std::nullopt;
+  }
+
+  [[nodiscard]] bool has_work() const {
+    if (!injector_.empty()) {
+      return true;
+    }
+    for (const auto &slot : slots_) {
+      if (!slot->deque.empty()) {
+        return true;
       }
+    }
+    return false;
+  }
 
-      task->execute();
+  // 返回 false 表示线程池已关闭且没有剩余任务
+  bool park() {
+    const uint32_t epoch = wake_epoch_.load(std::memory_order_acquire);
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    // 与 wake_one()/wake_all() 的屏障配对；has_work() 里是 relaxed/acquire 读，单靠 fetch_add 不够
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (has_work()) {
+      sleepers_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+    if (!running_.load(std::memory_order_seq_cst)) {
+      sleepers_.fetch_sub(1, std::memory_order_relaxed);
+      return false;
     }
+    wake_epoch_.wait(epoch, std::memory_order_acquire);
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  void worker_loop(size_t index) {
+    current() = CurrentWorker{this, index};
+
+    while (true) {
+      std::optional<TaskNode *> raw;
+      for (int spin = 0; spin < kSpinRounds && !raw; ++spin) {
+        raw = find_task(index);
+        if (!raw) {
+          cpu_relax();
+        }
+      }
+
+      if (raw) {
+        run_node(*raw);
+      } else if (!park()) {
+        break;
+      }
+    }
+
+    current() = CurrentWorker{};
   }
 };
 } // namespace threadpool
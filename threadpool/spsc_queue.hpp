@@ -0,0 +1,85 @@
+#pragma once
+#include "cacheline.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace threadpool {
+
+// 有界无锁单生产者单消费者环形队列。head/tail 各占一条缓存行，
+// 双方各自缓存对方的位置，只有缓存值显示满/空时才读取对方的原子变量
+template <typename T> class SpscQueue {
+  struct Slot {
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T *value() { return std::launder(reinterpret_cast<T *>(storage)); }
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0}; // 消费者写
+  alignas(kCacheLineSize) size_t cached_tail_ = 0;      // 仅消费者访问
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0}; // 生产者写
+  alignas(kCacheLineSize) size_t cached_head_ = 0;      // 仅生产者访问
+
+public:
+  // 容量向上取整为 2 的幂
+  explicit SpscQueue(size_t capacity)
+      : slots_(new Slot[std::bit_ceil(std::max<size_t>(capacity, 2))]),
+        mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1) {}
+
+  ~SpscQueue() {
+    while (try_pop()) {
+    }
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // 仅生产者调用；队列满时返回 false，value 保持不变
+  template <typename U> bool try_push(U &&value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ > mask_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ > mask_) {
+        return false;
+      }
+    }
+    ::new (slots_[tail & mask_].storage) T(std::forward<U>(value));
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 仅消费者调用
+  std::optional<T> try_pop() {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return std::nullopt;
+      }
+    }
+    auto &slot = slots_[head & mask_];
+    std::optional<T> result(std::move(*slot.value()));
+    slot.value()->~T();
+    head_.store(head + 1, std::memory_order_release);
+    return result;
+  }
+
+  // 并发修改时只是近似值
+  [[nodiscard]] size_t size() const {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+  [[nodiscard]] size_t capacity() const { return mask_ + 1; }
+};
+
+} // namespace threadpool
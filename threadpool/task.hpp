@@ -1,8 +1,14 @@
 #pragma once
+#include "block_cache.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <expected>
 #include <functional>
 #include <future>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace threadpool {
 
@@ -10,41 +16,144 @@ template <typename T> using TaskResult = std::expected<T, std::string>;
 
 template <typename T> using Task = std::function<TaskResult<T>()>;
 
-class AnyTask {
-  struct TaskBase {
-    virtual ~TaskBase() = default;
-    virtual void execute() = 0;
+// 检测类型是否已经是 TaskResult<T>
+template <typename T>
+struct is_task_result : std::false_type {};
+
+template <typename T>
+struct is_task_result<TaskResult<T>> : std::true_type {
+  using value_type = T;
+};
+
+template <typename T>
+inline constexpr bool is_task_result_v = is_task_result<T>::value;
+
+template <typename T>
+struct unwrap_task_result {
+  using type = T;
+};
+
+template <typename T>
+struct unwrap_task_result<TaskResult<T>> {
+  using type = T;
+};
+
+template <typename T>
+using unwrap_task_result_t = typename unwrap_task_result<T>::type;
+
+// 只能移动的 void() 任务，带小对象缓冲区：能放进 kInlineSize 的可调用对象
+// 直接存放在内联缓冲区里，否则放在 BlockCache 分配的块中。用手写的函数表代替虚函数。
+// 40 字节的缓冲区让 UniqueTask 加上入队时间戳仍是一个 64 字节的 TaskNode，
+// 足够放下 submit() 打包的 promise 和常见的几个捕获
+class UniqueTask {
+public:
+  static constexpr size_t kInlineSize = 40;
+
+private:
+  struct VTable {
+    void (*invoke)(void *);
+    void (*move)(void *dst, void *src) noexcept; // 移动后销毁 src
+    void (*destroy)(void *) noexcept;
   };
-  template <typename T> struct TaskImpl : TaskBase {
-    Task<T> task;
-    std::promise<TaskResult<T>> promise;
 
-    explicit TaskImpl(Task<T> t) : task(std::move(t)) {}
+  template <typename F>
+  static constexpr bool kInline = sizeof(F) <= kInlineSize &&
+                                 alignof(F) <= alignof(std::max_align_t) &&
+                                 std::is_nothrow_move_constructible_v<F>;
+
+  template <typename F> static constexpr VTable inline_vtable = {
+      [](void *p) { (*static_cast<F *>(p))(); },
+      [](void *dst, void *src) noexcept {
+        ::new (dst) F(std::move(*static_cast<F *>(src)));
+        static_cast<F *>(src)->~F();
+      },
+      [](void *p) noexcept { static_cast<F *>(p)->~F(); }};
+
+  template <typename F> static constexpr VTable heap_vtable = {
+      [](void *p) { (**static_cast<F **>(p))(); },
+      [](void *dst, void *src) noexcept { *static_cast<F **>(dst) = *static_cast<F **>(src); },
+      [](void *p) noexcept {
+        F *f = *static_cast<F **>(p);
+        f->~F();
+        BlockCache::deallocate(f, sizeof(F));
+      }};
+
+  alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+  const VTable *vtable_ = nullptr;
 
-    void execute() override {
+public:
+  UniqueTask() = default;
+
+  template <typename F>
+    requires(!std::is_same_v<std::decay_t<F>, UniqueTask> && std::is_invocable_v<std::decay_t<F> &>)
+  UniqueTask(F &&f) { // NOLINT: 允许从 lambda 隐式构造
+    using Fn = std::decay_t<F>;
+    if constexpr (kInline<Fn>) {
+      ::new (storage_) Fn(std::forward<F>(f));
+      vtable_ = &inline_vtable<Fn>;
+    } else {
+      static_assert(alignof(Fn) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+      void *block = BlockCache::allocate(sizeof(Fn));
       try {
-        auto result = task();
-        promise.set_value(std::move(result));
+        *reinterpret_cast<Fn **>(storage_) = ::new (block) Fn(std::forward<F>(f));
       } catch (...) {
-        promise.set_exception(std::current_exception());
+        BlockCache::deallocate(block, sizeof(Fn));
+        throw;
       }
+      vtable_ = &heap_vtable<Fn>;
     }
-  };
-  std::unique_ptr<TaskBase> task_;
+  }
 
-public:
-  template <typename T>
-  static AnyTask create(Task<T> task, std::promise<TaskResult<T>> promise) {
-    AnyTask any_task;
-    auto impl = std::make_unique<TaskImpl<T>>(std::move(task));
-    impl->promise = std::move(promise);
-    any_task.task_ = std::move(impl);
-    return any_task;
+  UniqueTask(UniqueTask &&other) noexcept : vtable_(other.vtable_) {
+    if (vtable_ != nullptr) {
+      vtable_->move(storage_, other.storage_);
+      other.vtable_ = nullptr;
+    }
   }
-  void execute() {
-    if (task_) {
-      task_->execute();
+
+  UniqueTask &operator=(UniqueTask &&other) noexcept {
+    if (this != &other) {
+      reset();
+      if (other.vtable_ != nullptr) {
+        other.vtable_->move(storage_, other.storage_);
+        vtable_ = std::exchange(other.vtable_, nullptr);
+      }
+    }
+    return *this;
+  }
+
+  UniqueTask(const UniqueTask &) = delete;
+  UniqueTask &operator=(const UniqueTask &) = delete;
+
+  ~UniqueTask() { reset(); }
+
+  void operator()() { vtable_->invoke(storage_); }
+
+  explicit operator bool() const { return vtable_ != nullptr; }
+
+  void reset() noexcept {
+    if (vtable_ != nullptr) {
+      vtable_->destroy(storage_);
+      vtable_ = nullptr;
     }
   }
 };
+
+// 线程池队列中传递的任务节点，队列里只存放指针。enqueued_ns 只在线程池接入指标时写入
+struct TaskNode {
+  UniqueTask task;
+  int64_t enqueued_ns = 0;
+
+  template <typename F> explicit TaskNode(F &&f) : task(std::forward<F>(f)) {}
+
+  void operator()() { task(); }
+};
+
+static_assert(sizeof(TaskNode) <= 64);
+
+// promise 的共享状态与结果存储都从 BlockCache 分配
+template <typename T> std::promise<T> make_promise() {
+  return std::promise<T>(std::allocator_arg, PoolAllocator<char>{});
+}
+
 } // namespace threadpool
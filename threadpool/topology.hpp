@@ -0,0 +1,144 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <string_view>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace threadpool {
+
+// 从 sysfs 读取的 CPU 与 NUMA 节点对应关系，只包含当前进程允许运行的 CPU。
+// 内核未启用 NUMA 时所有 CPU 都属于节点 0
+class CpuTopology {
+public:
+  struct Cpu {
+    unsigned id;
+    unsigned node;
+  };
+
+private:
+  std::vector<Cpu> cpus_;
+  unsigned node_count_ = 1;
+
+public:
+  static CpuTopology detect(const std::filesystem::path &sysfs = "/sys/devices/system") {
+    CpuTopology topology;
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool masked = ::sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    std::vector<unsigned> online = read_cpu_list(sysfs / "cpu" / "online");
+    if (online.empty()) {
+      online.resize(std::max(1L, ::sysconf(_SC_NPROCESSORS_ONLN)));
+      for (unsigned i = 0; i < online.size(); ++i) {
+        online[i] = i;
+      }
+    }
+    for (unsigned id : online) {
+      if (!masked || (id < CPU_SETSIZE && CPU_ISSET(id, &allowed))) {
+        topology.cpus_.push_back({id, 0});
+      }
+    }
+
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(sysfs / "node", ec)) {
+      const auto name = entry.path().filename().string();
+      unsigned node = 0;
+      if (!name.starts_with("node") ||
+          std::from_chars(name.data() + 4, name.data() + name.size(), node).ec != std::errc{}) {
+        continue;
+      }
+      topology.node_count_ = std::max(topology.node_count_, node + 1);
+      for (unsigned id : read_cpu_list(entry.path() / "cpulist")) {
+        for (auto &cpu : topology.cpus_) {
+          if (cpu.id == id) {
+            cpu.node = node;
+          }
+        }
+      }
+    }
+    return topology;
+  }
+
+  // 解析 "0-3,8,10-11" 格式的 CPU 列表
+  static std::vector<unsigned> parse_cpu_list(std::string_view list) {
+    std::vector<unsigned> ids;
+    while (!list.empty()) {
+      const auto comma = std::min(list.find(','), list.size());
+      auto item = list.substr(0, comma);
+      list.remove_prefix(std::min(comma + 1, list.size()));
+
+      unsigned first = 0;
+      auto [end, ec] = std::from_chars(item.data(), item.data() + item.size(), first);
+      if (ec != std::errc{}) {
+        continue;
+      }
+      unsigned last = first;
+      if (end != item.data() + item.size() && *end == '-') {
+        std::from_chars(end + 1, item.data() + item.size(), last);
+      }
+      for (unsigned id = first; id <= last; ++id) {
+        ids.push_back(id);
+      }
+    }
+    return ids;
+  }
+
+  [[nodiscard]] const std::vector<Cpu> &cpus() const { return cpus_; }
+  [[nodiscard]] unsigned node_count() const { return node_count_; }
+
+  [[nodiscard]] std::vector<Cpu> cpus_on(unsigned node) const {
+    std::vector<Cpu> result;
+    std::copy_if(cpus_.begin(), cpus_.end(), std::back_inserter(result),
+                 [node](const Cpu &cpu) { return cpu.node == node; });
+    return result;
+  }
+
+private:
+  static std::vector<unsigned> read_cpu_list(const std::filesystem::path &path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return parse_cpu_list(line);
+  }
+};
+
+// 把调用线程绑定到一个 CPU
+inline bool pin_current_thread(unsigned cpu) {
+  if (cpu >= CPU_SETSIZE) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+}
+
+// 调用线程之后的内存分配优先落在 node 上（内存不足时可回退到其他节点）。
+// 直接调用 set_mempolicy，不依赖 libnuma
+inline bool prefer_local_memory(unsigned node) {
+  constexpr unsigned kBits = 8 * sizeof(unsigned long);
+  unsigned long mask[1024 / kBits] = {};
+  if (node >= 1024) {
+    return false;
+  }
+  mask[node / kBits] = 1UL << (node % kBits);
+  return ::syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, 1024UL) == 0;
+}
+
+// 绑定 CPU 并优先使用其所在节点的内存
+inline bool bind_current_thread(const CpuTopology::Cpu &cpu) {
+  const bool pinned = pin_current_thread(cpu.id);
+  const bool local = prefer_local_memory(cpu.node);
+  return pinned && local;
+}
+
+} // namespace threadpool
@@ -0,0 +1,27 @@
+// tools/log_decode.cpp
+// 把 BinaryFileSink 写出的二进制日志转成文本：log_decode server.blog [更多文件...]
+#include "logger/binary.hpp"
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <binary log>...\n";
+    return 2;
+  }
+  int status = 0;
+  for (int i = 1; i < argc; ++i) {
+    std::ifstream in(argv[i], std::ios::binary);
+    if (!in) {
+      std::cerr << argv[i] << ": cannot open\n";
+      status = 1;
+      continue;
+    }
+    logger::BinaryLogDecoder decoder;
+    if (!decoder.decode(in, std::cout)) {
+      std::cerr << argv[i] << ": malformed or truncated log\n";
+      status = 1;
+    }
+  }
+  return status;
+}